@@ -0,0 +1,105 @@
+#-------------------------------------------------
+#
+# Project created by QtCreator 2015-01-18T13:57:36
+#
+#-------------------------------------------------
+
+QT       += core gui concurrent
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = Simple3D
+TEMPLATE = app
+CONFIG += c++11
+
+include(libraries.pri)
+
+
+SOURCES += \
+    asciiStlParser.cpp \
+    boxSize.cpp \
+    decimation.cpp \
+    decompressingDevice.cpp \
+    dimEditDialog.cpp \
+    geometryArray.cpp \
+    geometryCache.cpp \
+    geometryKernels.cpp \
+    loadProgress.cpp \
+    main.cpp \
+    managedPart.cpp \
+    memoryBudget.cpp \
+    meshAdjacency.cpp \
+    meshIntegrity.cpp \
+    normalSmoothing.cpp \
+    openGLWidget.cpp \
+    packer.cpp \
+    packing.cpp \
+    parallelFor.cpp \
+    part.cpp \
+    partFactory.cpp \
+    partMesh.cpp \
+    partObj.cpp \
+    partPly.cpp \
+    partsModel.cpp \
+    partStl.cpp \
+    recentFilesQMenu.cpp \
+    simple3d.cpp \
+    stlBatchReader.cpp \
+    stlBatchWriter.cpp \
+    textParsing.cpp \
+    threeMfWriter.cpp \
+    vertexWelding.cpp \
+    zipWriter.cpp
+
+HEADERS  += \
+    asciiStlParser.h \
+    boxSize.h \
+    decimation.h \
+    decompressingDevice.h \
+    dimEditDialog.h \
+    disjointSets.h \
+    geometryArray.h \
+    geometryCache.h \
+    geometryKernels.h \
+    loadProgress.h \
+    managedPart.h \
+    memoryBudget.h \
+    meshAdjacency.h \
+    meshIntegrity.h \
+    normalSmoothing.h \
+    openGLWidget.h \
+    packedNormal.h \
+    packer.h \
+    packing.h \
+    parallelFor.h \
+    part.h \
+    partFactory.h \
+    partMesh.h \
+    partObj.h \
+    partPly.h \
+    partsModel.h \
+    partStl.h \
+    recentFilesQMenu.h \
+    simple3d.h \
+    stlBatchReader.h \
+    stlBatchWriter.h \
+    textParsing.h \
+    threeMfWriter.h \
+    ui_dimEditDialog.h \
+    ui_simple3d.h \
+    vertexWelding.h \
+    zipWriter.h
+
+RESOURCES += \
+    resources.qrc
+
+FORMS += \
+    dimEditDialog.ui \
+    simple3d.ui
+
+DISTFILES += \
+    lightingFragmentShader.fsh \
+    lightingVertexShader.vsh
+
+win32:RC_ICONS = simple3d.ico
+unix:RC_ICONS = simple3d.png
@@ -0,0 +1,303 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "asciiStlParser.h"
+#include "textParsing.h"
+
+#include <cstring>   // strlen, strncmp
+
+// Constructor.
+AsciiStlParser::AsciiStlParser(const char * begin, const char * end)
+    : m_begin(begin), m_end(end), m_pos(begin), m_hasReachedEnd(false),
+      m_hasReachedEndSolid(false), m_errorPos(nullptr), m_errorMessage()
+{}
+
+
+//=============================================================================
+// The function "parseHeader" parses the first line of the ascii STL text,
+// i.e., the word "solid" followed by an optional name.
+// OUTPUT: The function returns "false" if the line is missing and "true"
+// otherwise.
+//=============================================================================
+bool AsciiStlParser::parseHeader()
+{
+    m_pos = skipBlanks(m_pos, m_end);
+    if (expectKeyword("solid") == false)
+        return false;
+    // The rest of the line is the name of the solid which is of no interest.
+    m_pos = skipLine(m_pos, m_end);
+    return true;
+}
+
+
+//=============================================================================
+// The function "parseFacets" parses facets until a given position, the word
+// "endsolid", the end of the text, or a given number of facets is reached. A
+// facet starting before the given position is always parsed completely.
+// The ascii STL format:
+// solid name
+// facet normal ni nj nk
+//     outer loop
+//         vertex v1x v1y v1z
+//         vertex v2x v2y v2z
+//         vertex v3x v3y v3z
+//     endloop
+// endfacet
+// endsolid name
+// INPUT: "const char * stop" is the position at which to stop parsing facets.
+// "qint64 maxNumFacets" is the maximal number of facets to be parsed, or -1
+// for no limit.
+// OUTPUT: "GeometryArray<QVector3D> & normals" gets the normals of the parsed
+// triangles appended.
+// "GeometryArray<QVector3D> & vertices" gets the vertices of the parsed triangles
+// appended.
+// The function itself returns "false" if any discrepancy is encountered and
+// "true" otherwise.
+//=============================================================================
+bool AsciiStlParser::parseFacets(const char * stop, GeometryArray<QVector3D> & normals,
+                                 GeometryArray<QVector3D> & vertices, qint64 maxNumFacets)
+{
+    const char * limit = qMin(stop, m_end);
+    const qint64 numInitialFacets = normals.size();
+    bool isFirstFacet = true;
+    while ((maxNumFacets < 0) || (normals.size() - numInitialFacets < maxNumFacets))
+    {
+        // Skip white spaces and empty lines.
+        skipWhiteSpaces();
+        if (m_pos == m_end)
+        {
+            m_hasReachedEnd = true;
+            return true;
+        }
+        if (m_pos >= limit)
+            return true;
+
+        // Stop at the word "endsolid" ignoring the name that follows.
+        if (isKeyword("endsolid") == true)
+        {
+            m_pos = skipLine(m_pos, m_end);
+            m_hasReachedEnd = true;
+            m_hasReachedEndSolid = true;
+            return true;
+        }
+
+        // Parse the next facet.
+        const char * facetBegin = m_pos;
+        if (parseFacet(normals, vertices) == false)
+            return false;
+
+        // Once the size of a facet is known, estimate the number of
+        // remaining ones and reserve sufficient memory for them.
+        if (isFirstFacet == true)
+        {
+            isFirstFacet = false;
+            const qint64 facetSize = qMax(qint64(m_pos - facetBegin), qint64(1));
+            qint64 numFacets = (limit - m_pos) / facetSize * 21 / 20 + 1;
+            if (maxNumFacets >= 0)
+                numFacets = qMin(numFacets, maxNumFacets - 1);
+            numFacets += normals.size();
+            if (normals.capacity() < numFacets)
+            {
+                normals.reserve(numFacets);
+                vertices.reserve(3 * numFacets);
+            }
+        }
+    }
+    return true;
+}
+
+
+//=============================================================================
+// The function "parseFacet" parses a single facet.
+// OUTPUT: "GeometryArray<QVector3D> & normals" gets the facet's normal appended.
+// "GeometryArray<QVector3D> & vertices" gets the facet's vertices appended.
+// The function itself returns "false" if any discrepancy is encountered and
+// "true" otherwise.
+//=============================================================================
+bool AsciiStlParser::parseFacet(GeometryArray<QVector3D> & normals, GeometryArray<QVector3D> & vertices)
+{
+    // facet normal ni nj nk
+    QVector3D normal;
+    if ((expectKeyword("facet") == false) || (expectKeyword("normal") == false) ||
+        (expectVector(normal) == false) || (expectEndOfLine() == false))
+        return false;
+
+    // outer loop
+    skipWhiteSpaces();
+    if ((expectKeyword("outer") == false) || (expectKeyword("loop") == false) ||
+        (expectEndOfLine() == false))
+        return false;
+
+    // vertex vx vy vz
+    QVector3D vertex[3];
+    for (int k = 0; k < 3; ++k)
+    {
+        skipWhiteSpaces();
+        if ((expectKeyword("vertex") == false) || (expectVector(vertex[k]) == false) ||
+            (expectEndOfLine() == false))
+            return false;
+    }
+
+    // endloop
+    skipWhiteSpaces();
+    if ((expectKeyword("endloop") == false) || (expectEndOfLine() == false))
+        return false;
+
+    // endfacet
+    skipWhiteSpaces();
+    if ((expectKeyword("endfacet") == false) || (expectEndOfLine() == false))
+        return false;
+
+    normals.push_back(normal);
+    vertices.push_back(vertex[0]);
+    vertices.push_back(vertex[1]);
+    vertices.push_back(vertex[2]);
+    return true;
+}
+
+
+//=============================================================================
+// The function "findFacetStart" finds the first line after the one holding a
+// given position that starts (possibly after blanks) with the word "facet".
+// Such a line can only begin a facet, so parsing can start there
+// independently of the preceding text.
+// INPUT: "const char * pos" is the position to start searching from.
+// "const char * end" is the end of the text.
+// OUTPUT: The function returns the position of the word "facet", or "end" if
+// there are no more facets.
+//=============================================================================
+const char * AsciiStlParser::findFacetStart(const char * pos, const char * end)
+{
+    for (const char * lineBegin = skipLine(pos, end); lineBegin != end; )
+    {
+        const char * word = skipBlanks(lineBegin, end);
+        if ((end - word > 5) && (strncmp(word, "facet", 5) == 0) && (isBlank(word[5]) == true))
+            return word;
+        lineBegin = skipLine(word, end);
+    }
+    return end;
+}
+
+
+//=============================================================================
+// The function "findLastFacetStart" finds the last line in a given text that
+// starts (possibly after blanks) with the word "facet". All facets starting
+// before that line are complete in the text.
+// INPUT: "const char * begin" and "const char * end" specify the text.
+// OUTPUT: The function returns the position of the word "facet", or "begin"
+// if there is no facet in the text.
+//=============================================================================
+const char * AsciiStlParser::findLastFacetStart(const char * begin, const char * end)
+{
+    for (const char * wordEnd = end; wordEnd - begin >= 6; --wordEnd)
+    {
+        // Look for the word "facet" followed by a blank.
+        const char * word = wordEnd - 6;
+        if ((isBlank(word[5]) == false) || (strncmp(word, "facet", 5) != 0))
+            continue;
+        // Make sure only blanks precede it on its line.
+        const char * pos = word;
+        while ((pos != begin) && (isBlank(*(pos - 1)) == true))
+            --pos;
+        if ((pos == begin) || (*(pos - 1) == '\n'))
+            return word;
+    }
+    return begin;
+}
+
+
+//=============================================================================
+// The function "isKeyword" checks if the text at the current position is a
+// given keyword followed by a white space or the end of the text.
+//=============================================================================
+bool AsciiStlParser::isKeyword(const char * keyword) const
+{
+    const qint64 length = strlen(keyword);
+    if ((m_end - m_pos < length) || (strncmp(m_pos, keyword, length) != 0))
+        return false;
+    const char * next = m_pos + length;
+    return (next == m_end) || (isBlank(*next) == true) || (*next == '\n');
+}
+
+
+//=============================================================================
+// The function "expectKeyword" consumes a given keyword along with the blanks
+// following it.
+// OUTPUT: The function returns "false" if the keyword is not found at the
+// current position and "true" otherwise.
+//=============================================================================
+bool AsciiStlParser::expectKeyword(const char * keyword)
+{
+    if (isKeyword(keyword) == false)
+        return fail(QString("expected \"%1\"").arg(keyword));
+    m_pos = skipBlanks(m_pos + strlen(keyword), m_end);
+    return true;
+}
+
+
+//=============================================================================
+// The function "expectEndOfLine" consumes the end of the current line.
+// OUTPUT: The function returns "false" if anything but blanks remain on the
+// current line and "true" otherwise.
+//=============================================================================
+bool AsciiStlParser::expectEndOfLine()
+{
+    m_pos = skipBlanks(m_pos, m_end);
+    if (m_pos == m_end)
+        return true;
+    if (*m_pos != '\n')
+        return fail("unexpected text at the end of the line");
+    ++m_pos;
+    return true;
+}
+
+
+//=============================================================================
+// The function "expectVector" consumes three blank-separated numbers.
+// OUTPUT: "QVector3D & vector" returns the parsed numbers.
+// The function itself returns "false" if three numbers are not found at the
+// current position and "true" otherwise.
+//=============================================================================
+bool AsciiStlParser::expectVector(QVector3D & vector)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        m_pos = skipBlanks(m_pos, m_end);
+        float value;
+        const char * next = parseFloat(m_pos, m_end, value);
+        if ((next == nullptr) || ((next != m_end) && (isBlank(*next) == false) && (*next != '\n')))
+            return fail("expected a number");
+        vector[i] = value;
+        m_pos = next;
+    }
+    return true;
+}
+
+
+//=============================================================================
+// The function "skipWhiteSpaces" skips blanks and line ends.
+//=============================================================================
+void AsciiStlParser::skipWhiteSpaces()
+{
+    while ((m_pos != m_end) && ((isBlank(*m_pos) == true) || (*m_pos == '\n')))
+        ++m_pos;
+}
+
+
+//=============================================================================
+// The function "fail" records the position and the reason of a failure.
+// INPUT: "const QString & message" describes the failure.
+// OUTPUT: The function always returns "false".
+//=============================================================================
+bool AsciiStlParser::fail(const QString & message)
+{
+    m_errorPos = m_pos;
+    m_errorMessage = message;
+    return false;
+}
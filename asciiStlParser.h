@@ -0,0 +1,69 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef ASCII_STL_PARSER_HEADER
+#define ASCII_STL_PARSER_HEADER
+
+#include <QString>
+#include <QVector3D>
+#include "geometryArray.h"
+
+//=============================================================================
+// This class parses ascii STL text held in memory (e.g., a memory-mapped
+// file) without creating any intermediate strings. It checks the grammar as
+// strictly as the line-based reader it replaces: every statement has to be on
+// its own line with exactly the expected keywords and numbers.
+//=============================================================================
+class AsciiStlParser
+{
+public:
+    explicit AsciiStlParser(const char * begin, const char * end);
+
+    // Parse the "solid name" line.
+    bool parseHeader();
+
+    // Continue parsing at a given position, e.g., the beginning of a facet.
+    void setPosition(const char * pos) { m_pos = pos; }
+
+    // Parse facets starting before a given position.
+    bool parseFacets(const char * stop, GeometryArray<QVector3D> & normals,
+                     GeometryArray<QVector3D> & vertices, qint64 maxNumFacets = -1);
+
+    // Accessors.
+    const char * position() const { return m_pos; }
+    bool hasReachedEnd() const { return m_hasReachedEnd; }
+    bool hasReachedEndSolid() const { return m_hasReachedEndSolid; }
+    const char * errorPosition() const { return m_errorPos; }
+    const QString & errorMessage() const { return m_errorMessage; }
+
+    // Find the first facet starting on a line after a given position.
+    static const char * findFacetStart(const char * pos, const char * end);
+    // Find the last facet starting on a line in a given text.
+    static const char * findLastFacetStart(const char * begin, const char * end);
+
+private:
+    bool isKeyword(const char * keyword) const;
+    bool expectKeyword(const char * keyword);
+    bool expectEndOfLine();
+    bool expectVector(QVector3D & vector);
+    bool parseFacet(GeometryArray<QVector3D> & normals, GeometryArray<QVector3D> & vertices);
+    void skipWhiteSpaces();
+    bool fail(const QString & message);
+
+private:
+    const char * m_begin;         // beginning of the text
+    const char * m_end;           // end of the text
+    const char * m_pos;           // current position in the text
+    bool m_hasReachedEnd;         // indicates if "endsolid" or the end of the text is reached
+    bool m_hasReachedEndSolid;    // indicates if "endsolid" is reached
+    const char * m_errorPos;      // position at which parsing failed
+    QString m_errorMessage;       // description of the failure
+};
+
+#endif // ASCII_STL_PARSER_HEADER
@@ -0,0 +1,186 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "decimation.h"
+#include "parallelFor.h"
+#include "partMesh.h"
+
+#include <QVector3D>
+#include <cmath>     // cbrt, floor, sqrt
+#include <vector>
+
+// Number of triangles processed by a single task.
+static const qint64 s_decimationChunkSize = 65536;
+// Largest number of cell sizes tried before settling on the best one.
+static const int s_maxNumDecimationPasses = 8;
+// Fraction of the allowed number of triangles that is close enough.
+static const double s_minFillRatio = 0.8;
+
+
+//=============================================================================
+// The function "clusterVertex" moves a vertex to the center of the cell of a
+// uniform grid it lies in.
+// INPUT: "const QVector3D & vertex" is the vertex.
+// "const QVector3D & origin" is a corner of the grid.
+// "float cellSize" is the size of the cells.
+// OUTPUT: The function returns the center of the cell.
+// NOTE: This is a non-member function.
+//=============================================================================
+static inline QVector3D clusterVertex(const QVector3D & vertex, const QVector3D & origin, float cellSize)
+{
+    return QVector3D(origin.x() + (std::floor((vertex.x() - origin.x()) / cellSize) + 0.5f) * cellSize,
+                     origin.y() + (std::floor((vertex.y() - origin.y()) / cellSize) + 0.5f) * cellSize,
+                     origin.z() + (std::floor((vertex.z() - origin.z()) / cellSize) + 0.5f) * cellSize);
+}
+
+
+//=============================================================================
+// The function "isTriangleKept" checks if a triangle keeps its area once its
+// corners are moved to the centers of their cells, i.e., if the corners lie
+// in 3 different cells.
+// INPUT: "const QVector3D * corners" are the 3 corners of the triangle.
+// "const QVector3D & origin" is a corner of the grid.
+// "float cellSize" is the size of the cells.
+// NOTE: This is a non-member function.
+//=============================================================================
+static inline bool isTriangleKept(const QVector3D * corners, const QVector3D & origin, float cellSize)
+{
+    const QVector3D a = clusterVertex(corners[0], origin, cellSize);
+    const QVector3D b = clusterVertex(corners[1], origin, cellSize);
+    const QVector3D c = clusterVertex(corners[2], origin, cellSize);
+    return (a != b) && (b != c) && (c != a);
+}
+
+
+//=============================================================================
+// The function "countKeptTriangles" counts in parallel chunks the triangles
+// of a part that keep their area once clustered on a grid.
+// INPUT: "const Part & part" is the part.
+// "const QVector3D & origin" is a corner of the grid.
+// "float cellSize" is the size of the cells.
+// OUTPUT: "std::vector<qint64> & chunkCounts" returns the number of triangles
+// kept in each chunk.
+// The function itself returns the total number of triangles kept.
+// NOTE: This is a non-member function.
+//=============================================================================
+static qint64 countKeptTriangles(const Part & part, const QVector3D & origin, float cellSize,
+                                 std::vector<qint64> & chunkCounts)
+{
+    const qint64 numTriangles = part.numTriangles();
+    chunkCounts.assign(static_cast<size_t>(numChunks(numTriangles, s_decimationChunkSize)), 0);
+    const QVector3D * positionData = part.positionConstData();
+    const quint32 * indexData = part.indexConstData();
+    qint64 * chunkCountData = chunkCounts.data();
+    parallelForChunks(numTriangles, s_decimationChunkSize, [=](qint64 chunkIndex, qint64 begin, qint64 end)
+    {
+        qint64 count = 0;
+        for (qint64 t = begin; t < end; ++t)
+        {
+            const QVector3D corners[3] = {positionData[indexData[3 * t]], positionData[indexData[3 * t + 1]],
+                                          positionData[indexData[3 * t + 2]]};
+            if (isTriangleKept(corners, origin, cellSize) == true)
+                ++count;
+        }
+        chunkCountData[chunkIndex] = count;
+    });
+
+    qint64 numKept = 0;
+    for (auto cit = chunkCounts.cbegin(); cit != chunkCounts.cend(); ++cit)
+        numKept += *cit;
+    return numKept;
+}
+
+
+//=============================================================================
+// The function "decimatePart" makes a coarser copy of a part by clustering
+// its vertices on a uniform grid: every vertex is moved to the center of its
+// cell, and the triangles whose corners end up in fewer than 3 cells are
+// dropped. The cell size is adjusted over a few passes until the number of
+// triangles kept is just within the limit. The triangles kept are welded
+// again and flat shaded with their new face normals.
+// INPUT: "const Part & part" is the part to be decimated.
+// "qint64 maxNumTriangles" is the largest number of triangles of the copy.
+// OUTPUT: The function returns the coarser copy, or null if no copy with so
+// few triangles keeps any of the shape.
+//=============================================================================
+std::shared_ptr<Part> decimatePart(const Part & part, qint64 maxNumTriangles)
+{
+    const qint64 numTriangles = part.numTriangles();
+    if ((numTriangles == 0) || (maxNumTriangles <= 0))
+        return std::shared_ptr<Part>(nullptr);
+
+    // A thin part is given some depth, so that the grid is well defined.
+    QVector3D minCoord;
+    QVector3D maxCoord;
+    part.coordinateRanges(minCoord, maxCoord);
+    const QVector3D extent = maxCoord - minCoord;
+    const float maxExtent = qMax(extent.x(), qMax(extent.y(), extent.z()));
+    if (maxExtent <= 0.0f)
+        return std::shared_ptr<Part>(nullptr);
+    const double minExtent = 1.0e-3 * maxExtent;
+    const double boxVolume = qMax(double(extent.x()), minExtent) * qMax(double(extent.y()), minExtent) *
+            qMax(double(extent.z()), minExtent);
+
+    // Start with as many cells in the box as there may be triangles. A
+    // surface passes through only some of them, and the number of triangles
+    // it keeps is about inversely proportional to the square of the cell
+    // size, by which the cell size is corrected.
+    double cellSize = std::cbrt(boxVolume / double(maxNumTriangles));
+    float bestCellSize = 0.0f;
+    qint64 bestNumKept = 0;
+    std::vector<qint64> chunkCounts;
+    for (int pass = 0; pass < s_maxNumDecimationPasses; ++pass)
+    {
+        const qint64 numKept = countKeptTriangles(part, minCoord, static_cast<float>(cellSize), chunkCounts);
+        if ((numKept <= maxNumTriangles) && (numKept > bestNumKept))
+        {
+            bestCellSize = static_cast<float>(cellSize);
+            bestNumKept = numKept;
+        }
+        if ((numKept <= maxNumTriangles) && (numKept >= s_minFillRatio * maxNumTriangles))
+            break;
+        cellSize *= std::sqrt(double(qMax(numKept, qint64(1))) / (0.5 * (1.0 + s_minFillRatio) * maxNumTriangles));
+    }
+    if (bestNumKept == 0)
+        return std::shared_ptr<Part>(nullptr);
+
+    // Write the triangles kept by every chunk at the offset given by the
+    // counts of the chunks before it.
+    countKeptTriangles(part, minCoord, bestCellSize, chunkCounts);
+    std::vector<qint64> chunkOffsets(chunkCounts.size(), 0);
+    for (size_t i = 1; i < chunkCounts.size(); ++i)
+        chunkOffsets[i] = chunkOffsets[i - 1] + chunkCounts[i - 1];
+    GeometryArray<QVector3D> newVertices(3 * bestNumKept);
+    const QVector3D * positionData = part.positionConstData();
+    const quint32 * indexData = part.indexConstData();
+    QVector3D * vertexOut = newVertices.data();
+    const qint64 * chunkOffsetData = chunkOffsets.data();
+    parallelForChunks(numTriangles, s_decimationChunkSize, [=](qint64 chunkIndex, qint64 begin, qint64 end)
+    {
+        qint64 out = 3 * chunkOffsetData[chunkIndex];
+        for (qint64 t = begin; t < end; ++t)
+        {
+            const QVector3D corners[3] = {positionData[indexData[3 * t]], positionData[indexData[3 * t + 1]],
+                                          positionData[indexData[3 * t + 2]]};
+            if (isTriangleKept(corners, minCoord, bestCellSize) == false)
+                continue;
+            for (int k = 0; k < 3; ++k)
+                vertexOut[out + k] = clusterVertex(corners[k], minCoord, bestCellSize);
+            out += 3;
+        }
+    });
+
+    // The corners in the same cell have the same center, so welding joins
+    // the triangles kept again.
+    std::shared_ptr<Part> decimatedPart(new PartMesh());
+    if (decimatedPart->setTriangles(newVertices) == false)
+        return std::shared_ptr<Part>(nullptr);
+    decimatedPart->computeFaceNormals();
+    return decimatedPart;
+}
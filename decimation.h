@@ -0,0 +1,19 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef DECIMATION_HEADER
+#define DECIMATION_HEADER
+
+#include <memory>   // shared_ptr
+#include "part.h"
+
+// Make a coarser copy of a part with at most a given number of triangles.
+std::shared_ptr<Part> decimatePart(const Part & part, qint64 maxNumTriangles);
+
+#endif // DECIMATION_HEADER
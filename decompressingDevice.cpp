@@ -0,0 +1,339 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "decompressingDevice.h"
+
+#include <QByteArray>
+#include <QFileInfo>
+#include <QStringList>
+#include <boost/iostreams/categories.hpp>
+#include <boost/iostreams/filtering_streambuf.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filter/zstd.hpp>
+#include <algorithm>  // min
+#include <exception>  // exception
+#include <ios>        // ios_base
+#include <new>        // bad_alloc
+
+//=============================================================================
+// The class "QFileSource" lets the Boost.Iostreams filters read from a QFile,
+// which also takes care of non-ASCII file names.
+//=============================================================================
+class QFileSource
+{
+public:
+    typedef char char_type;
+    typedef boost::iostreams::source_tag category;
+
+    explicit QFileSource(QFile * file) : m_file(file) {}
+
+    // A failed read throws rather than returning -1, which the filters would
+    // take for the end of the compressed data.
+    std::streamsize read(char * data, std::streamsize maxSize)
+    {
+        const qint64 count = m_file->read(data, maxSize);
+        if (count > 0)
+            return static_cast<std::streamsize>(count);
+        if ((count == 0) && (m_file->atEnd() == true))
+            return -1;
+        throw std::ios_base::failure(QString("Reading %1 failed: %2").arg(m_file->fileName())
+                                     .arg(m_file->errorString()).toStdString());
+    }
+
+private:
+    QFile * m_file;
+};
+
+
+// Constructor.
+DecompressingDevice::DecompressingDevice(const QString & fileName, Compression compression)
+    : QIODevice(), m_file(fileName), m_compression(compression), m_stream(), m_isStreamAtEnd(false)
+{}
+
+// Destructor.
+DecompressingDevice::~DecompressingDevice()
+{
+    close();
+}
+
+
+//=============================================================================
+// The function "open" opens the compressed file and sets up the decompression.
+// INPUT: "OpenMode mode" must be QIODevice::ReadOnly.
+// OUTPUT: The function returns "true" if successful and "false" otherwise.
+//=============================================================================
+bool DecompressingDevice::open(OpenMode mode)
+{
+    if ((mode & QIODevice::WriteOnly) != 0)
+    {
+        setErrorString("Compressed files can only be read.");
+        return false;
+    }
+    if (m_file.open(QIODevice::ReadOnly) == false)
+    {
+        setErrorString(m_file.errorString());
+        return false;
+    }
+
+    // Push the decompressor followed by the file source.
+    boost::iostreams::filtering_istreambuf * stream = new boost::iostreams::filtering_istreambuf();
+    if (m_compression == Compression::Gzip)
+        stream->push(boost::iostreams::gzip_decompressor());
+    else if (m_compression == Compression::Zstd)
+        stream->push(boost::iostreams::zstd_decompressor());
+    stream->push(QFileSource(&m_file));
+    m_stream.reset(stream);
+    m_isStreamAtEnd = false;
+
+    return QIODevice::open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+
+//=============================================================================
+// The function "close" closes the device and the compressed file.
+//=============================================================================
+void DecompressingDevice::close()
+{
+    if (isOpen() == true)
+        QIODevice::close();
+    m_stream.reset();
+    m_file.close();
+}
+
+
+//=============================================================================
+// The function "atEnd" indicates if all decompressed bytes have been read.
+//=============================================================================
+bool DecompressingDevice::atEnd() const
+{
+    return m_isStreamAtEnd;
+}
+
+
+//=============================================================================
+// The function "readData" decompresses the next bytes. The exceptions thrown
+// by the Boost.Iostreams filters on corrupt data are turned into a read error.
+// INPUT: "qint64 maxSize" is the maximal number of bytes to be read.
+// OUTPUT: "char * data" returns the decompressed bytes.
+// The function itself returns the number of bytes read, 0 at the end of the
+// data, or -1 if decompression failed.
+//=============================================================================
+qint64 DecompressingDevice::readData(char * data, qint64 maxSize)
+{
+    if ((m_stream == nullptr) || (m_isStreamAtEnd == true))
+        return 0;
+    try
+    {
+        const std::streamsize count = m_stream->sgetn(data, static_cast<std::streamsize>(maxSize));
+        if (count < maxSize)
+            m_isStreamAtEnd = true;
+        return static_cast<qint64>(count);
+    }
+    catch (const std::exception & e)
+    {
+        setErrorString(QString("Decompression of %1 failed: %2").arg(m_file.fileName()).arg(e.what()));
+        m_isStreamAtEnd = true;
+        return -1;
+    }
+}
+
+
+//=============================================================================
+// The function "writeData" refuses to write as the device is read-only.
+//=============================================================================
+qint64 DecompressingDevice::writeData(const char *, qint64)
+{
+    return -1;
+}
+
+
+//=============================================================================
+// The function "readToEnd" reads a device to its end, checking that every
+// read succeeds.
+// INPUT: "QIODevice * device" is the opened device.
+// "char * data", if given, receives the bytes, and "qint64 & size" must then
+// be the exact number of bytes of the device. If not given, the bytes are
+// read into a small scratch buffer and only counted.
+// OUTPUT: "qint64 & size" returns the number of bytes read.
+// "QString & errorString" returns the reason of a failure.
+// The function itself returns "false" if a read fails or the device does not
+// hold the given number of bytes, and "true" otherwise.
+// NOTE: This is a non-member function.
+//=============================================================================
+static bool readToEnd(QIODevice * device, char * data, qint64 & size, QString & errorString)
+{
+    static const qint64 s_blockSize = 1 << 20;
+    QByteArray scratch;
+    if (data == nullptr)
+        scratch.resize(static_cast<int>(s_blockSize));
+
+    qint64 numRead = 0;
+    while (device->atEnd() == false)
+    {
+        char * dest = (data == nullptr) ? scratch.data() : data + numRead;
+        const qint64 maxSize = (data == nullptr) ? s_blockSize : std::min(s_blockSize, size - numRead);
+        if (maxSize == 0)
+        {
+            // All expected bytes are in, so the device must hold no more.
+            char extra;
+            device->read(&extra, 1);
+            break;
+        }
+        const qint64 count = device->read(dest, maxSize);
+        if (count <= 0)
+            break;
+        numRead += count;
+    }
+
+    if ((device->atEnd() == false) || ((data != nullptr) && (numRead != size)))
+    {
+        errorString = device->errorString();
+        if (errorString.isEmpty() == true)
+            errorString = "The file changed while being read.";
+        return false;
+    }
+    size = numRead;
+    return true;
+}
+
+
+//=============================================================================
+// The function "open" maps a plain file into memory or decompresses a
+// compressed one into memory. A first pass over a compressed file finds the
+// size of its decompressed data and checks that it decompresses cleanly, and
+// the data are then decompressed into a 64-bit array of that exact size.
+// INPUT: "const QString & fileName" is the name of the file.
+// OUTPUT: "QString & errorString" returns the reason of a failure.
+// The function itself returns "false" if the file can not be read, fails to
+// decompress or is empty, and "true" otherwise.
+//=============================================================================
+bool FileContents::open(const QString & fileName, QString & errorString)
+{
+    Compression compression;
+    m_device = openInputFile(fileName, errorString, &compression);
+    if (m_device == nullptr)
+        return false;
+
+    if (compression == Compression::None)
+    {
+        QFile * file = static_cast<QFile *>(m_device.get());
+        m_size = file->size();
+        m_data = (m_size > 0) ? file->map(0, m_size) : nullptr;
+    }
+    else
+    {
+        qint64 size = 0;
+        if (readToEnd(m_device.get(), nullptr, size, errorString) == false)
+            return false;
+        m_device = openInputFile(fileName, errorString);
+        if (m_device == nullptr)
+            return false;
+        try
+        {
+            m_decompressed.resize(size);
+        }
+        catch (const std::bad_alloc &)
+        {
+            errorString = QString("Not enough memory to decompress %1 bytes.").arg(size);
+            return false;
+        }
+        if (readToEnd(m_device.get(), m_decompressed.data(), size, errorString) == false)
+            return false;
+        m_size = size;
+        m_data = reinterpret_cast<const uchar *>(m_decompressed.constData());
+    }
+    if ((m_data == nullptr) || (m_size == 0))
+    {
+        errorString = (m_size == 0) ? QString("The file is empty.") : m_device->errorString();
+        return false;
+    }
+    return true;
+}
+
+
+//=============================================================================
+// The function "detectCompression" detects if a file is gzip or zstd
+// compressed by checking its magic bytes.
+// INPUT: "const QString & fileName" is the name of the file.
+// OUTPUT: The function returns the compression format of the file.
+//=============================================================================
+Compression detectCompression(const QString & fileName)
+{
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly) == false)
+        return Compression::None;
+    return detectCompression(file.read(4));
+}
+
+
+//=============================================================================
+// The function "detectCompression" detects if data is gzip or zstd compressed
+// by checking its magic bytes.
+// INPUT: "const QByteArray & prefix" is the beginning of the data.
+// OUTPUT: The function returns the compression format of the data.
+//=============================================================================
+Compression detectCompression(const QByteArray & prefix)
+{
+    if (prefix.startsWith("\x1f\x8b") == true)
+        return Compression::Gzip;
+    if (prefix.startsWith(QByteArray("\x28\xb5\x2f\xfd", 4)) == true)
+        return Compression::Zstd;
+    return Compression::None;
+}
+
+
+//=============================================================================
+// The function "openInputFile" opens a file for reading, decompressing it on
+// the fly if it is gzip or zstd compressed.
+// INPUT: "const QString & fileName" is the name of the file.
+// OUTPUT: "QString & errorString" returns the reason of a failure.
+// "Compression * compression", if given, returns the compression of the file.
+// The function itself returns the opened device, or null on failure.
+//=============================================================================
+std::unique_ptr<QIODevice> openInputFile(const QString & fileName, QString & errorString,
+                                         Compression * compression)
+{
+    const Compression fileCompression = detectCompression(fileName);
+    if (compression != nullptr)
+        *compression = fileCompression;
+    std::unique_ptr<QIODevice> device;
+    if (fileCompression == Compression::None)
+        device.reset(new QFile(fileName));
+    else
+        device.reset(new DecompressingDevice(fileName, fileCompression));
+    if (device->open(QIODevice::ReadOnly) == false)
+    {
+        errorString = device->errorString();
+        device.reset();
+    }
+    return device;
+}
+
+
+//=============================================================================
+// The function "dataSuffix" finds the extension of the data held in a file,
+// i.e., the extension of the file with a compression extension stripped, so
+// that both "part.stl" and "part.stl.gz" give "stl".
+// INPUT: "const QString & fileName" is the name of the file.
+// OUTPUT: The function returns the extension in lower case.
+//=============================================================================
+QString dataSuffix(const QString & fileName)
+{
+    QString name = QFileInfo(fileName).fileName().toLower();
+    const QStringList compressionSuffixes = QStringList() << ".gz" << ".zst" << ".zstd";
+    for (auto cit = compressionSuffixes.cbegin(); cit != compressionSuffixes.cend(); ++cit)
+    {
+        if (name.endsWith(*cit) == true)
+        {
+            name.chop(cit->size());
+            break;
+        }
+    }
+    return QFileInfo(name).suffix();
+}
@@ -0,0 +1,86 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef DECOMPRESSING_DEVICE_HEADER
+#define DECOMPRESSING_DEVICE_HEADER
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QFile>
+#include <QString>
+#include "geometryArray.h"
+#include <memory>   // unique_ptr
+#include <streambuf>
+
+enum class Compression {None, Gzip, Zstd};  // compression formats recognized by their magic bytes
+
+//=============================================================================
+// This class is a sequential, read-only device that decompresses a gzip or
+// zstd compressed file on the fly. Only a small decompression window is kept
+// in memory regardless of the size of the file.
+//=============================================================================
+class DecompressingDevice : public QIODevice
+{
+public:
+    explicit DecompressingDevice(const QString & fileName, Compression compression);
+    virtual ~DecompressingDevice() override;
+
+    virtual bool open(OpenMode mode) override;
+    virtual void close() override;
+    virtual bool isSequential() const override { return true; }
+    virtual bool atEnd() const override;
+
+    // The number of compressed bytes consumed so far and in total.
+    qint64 compressedPos() const { return m_file.isOpen() ? m_file.pos() : 0; }
+    qint64 compressedSize() const { return m_file.size(); }
+
+protected:
+    virtual qint64 readData(char * data, qint64 maxSize) override;
+    virtual qint64 writeData(const char * data, qint64 maxSize) override;
+
+private:
+    QFile m_file;                   // compressed file
+    Compression m_compression;      // compression format of the file
+    std::unique_ptr<std::streambuf> m_stream;  // decompressing stream buffer
+    bool m_isStreamAtEnd;           // indicates if all decompressed bytes were read
+};
+
+
+//=============================================================================
+// This class gives access to the whole content of a file in memory. A plain
+// file is memory-mapped, while a compressed one is decompressed into a 64-bit
+// array, so that its content may exceed 2 GB.
+//=============================================================================
+class FileContents
+{
+public:
+    FileContents() : m_device(), m_decompressed(), m_data(nullptr), m_size(0) {}
+
+    bool open(const QString & fileName, QString & errorString);
+
+    // Accessors.
+    const uchar * data() const { return m_data; }
+    qint64 size() const { return m_size; }
+
+private:
+    std::unique_ptr<QIODevice> m_device;  // opened file
+    GeometryArray<char> m_decompressed;   // content of a compressed file
+    const uchar * m_data;                 // beginning of the content
+    qint64 m_size;                        // number of bytes of the content
+};
+
+
+// Non-members.
+Compression detectCompression(const QString & fileName);
+Compression detectCompression(const QByteArray & prefix);
+std::unique_ptr<QIODevice> openInputFile(const QString & fileName, QString & errorString,
+                                         Compression * compression = nullptr);
+QString dataSuffix(const QString & fileName);
+
+#endif // DECOMPRESSING_DEVICE_HEADER
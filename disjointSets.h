@@ -0,0 +1,73 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef DISJOINT_SETS_HEADER
+#define DISJOINT_SETS_HEADER
+
+#include <QtGlobal>
+#include <atomic>    // atomic
+#include <utility>   // swap
+
+// A disjoint-set forest shared by several threads is an array of parents,
+// one per element, every root being its own parent. The higher root is always
+// linked under the lower one, so the root of every set ends up its lowest
+// element whatever the order in which the threads unite the sets.
+
+
+//=============================================================================
+// The function "findRoot" finds the root of the set of an element in a
+// disjoint-set forest shared by several threads. Every parent is lower than
+// its children, so pointing an element at its grandparent on the way, which
+// halves the path, never creates a loop even if other threads link roots
+// at the same time.
+// INPUT: "std::atomic<quint32> * parents" are the parents of the elements.
+// "quint32 element" is the element.
+// OUTPUT: The function returns the root.
+// NOTE: This is a non-member function.
+//=============================================================================
+inline quint32 findRoot(std::atomic<quint32> * parents, quint32 element)
+{
+    while (true)
+    {
+        quint32 parent = parents[element].load(std::memory_order_relaxed);
+        if (parent == element)
+            return element;
+        const quint32 grandparent = parents[parent].load(std::memory_order_relaxed);
+        if (grandparent != parent)
+            parents[element].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+        element = grandparent;
+    }
+}
+
+
+//=============================================================================
+// The function "uniteSets" unites the sets of two elements in a disjoint-set
+// forest shared by several threads, linking the higher root under the lower
+// one unless another thread has linked it first, in which case it retries.
+// INPUT: "std::atomic<quint32> * parents" are the parents of the elements.
+// "quint32 first" and "quint32 second" are the elements.
+// NOTE: This is a non-member function.
+//=============================================================================
+inline void uniteSets(std::atomic<quint32> * parents, quint32 first, quint32 second)
+{
+    while (true)
+    {
+        first = findRoot(parents, first);
+        second = findRoot(parents, second);
+        if (first == second)
+            return;
+        if (first < second)
+            std::swap(first, second);
+        quint32 expected = first;
+        if (parents[first].compare_exchange_strong(expected, second, std::memory_order_relaxed) == true)
+            return;
+    }
+}
+
+#endif // DISJOINT_SETS_HEADER
@@ -0,0 +1,105 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "geometryArray.h"
+
+#include <cstdlib>   // calloc, free
+#include <limits>    // numeric_limits
+#include <new>       // bad_alloc
+
+#if defined(Q_OS_WIN)
+// Without NOMINMAX, windows.h defines macros min and max.
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/mman.h>
+#endif
+
+// Smallest array mapped directly from the system rather than taken from the
+// heap, in bytes. Mapped memory comes zero-filled page by page as it is first
+// touched, and is returned to the system as soon as it is freed.
+static const qint64 s_minNumBytesMapped = Q_INT64_C(32) * 1024 * 1024;
+
+
+//=============================================================================
+// The function "allocateGeometryMemory" allocates zero-filled memory for a
+// geometry array. Large blocks are mapped directly from the system, on huge
+// pages where supported, and small ones are taken from the heap.
+// INPUT: "qint64 numBytes" is the size of the memory.
+// OUTPUT: "bool & isMapped" returns if the memory is mapped from the system.
+// The function returns the memory, or null if the size is 0. It throws
+// "std::bad_alloc" if the memory can not be allocated.
+// NOTE: This is a non-member function.
+//=============================================================================
+void * allocateGeometryMemory(qint64 numBytes, bool & isMapped)
+{
+    isMapped = false;
+    if (numBytes <= 0)
+        return nullptr;
+    if (static_cast<quint64>(numBytes) > std::numeric_limits<size_t>::max())
+        throw std::bad_alloc();
+    const size_t size = static_cast<size_t>(numBytes);
+
+    if (numBytes >= s_minNumBytesMapped)
+    {
+#if defined(Q_OS_WIN)
+        void * memory = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if (memory != nullptr)
+        {
+            isMapped = true;
+            return memory;
+        }
+#elif defined(Q_OS_UNIX)
+        void * memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory != MAP_FAILED)
+        {
+#if defined(MADV_HUGEPAGE)
+            // Huge pages cut the page faults and TLB misses of walking large
+            // arrays; the hint is simply ignored where they are disabled.
+            madvise(memory, size, MADV_HUGEPAGE);
+#endif
+            isMapped = true;
+            return memory;
+        }
+#endif
+    }
+
+    void * memory = std::calloc(size, 1);
+    if (memory == nullptr)
+        throw std::bad_alloc();
+    return memory;
+}
+
+
+//=============================================================================
+// The function "freeGeometryMemory" frees memory allocated by the function
+// "allocateGeometryMemory".
+// INPUT: "void * memory" is the memory; null is ignored.
+// "qint64 numBytes" is the size of the memory.
+// "bool isMapped" indicates if the memory is mapped from the system.
+// NOTE: This is a non-member function.
+//=============================================================================
+void freeGeometryMemory(void * memory, qint64 numBytes, bool isMapped)
+{
+    if (memory == nullptr)
+        return;
+    if (isMapped == false)
+    {
+        std::free(memory);
+        return;
+    }
+#if defined(Q_OS_WIN)
+    Q_UNUSED(numBytes);
+    VirtualFree(memory, 0, MEM_RELEASE);
+#elif defined(Q_OS_UNIX)
+    munmap(memory, static_cast<size_t>(numBytes));
+#endif
+}
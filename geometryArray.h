@@ -0,0 +1,228 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef GEOMETRY_ARRAY_HEADER
+#define GEOMETRY_ARRAY_HEADER
+
+#include <QtGlobal>
+#include <cstring>   // memcpy, memset
+#include <utility>   // swap
+
+// Non-members.
+void * allocateGeometryMemory(qint64 numBytes, bool & isMapped);
+void freeGeometryMemory(void * memory, qint64 numBytes, bool isMapped);
+
+//=============================================================================
+// This class template is a contiguous array of plain values, e.g., the
+// vertices of a part, indexed by 64-bit integers so that it can grow beyond
+// the size limits of QVector. Large arrays are mapped directly from the
+// system, on huge pages where supported, rather than taken from the heap.
+// New elements are zero-filled and the elements are copied bytewise, so the
+// array is meant for types like QVector3D, float and integers.
+//=============================================================================
+template <typename T>
+class GeometryArray
+{
+public:
+    typedef T value_type;
+    typedef T * iterator;
+    typedef const T * const_iterator;
+
+    // Constructors.
+    GeometryArray() : m_data(nullptr), m_size(0), m_capacity(0), m_isMapped(false) {}
+    explicit GeometryArray(qint64 size) : GeometryArray() { resize(size); }
+    GeometryArray(const GeometryArray & other) : GeometryArray() { append(other.m_data, other.m_size); }
+    GeometryArray(GeometryArray && other) : GeometryArray() { swap(other); }
+    ~GeometryArray() { freeGeometryMemory(m_data, m_capacity * qint64(sizeof(T)), m_isMapped); }
+
+    GeometryArray & operator=(const GeometryArray & other);
+    GeometryArray & operator=(GeometryArray && other);
+
+    // Accessors.
+    qint64 size() const { return m_size; }
+    qint64 capacity() const { return m_capacity; }
+    bool isEmpty() const { return m_size == 0; }
+    bool isMapped() const { return m_isMapped; }
+
+    T * data() { return m_data; }
+    const T * data() const { return m_data; }
+    const T * constData() const { return m_data; }
+    iterator begin() { return m_data; }
+    iterator end() { return m_data + m_size; }
+    const_iterator begin() const { return m_data; }
+    const_iterator end() const { return m_data + m_size; }
+    const_iterator cbegin() const { return m_data; }
+    const_iterator cend() const { return m_data + m_size; }
+    T & operator[](qint64 i) { Q_ASSERT((0 <= i) && (i < m_size)); return m_data[i]; }
+    const T & operator[](qint64 i) const { Q_ASSERT((0 <= i) && (i < m_size)); return m_data[i]; }
+    const T & at(qint64 i) const { return (*this)[i]; }
+    T & back() { return (*this)[m_size - 1]; }
+    const T & back() const { return (*this)[m_size - 1]; }
+
+    // Modifiers.
+    void reserve(qint64 capacity);
+    void resize(qint64 size);
+    void clear();
+    void squeeze();
+    void push_back(const T & value);
+    void append(const T & value) { push_back(value); }
+    void append(const T * values, qint64 numValues);
+    void append(const GeometryArray & other) { append(other.m_data, other.m_size); }
+    void swap(GeometryArray & other);
+
+private:
+    void reallocate(qint64 capacity);
+
+    // The memory past the last element is kept zero-filled, so that growing
+    // the array never needs to fill it.
+    T * m_data;          // elements of the array
+    qint64 m_size;       // number of elements
+    qint64 m_capacity;   // number of elements the memory can hold
+    bool m_isMapped;     // indicates if the memory is mapped from the system rather than the heap
+};
+
+
+// Copy assignment.
+template <typename T>
+GeometryArray<T> & GeometryArray<T>::operator=(const GeometryArray<T> & other)
+{
+    if (this != &other)
+    {
+        GeometryArray<T> copy(other);
+        swap(copy);
+    }
+    return *this;
+}
+
+// Move assignment.
+template <typename T>
+GeometryArray<T> & GeometryArray<T>::operator=(GeometryArray<T> && other)
+{
+    GeometryArray<T> moved(std::move(other));
+    swap(moved);
+    return *this;
+}
+
+
+//=============================================================================
+// The function "reserve" makes room for a given number of elements without
+// changing the size of the array.
+// INPUT: "qint64 capacity" is the number of elements to make room for.
+//=============================================================================
+template <typename T>
+void GeometryArray<T>::reserve(qint64 capacity)
+{
+    if (capacity > m_capacity)
+        reallocate(capacity);
+}
+
+
+//=============================================================================
+// The function "resize" changes the number of elements in the array. New
+// elements are zero-filled.
+// INPUT: "qint64 size" is the new number of elements.
+//=============================================================================
+template <typename T>
+void GeometryArray<T>::resize(qint64 size)
+{
+    size = qMax(size, qint64(0));
+    if (size > m_capacity)
+        reallocate(size);
+    else if (size < m_size)
+        std::memset(static_cast<void *>(m_data + size), 0, (m_size - size) * sizeof(T));
+    m_size = size;
+}
+
+
+//=============================================================================
+// The function "clear" removes all elements and releases the memory.
+//=============================================================================
+template <typename T>
+void GeometryArray<T>::clear()
+{
+    GeometryArray<T> empty;
+    swap(empty);
+}
+
+
+//=============================================================================
+// The function "squeeze" releases the memory not used by the elements.
+//=============================================================================
+template <typename T>
+void GeometryArray<T>::squeeze()
+{
+    if (m_capacity > m_size)
+        reallocate(m_size);
+}
+
+
+//=============================================================================
+// The function "push_back" adds an element at the end of the array.
+// INPUT: "const T & value" is the element.
+//=============================================================================
+template <typename T>
+void GeometryArray<T>::push_back(const T & value)
+{
+    if (m_size == m_capacity)
+        reallocate(qMax(2 * m_capacity, qint64(16)));
+    m_data[m_size++] = value;
+}
+
+
+//=============================================================================
+// The function "append" adds a range of elements at the end of the array.
+// INPUT: "const T * values" are the elements.
+// "qint64 numValues" is the number of elements.
+//=============================================================================
+template <typename T>
+void GeometryArray<T>::append(const T * values, qint64 numValues)
+{
+    if (numValues <= 0)
+        return;
+    if (m_size + numValues > m_capacity)
+        reallocate(qMax(m_size + numValues, 2 * m_capacity));
+    std::memcpy(m_data + m_size, values, numValues * sizeof(T));
+    m_size += numValues;
+}
+
+
+//=============================================================================
+// The function "swap" exchanges the elements of two arrays without copying.
+// INPUT: "GeometryArray & other" is the other array.
+//=============================================================================
+template <typename T>
+void GeometryArray<T>::swap(GeometryArray<T> & other)
+{
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_capacity, other.m_capacity);
+    std::swap(m_isMapped, other.m_isMapped);
+}
+
+
+//=============================================================================
+// The function "reallocate" moves the elements to new memory of a given
+// capacity. The new memory comes zero-filled.
+// INPUT: "qint64 capacity" is the number of elements the new memory holds; it
+// is not less than the size of the array.
+//=============================================================================
+template <typename T>
+void GeometryArray<T>::reallocate(qint64 capacity)
+{
+    bool isMapped = false;
+    T * data = static_cast<T *>(allocateGeometryMemory(capacity * qint64(sizeof(T)), isMapped));
+    if (m_size > 0)
+        std::memcpy(data, m_data, m_size * sizeof(T));
+    freeGeometryMemory(m_data, m_capacity * qint64(sizeof(T)), m_isMapped);
+    m_data = data;
+    m_capacity = capacity;
+    m_isMapped = isMapped;
+}
+
+#endif // GEOMETRY_ARRAY_HEADER
@@ -0,0 +1,445 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "geometryCache.h"
+#include "loadProgress.h"
+#include "parallelFor.h"
+#include "partMesh.h"
+#include "normalSmoothing.h"
+#include "vertexWelding.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QVector>
+#include <QVector3D>
+#include <algorithm>      // copy
+#include <utility>        // move
+#include <cstring>        // memcmp, memcpy, memset
+#include <limits>         // numeric_limits
+#include <vector>
+
+// The triangles are stored as arrays of floats.
+static_assert(sizeof(QVector3D) == 3 * sizeof(float), "QVector3D is expected to hold 3 floats");
+
+// Extension of the cache files.
+static const char * const s_cacheFileSuffix = ".s3dgeo";
+// Magic bytes at the beginning of a cache file, including the format version.
+static const char s_cacheMagic[8] = {'S', '3', 'D', 'G', 'E', 'O', 'M', '6'};
+// Written in native byte order to recognize files of another byte order.
+static const quint32 s_byteOrderMark = 0x01020304;
+// Flag indicating that packed vertex normals, 3 per triangle, are stored.
+static const quint32 s_vertexNormalsFlag = 1;
+// Alignment of the sections of a cache file, in bytes.
+static const qint64 s_sectionAlignment = 64;
+// Number of bytes hashed at each end of an original file.
+static const qint64 s_hashedEndSize = 64 * 1024;
+// Number of triangles or positions restored by a single task when reading in
+// parallel.
+static const qint64 s_cacheChunkSize = 65536;
+
+//=============================================================================
+// The class "GeometryCacheHeader" is the header of a cache file. It is
+// followed by the sections of unique positions, of position indices, 3 per
+// triangle, of packed face normals, 1 per triangle, and, if the part has
+// them, of packed vertex normals, 3 per triangle.
+//=============================================================================
+struct GeometryCacheHeader
+{
+    char magic[8];             // magic bytes and format version
+    quint32 byteOrderMark;     // recognizes the byte order of the file
+    quint32 flags;             // presence of the vertex normals
+    qint64 numTriangles;       // number of triangles
+    qint64 numPositions;       // number of unique positions
+    double volume;             // volume of the part
+    double area;               // surface area of the part
+    MeshIntegrity integrity;   // holes, faulty edges and pieces of the surface
+    float boxSize[3];          // size of the minimal containing box
+    float origin[3];           // lower left corner of the containing box
+    quint32 reserved;          // unused, zero
+};
+
+
+//=============================================================================
+// The function "alignedOffset" rounds an offset up to the section alignment.
+// INPUT: "qint64 offset" is an offset within a cache file.
+// OUTPUT: The function returns the smallest aligned offset not below it.
+// NOTE: This is a non-member function.
+//=============================================================================
+static qint64 alignedOffset(qint64 offset)
+{
+    return (offset + s_sectionAlignment - 1) / s_sectionAlignment * s_sectionAlignment;
+}
+
+
+//=============================================================================
+// The function "sectionOffsets" computes where the sections of a cache file
+// start and how large the file is.
+// INPUT: "const GeometryCacheHeader & header" is the header of the file.
+// OUTPUT: "qint64 & indexOffset", "qint64 & normalOffset" and
+// "qint64 & vertexNormalOffset" return the offsets of the index, of the face
+// normal and of the vertex normal section.
+// The function itself returns the size of the file.
+// NOTE: This is a non-member function.
+//=============================================================================
+static qint64 sectionOffsets(const GeometryCacheHeader & header, qint64 & indexOffset, qint64 & normalOffset,
+                             qint64 & vertexNormalOffset)
+{
+    const qint64 positionOffset = alignedOffset(sizeof(GeometryCacheHeader));
+    indexOffset = alignedOffset(positionOffset + header.numPositions * qint64(sizeof(QVector3D)));
+    normalOffset = alignedOffset(indexOffset + 3 * header.numTriangles * qint64(sizeof(quint32)));
+    const qint64 normalEnd = normalOffset + header.numTriangles * qint64(sizeof(PackedNormal));
+    if ((header.flags & s_vertexNormalsFlag) == 0)
+    {
+        vertexNormalOffset = normalEnd;
+        return normalEnd;
+    }
+    vertexNormalOffset = alignedOffset(normalEnd);
+    return vertexNormalOffset + 3 * header.numTriangles * qint64(sizeof(PackedNormal));
+}
+
+
+// Constructor.
+GeometryCache::GeometryCache(const QString & directory, qint64 maxSize)
+    : m_directory(directory), m_maxSize(maxSize), m_evictionMutex()
+{}
+
+
+//=============================================================================
+// The function "defaultDirectory" returns the directory of the cache files
+// unless another one is given, under the user's cache location.
+//=============================================================================
+QString GeometryCache::defaultDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/Simple3D/geometry";
+}
+
+
+//=============================================================================
+// The function "setMaxSize" sets the limit of the total size of the cache
+// files and evicts entries beyond it.
+// INPUT: "qint64 maxSize" is the limit in bytes; 0 disables the cache.
+//=============================================================================
+void GeometryCache::setMaxSize(qint64 maxSize)
+{
+    m_maxSize = qMax(maxSize, qint64(0));
+    evict();
+}
+
+
+//=============================================================================
+// The function "entryFileName" finds the name of the cache file of a given
+// original file.
+// INPUT: "const QString & fileName" is the name of the original file.
+// The parts welded with a tolerance, or smoothed within a crease angle, have
+// entries of their own, one per tolerance and angle.
+// OUTPUT: The function returns the name of the cache file, or an empty string
+// if the original file can not be read.
+//=============================================================================
+QString GeometryCache::entryFileName(const QString & fileName) const
+{
+    const QByteArray key = geometryCacheKey(fileName);
+    if (key.isEmpty() == true)
+        return QString();
+    const float tolerance = weldTolerance();
+    const QString toleranceSuffix = (tolerance > 0.0f) ? "-w" + QString::number(tolerance, 'g', 9) : QString();
+    const float angle = creaseAngle();
+    const QString angleSuffix = (angle > 0.0f) ? "-s" + QString::number(angle, 'g', 9) : QString();
+    return m_directory + "/" + QString::fromLatin1(key) + toleranceSuffix + angleSuffix + s_cacheFileSuffix;
+}
+
+
+//=============================================================================
+// The function "load" restores a part from the cache. The cache file is
+// memory-mapped and the positions, the indices and the normals are copied in
+// parallel chunks. A file that turns out to be damaged is removed.
+// INPUT: "const QString & fileName" is the name of the original file.
+// "LoadProgress * progress", if given, tracks the progress of the reading.
+// OUTPUT: The function returns the part, ready to be managed, or null if it is
+// not in the cache.
+//=============================================================================
+std::shared_ptr<ManagedPart> GeometryCache::load(const QString & fileName, LoadProgress * progress) const
+{
+    if (m_maxSize <= 0)
+        return std::shared_ptr<ManagedPart>(nullptr);
+    const QString cacheFileName = entryFileName(fileName);
+    if ((cacheFileName.isEmpty() == true) || (QFile::exists(cacheFileName) == false))
+        return std::shared_ptr<ManagedPart>(nullptr);
+
+    // Map the cache file and check its header.
+    QFile file(cacheFileName);
+    if (file.open(QIODevice::ReadOnly) == false)
+        return std::shared_ptr<ManagedPart>(nullptr);
+    const qint64 fileSize = file.size();
+    const uchar * data = (fileSize >= qint64(sizeof(GeometryCacheHeader))) ? file.map(0, fileSize) : nullptr;
+    GeometryCacheHeader header;
+    qint64 indexOffset = 0;
+    qint64 normalOffset = 0;
+    qint64 vertexNormalOffset = 0;
+    bool isValid = (data != nullptr);
+    if (isValid == true)
+    {
+        memcpy(&header, data, sizeof(header));
+        isValid = (memcmp(header.magic, s_cacheMagic, sizeof(s_cacheMagic)) == 0) &&
+                (header.byteOrderMark == s_byteOrderMark) &&
+                (header.numTriangles > 0) && (header.numPositions > 0) &&
+                (header.numPositions <= 3 * header.numTriangles) &&
+                (header.numPositions < qint64(std::numeric_limits<quint32>::max())) &&
+                (sectionOffsets(header, indexOffset, normalOffset, vertexNormalOffset) == fileSize);
+    }
+    if (isValid == false)
+    {
+        qDebug() << "Removing the damaged cache file" << cacheFileName;
+        file.close();
+        QFile::remove(cacheFileName);
+        return std::shared_ptr<ManagedPart>(nullptr);
+    }
+    if (progress != nullptr)
+        progress->setNumBytesTotal(fileSize);
+
+    // Copy the sections in parallel chunks, each writing into its own slice
+    // of the output vectors.
+    const QVector3D * positions = reinterpret_cast<const QVector3D *>(data + alignedOffset(sizeof(header)));
+    const quint32 * indices = reinterpret_cast<const quint32 *>(data + indexOffset);
+    const PackedNormal * faceNormals = reinterpret_cast<const PackedNormal *>(data + normalOffset);
+    const PackedNormal * vertexNormals = reinterpret_cast<const PackedNormal *>(data + vertexNormalOffset);
+    const bool hasVertexNormals = ((header.flags & s_vertexNormalsFlag) != 0);
+    const qint64 numTriangles = header.numTriangles;
+    const quint32 numPositions = static_cast<quint32>(header.numPositions);
+    GeometryArray<QVector3D> positionArray(numPositions);
+    GeometryArray<quint32> indexArray(3 * numTriangles);
+    GeometryArray<PackedNormal> faceNormalArray(numTriangles);
+    GeometryArray<PackedNormal> vertexNormalArray((hasVertexNormals == true) ? 3 * numTriangles : 0);
+    QVector3D * positionOut = positionArray.data();
+    quint32 * indexOut = indexArray.data();
+    PackedNormal * faceNormalOut = faceNormalArray.data();
+    PackedNormal * normalOut = vertexNormalArray.data();
+    parallelForChunks(numPositions, s_cacheChunkSize, [=](qint64, qint64 begin, qint64 end)
+    {
+        std::copy(positions + begin, positions + end, positionOut + begin);
+    });
+    std::atomic<bool> hasBadIndex(false);
+    parallelForChunks(numTriangles, s_cacheChunkSize, [&](qint64, qint64 begin, qint64 end)
+    {
+        if (isLoadCanceled(progress) == true)
+            return;
+        for (qint64 i = 3 * begin; i < 3 * end; ++i)
+        {
+            const quint32 index = indices[i];
+            if (index >= numPositions)
+            {
+                hasBadIndex = true;
+                return;
+            }
+            indexOut[i] = index;
+        }
+        std::copy(faceNormals + begin, faceNormals + end, faceNormalOut + begin);
+        if (hasVertexNormals == true)
+            std::copy(vertexNormals + 3 * begin, vertexNormals + 3 * end, normalOut + 3 * begin);
+        reportLoadProgress(progress, fileSize * (end - begin) / numTriangles, end - begin);
+    });
+    if ((hasBadIndex == true) || (isLoadCanceled(progress) == true))
+    {
+        if (hasBadIndex == true)
+        {
+            qDebug() << "Removing the damaged cache file" << cacheFileName;
+            file.close();
+            QFile::remove(cacheFileName);
+        }
+        return std::shared_ptr<ManagedPart>(nullptr);
+    }
+    file.close();
+
+    // Mark the entry as recently used.
+    QFile touchedFile(cacheFileName);
+    if (touchedFile.open(QIODevice::ReadWrite) == true)
+        touchedFile.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+
+    std::shared_ptr<Part> part(new PartMesh(std::move(positionArray), std::move(indexArray),
+                                            std::move(faceNormalArray), std::move(vertexNormalArray)));
+    return std::make_shared<ManagedPart>(part, header.volume, header.area,
+                                         BoxSize(header.boxSize[0], header.boxSize[1], header.boxSize[2]),
+                                         QVector3D(header.origin[0], header.origin[1], header.origin[2]),
+                                         header.integrity);
+}
+
+
+//=============================================================================
+// The function "numTriangles" reads the number of triangles of a part from
+// the header of its cache file, without restoring the part.
+// INPUT: "const QString & fileName" is the name of the original file.
+// OUTPUT: The function returns the number of triangles, or -1 if the part is
+// not in the cache.
+//=============================================================================
+qint64 GeometryCache::numTriangles(const QString & fileName) const
+{
+    if (m_maxSize <= 0)
+        return -1;
+    const QString cacheFileName = entryFileName(fileName);
+    if (cacheFileName.isEmpty() == true)
+        return -1;
+    QFile file(cacheFileName);
+    GeometryCacheHeader header;
+    if ((file.open(QIODevice::ReadOnly) == false) ||
+        (file.read(reinterpret_cast<char *>(&header), sizeof(header)) != qint64(sizeof(header))) ||
+        (memcmp(header.magic, s_cacheMagic, sizeof(s_cacheMagic)) != 0) ||
+        (header.byteOrderMark != s_byteOrderMark) || (header.numTriangles <= 0))
+        return -1;
+    return header.numTriangles;
+}
+
+
+//=============================================================================
+// The function "store" adds a part read from a given file to the cache unless
+// it is already there. The welded positions, their indices, the packed face
+// normals and the vertex normals, if any, are stored as they are.
+// The file is written under a temporary name and renamed once complete, so a
+// concurrent reader never sees it partially written.
+// INPUT: "const QString & fileName" is the name of the original file.
+// "const ManagedPart & managedPart" is the part read from it.
+// OUTPUT: The function returns "true" if the part is in the cache afterwards,
+// and "false" otherwise.
+//=============================================================================
+bool GeometryCache::store(const QString & fileName, const ManagedPart & managedPart)
+{
+    if ((m_maxSize <= 0) || (managedPart.part() == nullptr))
+        return false;
+    const QString cacheFileName = entryFileName(fileName);
+    if (cacheFileName.isEmpty() == true)
+        return false;
+    if (QFile::exists(cacheFileName) == true)
+        return true;
+
+    const GeometryArray<QVector3D> & positions = managedPart.part()->positions();
+    const GeometryArray<quint32> & indices = managedPart.part()->indices();
+    const GeometryArray<PackedNormal> & faceNormals = managedPart.part()->faceNormals();
+    const GeometryArray<PackedNormal> & vertexNormals = managedPart.part()->vertexNormals();
+    const qint64 numTriangles = indices.size() / 3;
+    const bool hasVertexNormals = managedPart.part()->hasVertexNormals();
+    if ((numTriangles == 0) || (positions.isEmpty() == true) || (faceNormals.size() != numTriangles) ||
+        ((hasVertexNormals == true) && (vertexNormals.size() != indices.size())))
+        return false;
+
+    // Fill in the header.
+    GeometryCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, s_cacheMagic, sizeof(s_cacheMagic));
+    header.byteOrderMark = s_byteOrderMark;
+    header.flags = (hasVertexNormals == true) ? s_vertexNormalsFlag : 0;
+    header.numTriangles = numTriangles;
+    header.numPositions = positions.size();
+    header.volume = managedPart.volume();
+    header.area = managedPart.area();
+    header.integrity = managedPart.integrity();
+    header.boxSize[0] = managedPart.boxSize().x();
+    header.boxSize[1] = managedPart.boxSize().y();
+    header.boxSize[2] = managedPart.boxSize().z();
+    header.origin[0] = managedPart.origin().x();
+    header.origin[1] = managedPart.origin().y();
+    header.origin[2] = managedPart.origin().z();
+    qint64 indexOffset = 0;
+    qint64 normalOffset = 0;
+    qint64 vertexNormalOffset = 0;
+    const qint64 fileSize = sectionOffsets(header, indexOffset, normalOffset, vertexNormalOffset);
+
+    // Write the sections, padded to their offsets.
+    if (QDir().mkpath(m_directory) == false)
+        return false;
+    QSaveFile file(cacheFileName);
+    if (file.open(QIODevice::WriteOnly) == false)
+    {
+        qDebug() << "Could not write the cache file" << cacheFileName << ":" << file.errorString();
+        return false;
+    }
+    const QByteArray padding(static_cast<int>(s_sectionAlignment), '\0');
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(padding.constData(), alignedOffset(file.pos()) - file.pos());
+    file.write(reinterpret_cast<const char *>(positions.constData()), positions.size() * sizeof(QVector3D));
+    file.write(padding.constData(), indexOffset - file.pos());
+    file.write(reinterpret_cast<const char *>(indices.constData()), indices.size() * sizeof(quint32));
+    file.write(padding.constData(), normalOffset - file.pos());
+    file.write(reinterpret_cast<const char *>(faceNormals.constData()), faceNormals.size() * sizeof(PackedNormal));
+    if (hasVertexNormals == true)
+    {
+        file.write(padding.constData(), vertexNormalOffset - file.pos());
+        file.write(reinterpret_cast<const char *>(vertexNormals.constData()),
+                   vertexNormals.size() * sizeof(PackedNormal));
+    }
+    if ((file.pos() != fileSize) || (file.commit() == false))
+    {
+        qDebug() << "Could not write the cache file" << cacheFileName << ":" << file.errorString();
+        return false;
+    }
+
+    evict();
+    return true;
+}
+
+
+//=============================================================================
+// The function "evict" removes the least recently used cache files until the
+// total size of the cache files is within the limit.
+//=============================================================================
+void GeometryCache::evict()
+{
+    QMutexLocker locker(&m_evictionMutex);
+    QDir dir(m_directory);
+    if (dir.exists() == false)
+        return;
+
+    // The files are listed most recently used first.
+    const QFileInfoList entries = dir.entryInfoList(QStringList(QString("*") + s_cacheFileSuffix),
+                                                    QDir::Files, QDir::Time);
+    qint64 totalSize = 0;
+    for (auto cit = entries.cbegin(); cit != entries.cend(); ++cit)
+        totalSize += cit->size();
+    for (auto crit = entries.crbegin(); (crit != entries.crend()) && (totalSize > m_maxSize); ++crit)
+    {
+        if (QFile::remove(crit->absoluteFilePath()) == true)
+            totalSize -= crit->size();
+    }
+}
+
+
+//=============================================================================
+// The function "geometryCacheKey" computes the key of the cache entry of a
+// given file from its path, size, and modification time, and from the bytes
+// at both of its ends. Hashing the whole file would cost as much as reading
+// it, which is what the cache avoids.
+// INPUT: "const QString & fileName" is the name of the file.
+// OUTPUT: The function returns the key as a hexadecimal string, or an empty
+// one if the file can not be read.
+//=============================================================================
+QByteArray geometryCacheKey(const QString & fileName)
+{
+    QFileInfo info(fileName);
+    QFile file(fileName);
+    if ((info.exists() == false) || (file.open(QIODevice::ReadOnly) == false))
+        return QByteArray();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(info.absoluteFilePath().toUtf8());
+    const qint64 fileSize = info.size();
+    const qint64 modificationTime = info.lastModified().toMSecsSinceEpoch();
+    hash.addData(reinterpret_cast<const char *>(&fileSize), sizeof(fileSize));
+    hash.addData(reinterpret_cast<const char *>(&modificationTime), sizeof(modificationTime));
+    hash.addData(file.read(s_hashedEndSize));
+    if (fileSize > s_hashedEndSize)
+    {
+        file.seek(qMax(fileSize - s_hashedEndSize, s_hashedEndSize));
+        hash.addData(file.read(s_hashedEndSize));
+    }
+    return hash.result().toHex();
+}
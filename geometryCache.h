@@ -0,0 +1,71 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef GEOMETRY_CACHE_HEADER
+#define GEOMETRY_CACHE_HEADER
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <atomic>   // atomic
+#include <memory>   // shared_ptr
+#include "managedPart.h"
+
+class LoadProgress;
+
+// Default limit of the total size of the cache files, in bytes.
+const qint64 defaultGeometryCacheMaxSize = Q_INT64_C(4) * 1024 * 1024 * 1024;
+
+//=============================================================================
+// This class keeps the prepared geometry of parts read before in a directory
+// on disk, so that reading a part again maps a compact file instead of
+// parsing the original one. An entry is keyed by the path, the size, the
+// modification time and a content hash of the original file. The least
+// recently used entries are evicted once the cache grows beyond its limit.
+// All member functions are thread-safe.
+//=============================================================================
+class GeometryCache
+{
+public:
+    explicit GeometryCache(const QString & directory = defaultDirectory(),
+                           qint64 maxSize = defaultGeometryCacheMaxSize);
+
+    // Restore a part from the cache, if it is there.
+    std::shared_ptr<ManagedPart> load(const QString & fileName, LoadProgress * progress = nullptr) const;
+
+    // The number of triangles of a part in the cache, read from its header.
+    qint64 numTriangles(const QString & fileName) const;
+
+    // Add a part read from a given file to the cache.
+    bool store(const QString & fileName, const ManagedPart & managedPart);
+
+    // Set the limit of the total size of the cache files; 0 disables the cache.
+    void setMaxSize(qint64 maxSize);
+
+    // Accessors.
+    QString directory() const { return m_directory; }
+    qint64 maxSize() const { return m_maxSize; }
+
+    // The directory used unless another one is given.
+    static QString defaultDirectory();
+
+private:
+    QString entryFileName(const QString & fileName) const;
+    void evict();
+
+    QString m_directory;             // directory holding the cache files
+    std::atomic<qint64> m_maxSize;   // limit of the total size of the cache files
+    QMutex m_evictionMutex;          // serializes evictions
+};
+
+
+// Non-members.
+QByteArray geometryCacheKey(const QString & fileName);
+
+#endif // GEOMETRY_CACHE_HEADER
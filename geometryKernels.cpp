@@ -0,0 +1,817 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "geometryKernels.h"
+#include "parallelFor.h"
+
+#include <algorithm>  // copy
+#include <atomic>
+#include <cmath>      // sqrt
+#include <limits>     // numeric_limits
+#include <vector>
+
+// The vertices are read as arrays of floats.
+static_assert(sizeof(QVector3D) == 3 * sizeof(float), "QVector3D is expected to hold 3 floats");
+
+// SSE2 is part of every x86-64 processor. The wider instruction sets are
+// compiled into functions of their own and used only where the processor
+// supports them.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define GEOMETRY_KERNELS_USE_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(_MSC_VER)
+#define GEOMETRY_KERNELS_USE_AVX
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+#endif
+
+// GCC fuses multiplications and additions into FMA instructions wherever the
+// target has them, e.g., with AVX-512, which would make the sums depend on the
+// instruction set. The kernels are compiled without fusing.
+#if defined(__GNUC__) && !defined(__clang__)
+#define KERNEL_FUNCTION __attribute__((optimize("fp-contract=off")))
+#define KERNEL_TARGET_FUNCTION(isa) __attribute__((target(isa), optimize("fp-contract=off")))
+#elif defined(__GNUC__)
+#define KERNEL_FUNCTION
+#define KERNEL_TARGET_FUNCTION(isa) __attribute__((target(isa)))
+#else
+#define KERNEL_FUNCTION
+#define KERNEL_TARGET_FUNCTION(isa)
+#endif
+
+// Number of vertices whose ranges are found by a single task.
+static const qint64 s_rangeChunkSize = 3 * 65536;
+// Number of triangles measured by a single task. It is a multiple of the
+// number of sum lanes.
+static const qint64 s_measureChunkSize = 65536;
+// Number of partial sums every chunk keeps of a measure, whatever the width
+// of the registers, so that the sums are the same with every instruction
+// set: triangle "i" of a chunk goes to lane "i % s_numSumLanes".
+static const int s_numSumLanes = 8;
+// Highest instruction set the kernels are allowed to use.
+static std::atomic<int> s_maxSimdLevel(static_cast<int>(SimdLevel::Avx512));
+
+
+//=============================================================================
+// The class "LaneSums" holds the partial sums of the measures of the
+// triangles of a chunk, each sum along with the error of its rounding.
+//=============================================================================
+struct LaneSums
+{
+    double volumeSum[s_numSumLanes];   // sums of six times the signed volumes
+    double volumeError[s_numSumLanes]; // rounding errors of the volume sums
+    double areaSum[s_numSumLanes];     // sums of twice the areas
+    double areaError[s_numSumLanes];   // rounding errors of the area sums
+};
+
+
+//=============================================================================
+// The function "supportedSimdLevel" finds the widest instruction set the
+// processor and the operating system support, once.
+// OUTPUT: The function returns the instruction set.
+// NOTE: This is a non-member function.
+//=============================================================================
+SimdLevel supportedSimdLevel()
+{
+#if defined(GEOMETRY_KERNELS_USE_AVX) && defined(_MSC_VER)
+    static const SimdLevel level = []()
+    {
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return SimdLevel::Sse2;
+        // The operating system must save the wide registers.
+        __cpuid(info, 1);
+        if ((info[2] & (1 << 27)) == 0)
+            return SimdLevel::Sse2;
+        const unsigned long long enabledStates = _xgetbv(0);
+        __cpuidex(info, 7, 0);
+        if (((info[1] & (1 << 16)) != 0) && ((enabledStates & 0xE6) == 0xE6))
+            return SimdLevel::Avx512;
+        if (((info[1] & (1 << 5)) != 0) && ((enabledStates & 0x06) == 0x06))
+            return SimdLevel::Avx2;
+        return SimdLevel::Sse2;
+    }();
+    return level;
+#elif defined(GEOMETRY_KERNELS_USE_AVX)
+    // The checks include the support of the operating system.
+    static const SimdLevel level = []()
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return SimdLevel::Avx512;
+        if (__builtin_cpu_supports("avx2"))
+            return SimdLevel::Avx2;
+        return SimdLevel::Sse2;
+    }();
+    return level;
+#elif defined(GEOMETRY_KERNELS_USE_SSE2)
+    return SimdLevel::Sse2;
+#else
+    return SimdLevel::None;
+#endif
+}
+
+
+//=============================================================================
+// The function "simdLevel" finds the instruction set the kernels use.
+// OUTPUT: The function returns the widest supported instruction set that is
+// allowed.
+// NOTE: This is a non-member function.
+//=============================================================================
+SimdLevel simdLevel()
+{
+    return static_cast<SimdLevel>(qMin(static_cast<int>(supportedSimdLevel()), s_maxSimdLevel.load()));
+}
+
+
+//=============================================================================
+// The function "setMaxSimdLevel" limits the instruction set the kernels use,
+// e.g., to compare the results of different instruction sets.
+// INPUT: "SimdLevel maxLevel" is the highest instruction set allowed.
+// NOTE: This is a non-member function.
+//=============================================================================
+void setMaxSimdLevel(SimdLevel maxLevel)
+{
+    s_maxSimdLevel = static_cast<int>(maxLevel);
+}
+
+
+//=============================================================================
+// The function "foldCoordinateRanges" folds the smallest and largest values
+// of a block of consecutive coordinates into the coordinate ranges.
+// INPUT: "const float * minValues" and "const float * maxValues" are the
+// smallest and largest values of the block, per position.
+// "int blockSize" is the size of the block, a multiple of 3 starting at an x
+// coordinate.
+// OUTPUT: "float * minCoord" and "float * maxCoord" are updated.
+// NOTE: This is a non-member function.
+//=============================================================================
+static void foldCoordinateRanges(const float * minValues, const float * maxValues, int blockSize,
+                                 float * minCoord, float * maxCoord)
+{
+    for (int i = 0; i < blockSize; ++i)
+    {
+        minCoord[i % 3] = qMin(minCoord[i % 3], minValues[i]);
+        maxCoord[i % 3] = qMax(maxCoord[i % 3], maxValues[i]);
+    }
+}
+
+
+//=============================================================================
+// The function "findCoordinateRangesScalar" finds the ranges of the
+// coordinates of a range of vertices one coordinate at a time. It also
+// finishes the vertices left over by the vector versions.
+// INPUT: "const float * coords" are the coordinates of the vertices.
+// "qint64 begin" and "qint64 end" specify the range [begin, end) of
+// coordinates, both multiples of 3.
+// OUTPUT: "float * minCoord" and "float * maxCoord" are updated.
+// NOTE: This is a non-member function.
+//=============================================================================
+static void findCoordinateRangesScalar(const float * coords, qint64 begin, qint64 end,
+                                       float * minCoord, float * maxCoord)
+{
+    for (qint64 i = begin; i < end; i += 3)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            minCoord[k] = qMin(minCoord[k], coords[i + k]);
+            maxCoord[k] = qMax(maxCoord[k], coords[i + k]);
+        }
+    }
+}
+
+
+#ifdef GEOMETRY_KERNELS_USE_SSE2
+//=============================================================================
+// The function "findCoordinateRangesSse2" is the SSE2 version of
+// "findCoordinateRangesScalar". Blocks of 4 vertices are taken as 3
+// registers, the positions of which hold the same coordinates from block to
+// block.
+// NOTE: This is a non-member function.
+//=============================================================================
+static void findCoordinateRangesSse2(const float * coords, qint64 begin, qint64 end,
+                                     float * minCoord, float * maxCoord)
+{
+    const int blockSize = 12;
+    if (end - begin < blockSize)
+    {
+        findCoordinateRangesScalar(coords, begin, end, minCoord, maxCoord);
+        return;
+    }
+    __m128 minValues[3];
+    __m128 maxValues[3];
+    for (int k = 0; k < 3; ++k)
+        minValues[k] = maxValues[k] = _mm_loadu_ps(coords + begin + 4 * k);
+    qint64 i = begin;
+    for (; i + blockSize <= end; i += blockSize)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            const __m128 values = _mm_loadu_ps(coords + i + 4 * k);
+            minValues[k] = _mm_min_ps(minValues[k], values);
+            maxValues[k] = _mm_max_ps(maxValues[k], values);
+        }
+    }
+    float minBlock[blockSize];
+    float maxBlock[blockSize];
+    for (int k = 0; k < 3; ++k)
+    {
+        _mm_storeu_ps(minBlock + 4 * k, minValues[k]);
+        _mm_storeu_ps(maxBlock + 4 * k, maxValues[k]);
+    }
+    foldCoordinateRanges(minBlock, maxBlock, blockSize, minCoord, maxCoord);
+    findCoordinateRangesScalar(coords, i, end, minCoord, maxCoord);
+}
+#endif // GEOMETRY_KERNELS_USE_SSE2
+
+
+#ifdef GEOMETRY_KERNELS_USE_AVX
+//=============================================================================
+// The function "findCoordinateRangesAvx2" is the AVX2 version of
+// "findCoordinateRangesScalar", taking blocks of 8 vertices.
+// NOTE: This is a non-member function.
+//=============================================================================
+KERNEL_TARGET_FUNCTION("avx2")
+static void findCoordinateRangesAvx2(const float * coords, qint64 begin, qint64 end,
+                                     float * minCoord, float * maxCoord)
+{
+    const int blockSize = 24;
+    if (end - begin < blockSize)
+    {
+        findCoordinateRangesScalar(coords, begin, end, minCoord, maxCoord);
+        return;
+    }
+    __m256 minValues[3];
+    __m256 maxValues[3];
+    for (int k = 0; k < 3; ++k)
+        minValues[k] = maxValues[k] = _mm256_loadu_ps(coords + begin + 8 * k);
+    qint64 i = begin;
+    for (; i + blockSize <= end; i += blockSize)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            const __m256 values = _mm256_loadu_ps(coords + i + 8 * k);
+            minValues[k] = _mm256_min_ps(minValues[k], values);
+            maxValues[k] = _mm256_max_ps(maxValues[k], values);
+        }
+    }
+    float minBlock[blockSize];
+    float maxBlock[blockSize];
+    for (int k = 0; k < 3; ++k)
+    {
+        _mm256_storeu_ps(minBlock + 8 * k, minValues[k]);
+        _mm256_storeu_ps(maxBlock + 8 * k, maxValues[k]);
+    }
+    foldCoordinateRanges(minBlock, maxBlock, blockSize, minCoord, maxCoord);
+    findCoordinateRangesScalar(coords, i, end, minCoord, maxCoord);
+}
+
+
+//=============================================================================
+// The function "findCoordinateRangesAvx512" is the AVX-512 version of
+// "findCoordinateRangesScalar", taking blocks of 16 vertices.
+// NOTE: This is a non-member function.
+//=============================================================================
+KERNEL_TARGET_FUNCTION("avx512f")
+static void findCoordinateRangesAvx512(const float * coords, qint64 begin, qint64 end,
+                                       float * minCoord, float * maxCoord)
+{
+    const int blockSize = 48;
+    if (end - begin < blockSize)
+    {
+        findCoordinateRangesScalar(coords, begin, end, minCoord, maxCoord);
+        return;
+    }
+    __m512 minValues[3];
+    __m512 maxValues[3];
+    for (int k = 0; k < 3; ++k)
+        minValues[k] = maxValues[k] = _mm512_loadu_ps(coords + begin + 16 * k);
+    qint64 i = begin;
+    for (; i + blockSize <= end; i += blockSize)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            const __m512 values = _mm512_loadu_ps(coords + i + 16 * k);
+            minValues[k] = _mm512_min_ps(minValues[k], values);
+            maxValues[k] = _mm512_max_ps(maxValues[k], values);
+        }
+    }
+    float minBlock[blockSize];
+    float maxBlock[blockSize];
+    for (int k = 0; k < 3; ++k)
+    {
+        _mm512_storeu_ps(minBlock + 16 * k, minValues[k]);
+        _mm512_storeu_ps(maxBlock + 16 * k, maxValues[k]);
+    }
+    foldCoordinateRanges(minBlock, maxBlock, blockSize, minCoord, maxCoord);
+    findCoordinateRangesScalar(coords, i, end, minCoord, maxCoord);
+}
+#endif // GEOMETRY_KERNELS_USE_AVX
+
+
+//=============================================================================
+// The function "findChunkCoordinateRanges" finds the ranges of the
+// coordinates of a range of vertices with the allowed instruction set.
+// INPUT: "const QVector3D * vertices" are the vertices.
+// "qint64 begin" and "qint64 end" specify the nonempty range [begin, end) of
+// vertices.
+// "SimdLevel level" is the instruction set to use.
+// OUTPUT: "float * minCoord" and "float * maxCoord" return the smallest and
+// the largest x, y, and z coordinates.
+// NOTE: This is a non-member function.
+//=============================================================================
+static void findChunkCoordinateRanges(const QVector3D * vertices, qint64 begin, qint64 end, SimdLevel level,
+                                      float * minCoord, float * maxCoord)
+{
+    const float * coords = reinterpret_cast<const float *>(vertices);
+    for (int k = 0; k < 3; ++k)
+        minCoord[k] = maxCoord[k] = coords[3 * begin + k];
+    switch (level)
+    {
+#ifdef GEOMETRY_KERNELS_USE_AVX
+    case SimdLevel::Avx512:
+        findCoordinateRangesAvx512(coords, 3 * begin, 3 * end, minCoord, maxCoord);
+        break;
+    case SimdLevel::Avx2:
+        findCoordinateRangesAvx2(coords, 3 * begin, 3 * end, minCoord, maxCoord);
+        break;
+#endif
+#ifdef GEOMETRY_KERNELS_USE_SSE2
+    case SimdLevel::Sse2:
+        findCoordinateRangesSse2(coords, 3 * begin, 3 * end, minCoord, maxCoord);
+        break;
+#endif
+    default:
+        findCoordinateRangesScalar(coords, 3 * begin, 3 * end, minCoord, maxCoord);
+        break;
+    }
+}
+
+
+//=============================================================================
+// The function "addCompensated" adds a value to a sum and accumulates the
+// error of the rounding, which the two-sum algorithm finds exactly.
+// INPUT: "double value" is the value to be added.
+// OUTPUT: "double & sum" and "double & error" are updated.
+// NOTE: This is a non-member function.
+//=============================================================================
+KERNEL_FUNCTION
+static inline void addCompensated(double value, double & sum, double & error)
+{
+    const double newSum = sum + value;
+    const double addend = newSum - sum;
+    error += (sum - (newSum - addend)) + (value - addend);
+    sum = newSum;
+}
+
+
+//=============================================================================
+// The function "measureTrianglesScalar" sums the measures of a range of
+// triangles one triangle at a time, in the order and with the operations of
+// the vector versions. Every triangle is taken relative to a reference point,
+// which keeps the terms of the volume small for parts far from the origin.
+// INPUT: "const QVector3D * positions" are the positions of the vertices.
+// "const quint32 * indices" are the indices of the positions, 3 per triangle.
+// "qint64 begin" and "qint64 end" specify the range [begin, end) of
+// triangles, whose size is a multiple of "s_numSumLanes".
+// "const QVector3D & reference" is the reference point.
+// OUTPUT: "LaneSums & sums" is updated.
+// NOTE: This is a non-member function.
+//=============================================================================
+KERNEL_FUNCTION
+static void measureTrianglesScalar(const QVector3D * positions, const quint32 * indices, qint64 begin, qint64 end,
+                                   const QVector3D & reference, LaneSums & sums)
+{
+    const float * coords = reinterpret_cast<const float *>(positions);
+    const double ref[3] = {reference.x(), reference.y(), reference.z()};
+    for (qint64 t = begin; t < end; ++t)
+    {
+        double c[9];
+        for (int k = 0; k < 9; ++k)
+            c[k] = double(coords[3 * qint64(indices[3 * t + k / 3]) + k % 3]) - ref[k % 3];
+        // Six times the signed volume of the tetrahedron spanned with the
+        // reference point.
+        const double crossX = c[4] * c[8] - c[5] * c[7];
+        const double crossY = c[5] * c[6] - c[3] * c[8];
+        const double crossZ = c[3] * c[7] - c[4] * c[6];
+        const double volume = c[0] * crossX + c[1] * crossY + c[2] * crossZ;
+        // Twice the area of the triangle.
+        const double ux = c[3] - c[0], uy = c[4] - c[1], uz = c[5] - c[2];
+        const double vx = c[6] - c[0], vy = c[7] - c[1], vz = c[8] - c[2];
+        const double nx = uy * vz - uz * vy;
+        const double ny = uz * vx - ux * vz;
+        const double nz = ux * vy - uy * vx;
+        const double area = std::sqrt(nx * nx + ny * ny + nz * nz);
+
+        const int lane = static_cast<int>((t - begin) % s_numSumLanes);
+        addCompensated(volume, sums.volumeSum[lane], sums.volumeError[lane]);
+        addCompensated(area, sums.areaSum[lane], sums.areaError[lane]);
+    }
+}
+
+
+#ifdef GEOMETRY_KERNELS_USE_SSE2
+//=============================================================================
+// The function "addCompensatedSse2" is the SSE2 version of "addCompensated"
+// for two values at a time.
+// NOTE: This is a non-member function.
+//=============================================================================
+KERNEL_FUNCTION
+static inline void addCompensatedSse2(__m128d value, __m128d & sum, __m128d & error)
+{
+    const __m128d newSum = _mm_add_pd(sum, value);
+    const __m128d addend = _mm_sub_pd(newSum, sum);
+    error = _mm_add_pd(error, _mm_add_pd(_mm_sub_pd(sum, _mm_sub_pd(newSum, addend)), _mm_sub_pd(value, addend)));
+    sum = newSum;
+}
+
+
+//=============================================================================
+// The function "measureTrianglesSse2" is the SSE2 version of
+// "measureTrianglesScalar". Two triangles are measured at a time, each in a
+// lane of the registers, and every register of sums covers two of the lanes
+// of the sums.
+// NOTE: This is a non-member function.
+//=============================================================================
+KERNEL_FUNCTION
+static void measureTrianglesSse2(const QVector3D * positions, const quint32 * indices, qint64 begin, qint64 end,
+                                 const QVector3D & reference, LaneSums & sums)
+{
+    const int numRegisters = s_numSumLanes / 2;
+    const float * coords = reinterpret_cast<const float *>(positions);
+    const __m128d ref[3] = {_mm_set1_pd(reference.x()), _mm_set1_pd(reference.y()), _mm_set1_pd(reference.z())};
+    __m128d volumeSum[numRegisters], volumeError[numRegisters], areaSum[numRegisters], areaError[numRegisters];
+    for (int r = 0; r < numRegisters; ++r)
+    {
+        volumeSum[r] = _mm_loadu_pd(sums.volumeSum + 2 * r);
+        volumeError[r] = _mm_loadu_pd(sums.volumeError + 2 * r);
+        areaSum[r] = _mm_loadu_pd(sums.areaSum + 2 * r);
+        areaError[r] = _mm_loadu_pd(sums.areaError + 2 * r);
+    }
+    for (qint64 t = begin; t < end; t += s_numSumLanes)
+    {
+        for (int r = 0; r < numRegisters; ++r)
+        {
+            const quint32 * corners = indices + 3 * (t + 2 * r);
+            __m128d c[9];
+            for (int k = 0; k < 9; ++k)
+                c[k] = _mm_sub_pd(_mm_set_pd(coords[3 * qint64(corners[3 + k / 3]) + k % 3],
+                                             coords[3 * qint64(corners[k / 3]) + k % 3]), ref[k % 3]);
+            const __m128d crossX = _mm_sub_pd(_mm_mul_pd(c[4], c[8]), _mm_mul_pd(c[5], c[7]));
+            const __m128d crossY = _mm_sub_pd(_mm_mul_pd(c[5], c[6]), _mm_mul_pd(c[3], c[8]));
+            const __m128d crossZ = _mm_sub_pd(_mm_mul_pd(c[3], c[7]), _mm_mul_pd(c[4], c[6]));
+            const __m128d volume = _mm_add_pd(_mm_add_pd(_mm_mul_pd(c[0], crossX), _mm_mul_pd(c[1], crossY)),
+                                              _mm_mul_pd(c[2], crossZ));
+            const __m128d ux = _mm_sub_pd(c[3], c[0]), uy = _mm_sub_pd(c[4], c[1]), uz = _mm_sub_pd(c[5], c[2]);
+            const __m128d vx = _mm_sub_pd(c[6], c[0]), vy = _mm_sub_pd(c[7], c[1]), vz = _mm_sub_pd(c[8], c[2]);
+            const __m128d nx = _mm_sub_pd(_mm_mul_pd(uy, vz), _mm_mul_pd(uz, vy));
+            const __m128d ny = _mm_sub_pd(_mm_mul_pd(uz, vx), _mm_mul_pd(ux, vz));
+            const __m128d nz = _mm_sub_pd(_mm_mul_pd(ux, vy), _mm_mul_pd(uy, vx));
+            const __m128d area = _mm_sqrt_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(nx, nx), _mm_mul_pd(ny, ny)),
+                                                        _mm_mul_pd(nz, nz)));
+            addCompensatedSse2(volume, volumeSum[r], volumeError[r]);
+            addCompensatedSse2(area, areaSum[r], areaError[r]);
+        }
+    }
+    for (int r = 0; r < numRegisters; ++r)
+    {
+        _mm_storeu_pd(sums.volumeSum + 2 * r, volumeSum[r]);
+        _mm_storeu_pd(sums.volumeError + 2 * r, volumeError[r]);
+        _mm_storeu_pd(sums.areaSum + 2 * r, areaSum[r]);
+        _mm_storeu_pd(sums.areaError + 2 * r, areaError[r]);
+    }
+}
+#endif // GEOMETRY_KERNELS_USE_SSE2
+
+
+#ifdef GEOMETRY_KERNELS_USE_AVX
+//=============================================================================
+// The function "addCompensatedAvx2" is the AVX2 version of "addCompensated"
+// for four values at a time.
+// NOTE: This is a non-member function.
+//=============================================================================
+KERNEL_TARGET_FUNCTION("avx2")
+static inline void addCompensatedAvx2(__m256d value, __m256d & sum, __m256d & error)
+{
+    const __m256d newSum = _mm256_add_pd(sum, value);
+    const __m256d addend = _mm256_sub_pd(newSum, sum);
+    error = _mm256_add_pd(error, _mm256_add_pd(_mm256_sub_pd(sum, _mm256_sub_pd(newSum, addend)),
+                                               _mm256_sub_pd(value, addend)));
+    sum = newSum;
+}
+
+
+//=============================================================================
+// The function "measureTrianglesAvx2" is the AVX2 version of
+// "measureTrianglesScalar". The indices and then the coordinates of 8
+// triangles are gathered at a time, and measured 4 at a time, each in a lane
+// of the registers. The offsets of the coordinates must fit in 32 bits.
+// NOTE: This is a non-member function.
+//=============================================================================
+KERNEL_TARGET_FUNCTION("avx2")
+static void measureTrianglesAvx2(const QVector3D * positions, const quint32 * indices, qint64 begin, qint64 end,
+                                 const QVector3D & reference, LaneSums & sums)
+{
+    const int numRegisters = s_numSumLanes / 4;
+    const float * coords = reinterpret_cast<const float *>(positions);
+    const __m256i cornerOffsets = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const __m256d ref[3] = {_mm256_set1_pd(reference.x()), _mm256_set1_pd(reference.y()),
+                            _mm256_set1_pd(reference.z())};
+    __m256d volumeSum[numRegisters], volumeError[numRegisters], areaSum[numRegisters], areaError[numRegisters];
+    for (int r = 0; r < numRegisters; ++r)
+    {
+        volumeSum[r] = _mm256_loadu_pd(sums.volumeSum + 4 * r);
+        volumeError[r] = _mm256_loadu_pd(sums.volumeError + 4 * r);
+        areaSum[r] = _mm256_loadu_pd(sums.areaSum + 4 * r);
+        areaError[r] = _mm256_loadu_pd(sums.areaError + 4 * r);
+    }
+    for (qint64 t = begin; t < end; t += s_numSumLanes)
+    {
+        __m256d gathered[2][9];
+        for (int j = 0; j < 3; ++j)
+        {
+            const __m256i index = _mm256_i32gather_epi32(reinterpret_cast<const int *>(indices + 3 * t + j),
+                                                         cornerOffsets, 4);
+            const __m256i offsets = _mm256_add_epi32(index, _mm256_add_epi32(index, index));
+            for (int m = 0; m < 3; ++m)
+            {
+                const int k = 3 * j + m;
+                const __m256 values = _mm256_i32gather_ps(coords + m, offsets, 4);
+                gathered[0][k] = _mm256_sub_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(values)), ref[m]);
+                gathered[1][k] = _mm256_sub_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(values, 1)), ref[m]);
+            }
+        }
+        for (int r = 0; r < numRegisters; ++r)
+        {
+            const __m256d * c = gathered[r];
+            const __m256d crossX = _mm256_sub_pd(_mm256_mul_pd(c[4], c[8]), _mm256_mul_pd(c[5], c[7]));
+            const __m256d crossY = _mm256_sub_pd(_mm256_mul_pd(c[5], c[6]), _mm256_mul_pd(c[3], c[8]));
+            const __m256d crossZ = _mm256_sub_pd(_mm256_mul_pd(c[3], c[7]), _mm256_mul_pd(c[4], c[6]));
+            const __m256d volume = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(c[0], crossX),
+                                                               _mm256_mul_pd(c[1], crossY)),
+                                                 _mm256_mul_pd(c[2], crossZ));
+            const __m256d ux = _mm256_sub_pd(c[3], c[0]), uy = _mm256_sub_pd(c[4], c[1]);
+            const __m256d uz = _mm256_sub_pd(c[5], c[2]), vx = _mm256_sub_pd(c[6], c[0]);
+            const __m256d vy = _mm256_sub_pd(c[7], c[1]), vz = _mm256_sub_pd(c[8], c[2]);
+            const __m256d nx = _mm256_sub_pd(_mm256_mul_pd(uy, vz), _mm256_mul_pd(uz, vy));
+            const __m256d ny = _mm256_sub_pd(_mm256_mul_pd(uz, vx), _mm256_mul_pd(ux, vz));
+            const __m256d nz = _mm256_sub_pd(_mm256_mul_pd(ux, vy), _mm256_mul_pd(uy, vx));
+            const __m256d area = _mm256_sqrt_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(nx, nx),
+                                                                            _mm256_mul_pd(ny, ny)),
+                                                              _mm256_mul_pd(nz, nz)));
+            addCompensatedAvx2(volume, volumeSum[r], volumeError[r]);
+            addCompensatedAvx2(area, areaSum[r], areaError[r]);
+        }
+    }
+    for (int r = 0; r < numRegisters; ++r)
+    {
+        _mm256_storeu_pd(sums.volumeSum + 4 * r, volumeSum[r]);
+        _mm256_storeu_pd(sums.volumeError + 4 * r, volumeError[r]);
+        _mm256_storeu_pd(sums.areaSum + 4 * r, areaSum[r]);
+        _mm256_storeu_pd(sums.areaError + 4 * r, areaError[r]);
+    }
+}
+
+
+//=============================================================================
+// The function "addCompensatedAvx512" is the AVX-512 version of
+// "addCompensated" for eight values at a time.
+// NOTE: This is a non-member function.
+//=============================================================================
+KERNEL_TARGET_FUNCTION("avx512f")
+static inline void addCompensatedAvx512(__m512d value, __m512d & sum, __m512d & error)
+{
+    const __m512d newSum = _mm512_add_pd(sum, value);
+    const __m512d addend = _mm512_sub_pd(newSum, sum);
+    error = _mm512_add_pd(error, _mm512_add_pd(_mm512_sub_pd(sum, _mm512_sub_pd(newSum, addend)),
+                                               _mm512_sub_pd(value, addend)));
+    sum = newSum;
+}
+
+
+//=============================================================================
+// The function "measureTrianglesAvx512" is the AVX-512 version of
+// "measureTrianglesScalar". The indices and then the coordinates of 8
+// triangles are gathered and measured at a time, each in a lane of the
+// registers. The offsets of the coordinates must fit in 32 bits.
+// NOTE: This is a non-member function.
+//=============================================================================
+KERNEL_TARGET_FUNCTION("avx512f")
+static void measureTrianglesAvx512(const QVector3D * positions, const quint32 * indices, qint64 begin, qint64 end,
+                                   const QVector3D & reference, LaneSums & sums)
+{
+    const float * coords = reinterpret_cast<const float *>(positions);
+    const __m256i cornerOffsets = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const __m512d ref[3] = {_mm512_set1_pd(reference.x()), _mm512_set1_pd(reference.y()),
+                            _mm512_set1_pd(reference.z())};
+    __m512d volumeSum = _mm512_loadu_pd(sums.volumeSum);
+    __m512d volumeError = _mm512_loadu_pd(sums.volumeError);
+    __m512d areaSum = _mm512_loadu_pd(sums.areaSum);
+    __m512d areaError = _mm512_loadu_pd(sums.areaError);
+    for (qint64 t = begin; t < end; t += s_numSumLanes)
+    {
+        __m512d c[9];
+        for (int j = 0; j < 3; ++j)
+        {
+            const __m256i index = _mm256_i32gather_epi32(reinterpret_cast<const int *>(indices + 3 * t + j),
+                                                         cornerOffsets, 4);
+            const __m256i offsets = _mm256_add_epi32(index, _mm256_add_epi32(index, index));
+            for (int m = 0; m < 3; ++m)
+                c[3 * j + m] = _mm512_sub_pd(_mm512_cvtps_pd(_mm256_i32gather_ps(coords + m, offsets, 4)), ref[m]);
+        }
+        const __m512d crossX = _mm512_sub_pd(_mm512_mul_pd(c[4], c[8]), _mm512_mul_pd(c[5], c[7]));
+        const __m512d crossY = _mm512_sub_pd(_mm512_mul_pd(c[5], c[6]), _mm512_mul_pd(c[3], c[8]));
+        const __m512d crossZ = _mm512_sub_pd(_mm512_mul_pd(c[3], c[7]), _mm512_mul_pd(c[4], c[6]));
+        const __m512d volume = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(c[0], crossX),
+                                                           _mm512_mul_pd(c[1], crossY)),
+                                             _mm512_mul_pd(c[2], crossZ));
+        const __m512d ux = _mm512_sub_pd(c[3], c[0]), uy = _mm512_sub_pd(c[4], c[1]);
+        const __m512d uz = _mm512_sub_pd(c[5], c[2]), vx = _mm512_sub_pd(c[6], c[0]);
+        const __m512d vy = _mm512_sub_pd(c[7], c[1]), vz = _mm512_sub_pd(c[8], c[2]);
+        const __m512d nx = _mm512_sub_pd(_mm512_mul_pd(uy, vz), _mm512_mul_pd(uz, vy));
+        const __m512d ny = _mm512_sub_pd(_mm512_mul_pd(uz, vx), _mm512_mul_pd(ux, vz));
+        const __m512d nz = _mm512_sub_pd(_mm512_mul_pd(ux, vy), _mm512_mul_pd(uy, vx));
+        const __m512d area = _mm512_sqrt_pd(_mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(nx, nx),
+                                                                        _mm512_mul_pd(ny, ny)),
+                                                          _mm512_mul_pd(nz, nz)));
+        addCompensatedAvx512(volume, volumeSum, volumeError);
+        addCompensatedAvx512(area, areaSum, areaError);
+    }
+    _mm512_storeu_pd(sums.volumeSum, volumeSum);
+    _mm512_storeu_pd(sums.volumeError, volumeError);
+    _mm512_storeu_pd(sums.areaSum, areaSum);
+    _mm512_storeu_pd(sums.areaError, areaError);
+}
+#endif // GEOMETRY_KERNELS_USE_AVX
+
+
+//=============================================================================
+// The function "measureChunkTriangles" sums the measures of a range of
+// triangles with the allowed instruction set. The triangles left over after
+// the last full group of "s_numSumLanes" are padded with triangles collapsed
+// to the reference point, which add exact zeros, so that every triangle goes
+// through the same operations.
+// INPUT: "const QVector3D * positions" are the positions of the vertices.
+// "const quint32 * indices" are the indices of the positions, 3 per triangle.
+// "qint64 begin" and "qint64 end" specify the range [begin, end) of triangles.
+// "const QVector3D & reference" is the reference point.
+// "SimdLevel level" is the instruction set to use.
+// OUTPUT: "LaneSums & sums" returns the sums.
+// NOTE: This is a non-member function.
+//=============================================================================
+static void measureChunkTriangles(const QVector3D * positions, const quint32 * indices, qint64 begin, qint64 end,
+                                  const QVector3D & reference, SimdLevel level, LaneSums & sums)
+{
+    void (* measure)(const QVector3D *, const quint32 *, qint64, qint64, const QVector3D &, LaneSums &) =
+            measureTrianglesScalar;
+    switch (level)
+    {
+#ifdef GEOMETRY_KERNELS_USE_AVX
+    case SimdLevel::Avx512:
+        measure = measureTrianglesAvx512;
+        break;
+    case SimdLevel::Avx2:
+        measure = measureTrianglesAvx2;
+        break;
+#endif
+#ifdef GEOMETRY_KERNELS_USE_SSE2
+    case SimdLevel::Sse2:
+        measure = measureTrianglesSse2;
+        break;
+#endif
+    default:
+        break;
+    }
+
+    for (int lane = 0; lane < s_numSumLanes; ++lane)
+        sums.volumeSum[lane] = sums.volumeError[lane] = sums.areaSum[lane] = sums.areaError[lane] = 0.0;
+    const qint64 fullEnd = begin + (end - begin) / s_numSumLanes * s_numSumLanes;
+    measure(positions, indices, begin, fullEnd, reference, sums);
+    if (fullEnd < end)
+    {
+        QVector3D padded[3 * s_numSumLanes];
+        quint32 paddedIndices[3 * s_numSumLanes];
+        for (int i = 0; i < 3 * s_numSumLanes; ++i)
+        {
+            padded[i] = (i < 3 * (end - fullEnd)) ? positions[indices[3 * fullEnd + i]] : reference;
+            paddedIndices[i] = static_cast<quint32>(i);
+        }
+        measure(padded, paddedIndices, 0, s_numSumLanes, reference, sums);
+    }
+}
+
+
+//=============================================================================
+// The function "findCoordinateRanges" finds the smallest and largest of
+// coordinates of a collection of 3D vectors. The vectors are split into
+// chunks of fixed size, whose ranges are found in parallel with the widest
+// instruction set available.
+// INPUT: "const QVector3D * vertices" is a collection of 3D vectors.
+// "qint64 numVertices" is the number of the vectors.
+// OUTPUT: "QVector3D & minCoord" returns the smallest x, y, and z coordinates.
+// "QVector3D & maxCoord" returns the largest x, y, and z coordinates.
+// Both are zero if there are no vectors.
+// NOTE: This is a non-member function.
+//=============================================================================
+void findCoordinateRanges(const QVector3D * vertices, qint64 numVertices,
+                          QVector3D & minCoord, QVector3D & maxCoord)
+{
+    minCoord = maxCoord = QVector3D();
+    if (numVertices <= 0)
+        return;
+    const SimdLevel level = simdLevel();
+    std::vector<float> chunkRanges(static_cast<size_t>(6 * numChunks(numVertices, s_rangeChunkSize)));
+    float * chunkRangeData = chunkRanges.data();
+    parallelForChunks(numVertices, s_rangeChunkSize, [=](qint64 chunkIndex, qint64 begin, qint64 end)
+    {
+        float * ranges = chunkRangeData + 6 * chunkIndex;
+        findChunkCoordinateRanges(vertices, begin, end, level, ranges, ranges + 3);
+    });
+
+    float ranges[6];
+    std::copy(chunkRanges.cbegin(), chunkRanges.cbegin() + 6, ranges);
+    for (size_t i = 6; i < chunkRanges.size(); i += 6)
+        foldCoordinateRanges(&chunkRanges[i], &chunkRanges[i + 3], 3, ranges, ranges + 3);
+    minCoord = QVector3D(ranges[0], ranges[1], ranges[2]);
+    maxCoord = QVector3D(ranges[3], ranges[4], ranges[5]);
+}
+
+
+//=============================================================================
+// The function "measureTriangles" finds the ranges of the coordinates, the
+// signed volume and the area of an indexed triangle mesh. The ranges are
+// those of the positions. The triangles are split into chunks of fixed size,
+// measured in parallel with the widest instruction set available. Every chunk sums the
+// volumes and the areas in a fixed number of lanes with compensated double
+// precision, and the sums of the chunks are added up in order, so the
+// results are the same whatever the number of threads and the instruction
+// set. Another pass over the triangles may be fused into this one: it runs
+// on every chunk right before the chunk is measured, on the same thread,
+// while the positions of the chunk are in the cache.
+// INPUT: "const QVector3D * positions" are the positions of the vertices.
+// "qint64 numPositions" is the number of positions.
+// "const quint32 * indices" are the indices of the positions, 3 per triangle.
+// "qint64 numTriangles" is the number of triangles.
+// "const std::function<void(qint64, qint64)> & prepareChunk", unless empty,
+// is called with the range [begin, end) of every chunk of triangles.
+// OUTPUT: The function returns the measures; all are zero if there are no
+// triangles.
+// NOTE: This is a non-member function.
+//=============================================================================
+TriangleMeasures measureTriangles(const QVector3D * positions, qint64 numPositions,
+                                  const quint32 * indices, qint64 numTriangles,
+                                  const std::function<void(qint64, qint64)> & prepareChunk)
+{
+    TriangleMeasures measures;
+    measures.signedVolume = 0.0;
+    measures.area = 0.0;
+    if ((numTriangles <= 0) || (numPositions <= 0))
+        return measures;
+    findCoordinateRanges(positions, numPositions, measures.minCoord, measures.maxCoord);
+
+    // The first vertex serves as the reference point of the volumes. The
+    // gathers take 32-bit offsets of the coordinates, which limits the wider
+    // instruction sets to the meshes with fewer positions.
+    const QVector3D reference = positions[indices[0]];
+    SimdLevel level = simdLevel();
+    if ((3 * numPositions > qint64(std::numeric_limits<qint32>::max())) && (level > SimdLevel::Sse2))
+        level = SimdLevel::Sse2;
+    std::vector<LaneSums> chunkSums(static_cast<size_t>(numChunks(numTriangles, s_measureChunkSize)));
+    LaneSums * chunkSumData = chunkSums.data();
+    const std::function<void(qint64, qint64)> * prepare = (prepareChunk != nullptr) ? &prepareChunk : nullptr;
+    parallelForChunks(numTriangles, s_measureChunkSize, [=](qint64 chunkIndex, qint64 begin, qint64 end)
+    {
+        if (prepare != nullptr)
+            (*prepare)(begin, end);
+        measureChunkTriangles(positions, indices, begin, end, reference, level, chunkSumData[chunkIndex]);
+    });
+
+    // Add up the sums of the chunks, lane by lane, in a fixed order.
+    double volumeSum = 0.0;
+    double volumeError = 0.0;
+    double areaSum = 0.0;
+    double areaError = 0.0;
+    for (auto cit = chunkSums.cbegin(); cit != chunkSums.cend(); ++cit)
+    {
+        for (int lane = 0; lane < s_numSumLanes; ++lane)
+        {
+            addCompensated(cit->volumeSum[lane], volumeSum, volumeError);
+            volumeError += cit->volumeError[lane];
+            addCompensated(cit->areaSum[lane], areaSum, areaError);
+            areaError += cit->areaError[lane];
+        }
+    }
+    measures.signedVolume = (volumeSum + volumeError) / 6.0;
+    measures.area = (areaSum + areaError) / 2.0;
+    return measures;
+}
@@ -0,0 +1,51 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef GEOMETRY_KERNELS_HEADER
+#define GEOMETRY_KERNELS_HEADER
+
+#include <QtGlobal>
+#include <QVector3D>
+#include <functional>  // function
+
+//=============================================================================
+// The instruction sets the geometry kernels can run on, from the plainest.
+//=============================================================================
+enum class SimdLevel {None, Sse2, Avx2, Avx512};
+
+//=============================================================================
+// This class holds the measures of a triangle mesh.
+//=============================================================================
+struct TriangleMeasures
+{
+    QVector3D minCoord;    // smallest x, y, and z coordinates
+    QVector3D maxCoord;    // largest x, y, and z coordinates
+    double signedVolume;   // volume enclosed, positive if the triangles face outward
+    double area;           // total area of the triangles
+};
+
+// Find the widest instruction set the processor supports, and the one the
+// kernels use, which may be limited, e.g., to compare the results.
+SimdLevel supportedSimdLevel();
+SimdLevel simdLevel();
+void setMaxSimdLevel(SimdLevel maxLevel);
+
+// Find the x-, y-, and z-ranges of a collection of 3D vectors in parallel.
+void findCoordinateRanges(const QVector3D * vertices, qint64 numVertices,
+                          QVector3D & minCoord, QVector3D & maxCoord);
+
+// Find the ranges, the signed volume and the area of an indexed triangle mesh
+// in parallel. The results do not depend on the number of threads or on the
+// instruction set. A given function may prepare every chunk of triangles,
+// e.g., set their normals, right before the chunk is measured.
+TriangleMeasures measureTriangles(const QVector3D * positions, qint64 numPositions,
+                                  const quint32 * indices, qint64 numTriangles,
+                                  const std::function<void(qint64, qint64)> & prepareChunk = nullptr);
+
+#endif // GEOMETRY_KERNELS_HEADER
@@ -0,0 +1,12 @@
+# Libraries shared by the application and its tests.
+
+INCLUDEPATH += "C:/Program Files/Boost/include"
+
+# Boost.Iostreams with its zlib and zstd filters decompresses .stl.gz and
+# .stl.zst files on the fly.
+# With MSVC, Boost links its Iostreams library itself through auto-linking,
+# but zlib and zstd are named explicitly; MinGW names all three.
+win32:LIBS += -L"C:/Program Files/Boost/lib"
+win32-msvc*:LIBS += -lzlib -lzstd
+win32-g++:LIBS += -lboost_iostreams -lz -lzstd
+unix:LIBS += -lboost_iostreams -lz -lzstd
@@ -0,0 +1,93 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "loadProgress.h"
+
+#include <QMutexLocker>
+
+// Constructor.
+LoadProgress::LoadProgress()
+    : m_numBytesTotal(0), m_numBytesRead(0), m_numTrianglesRead(0),
+      m_isCanceled(false), m_mutex(), m_errorMessage()
+{}
+
+
+//=============================================================================
+// The function "setErrorMessage" records the description of a failure unless
+// one has already been recorded.
+// INPUT: "const QString & message" describes the failure.
+//=============================================================================
+void LoadProgress::setErrorMessage(const QString & message)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_errorMessage.isEmpty() == true)
+        m_errorMessage = message;
+}
+
+
+//=============================================================================
+// The function "hasError" checks if a failure has been recorded.
+//=============================================================================
+bool LoadProgress::hasError() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_errorMessage.isEmpty() == false;
+}
+
+
+//=============================================================================
+// The function "errorMessage" returns the description of the first failure.
+//=============================================================================
+QString LoadProgress::errorMessage() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_errorMessage;
+}
+
+
+//=============================================================================
+// The function "isLoadCanceled" checks if reading is to be canceled.
+// INPUT: "const LoadProgress * progress" is the progress of the reading, or
+// null if it is not tracked.
+//=============================================================================
+bool isLoadCanceled(const LoadProgress * progress)
+{
+    return (progress != nullptr) && (progress->isCanceled() == true);
+}
+
+
+//=============================================================================
+// The function "reportLoadProgress" adds to the amount of processed data.
+// INPUT: "LoadProgress * progress" is the progress of the reading, or null if
+// it is not tracked.
+// "qint64 numBytes" and "qint64 numTriangles" are the newly processed bytes
+// and triangles.
+//=============================================================================
+void reportLoadProgress(LoadProgress * progress, qint64 numBytes, qint64 numTriangles)
+{
+    if (progress == nullptr)
+        return;
+    progress->addNumBytesRead(numBytes);
+    progress->addNumTrianglesRead(numTriangles);
+}
+
+
+//=============================================================================
+// The function "reportLoadError" reports a failure of reading. It is safe to
+// call from any thread; the message is shown to the user later on the GUI
+// thread.
+// INPUT: "LoadProgress * progress" is the progress of the reading, or null if
+// it is not tracked.
+// "const QString & message" describes the failure.
+//=============================================================================
+void reportLoadError(LoadProgress * progress, const QString & message)
+{
+    if (progress != nullptr)
+        progress->setErrorMessage(message);
+}
@@ -0,0 +1,61 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef LOAD_PROGRESS_HEADER
+#define LOAD_PROGRESS_HEADER
+
+#include <QMutex>
+#include <QString>
+#include <atomic>   // atomic
+
+//=============================================================================
+// This class lets a reader running on a worker thread report its progress
+// and its errors, and lets any other thread cancel the reading. All member
+// functions are thread-safe.
+//=============================================================================
+class LoadProgress
+{
+public:
+    LoadProgress();
+
+    // Progress, reported by the reader.
+    void setNumBytesTotal(qint64 numBytes) { m_numBytesTotal = numBytes; }
+    void addNumBytesRead(qint64 numBytes) { m_numBytesRead += numBytes; }
+    void addNumTrianglesRead(qint64 numTriangles) { m_numTrianglesRead += numTriangles; }
+
+    // Cancellation, requested by anyone.
+    void cancel() { m_isCanceled = true; }
+
+    // Errors, reported by the reader. Only the first one is kept.
+    void setErrorMessage(const QString & message);
+
+    // Accessors.
+    qint64 numBytesTotal() const { return m_numBytesTotal; }
+    qint64 numBytesRead() const { return m_numBytesRead; }
+    qint64 numTrianglesRead() const { return m_numTrianglesRead; }
+    bool isCanceled() const { return m_isCanceled; }
+    bool hasError() const;
+    QString errorMessage() const;
+
+private:
+    std::atomic<qint64> m_numBytesTotal;     // size of the file being read
+    std::atomic<qint64> m_numBytesRead;      // number of bytes processed so far
+    std::atomic<qint64> m_numTrianglesRead;  // number of triangles processed so far
+    std::atomic<bool> m_isCanceled;          // indicates if reading is to be canceled
+    mutable QMutex m_mutex;                  // guards the error message
+    QString m_errorMessage;                  // description of the first failure
+};
+
+
+// Non-members.
+bool isLoadCanceled(const LoadProgress * progress);
+void reportLoadProgress(LoadProgress * progress, qint64 numBytes, qint64 numTriangles);
+void reportLoadError(LoadProgress * progress, const QString & message);
+
+#endif // LOAD_PROGRESS_HEADER
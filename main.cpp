@@ -9,6 +9,7 @@
 
 #include "partsModel.h"
 #include "simple3d.h"
+#include "parallelFor.h"
 #include <QApplication>
 #include <QSurfaceFormat>
 
@@ -16,6 +17,10 @@ int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
 
+    // Allow forcing all parallel processing onto a single thread.
+    if (a.arguments().contains(QStringLiteral("--single-thread")) == true)
+        setDoForceSingleThread(true);
+
     // Create the parts model.
     BoxSize masterBox(120, 130, 120);
     //BoxSize masterBox(20, 130, 120);
@@ -8,25 +8,63 @@
 //=============================================================================
 
 #include "managedPart.h"
+#include "normalSmoothing.h"
+#include <QFileInfo>
 
 // Constructor.
-ManagedPart::ManagedPart(std::shared_ptr<Part> part) : m_part(part)
+ManagedPart::ManagedPart(std::shared_ptr<Part> part) : m_part(part), m_fileName(), m_isDecimated(false)
 {
-    // Compute and set the volume.
-    setVolume();
-    // Compute and set the positions of the lower left and upper right corners.
-    QVector3D maxCoord;
-    QVector3D minCoord;
-    m_part->coordinateRanges(minCoord, maxCoord);
+    // Find the positions of the lower left and upper right corners, the volume
+    // and the area in parallel, unless they have been found while the part
+    // was read. Coordinates are assumed to be in mm.
+    const TriangleMeasures measures = m_part->measureTriangles();
+    m_volume = qAbs(measures.signedVolume / 1000.0);  // in mL
+    m_area = measures.area / 100.0;  // in square cm
     // Set the size of the minimal containing box.
-    m_boxSize = maxCoord - minCoord;
-    // Shift the part so that the lower left corner is at the origin.
-    m_part->shift(-minCoord);
+    m_boxSize = measures.maxCoord - measures.minCoord;
+    // Rather than shifting the part so that the lower left corner is at the
+    // origin, keep the corner and subtract it wherever the part is placed.
+    m_origin = measures.minCoord;
 
-    // Smooth the vertex normals - replace the vertex normal in each instance
-    // of that vertex in every triangle by the normalized sum of the normals
-    // that vertex had in the different triangles. Does not seem to have good
-    // effect on geometric shapes; keeping different normals for the same
-    // vertex in the different triangles seems to be visually more pleasant.
-    //m_part->smoothVertexNormals();
+    // Check if the surface is closed and consistently oriented, as otherwise
+    // the volume means little, and smooth the vertex normals within the
+    // crease angle, so that curved surfaces look smooth while sharp edges
+    // stay sharp. The normals a part comes with are kept. Both go through
+    // the triangle corners at every position, which are listed once.
+    PositionCorners positionCorners;
+    m_part->findPositionCorners(positionCorners);
+    m_integrity = m_part->analyzeIntegrity(positionCorners);
+    const float angle = creaseAngle();
+    if ((m_part->hasVertexNormals() == false) && (angle > 0.0f))
+        m_part->smoothVertexNormals(angle, positionCorners);
+}
+
+// Constructor of a part that has already been prepared, e.g., restored from
+// the geometry cache, given the position of its lower left corner and the
+// integrity of its surface.
+ManagedPart::ManagedPart(std::shared_ptr<Part> part, double volume, double area, const BoxSize & boxSize,
+                         const QVector3D & origin, const MeshIntegrity & integrity)
+    : m_part(part), m_volume(volume), m_area(area), m_boxSize(boxSize), m_origin(origin),
+      m_integrity(integrity), m_drawingPosition(),
+      m_doRotateBeforeDrawing(false), m_fileName(), m_isDecimated(false)
+{}
+
+
+//=============================================================================
+// The function "decimatedFileNames" lists the files whose parts are held as
+// coarser copies of the meshes in the files.
+// INPUT: "const QList<ManagedPart> & parts" are the parts.
+// OUTPUT: The function returns the names of the files, each listed once.
+// NOTE: This is a non-member function.
+//=============================================================================
+QStringList decimatedFileNames(const QList<ManagedPart> & parts)
+{
+    QStringList fileNames;
+    for (auto cit = parts.cbegin(); cit != parts.cend(); ++cit)
+    {
+        if (cit->isDecimated() == true)
+            fileNames.push_back(QFileInfo(cit->fileName()).fileName());
+    }
+    fileNames.removeDuplicates();
+    return fileNames;
 }
@@ -10,34 +10,58 @@
 #ifndef MANAGED_PART_HEADER
 #define MANAGED_PART_HEADER
 
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector3D>
 #include <memory>   // shared_ptr
 #include "part.h"
 #include "boxSize.h"
+#include "meshIntegrity.h"
 
 class ManagedPart
 {
 public:
     // Constructor.
     explicit ManagedPart(std::shared_ptr<Part> part = std::shared_ptr<Part>());
+    ManagedPart(std::shared_ptr<Part> part, double volume, double area, const BoxSize & boxSize,
+                const QVector3D & origin, const MeshIntegrity & integrity);
 
     // Accessors.
     std::shared_ptr<Part> part() const { return m_part; }
     double volume() const { return m_volume; }
+    double area() const { return m_area; }
     const BoxSize & boxSize() const { return m_boxSize; }
+    const QVector3D & origin() const { return m_origin; }
+    const MeshIntegrity & integrity() const { return m_integrity; }
+    bool isVolumeTrusted() const { return ::isVolumeTrusted(m_integrity); }
     const Position & drawingPosition() const { return m_drawingPosition; }
     bool doRotateBeforeDrawing() const { return m_doRotateBeforeDrawing; }
+    const QString & fileName() const { return m_fileName; }
+    bool isDecimated() const { return m_isDecimated; }
 
     // Setters.
     void setVolume() { m_volume = m_part->computeVolume(); }
     void setDrawingPosition(const Position & position) { m_drawingPosition = position; }
     void setDoRotateBeforeDrawing(bool doRotate) { m_doRotateBeforeDrawing = doRotate; }
+    void setFileName(const QString & fileName) { m_fileName = fileName; }
+    void setIsDecimated(bool isDecimated) { m_isDecimated = isDecimated; }
 
 private:
     std::shared_ptr<Part> m_part;   // the part being managed
     double m_volume;                // volume of the part
+    double m_area;                  // surface area of the part
     BoxSize m_boxSize;              // dimensions of the minimal bounding box
+    QVector3D m_origin;             // lower left corner of the bounding box, subtracted when placing the part
+    MeshIntegrity m_integrity;      // holes, faulty edges and pieces of the surface
     Position m_drawingPosition;     // position of lower left corner for drawing
     bool m_doRotateBeforeDrawing;   // indicates if the part is to be rotated for drawing
+    QString m_fileName;             // name of the file the part was read from
+    bool m_isDecimated;             // indicates if the part is a coarser copy of the one in the file
 };
 
+
+// Non-members.
+QStringList decimatedFileNames(const QList<ManagedPart> & parts);
+
 #endif // MANAGED_PART_HEADER
@@ -0,0 +1,107 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "memoryBudget.h"
+
+#include <limits>   // numeric_limits
+
+#if defined(Q_OS_WIN)
+// Keep the min and max macros of windows.h off std::numeric_limits.
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(Q_OS_MAC)
+#include <sys/types.h>
+#include <sys/sysctl.h>
+#elif defined(Q_OS_UNIX)
+#include <unistd.h>
+#endif
+
+// Size of the physical memory assumed where it can not be found out, in bytes.
+static const qint64 s_assumedPhysicalMemorySize = Q_INT64_C(4) * 1024 * 1024 * 1024;
+
+
+// Constructor.
+MemoryBudget::MemoryBudget(qint64 limit) : m_limit(limit), m_numBytesUsed(0)
+{}
+
+
+//=============================================================================
+// The function "tryReserve" reserves a given amount of memory provided it
+// fits within the limit along with the memory reserved before.
+// INPUT: "qint64 numBytes" is the amount of memory.
+// OUTPUT: The function returns "true" if the memory has been reserved, and
+// "false" otherwise.
+//=============================================================================
+bool MemoryBudget::tryReserve(qint64 numBytes)
+{
+    qint64 numBytesUsed = m_numBytesUsed;
+    do
+    {
+        const qint64 limit = m_limit;
+        if ((limit > 0) && (numBytesUsed + numBytes > limit))
+            return false;
+    }
+    while (m_numBytesUsed.compare_exchange_weak(numBytesUsed, numBytesUsed + numBytes) == false);
+    return true;
+}
+
+
+//=============================================================================
+// The function "numBytesLeft" returns the memory that can still be reserved
+// within the limit.
+//=============================================================================
+qint64 MemoryBudget::numBytesLeft() const
+{
+    const qint64 limit = m_limit;
+    if (limit <= 0)
+        return std::numeric_limits<qint64>::max();
+    return qMax(limit - m_numBytesUsed, qint64(0));
+}
+
+
+//=============================================================================
+// The function "physicalMemorySize" finds the size of the physical memory of
+// the computer.
+// OUTPUT: The function returns the size in bytes, or a typical size if it can
+// not be found out.
+//=============================================================================
+qint64 physicalMemorySize()
+{
+#if defined(Q_OS_WIN)
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status) != 0)
+        return static_cast<qint64>(status.ullTotalPhys);
+#elif defined(Q_OS_MAC)
+    int names[2] = {CTL_HW, HW_MEMSIZE};
+    quint64 size = 0;
+    size_t length = sizeof(size);
+    if (sysctl(names, 2, &size, &length, nullptr, 0) == 0)
+        return static_cast<qint64>(size);
+#elif defined(Q_OS_UNIX)
+    const long numPages = sysconf(_SC_PHYS_PAGES);
+    const long pageSize = sysconf(_SC_PAGE_SIZE);
+    if ((numPages > 0) && (pageSize > 0))
+        return static_cast<qint64>(numPages) * pageSize;
+#endif
+    return s_assumedPhysicalMemorySize;
+}
+
+
+//=============================================================================
+// The function "defaultMemoryBudget" returns the memory the loaded parts may
+// take unless another limit is set: half of the physical memory, leaving the
+// rest to the system, the graphics driver and other applications.
+//=============================================================================
+qint64 defaultMemoryBudget()
+{
+    return physicalMemorySize() / 2;
+}
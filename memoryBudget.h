@@ -0,0 +1,61 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef MEMORY_BUDGET_HEADER
+#define MEMORY_BUDGET_HEADER
+
+#include <QtGlobal>
+#include <atomic>   // atomic
+
+// Number of bytes a vertex takes in the OpenGL vertex buffers: 3 coordinates
+// followed by 3 normal coordinates.
+const qint64 numBytesPerBufferVertex = 6 * sizeof(float);
+// Largest number of vertices placed in a single OpenGL vertex buffer, which
+// is also the size of the staging buffer the vertices are interleaved in.
+const qint64 maxNumVerticesPerBuffer = 3 * 4 * 1024 * 1024;
+
+//=============================================================================
+// This class keeps track of the memory taken by the loaded parts against a
+// limit, so that a part is admitted only if it fits. Memory is reserved
+// before a part is read and released once the part is dropped. All member
+// functions are thread-safe.
+//=============================================================================
+class MemoryBudget
+{
+public:
+    explicit MemoryBudget(qint64 limit);
+
+    // Reserve memory if it fits within the limit.
+    bool tryReserve(qint64 numBytes);
+
+    // Reserve memory regardless of the limit, e.g., for a part already held.
+    void reserve(qint64 numBytes) { m_numBytesUsed += numBytes; }
+
+    // Release memory reserved before.
+    void release(qint64 numBytes) { m_numBytesUsed -= numBytes; }
+
+    // Set the limit; 0 or less means no limit.
+    void setLimit(qint64 limit) { m_limit = limit; }
+
+    // Accessors.
+    qint64 limit() const { return m_limit; }
+    qint64 numBytesUsed() const { return m_numBytesUsed; }
+    qint64 numBytesLeft() const;
+
+private:
+    std::atomic<qint64> m_limit;          // largest amount of memory to be used, or 0 if unlimited
+    std::atomic<qint64> m_numBytesUsed;   // memory reserved so far
+};
+
+
+// Non-members.
+qint64 physicalMemorySize();
+qint64 defaultMemoryBudget();
+
+#endif // MEMORY_BUDGET_HEADER
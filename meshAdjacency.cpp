@@ -0,0 +1,78 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "meshAdjacency.h"
+#include "parallelFor.h"
+
+#include <algorithm>  // sort
+#include <atomic>     // atomic
+#include <vector>
+
+// Number of vertices or positions handled by a single task.
+static const qint64 s_adjacencyChunkSize = 65536;
+
+
+//=============================================================================
+// The function "findPositionCorners" lists the triangle corners at every
+// position, in increasing order, as a compressed adjacency: the corners are
+// counted per position, the counts turned into offsets, and the corners
+// scattered to their places and sorted, so the lists do not depend on the
+// order in which the threads reach them.
+// INPUT: "const quint32 * indices" are the indices of the positions, 3 per triangle.
+// "qint64 numVertices" is the number of indices, fewer than 2^32.
+// "qint64 numPositions" is the number of positions.
+// OUTPUT: "PositionCorners & positionCorners" returns the lists of corners.
+// NOTE: This is a non-member function.
+//=============================================================================
+void findPositionCorners(const quint32 * indices, qint64 numVertices, qint64 numPositions,
+                         PositionCorners & positionCorners)
+{
+    GeometryArray<quint32> & begins = positionCorners.begins;
+    GeometryArray<quint32> & corners = positionCorners.corners;
+    begins.clear();
+    corners.clear();
+    if (numPositions <= 0)
+        return;
+
+    // Count the corners at every position.
+    std::vector<std::atomic<quint32> > cursors(static_cast<size_t>(numPositions));
+    std::atomic<quint32> * cursorData = cursors.data();
+    parallelForChunks(numVertices, s_adjacencyChunkSize, [=](qint64, qint64 begin, qint64 end)
+    {
+        for (qint64 i = begin; i < end; ++i)
+            cursorData[indices[i]].fetch_add(1, std::memory_order_relaxed);
+    });
+
+    // Turn the counts into the offsets of the lists, which are also where
+    // the corners of every position start to be written.
+    begins.resize(numPositions + 1);
+    quint32 offset = 0;
+    for (qint64 p = 0; p < numPositions; ++p)
+    {
+        begins[p] = offset;
+        offset += cursorData[p].load(std::memory_order_relaxed);
+        cursorData[p].store(begins[p], std::memory_order_relaxed);
+    }
+    begins[numPositions] = offset;
+
+    // Scatter the corners to their lists, and sort every list.
+    corners.resize(numVertices);
+    quint32 * cornerData = corners.data();
+    parallelForChunks(numVertices, s_adjacencyChunkSize, [=](qint64, qint64 begin, qint64 end)
+    {
+        for (qint64 i = begin; i < end; ++i)
+            cornerData[cursorData[indices[i]].fetch_add(1, std::memory_order_relaxed)] = quint32(i);
+    });
+    const quint32 * beginData = begins.constData();
+    parallelForChunks(numPositions, s_adjacencyChunkSize, [=](qint64, qint64 begin, qint64 end)
+    {
+        for (qint64 p = begin; p < end; ++p)
+            std::sort(cornerData + beginData[p], cornerData + beginData[p + 1]);
+    });
+}
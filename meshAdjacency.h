@@ -0,0 +1,32 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef MESH_ADJACENCY_HEADER
+#define MESH_ADJACENCY_HEADER
+
+#include <QtGlobal>
+#include "geometryArray.h"
+
+//=============================================================================
+// This class lists the triangle corners at every position of an indexed
+// triangle mesh: the corners at position "p", i.e., the indices "3 * t + k"
+// of the vertices referring to it, are "corners[begins[p]]" up to, but not
+// including, "corners[begins[p + 1]]", in increasing order.
+//=============================================================================
+struct PositionCorners
+{
+    GeometryArray<quint32> begins;    // where the list of every position begins, and the total number of corners
+    GeometryArray<quint32> corners;   // lists of corners, position after position
+};
+
+// Non-members.
+void findPositionCorners(const quint32 * indices, qint64 numVertices, qint64 numPositions,
+                         PositionCorners & positionCorners);
+
+#endif // MESH_ADJACENCY_HEADER
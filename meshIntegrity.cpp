@@ -0,0 +1,305 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "meshIntegrity.h"
+#include "disjointSets.h"
+#include "parallelFor.h"
+
+#include <algorithm>  // fill, sort
+#include <atomic>     // atomic
+#include <limits>     // numeric_limits
+#include <vector>
+
+// Number of positions handled by a single task.
+static const qint64 s_integrityChunkSize = 16384;
+// Marks an edge without a neighboring triangle across it that counts, i.e.,
+// a boundary or non-manifold edge.
+static const quint32 s_noNeighbor = std::numeric_limits<quint32>::max();
+// Marks a neighboring triangle running along the shared edge in the same
+// direction. Triangle indices are below 2^31, as there are fewer than 2^32
+// vertices.
+static const quint32 s_misorientedBit = 0x80000000u;
+
+//=============================================================================
+// The class "EdgeEnd" describes the use of an edge by a triangle, as seen
+// from the lower of the two positions of the edge.
+//=============================================================================
+struct EdgeEnd
+{
+    quint32 other;      // the higher position of the edge
+    quint32 slot;       // 3 * t + k for the edge from corner k to the next corner of triangle t
+    bool isForward;     // indicates if the triangle runs along the edge from the lower position
+    bool isCounted;     // indicates if the triangle is not degenerate
+};
+
+//=============================================================================
+// The class "EdgeCounts" holds the numbers of faulty edges found by a task.
+//=============================================================================
+struct EdgeCounts
+{
+    qint64 numBoundaryEdges;      // edges of only one triangle
+    qint64 numNonManifoldEdges;   // edges of more than two triangles
+    qint64 numMisorientedEdges;   // edges of two triangles running along them in the same direction
+};
+
+
+//=============================================================================
+// The function "analyzePositionEdges" analyzes the edges from every position
+// of a range to the higher positions: the ends of the edges of the triangles
+// at the position are gathered and sorted, and every edge classified by the
+// number of triangles using it and their directions along it. Every edge is
+// thus analyzed by exactly one task, and its two positions are united in a
+// disjoint-set forest.
+// INPUT: "const quint32 * indices" are the indices of the positions, 3 per triangle.
+// "const quint32 * beginData" and "const quint32 * cornerData" are the
+// triangle corners at every position.
+// "qint64 begin" and "qint64 end" are the range of positions.
+// "std::vector<EdgeEnd> & ends" is scratch space.
+// OUTPUT: "std::atomic<quint32> * parents" returns the disjoint-set forest
+// of the positions, united along the edges.
+// "quint32 * neighbors", if not null, returns the neighbor of every triangle
+// across every edge that has two triangles, flagged if they run along the
+// edge in the same direction, and "s_noNeighbor" across the other edges.
+// The function itself returns the numbers of faulty edges.
+// NOTE: This is a non-member function.
+//=============================================================================
+static EdgeCounts analyzePositionEdges(const quint32 * indices, const quint32 * beginData,
+                                       const quint32 * cornerData, qint64 begin, qint64 end,
+                                       std::vector<EdgeEnd> & ends, std::atomic<quint32> * parents,
+                                       quint32 * neighbors)
+{
+    EdgeCounts counts = {0, 0, 0};
+    for (qint64 position = begin; position < end; ++position)
+    {
+        const quint32 p = quint32(position);
+        ends.clear();
+        for (quint32 j = beginData[p]; j < beginData[p + 1]; ++j)
+        {
+            const quint32 corner = cornerData[j];
+            const quint32 t = corner / 3;
+            const quint32 k = corner - 3 * t;
+            const quint32 next = indices[3 * t + (k + 1) % 3];
+            const quint32 previous = indices[3 * t + (k + 2) % 3];
+            const bool isCounted = (next != p) && (previous != p) && (next != previous);
+            if (next > p)
+                ends.push_back({next, 3 * t + k, true, isCounted});
+            if (previous > p)
+                ends.push_back({previous, 3 * t + (k + 2) % 3, false, isCounted});
+        }
+        std::sort(ends.begin(), ends.end(), [](const EdgeEnd & a, const EdgeEnd & b)
+        {
+            return (a.other < b.other) || ((a.other == b.other) && (a.slot < b.slot));
+        });
+
+        for (size_t first = 0; first < ends.size(); )
+        {
+            const quint32 other = ends[first].other;
+            uniteSets(parents, p, other);
+            int numCounted = 0;
+            int numForward = 0;
+            quint32 edgeSlots[2] = {s_noNeighbor, s_noNeighbor};
+            size_t last = first;
+            for ( ; (last < ends.size()) && (ends[last].other == other); ++last)
+            {
+                if (ends[last].isCounted == false)
+                    continue;
+                if (numCounted < 2)
+                    edgeSlots[numCounted] = ends[last].slot;
+                ++numCounted;
+                if (ends[last].isForward == true)
+                    ++numForward;
+            }
+
+            if (numCounted == 1)
+            {
+                ++counts.numBoundaryEdges;
+            }
+            else if (numCounted > 2)
+            {
+                ++counts.numNonManifoldEdges;
+            }
+            else if (numCounted == 2)
+            {
+                const bool isMisoriented = (numForward != 1);
+                if (isMisoriented == true)
+                    ++counts.numMisorientedEdges;
+                if (neighbors != nullptr)
+                {
+                    const quint32 flag = (isMisoriented == true) ? s_misorientedBit : 0;
+                    neighbors[edgeSlots[0]] = (edgeSlots[1] / 3) | flag;
+                    neighbors[edgeSlots[1]] = (edgeSlots[0] / 3) | flag;
+                }
+            }
+            first = last;
+        }
+    }
+    return counts;
+}
+
+
+//=============================================================================
+// The function "countFlippedFaces" finds the fewest triangles to flip for
+// the edges to be oriented consistently: a breadth-first walk over every
+// connected piece of the surface splits its triangles into those oriented
+// like the first one and the others, and the smaller group is counted. A
+// piece that cannot be oriented at all, e.g., a Moebius strip, counts the
+// triangles as first reached.
+// INPUT: "const quint32 * neighbors" are the neighbors of every triangle
+// across its edges, as found by "analyzePositionEdges".
+// "qint64 numTriangles" is the number of triangles.
+// OUTPUT: The function returns the number of triangles to flip.
+// NOTE: This is a non-member function.
+//=============================================================================
+static qint64 countFlippedFaces(const quint32 * neighbors, qint64 numTriangles)
+{
+    // The side of every triangle: 0 if not reached yet, 1 if oriented like
+    // the first triangle of its piece, and 2 otherwise.
+    GeometryArray<quint8> sides(numTriangles);
+    quint8 * sideData = sides.data();
+    GeometryArray<quint32> queue(numTriangles);
+    quint32 * queueData = queue.data();
+    qint64 numFlipped = 0;
+    for (qint64 start = 0; start < numTriangles; ++start)
+    {
+        if (sideData[start] != 0)
+            continue;
+        qint64 sideCounts[2] = {1, 0};
+        sideData[start] = 1;
+        qint64 head = 0;
+        qint64 tail = 0;
+        queueData[tail++] = quint32(start);
+        while (head < tail)
+        {
+            const quint32 t = queueData[head++];
+            for (int k = 0; k < 3; ++k)
+            {
+                const quint32 neighbor = neighbors[3 * t + k];
+                if (neighbor == s_noNeighbor)
+                    continue;
+                const quint32 u = neighbor & ~s_misorientedBit;
+                if (sideData[u] != 0)
+                    continue;
+                const bool isFlipped = ((neighbor & s_misorientedBit) != 0);
+                sideData[u] = (isFlipped == true) ? quint8(3 - sideData[t]) : sideData[t];
+                ++sideCounts[sideData[u] - 1];
+                queueData[tail++] = u;
+            }
+        }
+        numFlipped += qMin(sideCounts[0], sideCounts[1]);
+    }
+    return numFlipped;
+}
+
+
+//=============================================================================
+// The function "analyzeMeshIntegrity" analyzes the integrity of an indexed
+// triangle mesh: it counts the boundary edges, which make the surface open,
+// the non-manifold edges, shared by more than two triangles, the edges of
+// two triangles facing opposite sides, the triangles to flip to orient the
+// surface consistently, and the connected pieces of the mesh. Every edge is
+// analyzed at its lower position, with the positions handled in parallel,
+// while the pieces are found with a disjoint-set forest of the positions
+// shared by all threads. The flipped triangles, which need a walk over the
+// surface, are only counted if some edges are misoriented.
+// INPUT: "const quint32 * indices" are the indices of the positions, 3 per triangle.
+// "qint64 numTriangles" is the number of triangles.
+// "qint64 numPositions" is the number of positions.
+// "const PositionCorners & positionCorners" are the triangle corners at every
+// position.
+// OUTPUT: The function returns the results of the analysis.
+// NOTE: This is a non-member function.
+//=============================================================================
+MeshIntegrity analyzeMeshIntegrity(const quint32 * indices, qint64 numTriangles, qint64 numPositions,
+                                   const PositionCorners & positionCorners)
+{
+    MeshIntegrity integrity = {0, 0, 0, 0, 0};
+    if ((numTriangles <= 0) || (numPositions <= 0))
+        return integrity;
+    const quint32 * beginData = positionCorners.begins.constData();
+    const quint32 * cornerData = positionCorners.corners.constData();
+
+    // Every position starts as a set of its own.
+    std::vector<std::atomic<quint32> > parents(static_cast<size_t>(numPositions));
+    std::atomic<quint32> * parentData = parents.data();
+    parallelForChunks(numPositions, s_integrityChunkSize, [=](qint64, qint64 begin, qint64 end)
+    {
+        for (qint64 p = begin; p < end; ++p)
+            parentData[p].store(quint32(p), std::memory_order_relaxed);
+    });
+
+    // Analyze the edges, counting the faulty ones per chunk so the totals
+    // are summed in the same order whatever the number of threads.
+    const qint64 chunkCount = numChunks(numPositions, s_integrityChunkSize);
+    std::vector<EdgeCounts> chunkCounts(static_cast<size_t>(chunkCount));
+    EdgeCounts * chunkCountData = chunkCounts.data();
+    parallelForChunks(numPositions, s_integrityChunkSize, [=](qint64 chunkIndex, qint64 begin, qint64 end)
+    {
+        std::vector<EdgeEnd> ends;
+        chunkCountData[chunkIndex] = analyzePositionEdges(indices, beginData, cornerData, begin, end,
+                                                          ends, parentData, nullptr);
+    });
+    for (auto it = chunkCounts.cbegin(); it != chunkCounts.cend(); ++it)
+    {
+        integrity.numBoundaryEdges += it->numBoundaryEdges;
+        integrity.numNonManifoldEdges += it->numNonManifoldEdges;
+        integrity.numMisorientedEdges += it->numMisorientedEdges;
+    }
+
+    // Count the roots of the positions used by any triangle, one per piece.
+    std::vector<qint64> chunkComponents(static_cast<size_t>(chunkCount), 0);
+    qint64 * chunkComponentData = chunkComponents.data();
+    parallelForChunks(numPositions, s_integrityChunkSize, [=](qint64 chunkIndex, qint64 begin, qint64 end)
+    {
+        qint64 count = 0;
+        for (qint64 p = begin; p < end; ++p)
+        {
+            if ((beginData[p] != beginData[p + 1]) && (parentData[p].load(std::memory_order_relaxed) == quint32(p)))
+                ++count;
+        }
+        chunkComponentData[chunkIndex] = count;
+    });
+    for (auto it = chunkComponents.cbegin(); it != chunkComponents.cend(); ++it)
+        integrity.numComponents += *it;
+
+    // Find the neighbors of the triangles across their edges, and count the
+    // triangles facing the other way from most of their pieces.
+    if (integrity.numMisorientedEdges > 0)
+    {
+        GeometryArray<quint32> neighbors(3 * numTriangles);
+        quint32 * neighborData = neighbors.data();
+        parallelForChunks(3 * numTriangles, s_integrityChunkSize, [=](qint64, qint64 begin, qint64 end)
+        {
+            std::fill(neighborData + begin, neighborData + end, s_noNeighbor);
+        });
+        parallelForChunks(numPositions, s_integrityChunkSize, [=](qint64, qint64 begin, qint64 end)
+        {
+            std::vector<EdgeEnd> ends;
+            analyzePositionEdges(indices, beginData, cornerData, begin, end, ends, parentData, neighborData);
+        });
+        integrity.numFlippedFaces = countFlippedFaces(neighborData, numTriangles);
+    }
+    return integrity;
+}
+
+
+//=============================================================================
+// The function "isVolumeTrusted" checks if a mesh is a closed, consistently
+// oriented surface, i.e., if the volume computed from its triangles is the
+// volume it encloses. An open or misoriented surface gives a meaningless one.
+// INPUT: "const MeshIntegrity & integrity" are the results of the analysis
+// of the mesh.
+// OUTPUT: The function returns "true" if the volume can be trusted and
+// "false" otherwise.
+// NOTE: This is a non-member function.
+//=============================================================================
+bool isVolumeTrusted(const MeshIntegrity & integrity)
+{
+    return (integrity.numBoundaryEdges == 0) && (integrity.numNonManifoldEdges == 0) &&
+           (integrity.numMisorientedEdges == 0);
+}
@@ -0,0 +1,40 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef MESH_INTEGRITY_HEADER
+#define MESH_INTEGRITY_HEADER
+
+#include <QtGlobal>
+#include "meshAdjacency.h"
+
+//=============================================================================
+// This class holds the results of the analysis of the integrity of a
+// triangle mesh. The edges of the degenerate triangles, i.e., those with
+// two corners at the same position, are not counted.
+//=============================================================================
+struct MeshIntegrity
+{
+    qint64 numBoundaryEdges;      // edges of only one triangle, i.e., holes in the surface
+    qint64 numNonManifoldEdges;   // edges shared by more than two triangles
+    qint64 numMisorientedEdges;   // edges of two triangles running along them in the same direction
+    qint64 numFlippedFaces;       // fewest triangles to flip for the edges to be oriented consistently
+    qint64 numComponents;         // connected pieces of the mesh
+};
+
+// Analyze the integrity of an indexed triangle mesh in parallel, given the
+// triangle corners at every position. The results do not depend on the
+// number of threads.
+MeshIntegrity analyzeMeshIntegrity(const quint32 * indices, qint64 numTriangles, qint64 numPositions,
+                                   const PositionCorners & positionCorners);
+
+// Check if a mesh is a closed, consistently oriented surface, i.e., if the
+// volume it encloses can be trusted.
+bool isVolumeTrusted(const MeshIntegrity & integrity);
+
+#endif // MESH_INTEGRITY_HEADER
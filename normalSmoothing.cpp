@@ -0,0 +1,137 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "normalSmoothing.h"
+#include "parallelFor.h"
+
+#include <QtMath>     // qDegreesToRadians
+#include <atomic>     // atomic
+#include <cmath>      // cos
+
+// Number of positions handled by a single task.
+static const qint64 s_smoothingChunkSize = 65536;
+// Largest number of triangle corners at a position whose normals are
+// smoothed, as every corner is compared with every other one. The corners of
+// a larger fan, e.g., at the apex of a finely divided cone, keep the normals
+// of their triangles.
+static const int s_maxNumFanCorners = 64;
+// Crease angle within which the vertex normals of the parts read are smoothed.
+static std::atomic<float> s_creaseAngle(defaultCreaseAngle);
+
+
+//=============================================================================
+// The function "setCreaseAngle" sets the crease angle within which the vertex
+// normals of the parts read are smoothed.
+// INPUT: "float creaseAngle" is the angle in degrees, up to 180; zero,
+// negative, and not-a-number values keep the face normals.
+//=============================================================================
+void setCreaseAngle(float creaseAngle)
+{
+    s_creaseAngle = (creaseAngle > 0.0f) ? qMin(creaseAngle, 180.0f) : 0.0f;
+}
+
+
+//=============================================================================
+// The function "creaseAngle" gets the crease angle within which the vertex
+// normals of the parts read are smoothed.
+//=============================================================================
+float creaseAngle()
+{
+    return s_creaseAngle;
+}
+
+
+//=============================================================================
+// The function "scaledFaceNormal" finds the normal of a triangle scaled by
+// twice its area, so that a sum of such normals weighs the triangles by area.
+// INPUT: "const QVector3D * positions" are the positions of the mesh.
+// "const quint32 * corners" are the indices of the positions of the corners.
+// OUTPUT: The function returns the scaled normal, zero for a degenerate
+// triangle.
+// NOTE: This is a non-member function.
+//=============================================================================
+static inline QVector3D scaledFaceNormal(const QVector3D * positions, const quint32 * corners)
+{
+    const QVector3D & first = positions[corners[0]];
+    return QVector3D::crossProduct(positions[corners[1]] - first, positions[corners[2]] - first);
+}
+
+
+//=============================================================================
+// The function "smoothVertexNormals" smoothes the vertex normals of an indexed
+// triangle mesh: the normal of every corner of a triangle is the sum of the
+// normals, weighed by area, of the triangles at the same position whose
+// normals are within the crease angle of the normal of its own triangle. The
+// corners on the two sides of a sharp edge thus keep different normals,
+// while a curved surface looks smooth. The triangles at every position are
+// listed once, and the positions are handled in parallel, each summing its
+// triangles in the order of the list.
+// INPUT: "const QVector3D * positions" are the positions of the mesh.
+// "qint64 numPositions" is the number of positions.
+// "const quint32 * indices" are the indices of the positions, 3 per triangle.
+// "qint64 numTriangles" is the number of triangles.
+// "const PositionCorners & positionCorners" are the triangle corners at every
+// position.
+// "float creaseAngle" is the largest angle, in degrees, between the normals
+// of two triangles smoothed together.
+// OUTPUT: "GeometryArray<PackedNormal> & vertexNormals" returns the packed
+// vertex normals, 3 per triangle.
+// NOTE: This is a non-member function.
+//=============================================================================
+void smoothVertexNormals(const QVector3D * positions, qint64 numPositions, const quint32 * indices,
+                         qint64 numTriangles, const PositionCorners & positionCorners, float creaseAngle,
+                         GeometryArray<PackedNormal> & vertexNormals)
+{
+    vertexNormals.clear();
+    if (numTriangles <= 0)
+        return;
+
+    // Two triangles are smoothed together if the cosine of the angle between
+    // their normals is at least that of the crease angle.
+    const float minCosine = std::cos(qDegreesToRadians(qBound(0.0f, creaseAngle, 180.0f)));
+    vertexNormals.resize(3 * numTriangles);
+    PackedNormal * normalOut = vertexNormals.data();
+    const quint32 * beginData = positionCorners.begins.constData();
+    const quint32 * cornerData = positionCorners.corners.constData();
+    parallelForChunks(numPositions, s_smoothingChunkSize, [=](qint64, qint64 begin, qint64 end)
+    {
+        QVector3D fanNormals[s_maxNumFanCorners];
+        float fanLengths[s_maxNumFanCorners];
+        for (qint64 p = begin; p < end; ++p)
+        {
+            const quint32 * fan = cornerData + beginData[p];
+            const int numFanCorners = static_cast<int>(beginData[p + 1] - beginData[p]);
+            if (numFanCorners > s_maxNumFanCorners)
+            {
+                for (int j = 0; j < numFanCorners; ++j)
+                    normalOut[fan[j]] = packNormal(scaledFaceNormal(positions, indices + fan[j] / 3 * 3));
+                continue;
+            }
+
+            for (int j = 0; j < numFanCorners; ++j)
+            {
+                fanNormals[j] = scaledFaceNormal(positions, indices + fan[j] / 3 * 3);
+                fanLengths[j] = fanNormals[j].length();
+            }
+            for (int j = 0; j < numFanCorners; ++j)
+            {
+                // The triangle of the corner itself is always counted, and a
+                // degenerate one takes the normals of all the others.
+                QVector3D sum;
+                for (int k = 0; k < numFanCorners; ++k)
+                {
+                    if (QVector3D::dotProduct(fanNormals[j], fanNormals[k]) >=
+                            minCosine * fanLengths[j] * fanLengths[k])
+                        sum += fanNormals[k];
+                }
+                normalOut[fan[j]] = packNormal(sum);
+            }
+        }
+    });
+}
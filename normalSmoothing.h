@@ -0,0 +1,35 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef NORMAL_SMOOTHING_HEADER
+#define NORMAL_SMOOTHING_HEADER
+
+#include <QtGlobal>
+#include <QVector3D>
+#include "geometryArray.h"
+#include "meshAdjacency.h"
+#include "packedNormal.h"
+
+// Crease angle, in degrees, the vertex normals are smoothed within unless set
+// otherwise. Sharp edges of machined parts, usually 90 degrees, stay sharp.
+const float defaultCreaseAngle = 45.0f;
+
+// Set and get the crease angle, in degrees, within which the vertex normals
+// of the parts read are smoothed. Zero keeps the face normals.
+void setCreaseAngle(float creaseAngle);
+float creaseAngle();
+
+// Smooth the vertex normals of an indexed triangle mesh within a crease angle
+// in parallel, given the triangle corners at every position. The results do
+// not depend on the number of threads.
+void smoothVertexNormals(const QVector3D * positions, qint64 numPositions, const quint32 * indices,
+                         qint64 numTriangles, const PositionCorners & positionCorners, float creaseAngle,
+                         GeometryArray<PackedNormal> & vertexNormals);
+
+#endif // NORMAL_SMOOTHING_HEADER
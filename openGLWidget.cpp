@@ -10,6 +10,8 @@
 #include "openGLWidget.h"
 #include "partStl.h"
 #include "partsModel.h"
+#include "parallelFor.h"
+#include "memoryBudget.h"
 
 #include <QTimer>
 #include <QMouseEvent>
@@ -18,6 +20,15 @@
 #include <QScreen>
 #include <QImage>
 
+// Parts with more than "maxNumVerticesPerBuffer" vertices, a multiple of 3,
+// are split over several buffers, which keeps every buffer well below the
+// 2 GB a QOpenGLBuffer can address, and bounds the memory used to interleave
+// the data before uploading it.
+static_assert(maxNumVerticesPerBuffer % 3 == 0, "A buffer is expected to hold whole triangles");
+static_assert(numBytesPerBufferVertex == 6 * sizeof(GLfloat), "A vertex is expected to take 6 floats");
+// Number of vertices interleaved by a single task when filling a buffer.
+static const qint64 s_interleaveChunkSize = 65536;
+
 
 // Constructor.
 OpenGLWidget::OpenGLWidget(QWidget *parent, PartsModel * partsModel)
@@ -148,57 +159,100 @@ void OpenGLWidget::createMasterBoxBuffer()
 
 
 //=============================================================================
-// The function "addBuffer" places the last part in the parts model to a new
-// OpenGL vertex buffer.
+// The function "createBuffers" creates the OpenGL vertex buffers of a part and
+// fills them with its vertices and vertex normals. The normals are kept
+// packed, one per vertex or, for a part without vertex normals, one per
+// triangle, and are unpacked here for every vertex. The positions shared by
+// the triangles are expanded through their indices and moved so that the
+// lower left corner of the part is at the origin. A large part is uploaded
+// in several buffers of bounded size.
+// INPUT: "int partIndex" is the index of the part.
+// OUTPUT: The function returns the buffers.
 //=============================================================================
-void OpenGLWidget::addBuffer()
+QList<QOpenGLBuffer> OpenGLWidget::createBuffers(int partIndex)
 {
-    // Get the index of the last part.
-    int partIndex = m_partsModel->numParts() - 1;
-
-    // Create a vector holding properly interleaved data for each triangle:
-    // 3 vertices followed by 3 normals.
-    const int numVertices = m_partsModel->numVertices(partIndex);
+    // Get the vertices and normals of the part.
+    const qint64 numVertices = m_partsModel->numVertices(partIndex);
+    const QVector3D * positions = m_partsModel->positionBeginIter(partIndex);
+    const quint32 * indices = m_partsModel->indexBeginIter(partIndex);
+    const PackedNormal * faceNormals = m_partsModel->faceNormalBeginIter(partIndex);
+    const PackedNormal * vertexNormals = m_partsModel->vertexNormalBeginIter(partIndex);
+    const QVector3D origin = m_partsModel->origin(partIndex);
 
     // Define temporary storage where to interleave the vertices and vertex
-    // normals.
-    QVector<GLfloat> buf;
-    buf.reserve(numVertices * 6);
+    // normals of one buffer at a time.
+    QVector<GLfloat> buf(static_cast<int>(6 * qMin(numVertices, maxNumVerticesPerBuffer)));
+    GLfloat * bufData = buf.data();
 
-    // Get constant iterator to the beginnings of the vectors of vertices and
-    // vertex normals of the last part.
-    auto citVert = m_partsModel->vertexBeginIter(partIndex);
-    auto citNorm = m_partsModel->vertexNormalBeginIter(partIndex);
-    for (int i = 0; i < numVertices; ++i, ++citVert, ++citNorm)
+    QList<QOpenGLBuffer> buffers;
+    for (qint64 first = 0; first < numVertices; first += maxNumVerticesPerBuffer)
     {
-        buf.push_back(static_cast<GLfloat>(citVert->x()));
-        buf.push_back(static_cast<GLfloat>(citVert->y()));
-        buf.push_back(static_cast<GLfloat>(citVert->z()));
-        buf.push_back(static_cast<GLfloat>(citNorm->x()));
-        buf.push_back(static_cast<GLfloat>(citNorm->y()));
-        buf.push_back(static_cast<GLfloat>(citNorm->z()));
+        // Fill in properly interleaved data for each triangle: 3 vertices
+        // followed by 3 normals.
+        const qint64 numBufferVertices = qMin(numVertices - first, maxNumVerticesPerBuffer);
+        parallelForChunks(numBufferVertices, s_interleaveChunkSize, [=](qint64, qint64 begin, qint64 end)
+        {
+            for (qint64 i = begin; i < end; ++i)
+            {
+                const QVector3D vertex = positions[indices[first + i]] - origin;
+                const QVector3D normal = unpackNormal((vertexNormals != nullptr) ? vertexNormals[first + i] :
+                                                                                   faceNormals[(first + i) / 3]);
+                GLfloat * out = bufData + 6 * i;
+                out[0] = static_cast<GLfloat>(vertex.x());
+                out[1] = static_cast<GLfloat>(vertex.y());
+                out[2] = static_cast<GLfloat>(vertex.z());
+                out[3] = static_cast<GLfloat>(normal.x());
+                out[4] = static_cast<GLfloat>(normal.y());
+                out[5] = static_cast<GLfloat>(normal.z());
+            }
+        });
+
+        // Create a buffer object, a general purpose array of data residing in
+        // the graphics card’s memory, to store the vertices and vertex normals
+        // of the rendered object.
+        buffers.push_back(QOpenGLBuffer());
+        QOpenGLBuffer & openGLBuffer = buffers.back();
+        openGLBuffer.create();
+        openGLBuffer.bind();
+        // Allocate memory and fill it in: for each vertex we need 3 vertex
+        // coordinates + 3 normal coordinates.
+        openGLBuffer.allocate(bufData, static_cast<int>(6 * numBufferVertices * sizeof(GLfloat)));
+        // Release the buffer.
+        openGLBuffer.release();
     }
+    return buffers;
+}
 
-    // Construct a new vertex buffer for the data being added.
-    m_buffers.push_back(QOpenGLBuffer());
-    // Get a reference to the new vertex buffer just created.
-    QOpenGLBuffer & openGLBuffer = m_buffers.back();
 
-    // Create a buffer object, a general purpose array of data residing in the
-    // graphics card’s memory, to store the vertices and vertex normals of the
-    // rendered object.
-    openGLBuffer.create();
-    openGLBuffer.bind();
-    // Allocate memory and fill it in: for each vertex we need 3 vertex
-    // coordinates + 3 normal coordinates.
-    openGLBuffer.allocate(buf.constData(), buf.size() * sizeof(GLfloat));
-    // Release the buffer.
-    openGLBuffer.release();
+//=============================================================================
+// The function "addBuffer" places every part in the parts model that has no
+// OpenGL vertex buffers yet, i.e., the parts added last, to new buffers.
+//=============================================================================
+void OpenGLWidget::addBuffer()
+{
+    for (int partIndex = m_buffers.size(); partIndex < m_partsModel->numParts(); ++partIndex)
+        m_buffers.push_back(createBuffers(partIndex));
 
     update();
 }
 
 
+//=============================================================================
+// The function "replaceBuffer" replaces the OpenGL vertex buffers of a part
+// that has been reread. The new buffers are filled in completely before they
+// take the place of the old ones, so no frame shows a part partly updated.
+// INPUT: "int partIndex" is the index of the part.
+//=============================================================================
+void OpenGLWidget::replaceBuffer(int partIndex)
+{
+    if ((0 <= partIndex) && (partIndex < m_buffers.size()))
+    {
+        m_buffers[partIndex] = createBuffers(partIndex);
+        update();
+    }
+}
+
+
 //=============================================================================
 // The function "removeBuffer" removes the OpenGL vertex buffer corresponding
 // to a specified part.
@@ -425,23 +479,27 @@ void OpenGLWidget::paintGL()
                 m_lightingShaderProgram.setUniformValue("ambientColor", m_partColor);
         }
 
-        m_buffers[i].bind();
-        // Specify how the shader program is to interpret the entries of the
-        // buffer as inputs for its vertex shader.
-        m_lightingShaderProgram.setAttributeBuffer("vertex", GL_FLOAT, 0, 3, 6 * sizeof(GLfloat));
-        m_lightingShaderProgram.setAttributeBuffer("normal", GL_FLOAT, 3 * sizeof(GLfloat), 3, 6 * sizeof(GLfloat));
-        // Get the number of vertices in the current buffer.
-        int numVertices = m_buffers[i].size() / (6 * sizeof(GLfloat));
-        m_buffers[i].release();
-
-        // Enable the vertex and vertex normal arrays.
-        m_lightingShaderProgram.enableAttributeArray("vertex");
-        m_lightingShaderProgram.enableAttributeArray("normal");
-        // Draw the triangles.
-        glDrawArrays(GL_TRIANGLES, 0, numVertices);
-        // Disable the vertex and vertex normal arrays.
-        m_lightingShaderProgram.disableAttributeArray("vertex");
-        m_lightingShaderProgram.disableAttributeArray("normal");
+        // Draw the part buffer by buffer.
+        for (auto it = m_buffers[i].begin(); it != m_buffers[i].end(); ++it)
+        {
+            it->bind();
+            // Specify how the shader program is to interpret the entries of
+            // the buffer as inputs for its vertex shader.
+            m_lightingShaderProgram.setAttributeBuffer("vertex", GL_FLOAT, 0, 3, 6 * sizeof(GLfloat));
+            m_lightingShaderProgram.setAttributeBuffer("normal", GL_FLOAT, 3 * sizeof(GLfloat), 3, 6 * sizeof(GLfloat));
+            // Get the number of vertices in the current buffer.
+            int numVertices = it->size() / (6 * sizeof(GLfloat));
+            it->release();
+
+            // Enable the vertex and vertex normal arrays.
+            m_lightingShaderProgram.enableAttributeArray("vertex");
+            m_lightingShaderProgram.enableAttributeArray("normal");
+            // Draw the triangles.
+            glDrawArrays(GL_TRIANGLES, 0, numVertices);
+            // Disable the vertex and vertex normal arrays.
+            m_lightingShaderProgram.disableAttributeArray("vertex");
+            m_lightingShaderProgram.disableAttributeArray("normal");
+        }
     }
     m_lightingShaderProgram.release();
 
@@ -39,6 +39,7 @@ public:
 public slots:
     void addBuffer();
     void removeBuffer(int partIndex);
+    void replaceBuffer(int partIndex);
     void restoreFocus() { setFocus(); }  // restore the focus on the drawings
     void updateWhenMasterBoxChange();
 
@@ -59,6 +60,7 @@ signals:
 
 private: // member functions
     void setDistanceFromCameraToWorldOrigin(float dist) { m_cameraToWorldOriginDistance = dist; }
+    QList<QOpenGLBuffer> createBuffers(int partIndex);
     void paintMasterBox();
     void initializePicking();
     void setColorsForPicking(int partIndex);
@@ -70,7 +72,7 @@ private: // member variables
     QMatrix4x4 m_pMatrix;                           // projection matrix
     QOpenGLShaderProgram m_lightingShaderProgram;   // to manage lighting shaders
     PartsModel * m_partsModel;                      // parts model
-    QList<QOpenGLBuffer> m_buffers;                 // buffers for the shading program, one per part
+    QList<QList<QOpenGLBuffer> > m_buffers;         // buffers for the shading program, a list per part
     QOpenGLBuffer m_masterBoxBuffer;                // buffer for the shading program, holds master box vertices
 
     QColor m_backgroundColor;    // background color
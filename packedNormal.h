@@ -0,0 +1,95 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef PACKED_NORMAL_HEADER
+#define PACKED_NORMAL_HEADER
+
+#include <QtGlobal>
+#include <QVector3D>
+
+// A unit normal packed into 32 bits by the octahedral mapping: the normal is
+// projected onto the octahedron |x| + |y| + |z| = 1, whose lower half is
+// folded over the upper one, and the resulting point of the square [-1,1]^2
+// is stored as two 16-bit signed fixed-point numbers, x in the low and y in
+// the high half. The angular error is below 0.05 degrees.
+typedef quint32 PackedNormal;
+
+// Packed value of the zero vector, e.g., the normal of a degenerate triangle.
+// The fixed-point numbers never take the value -32768 otherwise.
+const PackedNormal zeroPackedNormal = 0x80008000u;
+
+// Scale of the 16-bit fixed-point numbers.
+const float packedNormalScale = 32767.0f;
+
+
+//=============================================================================
+// The function "packNormal" packs a normal by the octahedral mapping.
+// INPUT: "const QVector3D & normal" is the normal; it need not be unit.
+// OUTPUT: The function returns the packed normal.
+// NOTE: This is a non-member function.
+//=============================================================================
+inline PackedNormal packNormal(const QVector3D & normal)
+{
+    const float sum = qAbs(normal.x()) + qAbs(normal.y()) + qAbs(normal.z());
+    // The comparison is false also for not-a-number coordinates.
+    if ((sum > 0.0f) == false)
+        return zeroPackedNormal;
+    float u = normal.x() / sum;
+    float v = normal.y() / sum;
+    if (normal.z() < 0.0f)
+    {
+        const float foldedU = (1.0f - qAbs(v)) * ((u >= 0.0f) ? 1.0f : -1.0f);
+        v = (1.0f - qAbs(u)) * ((v >= 0.0f) ? 1.0f : -1.0f);
+        u = foldedU;
+    }
+    const qint16 packedU = static_cast<qint16>(qRound(qBound(-1.0f, u, 1.0f) * packedNormalScale));
+    const qint16 packedV = static_cast<qint16>(qRound(qBound(-1.0f, v, 1.0f) * packedNormalScale));
+    return quint32(quint16(packedU)) | (quint32(quint16(packedV)) << 16);
+}
+
+
+//=============================================================================
+// The function "unpackNormal" restores a normal packed by "packNormal".
+// INPUT: "PackedNormal packed" is the packed normal.
+// OUTPUT: The function returns the unit normal, or the zero vector.
+// NOTE: This is a non-member function.
+//=============================================================================
+inline QVector3D unpackNormal(PackedNormal packed)
+{
+    if (packed == zeroPackedNormal)
+        return QVector3D();
+    const float u = static_cast<qint16>(packed & 0xFFFFu) / packedNormalScale;
+    const float v = static_cast<qint16>(packed >> 16) / packedNormalScale;
+    const float z = 1.0f - qAbs(u) - qAbs(v);
+    if (z >= 0.0f)
+        return QVector3D(u, v, z).normalized();
+    return QVector3D((1.0f - qAbs(v)) * ((u >= 0.0f) ? 1.0f : -1.0f),
+                     (1.0f - qAbs(u)) * ((v >= 0.0f) ? 1.0f : -1.0f), z).normalized();
+}
+
+
+//=============================================================================
+// The function "rotatePackedNormal" rotates a packed normal 90 degrees
+// counterclockwise in the xy-plane, mapping (x, y, z) to (-y, x, z). The
+// octahedral mapping commutes with the rotation, so the packed numbers are
+// rotated in the same way and no precision is lost.
+// INPUT: "PackedNormal packed" is the packed normal.
+// OUTPUT: The function returns the packed rotated normal.
+// NOTE: This is a non-member function.
+//=============================================================================
+inline PackedNormal rotatePackedNormal(PackedNormal packed)
+{
+    if (packed == zeroPackedNormal)
+        return packed;
+    const qint16 packedU = static_cast<qint16>(packed & 0xFFFFu);
+    const qint16 packedV = static_cast<qint16>(packed >> 16);
+    return quint32(quint16(static_cast<qint16>(-packedV))) | (quint32(quint16(packedU)) << 16);
+}
+
+#endif // PACKED_NORMAL_HEADER
@@ -0,0 +1,124 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "parallelFor.h"
+
+#include <QVector>
+#include <QtConcurrent>
+#include <atomic>   // atomic
+
+// Indicates if parallel loops are to run on the calling thread only.
+static std::atomic<bool> s_doForceSingleThread(false);
+// Indicates if parallel loops started from the current thread are to run on
+// that thread only.
+static thread_local bool s_doForceSingleThreadOnCurrentThread = false;
+
+//=============================================================================
+// The class "ParallelChunk" describes a range of items processed by a single
+// call of the loop function.
+//=============================================================================
+struct ParallelChunk
+{
+    qint64 index;  // index of the chunk
+    qint64 begin;  // first item in the chunk
+    qint64 end;    // one past the last item in the chunk
+};
+
+
+//=============================================================================
+// The function "setDoForceSingleThread" forces all parallel loops to run on
+// the calling thread, e.g., for comparison and debugging.
+// INPUT: "bool doForceSingleThread" indicates if a single thread is to be used.
+//=============================================================================
+void setDoForceSingleThread(bool doForceSingleThread)
+{
+    s_doForceSingleThread = doForceSingleThread;
+}
+
+
+//=============================================================================
+// The function "doForceSingleThread" indicates if all parallel loops are
+// forced to run on the calling thread.
+//=============================================================================
+bool doForceSingleThread()
+{
+    return s_doForceSingleThread;
+}
+
+
+//=============================================================================
+// The function "setDoForceSingleThreadOnCurrentThread" forces the parallel
+// loops started from the calling thread to run on that thread. Loops started
+// from other threads are not affected.
+// INPUT: "bool doForceSingleThread" indicates if a single thread is to be used.
+//=============================================================================
+void setDoForceSingleThreadOnCurrentThread(bool doForceSingleThread)
+{
+    s_doForceSingleThreadOnCurrentThread = doForceSingleThread;
+}
+
+
+//=============================================================================
+// The function "numChunks" finds the number of chunks of a given size needed
+// to cover a range of items.
+// INPUT: "qint64 numItems" is the number of items in the range.
+// "qint64 chunkSize" is the maximal number of items per chunk.
+// OUTPUT: The function returns the number of chunks.
+//=============================================================================
+qint64 numChunks(qint64 numItems, qint64 chunkSize)
+{
+    if (numItems <= 0)
+        return 0;
+    chunkSize = qMax(chunkSize, qint64(1));
+    return (numItems + chunkSize - 1) / chunkSize;
+}
+
+
+//=============================================================================
+// The function "parallelForChunks" splits a range of items into chunks and
+// processes the chunks in parallel.
+// INPUT: "qint64 numItems" is the number of items in the range [0, numItems).
+// "qint64 chunkSize" is the maximal number of items per chunk.
+// "function" is called once per chunk with the index of the chunk and the
+// range [begin, end) of items it covers. Calls for different chunks may run
+// concurrently and in any order, so they must write to disjoint data.
+//=============================================================================
+void parallelForChunks(qint64 numItems, qint64 chunkSize,
+                       const std::function<void(qint64 chunkIndex, qint64 begin, qint64 end)> & function)
+{
+    // Set up the chunks.
+    chunkSize = qMax(chunkSize, qint64(1));
+    const qint64 chunkCount = numChunks(numItems, chunkSize);
+    QVector<ParallelChunk> chunks;
+    chunks.reserve(chunkCount);
+    for (qint64 i = 0; i < chunkCount; ++i)
+    {
+        ParallelChunk chunk;
+        chunk.index = i;
+        chunk.begin = i * chunkSize;
+        chunk.end = qMin(numItems, chunk.begin + chunkSize);
+        chunks.push_back(chunk);
+    }
+
+    // Run a single chunk or loops forced to a single thread on the calling
+    // thread.
+    if ((chunks.size() <= 1) || (s_doForceSingleThread == true) ||
+        (s_doForceSingleThreadOnCurrentThread == true))
+    {
+        for (auto cit = chunks.cbegin(); cit != chunks.cend(); ++cit)
+            function(cit->index, cit->begin, cit->end);
+        return;
+    }
+
+    // Process the chunks on the global thread pool and wait for all of them.
+    QtConcurrent::blockingMap(chunks, [&function](ParallelChunk & chunk)
+    {
+        function(chunk.index, chunk.begin, chunk.end);
+    });
+}
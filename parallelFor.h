@@ -0,0 +1,35 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef PARALLEL_FOR_HEADER
+#define PARALLEL_FOR_HEADER
+
+#include <QtGlobal>
+#include <functional>   // function
+
+// Force all parallel loops to run on the calling thread only.
+void setDoForceSingleThread(bool doForceSingleThread);
+bool doForceSingleThread();
+
+// Force the parallel loops started from the calling thread to run on that
+// thread only, e.g., for work in the background that is not to compete with
+// the rest for the global thread pool.
+void setDoForceSingleThreadOnCurrentThread(bool doForceSingleThread);
+
+// Find the number of chunks of a given size needed to cover a range of items.
+qint64 numChunks(qint64 numItems, qint64 chunkSize);
+
+// Split the range [0, numItems) into consecutive chunks of "chunkSize" items
+// (the last one possibly shorter) and call the given function for every chunk
+// on the global thread pool. The chunks depend only on "numItems" and
+// "chunkSize", so per-chunk results do not depend on the number of threads.
+void parallelForChunks(qint64 numItems, qint64 chunkSize,
+                       const std::function<void(qint64 chunkIndex, qint64 begin, qint64 end)> & function);
+
+#endif // PARALLEL_FOR_HEADER
@@ -8,6 +8,8 @@
 //=============================================================================
 
 #include "part.h"
+#include "normalSmoothing.h"
+#include "parallelFor.h"
 
 #include <QFile>
 #include <QString>
@@ -18,27 +20,113 @@
 #include <QMessageBox>
 #include <QDebug>
 #include <algorithm>  // swap, lexicographical_compare
+#include <atomic>     // atomic
+
+// Number of triangles handled by a single task when setting normals or
+// moving the vertices.
+static const qint64 s_partChunkSize = 65536;
 
 // Constructors.
-Part::Part() : m_numTriangles(0), m_vertices(), m_vertexNormals()
+Part::Part() : m_numTriangles(0), m_positions(), m_indices(), m_faceNormals(), m_vertexNormals(), m_measures(),
+    m_areMeasuresKnown(false)
 {}
 
 Part::Part(const Part & part) :
     m_numTriangles(part.numTriangles()),
-    m_vertices(part.vertices()),
-    m_vertexNormals(part.vertexNormals())
+    m_positions(part.positions()),
+    m_indices(part.indices()),
+    m_faceNormals(part.faceNormals()),
+    m_vertexNormals(part.vertexNormals()),
+    m_measures(part.m_measures),
+    m_areMeasuresKnown(part.m_areMeasuresKnown)
 {}
 
 Part::~Part() {}
 
 
+//=============================================================================
+// The function "memorySize" finds the memory held by the positions, the
+// indices and the normals, including the room reserved beyond the last of
+// them.
+// OUTPUT: The function returns the memory in bytes.
+//=============================================================================
+qint64 Part::memorySize() const
+{
+    return m_positions.capacity() * qint64(sizeof(QVector3D)) + m_indices.capacity() * qint64(sizeof(quint32)) +
+            (m_faceNormals.capacity() + m_vertexNormals.capacity()) * qint64(sizeof(PackedNormal));
+}
+
+
+//=============================================================================
+// The function "setTriangles" welds the vertices of a triangle soup, within
+// the current weld tolerance, into the positions and the indices of the part.
+// The normals are left for the caller to set.
+// INPUT: "const GeometryArray<QVector3D> & vertices" are the vertices of the
+// soup, 3 per triangle.
+// OUTPUT: "QString * errorMessage", if not null, returns the reason of a failure.
+// The function itself returns "true" on success and "false" otherwise.
+//=============================================================================
+bool Part::setTriangles(const GeometryArray<QVector3D> & vertices, QString * errorMessage)
+{
+    const bool isSuccess = weldVertices(vertices.constData(), vertices.size(), weldTolerance(),
+                                        m_positions, m_indices, errorMessage);
+    m_numTriangles = m_indices.size() / 3;
+    m_areMeasuresKnown = false;
+    return isSuccess;
+}
+
+
+//=============================================================================
+// The function "setIndexedTriangles" takes over the positions and the indices
+// of an indexed mesh as they are. Only with a positive weld tolerance are the
+// positions within the tolerance of each other welded, and the indices then
+// renumbered to the welded positions. The normals are left for the caller to
+// set.
+// INPUT: "GeometryArray<QVector3D> & positions" are the positions, and
+// "GeometryArray<quint32> & indices" are the indices of the positions, 3 per
+// triangle. Both are taken over and left empty.
+// OUTPUT: "QString * errorMessage", if not null, returns the reason of a failure.
+// The function itself returns "true" on success and "false" otherwise.
+//=============================================================================
+bool Part::setIndexedTriangles(GeometryArray<QVector3D> & positions, GeometryArray<quint32> & indices,
+                               QString * errorMessage)
+{
+    m_positions.clear();
+    m_indices.clear();
+    m_numTriangles = 0;
+    m_areMeasuresKnown = false;
+    const float tolerance = weldTolerance();
+    if (tolerance > 0.0f)
+    {
+        GeometryArray<quint32> welded;
+        if (weldVertices(positions.constData(), positions.size(), tolerance, m_positions, welded,
+                         errorMessage) == false)
+            return false;
+        positions.clear();
+        const quint32 * weldedData = welded.constData();
+        quint32 * indexData = indices.data();
+        parallelForChunks(indices.size(), 3 * s_partChunkSize, [=](qint64, qint64 begin, qint64 end)
+        {
+            for (qint64 i = begin; i < end; ++i)
+                indexData[i] = weldedData[indexData[i]];
+        });
+    }
+    else
+        m_positions.swap(positions);
+    m_indices.swap(indices);
+    m_numTriangles = m_indices.size() / 3;
+    return true;
+}
+
+
 //=============================================================================
 // The function "shift" shifts the vertices by a given 3D vector.
 // INPUT: "const QVector3D & shift" is a 3D vector to be added to all vertices.
 //=============================================================================
 void Part::shift(const QVector3D & shift)
 {
-    for (auto it = m_vertices.begin(); it != m_vertices.end(); ++it)
+    m_areMeasuresKnown = false;
+    for (auto it = m_positions.begin(); it != m_positions.end(); ++it)
         *it += shift;
 }
 
@@ -58,15 +146,18 @@ void rotate(QVector3D & v)
 
 
 //=============================================================================
-// The function "rotate" rotates all vertices and vertex normals 90 degrees
+// The function "rotate" rotates all vertices and normals 90 degrees
 // counterclockwise.
 //=============================================================================
 void Part::rotate()
 {
-    for (auto it = m_vertices.begin(); it != m_vertices.end(); ++it)
+    m_areMeasuresKnown = false;
+    for (auto it = m_positions.begin(); it != m_positions.end(); ++it)
         ::rotate(*it);
+    for (auto it = m_faceNormals.begin(); it != m_faceNormals.end(); ++it)
+        *it = rotatePackedNormal(*it);
     for (auto it = m_vertexNormals.begin(); it != m_vertexNormals.end(); ++it)
-        ::rotate(*it);
+        *it = rotatePackedNormal(*it);
 }
 
 
@@ -77,7 +168,7 @@ void Part::rotate()
 //=============================================================================
 void Part::coordinateRanges(QVector3D & minCoord, QVector3D & maxCoord) const
 {
-    findCoordinateRanges(m_vertices, minCoord, maxCoord);
+    findCoordinateRanges(m_positions, minCoord, maxCoord);
 }
 
 
@@ -90,97 +181,114 @@ void Part::normalizeVertices()
     // Find the ranges of the coordinates of the vertices.
     QVector3D minCoord;
     QVector3D maxCoord;
-    findCoordinateRanges(m_vertices, minCoord, maxCoord);
+    findCoordinateRanges(m_positions, minCoord, maxCoord);
     qDebug() << "Min coordinates: " << minCoord;
     qDebug() << "Max coordinates: " << maxCoord;
 
-    // Shift and scale all vertices.
-    QVector3D shift = (maxCoord + minCoord) / 2;
-    QVector3D diameter = (maxCoord - minCoord) / 2;
-    float scale = qMax(diameter.x(), qMax(diameter.y(), diameter.z()));
-    for (auto it = m_vertices.begin(); it != m_vertices.end(); ++it)
-        *it = (*it - shift) / scale;
+    // Shift and scale all positions in parallel chunks.
+    const QVector3D shift = (maxCoord + minCoord) / 2;
+    const QVector3D diameter = (maxCoord - minCoord) / 2;
+    const float scale = qMax(diameter.x(), qMax(diameter.y(), diameter.z()));
+    m_areMeasuresKnown = false;
+    QVector3D * position = m_positions.data();
+    parallelForChunks(m_positions.size(), 3 * s_partChunkSize, [=](qint64, qint64 begin, qint64 end)
+    {
+        for (qint64 i = begin; i < end; ++i)
+            position[i] = (position[i] - shift) / scale;
+    });
 }
 
 
 //=============================================================================
-// The function "setFaceNormalsAsVertexNormals" sets given face normals as
-// vertex normals by simply setting three consecutive copies of the face
-// normal, one for each vertex.
-// INPUT: "const QVector<QVector3D> & faceNormals" are face (triangle) normals.
+// The function "computeFaceNormals" computes each triangle's normal from its
+// vertices, and drops the vertex normals, if any.
 //=============================================================================
-void Part::setFaceNormalsAsVertexNormals(const QVector<QVector3D> & faceNormals)
+void Part::computeFaceNormals()
 {
     m_vertexNormals.clear();
-    m_vertexNormals.reserve(3 * faceNormals.size());
-    for (auto cit = faceNormals.cbegin(); cit != faceNormals.cend(); ++cit)
+    m_faceNormals.clear();
+    m_faceNormals.resize(m_numTriangles);
+    const QVector3D * position = m_positions.constData();
+    const quint32 * index = m_indices.constData();
+    PackedNormal * packed = m_faceNormals.data();
+    parallelForChunks(m_faceNormals.size(), s_partChunkSize, [=](qint64, qint64 begin, qint64 end)
     {
-        m_vertexNormals.push_back(*cit);
-        m_vertexNormals.push_back(*cit);
-        m_vertexNormals.push_back(*cit);
-    }
+        for (qint64 t = begin; t < end; ++t)
+        {
+            packed[t] = packNormal(QVector3D::normal(position[index[3 * t]], position[index[3 * t + 1]],
+                                                     position[index[3 * t + 2]]));
+        }
+    });
 }
 
 
 //=============================================================================
-// The function "areFaceNormalsCorrect" checks if all read normals agree with
-// those computed from the triangles assuming the normal points toward the
-// viewer when the vertices of the triangle are listed counterclockwise.
-// INPUT: "const QVector<QVector3D> & faceNormals" are face (triangle) normals.
+// The function "prepareTriangles" sets the face normals of triangles just
+// read and measures the triangles in a single parallel pass: every chunk of
+// triangles has its normals checked against those computed from the
+// vertices, the read ones kept where they agree and repaired where they do
+// not, and is measured right away while its positions are in the cache. The
+// vertex normals, if any, are dropped.
+// INPUT: "const GeometryArray<QVector3D> & faceNormals" are the face normals
+// read, 1 per triangle; the triangles beyond them get computed normals.
 // "float threshold" specifies the maximal squared length of the difference of
 // two 3D vectors for which they are considered the same.
-// OUTPUT: The function returns "true" is all normals are correct and "false"
-// otherwise.
 //=============================================================================
-bool Part::areFaceNormalsCorrect(const QVector<QVector3D> & faceNormals, float threshold) const
+void Part::prepareTriangles(const GeometryArray<QVector3D> & faceNormals, float threshold)
 {
-    auto citTriangle = faceNormals.cbegin();
-    for (auto cit = m_vertices.cbegin(); cit != m_vertices.cend(); cit += 3, ++citTriangle)
+    m_vertexNormals.clear();
+    m_faceNormals.clear();
+    m_faceNormals.resize(m_numTriangles);
+    const QVector3D * position = m_positions.constData();
+    const quint32 * index = m_indices.constData();
+    const QVector3D * readNormal = faceNormals.constData();
+    const qint64 numReadNormals = faceNormals.size();
+    PackedNormal * packed = m_faceNormals.data();
+    std::atomic<qint64> numRepaired(0);
+    std::atomic<qint64> * numRepairedPtr = &numRepaired;
+    m_measures = ::measureTriangles(position, m_positions.size(), index, m_numTriangles,
+                                    [=](qint64 begin, qint64 end)
     {
-        // Compute the current triangle's normal.
-        QVector3D diff = *citTriangle - QVector3D::normal(*cit, *(cit + 1), *(cit + 2));
-        if (diff.lengthSquared() > threshold)
-            return false;
-    }
-    return true;
+        qint64 numChunkRepaired = 0;
+        for (qint64 t = begin; t < end; ++t)
+        {
+            const QVector3D normal = QVector3D::normal(position[index[3 * t]], position[index[3 * t + 1]],
+                                                       position[index[3 * t + 2]]);
+            const bool isCorrect = (t < numReadNormals) && ((readNormal[t] - normal).lengthSquared() <= threshold);
+            numChunkRepaired += (isCorrect == true) ? 0 : 1;
+            packed[t] = packNormal((isCorrect == true) ? readNormal[t] : normal);
+        }
+        *numRepairedPtr += numChunkRepaired;
+    });
+    m_areMeasuresKnown = true;
+    if (numRepaired > 0)
+        qDebug() << "Incorrect normals detected and repaired:" << numRepaired;
 }
 
 
 //=============================================================================
-// The function "setVertexNormals" computes each triangle's normal and sets it
-// as a vertex normal for each vertex of that triangle.
+// The function "vertexNormal" finds the normal of a given vertex.
+// INPUT: "qint64 i" is the index of the vertex.
+// OUTPUT: The function returns the vertex normal of the vertex if the part has
+// vertex normals, and the normal of its triangle otherwise.
 //=============================================================================
-void Part::setVertexNormals()
+QVector3D Part::vertexNormal(qint64 i) const
 {
-    m_vertexNormals.clear();
-    m_vertexNormals.reserve(m_vertices.size());
-    for (auto cit = m_vertices.cbegin(); cit != m_vertices.cend(); cit += 3)
-    {
-        QVector3D currNormal = QVector3D::normal(*cit, *(cit + 1), *(cit + 2));
-        m_vertexNormals.push_back(currNormal);
-        m_vertexNormals.push_back(currNormal);
-        m_vertexNormals.push_back(currNormal);
-    }
+    return unpackNormal(packedVertexNormal(i));
 }
 
 
 //=============================================================================
-// The function "setVertexNormalsAsCrossProducts" computes each triangle's
-// normal as the cross product of two of its sizes, i.e., it is a normal vector
-// whose length is proportional to the triangle's area rather than being one,
-// and sets it as a vertex normal for each vertex of that triangle.
+// The function "packedVertexNormal" finds the packed normal of a given vertex.
+// INPUT: "qint64 i" is the index of the vertex.
+// OUTPUT: The function returns the packed vertex normal of the vertex if the
+// part has vertex normals, and the packed normal of its triangle otherwise.
 //=============================================================================
-void Part::setVertexNormalsAsCrossProducts()
+PackedNormal Part::packedVertexNormal(qint64 i) const
 {
-    m_vertexNormals.clear();
-    m_vertexNormals.reserve(m_vertices.size());
-    for (auto cit = m_vertices.cbegin(); cit != m_vertices.cend(); cit += 3)
-    {
-        QVector3D currNormal = QVector3D::crossProduct(*(cit + 1) - *cit, *(cit + 2) - *cit);
-        m_vertexNormals.push_back(currNormal);
-        m_vertexNormals.push_back(currNormal);
-        m_vertexNormals.push_back(currNormal);
-    }
+    if (hasVertexNormals() == true)
+        return m_vertexNormals[i];
+    return m_faceNormals[i / 3];
 }
 
 
@@ -189,123 +297,84 @@ void Part::setVertexNormalsAsCrossProducts()
 // surface. Coordinates are asuumed to be in milimeters (mm).
 // OUTPUT: The function returns the computed volume in mililiters (mL).
 //=============================================================================
-double Part::computeVolume()
+double Part::computeVolume() const
+{
+    // Divide by 1000 to convert from cubic mm into cubic cm (aka mL).
+    return qAbs(measureTriangles().signedVolume / 1000.0);  // in mL
+}
+
+
+//=============================================================================
+// The function "measureTriangles" finds the x-, y-, and z-ranges, the signed
+// volume and the area of the triangles in a single parallel pass, unless
+// they have been found while preparing the triangles and the triangles have
+// not moved since.
+// OUTPUT: The function returns the measures.
+//=============================================================================
+TriangleMeasures Part::measureTriangles() const
 {
-    double volume = 0.0f;
-    for (auto cit = m_vertices.cbegin(); cit != m_vertices.cend(); cit += 3)
-        volume += QVector3D::dotProduct(QVector3D::crossProduct(*cit, *(cit + 1)), *(cit + 2));
-    // Divide by 6 to get volume and further by 1000 to convert from cubic mm
-    // into cubic cm (aka mL).
-    return qAbs(volume / 6000.0f);  // in mL
+    if (m_areMeasuresKnown == true)
+        return m_measures;
+    return ::measureTriangles(m_positions.constData(), m_positions.size(), m_indices.constData(), m_numTriangles);
 }
 
 
 //=============================================================================
 // The function "findCoordinateRanges" finds the smallest and largest of
 // coordinates of a collection of 3D vectors.
-// INPUT: "const QVector<QVector3D> & vertices" is a collection of 3D vectors.
+// INPUT: "const GeometryArray<QVector3D> & vertices" is a collection of 3D vectors.
 // OUTPUT: "QVector3D & minCoord" returns the smallest x, y, and z coordinates.
 // "QVector3D & maxCoord" returns the largest x, y, and z coordinates.
+// NOTE: This is a non-member function.
 //=============================================================================
-void findCoordinateRanges(const QVector<QVector3D> & vertices,
+void findCoordinateRanges(const GeometryArray<QVector3D> & vertices,
                           QVector3D & minCoord, QVector3D & maxCoord)
 {
-    // Initialize using the first 3D vector.
-    QVector3D vert = *vertices.cbegin();
-    float xMin, xMax, yMin, yMax, zMin, zMax;
-    xMin = xMax = vert.x();
-    yMin = yMax = vert.y();
-    zMin = zMax = vert.z();
-
-    // Find the ranges of the coordinates of the vertices.
-    for (auto cit = vertices.cbegin(); cit != vertices.cend(); ++cit)
-    {
-        if (xMin > cit->x())
-            xMin = cit->x();
-        else if (xMax < cit->x())
-            xMax = cit->x();
-        if (yMin > cit->y())
-            yMin = cit->y();
-        else if (yMax < cit->y())
-            yMax = cit->y();
-        if (zMin > cit->z())
-            zMin = cit->z();
-        else if (zMax < cit->z())
-            zMax = cit->z();
-    }
-
-    // Set the output.
-    minCoord.setX(xMin);
-    minCoord.setY(yMin);
-    minCoord.setZ(zMin);
-    maxCoord.setX(xMax);
-    maxCoord.setY(yMax);
-    maxCoord.setZ(zMax);
+    findCoordinateRanges(vertices.constData(), vertices.size(), minCoord, maxCoord);
 }
 
 
-
-
-#include <unordered_map>  // unordered_map
-#include <utility>        // make_pair
-#include <QVector3D>
-#include <boost/functional/hash.hpp> // hash_combine
-
 //=============================================================================
-// The class "vector3D_hash" computes a hash value for a 3D vectors.
+// The function "findPositionCorners" lists the triangle corners at every
+// position, which both the smoothing of the normals and the analysis of the
+// integrity go through.
+// OUTPUT: "PositionCorners & positionCorners" returns the lists of corners.
 //=============================================================================
-struct vector3D_hash
+void Part::findPositionCorners(PositionCorners & positionCorners) const
 {
-    std::size_t operator()(const QVector3D & vect) const
-    {
-        size_t seed = 0;
-        for(int i = 0; i < 3; ++i)
-            boost::hash_combine(seed, vect[i]);
-        return seed;
-    }
-};
+    ::findPositionCorners(m_indices.constData(), m_indices.size(), m_positions.size(), positionCorners);
+}
+
 
 //=============================================================================
-// The class "vector3D_equal_fn" compares two 3D vectors for being the same.
+// The function "smoothVertexNormals" smoothes the vertex normals by setting
+// the normal of every corner of a triangle to the average, weighed by area,
+// of the normals of the triangles sharing its position whose normals are
+// within a given crease angle of the normal of its triangle. The edges
+// sharper than the crease angle stay sharp, which keeps geometric shapes
+// looking as they are, while curved surfaces, e.g., of scans, look smooth.
+// INPUT: "float creaseAngle" is the crease angle in degrees.
+// "const PositionCorners & positionCorners" are the triangle corners at every
+// position.
 //=============================================================================
-struct vector3D_equal_fn
+void Part::smoothVertexNormals(float creaseAngle, const PositionCorners & positionCorners)
 {
-    bool operator() (QVector3D const & v1, QVector3D const & v2) const
-    {
-      return qFuzzyCompare(v1, v2);
-    }
-};
+    ::smoothVertexNormals(m_positions.constData(), m_positions.size(), m_indices.constData(), m_numTriangles,
+                          positionCorners, creaseAngle, m_vertexNormals);
+}
 
 
 //=============================================================================
-// The function "smoothVertexNormals" smoothes the vertex normals by replacing
-// the vertex normal in each instance of a vertex in every triangle by the
-// normalized sum of the normals that vertex had in the different triangles.
-// REMARK: The procedure does not seem to have good effect on geometric shapes;
-// keeping different normals for the same vertex in the different triangles
-// seems to be visually more pleasant.
+// The function "analyzeIntegrity" analyzes the integrity of the surface: the
+// boundary edges, which leave holes, the edges shared by more than two
+// triangles, the edges along which two triangles face opposite sides and
+// the triangles to flip to fix them, and the connected pieces. The volume is
+// only meaningful for a closed, consistently oriented surface.
+// INPUT: "const PositionCorners & positionCorners" are the triangle corners
+// at every position.
+// OUTPUT: The function returns the results of the analysis.
 //=============================================================================
-void Part::smoothVertexNormals()
+MeshIntegrity Part::analyzeIntegrity(const PositionCorners & positionCorners) const
 {
-    // Place all vertices as keys in a hash table where the value of each key
-    // is the average of all normals that that vertex has in the different
-    // triangles in which it participates.
-    std::unordered_map<QVector3D, QVector3D, vector3D_hash, vector3D_equal_fn> vertexToNormal;
-
-    for (auto citVert = m_vertices.cbegin(), citNorm = m_vertexNormals.cbegin();
-         citVert != m_vertices.cend(); ++citVert, ++citNorm)
-    {
-        vertexToNormal[*citVert] += *citNorm;
-    }
-
-    // Normalize the averaged normals.
-    for (auto & vt : vertexToNormal)
-        vt.second.normalize();
-
-    // Assign the averaged normal to each vertex.
-    for (auto itVert = m_vertices.begin(), itNorm = m_vertexNormals.begin();
-         itVert != m_vertices.end(); ++itVert, ++itNorm)
-    {
-        *itNorm = vertexToNormal[*itVert];
-    }
+    return analyzeMeshIntegrity(m_indices.constData(), m_numTriangles, m_positions.size(), positionCorners);
 }
@@ -12,8 +12,13 @@
 
 #include <QObject>
 #include <QString>
-#include <QVector>
 #include <QVector3D>
+#include "geometryArray.h"
+#include "geometryKernels.h"
+#include "meshAdjacency.h"
+#include "meshIntegrity.h"
+#include "packedNormal.h"
+#include "vertexWelding.h"
 
 class Part
 {
@@ -23,12 +28,21 @@ public:
     virtual ~Part() = 0;
 
     // Write out data.
-    virtual void writeData(const QString & filename) const = 0;
+    virtual bool writeData(const QString & filename, QString * errorMessage = nullptr) const = 0;
+
+    // Weld the vertices of a triangle soup into the positions and the
+    // indices of the part.
+    bool setTriangles(const GeometryArray<QVector3D> & vertices, QString * errorMessage = nullptr);
+
+    // Take over the positions and the indices of an indexed mesh, welding the
+    // positions only within a positive weld tolerance.
+    bool setIndexedTriangles(GeometryArray<QVector3D> & positions, GeometryArray<quint32> & indices,
+                             QString * errorMessage = nullptr);
 
     // Shift the vertices by a given 3D vector.
     void shift(const QVector3D & shift);
 
-    // Rotate 90 degrees counterclockwise the vertices and the vertex normals.
+    // Rotate 90 degrees counterclockwise the vertices and the normals.
     void rotate();
 
     // Find the x-, y-, and z-ranges of the part.
@@ -38,46 +52,70 @@ public:
     // and fits in the cube [-1,1]^3.
     void normalizeVertices();
 
-    // Check if given face normals agree with those computed from triangles.
-    bool areFaceNormalsCorrect(const QVector<QVector3D> & faceNormals, float threshold) const;
-
-    // Set each vertex's normal to the one computed from its triangle.
-    void setVertexNormals();
-    void setVertexNormalsAsCrossProducts();
+    // Set each triangle's normal to the one computed from its vertices.
+    void computeFaceNormals();
 
-    // Set existing face normals as vertex normals.
-    void setFaceNormalsAsVertexNormals(const QVector<QVector3D> & faceNormals);
+    // Set the face normals, keeping the given ones that agree with those
+    // computed from the triangles and repairing the others, and measure the
+    // triangles in the same pass.
+    void prepareTriangles(const GeometryArray<QVector3D> & faceNormals, float threshold);
 
     // Compute the volume encompassed by the closed surface.
-    double computeVolume();
-
-    // Smoothe the vertex normals by replacing the vertex normal in each
-    // instance of a vertex in every triangle by the normalized sum of the
-    // normals that vertex had in the different triangles.
-    void smoothVertexNormals();
-
-    // Accessors.
-    qint32 numTriangles() const { return m_numTriangles; }
-    long int numVertices() const { return m_vertices.size(); }
-
-    QVector<QVector3D>::const_iterator vertexBeginIter() const { return m_vertices.cbegin(); }
-    QVector<QVector3D>::const_iterator vertexEndIter() const { return m_vertices.cend(); }
-    const QVector3D * vertexConstData() const { return &(*m_vertices.cbegin()); }
-    const QVector<QVector3D> & vertices() const { return m_vertices; }
-    QVector<QVector3D>::const_iterator vertexNormalBeginIter() const { return m_vertexNormals.cbegin(); }
-    QVector<QVector3D>::const_iterator vertexNormalEndIter() const { return m_vertexNormals.cend(); }
-    const QVector3D * vertexNormalConstData() const { return &(*m_vertexNormals.cbegin()); }
-    const QVector<QVector3D> & vertexNormals() const { return m_vertexNormals; }
+    double computeVolume() const;
+
+    // Find the ranges, the signed volume and the area of the triangles, or
+    // take them from the preparation if the triangles have not moved since.
+    TriangleMeasures measureTriangles() const;
+
+    // List the triangle corners at every position.
+    void findPositionCorners(PositionCorners & positionCorners) const;
+
+    // Smoothe the vertex normals by setting the normal of every corner of a
+    // triangle to the average of the normals of the triangles sharing its
+    // position whose normals are within a given crease angle of its own.
+    void smoothVertexNormals(float creaseAngle, const PositionCorners & positionCorners);
+
+    // Find the holes, the non-manifold and misoriented edges, and the
+    // connected pieces of the surface.
+    MeshIntegrity analyzeIntegrity(const PositionCorners & positionCorners) const;
+
+    // Find the normal of the i-th vertex, i.e., its own normal if the part
+    // has vertex normals, and the normal of its triangle otherwise.
+    QVector3D vertexNormal(qint64 i) const;
+    PackedNormal packedVertexNormal(qint64 i) const;
+
+    // Accessors. The vertices are the corners of the triangles, 3 per
+    // triangle, and share the unique positions.
+    qint64 numTriangles() const { return m_numTriangles; }
+    qint64 numVertices() const { return 3 * m_numTriangles; }
+    qint64 numPositions() const { return m_positions.size(); }
+    qint64 memorySize() const;
+
+    QVector3D vertex(qint64 i) const { return m_positions[m_indices[i]]; }
+    const QVector3D * positionConstData() const { return m_positions.constData(); }
+    const GeometryArray<QVector3D> & positions() const { return m_positions; }
+    const quint32 * indexConstData() const { return m_indices.constData(); }
+    const GeometryArray<quint32> & indices() const { return m_indices; }
+    const PackedNormal * faceNormalConstData() const { return m_faceNormals.constData(); }
+    const GeometryArray<PackedNormal> & faceNormals() const { return m_faceNormals; }
+    bool hasVertexNormals() const { return m_vertexNormals.isEmpty() == false; }
+    const PackedNormal * vertexNormalConstData() const { return m_vertexNormals.constData(); }
+    const GeometryArray<PackedNormal> & vertexNormals() const { return m_vertexNormals; }
 
 protected:
-    qint32 m_numTriangles;               // number of triangles
-    QVector<QVector3D> m_vertices;       // all vertices, 3 per triangle
-    QVector<QVector3D> m_vertexNormals;  // all vertex normals, 3 per triangle
+    qint64 m_numTriangles;                     // number of triangles
+    GeometryArray<QVector3D> m_positions;      // unique positions of the vertices
+    GeometryArray<quint32> m_indices;          // indices of the positions, 3 per triangle
+    GeometryArray<PackedNormal> m_faceNormals; // all face normals, packed, 1 per triangle
+    GeometryArray<PackedNormal> m_vertexNormals; // vertex normals, packed, 3 per triangle, or none if the face normals are used
+    TriangleMeasures m_measures;               // measures found while preparing the triangles
+    bool m_areMeasuresKnown;                   // indicates if the measures are those of the current triangles
 };
 
 
 // Non-members.
-void findCoordinateRanges(const QVector<QVector3D> & vertices,
+void rotate(QVector3D & v);
+void findCoordinateRanges(const GeometryArray<QVector3D> & vertices,
                           QVector3D & minCoord, QVector3D & maxCoord);
 
 #endif // PART_HEADER
@@ -9,22 +9,229 @@
 
 #include "partFactory.h"
 #include "partStl.h"
+#include "partPly.h"
+#include "partObj.h"
 
 #include <QFileInfo>
-#include <QMessageBox>
 
-std::shared_ptr<Part> PartFactory::makePart(const QString & fileName)
+// Number of bytes read from the beginning of a file to decide its format.
+static const qint64 s_filePrefixSize = 512;
+// Ratio of the decompressed to the compressed size assumed when estimating
+// the size of compressed data.
+static const qint64 s_assumedCompressionRatio = 4;
+
+// Constructor.
+PartFactory::PartFactory() : m_loaders()
+{
+    // STL, binary or ascii. The binary format is recognized by its size.
+    PartLoader stlLoader;
+    stlLoader.formatName = "STL";
+    stlLoader.suffixes << "stl";
+    stlLoader.sniff = [](const FilePrefix & prefix)
+    {
+        return detectStlFormat(prefix.bytes, prefix.fileSize) != StlFormat::Unknown;
+    };
+    stlLoader.load = [](const FilePrefix & prefix, LoadProgress * progress)
+    {
+        // The format of a compressed file is detected again while streaming.
+        StlFormat format = (prefix.compression == Compression::None) ?
+                    detectStlFormat(prefix.bytes, prefix.fileSize) : StlFormat::Unknown;
+        return std::shared_ptr<Part>(new PartStl(prefix.fileName, format, progress));
+    };
+    stlLoader.estimateNumTriangles = [](const FilePrefix & prefix, qint64 dataSize)
+    {
+        return estimateStlNumTriangles(prefix.bytes, prefix.fileSize, dataSize);
+    };
+    registerLoader(stlLoader);
+
+    // PLY, binary little-endian or big-endian.
+    PartLoader plyLoader;
+    plyLoader.formatName = "PLY";
+    plyLoader.suffixes << "ply";
+    plyLoader.sniff = [](const FilePrefix & prefix)
+    {
+        return prefix.bytes.startsWith("ply\n") || prefix.bytes.startsWith("ply\r\n");
+    };
+    plyLoader.load = [](const FilePrefix & prefix, LoadProgress * progress)
+    {
+        return std::shared_ptr<Part>(new PartPly(prefix.fileName, progress));
+    };
+    plyLoader.estimateNumTriangles = [](const FilePrefix & prefix, qint64 dataSize)
+    {
+        return estimatePlyNumTriangles(prefix.bytes, dataSize);
+    };
+    registerLoader(plyLoader);
+
+    // Wavefront OBJ. Being plain text without a magic line, any file with
+    // the extension is accepted.
+    PartLoader objLoader;
+    objLoader.formatName = "OBJ";
+    objLoader.suffixes << "obj";
+    objLoader.sniff = [](const FilePrefix &)
+    {
+        return true;
+    };
+    objLoader.load = [](const FilePrefix & prefix, LoadProgress * progress)
+    {
+        return std::shared_ptr<Part>(new PartObj(prefix.fileName, progress));
+    };
+    objLoader.estimateNumTriangles = [](const FilePrefix &, qint64 dataSize)
+    {
+        return estimateObjNumTriangles(dataSize);
+    };
+    registerLoader(objLoader);
+}
+
+
+//=============================================================================
+// The function "registerLoader" adds a loader of a file format. Loaders are
+// tried in the order of registration.
+// INPUT: "const PartLoader & loader" is the loader to be added.
+//=============================================================================
+void PartFactory::registerLoader(const PartLoader & loader)
 {
-    // Check if the given file is an STL file.
-    QFileInfo fileInfo(fileName);
-    if (QString::compare(fileInfo.suffix(), "stl", Qt::CaseInsensitive) != 0)
+    m_loaders.push_back(loader);
+}
+
+
+//=============================================================================
+// The function "makePart" reads a part from a given file. The beginning of the
+// file is read once and offered to the loaders registered for the extension
+// of the file, and the first loader recognizing it reads the file. No user
+// interface is touched, so the function may run on a worker thread.
+// INPUT: "const QString & fileName" is the name of the file.
+// "LoadProgress * progress", if given, tracks the progress of the reading and
+// receives the description of a failure.
+// OUTPUT: The function returns the read part, or null on failure.
+//=============================================================================
+std::shared_ptr<Part> PartFactory::makePart(const QString & fileName, LoadProgress * progress) const
+{
+    // Find the loaders of the given file's extension.
+    const std::vector<const PartLoader *> candidates = findLoaders(fileName);
+    if (candidates.empty() == true)
     {
-        QMessageBox::information(0, "Input Error", "Reading from files with extension " +
-                                 fileInfo.suffix() + " is not supported.");
+        reportLoadError(progress, "Reading from files with extension " +
+                        QFileInfo(fileName).suffix() + " is not supported.");
         return std::shared_ptr<Part>(nullptr);
     }
-    else
+
+    // Read the beginning of the file and let the loaders recognize it.
+    FilePrefix prefix;
+    QString errorString;
+    if (readFilePrefix(fileName, prefix, errorString) == false)
+    {
+        reportLoadError(progress, "Could not open the file " + fileName +
+                        " for reading: " + errorString);
+        return std::shared_ptr<Part>(nullptr);
+    }
+    for (auto cit = candidates.cbegin(); cit != candidates.cend(); ++cit)
+    {
+        if ((*cit)->sniff(prefix) == true)
+        {
+            // The loader has already reported a failure of its own.
+            std::shared_ptr<Part> part = (*cit)->load(prefix, progress);
+            if ((part == nullptr) || (part->numTriangles() == 0))
+            {
+                if ((progress == nullptr) || (progress->hasError() == false))
+                    reportLoadError(progress, "The file " + fileName + " holds no triangles.");
+                return std::shared_ptr<Part>(nullptr);
+            }
+            return part;
+        }
+    }
+
+    reportLoadError(progress, "The file " + fileName + " is not a valid " +
+                    candidates.front()->formatName + " file.");
+    return std::shared_ptr<Part>(nullptr);
+}
+
+
+//=============================================================================
+// The function "estimateNumTriangles" estimates the number of triangles of a
+// file from its beginning and its size, without reading all of it. The size
+// of compressed data is estimated from the size of the file.
+// INPUT: "const QString & fileName" is the name of the file.
+// OUTPUT: The function returns the estimated number of triangles, or -1 if
+// the file can not be read or its format can not estimate it.
+//=============================================================================
+qint64 PartFactory::estimateNumTriangles(const QString & fileName) const
+{
+    const std::vector<const PartLoader *> candidates = findLoaders(fileName);
+    FilePrefix prefix;
+    QString errorString;
+    if ((candidates.empty() == true) || (readFilePrefix(fileName, prefix, errorString) == false))
+        return -1;
+    const qint64 dataSize = (prefix.fileSize >= 0) ? prefix.fileSize :
+                                                     s_assumedCompressionRatio * QFileInfo(fileName).size();
+    for (auto cit = candidates.cbegin(); cit != candidates.cend(); ++cit)
+    {
+        if ((*cit)->sniff(prefix) == true)
+        {
+            if ((*cit)->estimateNumTriangles == nullptr)
+                return -1;
+            return qMax((*cit)->estimateNumTriangles(prefix, dataSize), qint64(0));
+        }
+    }
+    return -1;
+}
+
+
+//=============================================================================
+// The function "findLoaders" finds the loaders registered for the extension
+// of a given file.
+// INPUT: "const QString & fileName" is the name of the file.
+// OUTPUT: The function returns the loaders in the order of registration.
+//=============================================================================
+std::vector<const PartLoader *> PartFactory::findLoaders(const QString & fileName) const
+{
+    const QString suffix = dataSuffix(fileName);
+    std::vector<const PartLoader *> loaders;
+    for (auto cit = m_loaders.cbegin(); cit != m_loaders.cend(); ++cit)
     {
-        return std::shared_ptr<Part>(new PartStl(fileName));
+        if (cit->suffixes.contains(suffix) == true)
+            loaders.push_back(&(*cit));
     }
+    return loaders;
+}
+
+
+//=============================================================================
+// The function "fileDialogFilter" makes a filter for file dialogs listing the
+// extensions of all registered formats, compressed or not.
+// OUTPUT: The function returns the filter, e.g., "STL (*.stl *.stl.gz)".
+//=============================================================================
+QString PartFactory::fileDialogFilter() const
+{
+    QStringList filters;
+    for (auto cit = m_loaders.cbegin(); cit != m_loaders.cend(); ++cit)
+    {
+        QStringList patterns;
+        for (auto citSuffix = cit->suffixes.cbegin(); citSuffix != cit->suffixes.cend(); ++citSuffix)
+            patterns << "*." + *citSuffix << "*." + *citSuffix + ".gz" << "*." + *citSuffix + ".zst";
+        filters << cit->formatName + " (" + patterns.join(" ") + ")";
+    }
+    return filters.join(";;");
+}
+
+
+//=============================================================================
+// The function "readFilePrefix" reads the beginning of a file, decompressing
+// it if needed, together with the size of the data.
+// INPUT: "const QString & fileName" is the name of the file.
+// OUTPUT: "FilePrefix & prefix" returns the beginning of the file.
+// "QString & errorString" returns the reason of a failure.
+// The function itself returns "false" if the file can not be read and "true"
+// otherwise.
+//=============================================================================
+bool readFilePrefix(const QString & fileName, FilePrefix & prefix, QString & errorString)
+{
+    prefix.fileName = fileName;
+    std::unique_ptr<QIODevice> device = openInputFile(fileName, errorString, &prefix.compression);
+    if (device == nullptr)
+        return false;
+
+    // The size of decompressed data is not known without decompressing it.
+    prefix.fileSize = (prefix.compression == Compression::None) ? device->size() : -1;
+    prefix.bytes = device->read(s_filePrefixSize);
+    return true;
 }
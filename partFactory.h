@@ -11,15 +11,72 @@
 #define PART_FACTORY_HEADER
 
 #include "part.h"
+#include "decompressingDevice.h"
+#include "loadProgress.h"
+#include <QByteArray>
 #include <QString>
-#include <memory>   // shared_prt
+#include <QStringList>
+#include <functional>   // function
+#include <memory>       // shared_prt
+#include <vector>
+
+//=============================================================================
+// This class holds the first bytes of a file, decompressed if the file is
+// compressed, on which the format of the file is decided.
+//=============================================================================
+struct FilePrefix
+{
+    QString fileName;         // name of the file
+    QByteArray bytes;         // first (decompressed) bytes of the file
+    qint64 fileSize;          // size of the (decompressed) data, -1 if unknown
+    Compression compression;  // compression of the file
+};
+
+
+//=============================================================================
+// This class describes a loader of a file format. The function "sniff" decides
+// from the prefix of a file alone if the file is in the loader's format, and
+// the function "load" reads the file into a part, reporting its progress and
+// any failure through the given progress, which may be null. Both may be
+// called on a worker thread. The optional function "estimateNumTriangles"
+// estimates the number of triangles of a file from its prefix and the size
+// of its data, so that the memory it takes can be told before reading it.
+//=============================================================================
+struct PartLoader
+{
+    QString formatName;        // name of the format shown to the user
+    QStringList suffixes;      // file extensions of the format, in lower case
+    std::function<bool(const FilePrefix &)> sniff;
+    std::function<std::shared_ptr<Part>(const FilePrefix &, LoadProgress *)> load;
+    std::function<qint64(const FilePrefix &, qint64)> estimateNumTriangles;
+};
+
 
 class PartFactory
 {
 public:
-    PartFactory() {}
+    PartFactory();
+
+    // Register a loader of another file format.
+    void registerLoader(const PartLoader & loader);
+
+    // Read a part from a file. Safe to call from a worker thread.
+    std::shared_ptr<Part> makePart(const QString & fileName, LoadProgress * progress = nullptr) const;
+
+    // Estimate the number of triangles of a file without reading all of it.
+    qint64 estimateNumTriangles(const QString & fileName) const;
 
-    std::shared_ptr<Part> makePart(const QString & fileName);
+    // A filter for file dialogs listing the extensions of all loaders.
+    QString fileDialogFilter() const;
+
+private:
+    std::vector<const PartLoader *> findLoaders(const QString & fileName) const;
+
+    std::vector<PartLoader> m_loaders;  // registered loaders
 };
 
+
+// Non-members.
+bool readFilePrefix(const QString & fileName, FilePrefix & prefix, QString & errorString);
+
 #endif // PART_FACTORY_HEADER
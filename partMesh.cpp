@@ -0,0 +1,35 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "partMesh.h"
+#include "partStl.h"
+
+// Constructors.
+PartMesh::PartMesh() : Part()
+{}
+
+PartMesh::PartMesh(GeometryArray<QVector3D> positions, GeometryArray<quint32> indices,
+                   GeometryArray<PackedNormal> faceNormals, GeometryArray<PackedNormal> vertexNormals) : Part()
+{
+    m_positions.swap(positions);
+    m_indices.swap(indices);
+    m_faceNormals.swap(faceNormals);
+    m_vertexNormals.swap(vertexNormals);
+    m_numTriangles = m_indices.size() / 3;
+}
+
+PartMesh::PartMesh(const PartMesh & meshPart) : Part(meshPart)
+{}
+
+
+// Write out data.
+bool PartMesh::writeData(const QString & filename, QString * errorMessage) const
+{
+    return writeBinaryStlFile(filename, m_positions, m_indices, m_faceNormals, errorMessage);
+}
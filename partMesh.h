@@ -0,0 +1,37 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef PART_MESH_HEADER
+#define PART_MESH_HEADER
+
+#include <QString>
+#include <QVector3D>
+#include "geometryArray.h"
+#include "part.h"
+
+//=============================================================================
+// This class is a part made of given triangles rather than read from a file
+// of some format.
+//=============================================================================
+class PartMesh : public Part
+{
+public:
+    // Constructors.
+    PartMesh();
+    PartMesh(GeometryArray<QVector3D> positions, GeometryArray<quint32> indices,
+             GeometryArray<PackedNormal> faceNormals,
+             GeometryArray<PackedNormal> vertexNormals = GeometryArray<PackedNormal>());
+    PartMesh(const PartMesh & part);
+    virtual ~PartMesh() override {}
+
+    // Write out data as a binary STL file.
+    virtual bool writeData(const QString & filename, QString * errorMessage = nullptr) const override;
+};
+
+#endif // PART_MESH_HEADER
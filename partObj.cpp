@@ -0,0 +1,467 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "partObj.h"
+#include "partStl.h"
+#include "decompressingDevice.h"
+#include "loadProgress.h"
+#include "parallelFor.h"
+#include "textParsing.h"
+
+#include <QString>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <algorithm>  // copy
+#include <cstring>    // memchr
+#include <limits>     // numeric_limits
+#include <vector>
+
+// Number of bytes of text parsed by a single task when reading in parallel.
+static const qint64 s_objChunkSize = 4 * 1024 * 1024;
+// Typical number of bytes of an OBJ file per triangle: a face line along
+// with about half a vertex line and half a normal line.
+static const qint64 s_objBytesPerTriangle = 50;
+
+// Constructors.
+PartObj::PartObj() : Part(), m_filename()
+{}
+
+PartObj::PartObj(const QString & filename, LoadProgress * progress) : Part(), m_filename(filename)
+{
+    readFile(progress);
+}
+
+PartObj::PartObj(const PartObj & objPart) : Part(objPart), m_filename(objPart.filename())
+{}
+
+
+// Write out data.
+bool PartObj::writeData(const QString & filename, QString * errorMessage) const
+{
+    return writeBinaryStlFile(filename, m_positions, m_indices, m_faceNormals, errorMessage);
+}
+
+
+//=============================================================================
+// The function "readFile" reads in the OBJ file of the part.
+// INPUT: "LoadProgress * progress", if given, tracks the progress of the
+// reading.
+//=============================================================================
+bool PartObj::readFile(LoadProgress * progress)
+{
+    // Read the triangles as a soup, and weld their vertices.
+    GeometryArray<QVector3D> vertices;
+    return (readObjFile(m_filename, vertices, m_faceNormals, m_vertexNormals, progress) == true) &&
+            (setTriangles(vertices) == true);
+}
+
+
+//=============================================================================
+// The class "ObjChunk" holds the result of parsing a piece of an OBJ file.
+//=============================================================================
+struct ObjChunk
+{
+    const char * begin;                  // beginning of the piece, at a line
+    const char * end;                    // end of the piece, at the next piece's line
+    qint64 firstPosition;                // number of "v" lines before the piece
+    qint64 firstNormal;                  // number of "vn" lines before the piece
+    GeometryArray<QVector3D> positions;  // positions of the "v" lines of the piece
+    GeometryArray<QVector3D> normals;    // normals of the "vn" lines of the piece
+    QVector<qint32> corners;             // vertex and normal index (or -1) of every triangle corner
+    qint64 firstTriangle;                // number of triangles before the piece
+    const char * errorPos;               // position at which parsing failed, if it did
+    QString errorMessage;                // description of the failure
+};
+
+
+//=============================================================================
+// The function "objKeyword" classifies an OBJ line by its keyword.
+// INPUT: "const char * pos" and "const char * lineEnd" delimit the line with
+// leading blanks skipped.
+// OUTPUT: The function returns 'v' for a position, 'n' for a normal, 'f' for
+// a face, and 0 for anything else.
+// NOTE: This is a non-member function.
+//=============================================================================
+static inline char objKeyword(const char * pos, const char * lineEnd)
+{
+    if ((lineEnd - pos >= 2) && (pos[0] == 'v') && (isBlank(pos[1]) == true))
+        return 'v';
+    if ((lineEnd - pos >= 3) && (pos[0] == 'v') && (pos[1] == 'n') && (isBlank(pos[2]) == true))
+        return 'n';
+    if ((lineEnd - pos >= 2) && (pos[0] == 'f') && (isBlank(pos[1]) == true))
+        return 'f';
+    return 0;
+}
+
+
+//=============================================================================
+// The function "countObjVertices" counts the "v" and the "vn" lines of a
+// piece of an OBJ file.
+// INPUT: "const char * begin" and "const char * end" delimit the piece.
+// OUTPUT: "qint64 & numPositions" and "qint64 & numNormals" return the counts.
+// NOTE: This is a non-member function.
+//=============================================================================
+static void countObjVertices(const char * begin, const char * end, qint64 & numPositions, qint64 & numNormals)
+{
+    numPositions = 0;
+    numNormals = 0;
+    for (const char * pos = begin; pos != end; )
+    {
+        const char * lineEnd = static_cast<const char *>(memchr(pos, '\n', end - pos));
+        if (lineEnd == nullptr)
+            lineEnd = end;
+        const char keyword = objKeyword(skipBlanks(pos, lineEnd), lineEnd);
+        if (keyword == 'v')
+            ++numPositions;
+        else if (keyword == 'n')
+            ++numNormals;
+        pos = (lineEnd == end) ? end : lineEnd + 1;
+    }
+}
+
+
+//=============================================================================
+// The function "parseObjIndex" parses a vertex or a normal index of a face and
+// resolves it into a 0-based index into the whole file's list.
+// INPUT: "const char * pos" and "const char * end" delimit the text.
+// "qint64 numBefore" is the number of entries defined before the face, which
+// negative indices count back from.
+// "qint64 numTotal" is the number of entries in the whole file.
+// OUTPUT: "qint32 & index" returns the resolved index.
+// The function itself returns the position after the index, or null if the
+// index is missing or out of range.
+// NOTE: This is a non-member function.
+//=============================================================================
+static inline const char * parseObjIndex(const char * pos, const char * end, qint64 numBefore,
+                                         qint64 numTotal, qint32 & index)
+{
+    qint64 value;
+    pos = parseInteger(pos, end, value);
+    if (pos == nullptr)
+        return nullptr;
+    const qint64 resolved = (value > 0) ? value - 1 : numBefore + value;
+    if ((value == 0) || (resolved < 0) || (resolved >= numTotal))
+        return nullptr;
+    index = static_cast<qint32>(resolved);
+    return pos;
+}
+
+
+//=============================================================================
+// The function "parseObjChunk" parses a piece of an OBJ file. Positions and
+// normals are collected, and polygons are split into triangle fans whose
+// corners refer to the whole file's lists of positions and normals.
+// INPUT: "ObjChunk & chunk" holds the piece and the number of positions and
+// normals before it.
+// "qint64 numPositions" and "qint64 numNormals" are the numbers of positions
+// and normals of the whole file.
+// OUTPUT: "ObjChunk & chunk" returns the parsed data or the failure.
+// The function itself returns "false" if any discrepancy is encountered and
+// "true" otherwise.
+// NOTE: This is a non-member function.
+//=============================================================================
+static bool parseObjChunk(ObjChunk & chunk, qint64 numPositions, qint64 numNormals)
+{
+    std::vector<qint32> polygon;  // vertex and normal index of every polygon corner
+    const char * end = chunk.end;
+    for (const char * pos = chunk.begin; pos != end; )
+    {
+        const char * lineEnd = static_cast<const char *>(memchr(pos, '\n', end - pos));
+        if (lineEnd == nullptr)
+            lineEnd = end;
+        const char * next = (lineEnd == end) ? end : lineEnd + 1;
+        pos = skipBlanks(pos, lineEnd);
+        const char keyword = objKeyword(pos, lineEnd);
+
+        if ((keyword == 'v') || (keyword == 'n'))
+        {
+            // Parse three coordinates; a "w" or colors may follow.
+            pos += (keyword == 'v') ? 1 : 2;
+            float coords[3];
+            for (int k = 0; (k < 3) && (pos != nullptr); ++k)
+                pos = parseFloat(skipBlanks(pos, lineEnd), lineEnd, coords[k]);
+            if (pos == nullptr)
+            {
+                chunk.errorPos = lineEnd;
+                chunk.errorMessage = "Three coordinates expected";
+                return false;
+            }
+            if (keyword == 'v')
+                chunk.positions.push_back(QVector3D(coords[0], coords[1], coords[2]));
+            else
+                chunk.normals.push_back(QVector3D(coords[0], coords[1], coords[2]).normalized());
+        }
+        else if (keyword == 'f')
+        {
+            // Parse the corners "v", "v/vt", "v//vn", or "v/vt/vn".
+            const qint64 numPositionsBefore = chunk.firstPosition + chunk.positions.size();
+            const qint64 numNormalsBefore = chunk.firstNormal + chunk.normals.size();
+            polygon.clear();
+            pos = skipBlanks(pos + 1, lineEnd);
+            while ((pos != nullptr) && (pos != lineEnd))
+            {
+                qint32 vertex;
+                qint32 normal = -1;
+                pos = parseObjIndex(pos, lineEnd, numPositionsBefore, numPositions, vertex);
+                if ((pos != nullptr) && (pos != lineEnd) && (*pos == '/'))
+                {
+                    // Skip the texture coordinate index.
+                    ++pos;
+                    while ((pos != lineEnd) && (*pos != '/') && (isBlank(*pos) == false))
+                        ++pos;
+                    if ((pos != lineEnd) && (*pos == '/'))
+                        pos = parseObjIndex(pos + 1, lineEnd, numNormalsBefore, numNormals, normal);
+                }
+                if ((pos != nullptr) && (pos != lineEnd) && (isBlank(*pos) == false))
+                    pos = nullptr;
+                if (pos != nullptr)
+                {
+                    polygon.push_back(vertex);
+                    polygon.push_back(normal);
+                    pos = skipBlanks(pos, lineEnd);
+                }
+            }
+            if (pos == nullptr)
+            {
+                chunk.errorPos = lineEnd;
+                chunk.errorMessage = "Invalid or out of range vertex index";
+                return false;
+            }
+
+            // Fan the polygon around its first corner.
+            const int numCorners = static_cast<int>(polygon.size() / 2);
+            for (int k = 2; k < numCorners; ++k)
+            {
+                chunk.corners << polygon[0] << polygon[1]
+                              << polygon[2 * k - 2] << polygon[2 * k - 1]
+                              << polygon[2 * k] << polygon[2 * k + 1];
+            }
+        }
+        // Comments, texture coordinates, groups, materials, etc. are ignored.
+        pos = next;
+    }
+    return true;
+}
+
+
+//=============================================================================
+// The function "estimateObjNumTriangles" estimates the number of triangles of
+// an OBJ file, which does not state it anywhere, from the size of its text.
+// INPUT: "qint64 dataSize" is the size of the (decompressed) text, or an
+// estimate of it.
+// OUTPUT: The function returns the estimated number of triangles.
+//=============================================================================
+qint64 estimateObjNumTriangles(qint64 dataSize)
+{
+    return dataSize / s_objBytesPerTriangle;
+}
+
+
+//=============================================================================
+// The function "readObjFile" reads in a given Wavefront OBJ file, possibly
+// gzip or zstd compressed.
+// INPUT: "const QString & fileName" is the name of the file to be read.
+// OUTPUT: "GeometryArray<QVector3D> & vertices" returns the vertices of the
+// triangles, 3 per triangle.
+// "GeometryArray<PackedNormal> & faceNormals" returns the packed normals of the
+// triangles, 1 per triangle.
+// "GeometryArray<PackedNormal> & vertexNormals" returns the packed vertex
+// normals, 3 per triangle, or none if the file holds no normals.
+// "LoadProgress * progress", if given, tracks the progress of the reading and
+// receives the line number and the reason of a failure.
+// The function itself returns "false" if any discrepancy is encountered and
+// "true" otherwise.
+//=============================================================================
+bool readObjFile(const QString & fileName, GeometryArray<QVector3D> & vertices,
+                 GeometryArray<PackedNormal> & faceNormals, GeometryArray<PackedNormal> & vertexNormals,
+                 LoadProgress * progress)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // Map the file, or decompress a compressed one, into memory.
+    FileContents contents;
+    QString errorString;
+    if (contents.open(fileName, errorString) == false)
+    {
+        reportLoadError(progress, "Could not read the file " + fileName + ": " + errorString);
+        return false;
+    }
+    if (progress != nullptr)
+        progress->setNumBytesTotal(contents.size());
+
+    QString errorMessage;
+    const char * text = reinterpret_cast<const char *>(contents.data());
+    bool success = parseObj(text, text + contents.size(), vertices, faceNormals, vertexNormals,
+                            &errorMessage, progress);
+    if (success == true)
+        reportReadingThroughput(fileName, contents.size(), timer.nsecsElapsed());
+    else if (isLoadCanceled(progress) == true)
+        reportLoadError(progress, "Loading of " + fileName + " was canceled.");
+    else
+        reportLoadError(progress, "OBJ format of " + fileName + " seems violated. " + errorMessage);
+    return success;
+}
+
+
+//=============================================================================
+// The function "parseObj" parses the text of an OBJ file into a triangle
+// soup. The text is split at line boundaries into pieces of roughly the same
+// size. A first parallel pass counts the positions and normals of every piece
+// so that each piece knows how many precede it, which lets the second
+// parallel pass resolve negative (relative) indices right away. The positions
+// and normals of the pieces are then gathered, and the triangles are written
+// into their final places in parallel. Every triangle gets the normal computed
+// from its vertices. Vertex normals are kept only if the file holds normals;
+// then corners with a normal index take that normal, and others take the
+// normal of their triangle.
+// INPUT: "const char * begin" and "const char * end" delimit the text.
+// OUTPUT: "GeometryArray<QVector3D> & vertices" returns the vertices of the
+// triangles, 3 per triangle.
+// "GeometryArray<PackedNormal> & faceNormals" returns the packed normals of the
+// triangles, 1 per triangle.
+// "GeometryArray<PackedNormal> & vertexNormals" returns the packed vertex
+// normals, 3 per triangle, or none if the file holds no normals.
+// "QString * errorMessage", if given, returns the line number and the reason
+// of a failure.
+// "LoadProgress * progress", if given, is advanced as the pieces are parsed.
+// Parsing stops early if it gets canceled.
+// The function itself returns "false" if any discrepancy is encountered or
+// parsing is canceled, and "true" otherwise.
+//=============================================================================
+bool parseObj(const char * begin, const char * end, GeometryArray<QVector3D> & vertices,
+              GeometryArray<PackedNormal> & faceNormals, GeometryArray<PackedNormal> & vertexNormals,
+              QString * errorMessage, LoadProgress * progress)
+{
+    // Split the text into pieces starting at lines. The number of pieces
+    // depends only on the size of the text.
+    const qint64 numPieces = qMax(numChunks(end - begin, s_objChunkSize), qint64(1));
+    QVector<ObjChunk> chunks(static_cast<int>(numPieces));
+    chunks.first().begin = begin;
+    for (qint64 i = 1; i < numPieces; ++i)
+    {
+        const char * splitPos = qMax(begin + i * s_objChunkSize, chunks[i - 1].begin);
+        const char * lineEnd = static_cast<const char *>(memchr(splitPos, '\n', end - splitPos));
+        chunks[i].begin = (lineEnd == nullptr) ? end : lineEnd + 1;
+        chunks[i - 1].end = chunks[i].begin;
+    }
+    chunks.last().end = end;
+
+    // Count the positions and normals of the pieces in parallel.
+    ObjChunk * chunkData = chunks.data();
+    QVector<qint64> numPiecePositions(static_cast<int>(numPieces));
+    QVector<qint64> numPieceNormals(static_cast<int>(numPieces));
+    qint64 * numPiecePositionData = numPiecePositions.data();
+    qint64 * numPieceNormalData = numPieceNormals.data();
+    parallelForChunks(numPieces, 1, [&](qint64 i, qint64, qint64)
+    {
+        countObjVertices(chunkData[i].begin, chunkData[i].end, numPiecePositionData[i], numPieceNormalData[i]);
+    });
+    qint64 numPositions = 0;
+    qint64 numNormals = 0;
+    for (int i = 0; i < numPieces; ++i)
+    {
+        chunks[i].firstPosition = numPositions;
+        chunks[i].firstNormal = numNormals;
+        numPositions += numPiecePositions[i];
+        numNormals += numPieceNormals[i];
+    }
+    // The corners of the faces refer to positions and normals by 32-bit
+    // indices.
+    if ((numPositions > std::numeric_limits<qint32>::max()) || (numNormals > std::numeric_limits<qint32>::max()))
+    {
+        if (errorMessage != nullptr)
+            *errorMessage = "The file holds more vertices than can be indexed.";
+        return false;
+    }
+    // Parse the pieces in parallel.
+    QVector<char> isPieceParsed(static_cast<int>(numPieces), 0);
+    char * isPieceParsedData = isPieceParsed.data();
+    parallelForChunks(numPieces, 1, [&](qint64 i, qint64, qint64)
+    {
+        if (isLoadCanceled(progress) == true)
+            return;
+        chunkData[i].positions.reserve(numPiecePositionData[i]);
+        chunkData[i].normals.reserve(numPieceNormalData[i]);
+        isPieceParsedData[i] = parseObjChunk(chunkData[i], numPositions, numNormals);
+        reportLoadProgress(progress, chunkData[i].end - chunkData[i].begin, chunkData[i].corners.size() / 6);
+    });
+    if (isLoadCanceled(progress) == true)
+        return false;
+
+    // Report the first failure along with its line number.
+    qint64 numTriangles = 0;
+    for (int i = 0; i < numPieces; ++i)
+    {
+        if (isPieceParsed[i] == false)
+        {
+            const qint64 lineNumber = lineNumberAt(begin, chunks[i].errorPos);
+            if (errorMessage != nullptr)
+                *errorMessage = QString("Line %1: %2.").arg(lineNumber).arg(chunks[i].errorMessage);
+            return false;
+        }
+        chunks[i].firstTriangle = numTriangles;
+        numTriangles += chunks[i].corners.size() / 6;
+    }
+    if (numTriangles == 0)
+    {
+        if (errorMessage != nullptr)
+            *errorMessage = "The file holds no faces.";
+        return false;
+    }
+
+    // Gather the positions and normals of the pieces.
+    GeometryArray<QVector3D> positions(numPositions);
+    GeometryArray<QVector3D> normals(numNormals);
+    QVector3D * positionData = positions.data();
+    QVector3D * normalData = normals.data();
+    parallelForChunks(numPieces, 1, [&](qint64 i, qint64, qint64)
+    {
+        ObjChunk & chunk = chunkData[i];
+        std::copy(chunk.positions.cbegin(), chunk.positions.cend(), positionData + chunk.firstPosition);
+        std::copy(chunk.normals.cbegin(), chunk.normals.cend(), normalData + chunk.firstNormal);
+        chunk.positions = GeometryArray<QVector3D>();
+        chunk.normals = GeometryArray<QVector3D>();
+    });
+
+    // Write the triangles of the pieces into their places in parallel.
+    const bool hasVertexNormals = (numNormals > 0);
+    vertices.resize(3 * numTriangles);
+    faceNormals.resize(numTriangles);
+    vertexNormals.clear();
+    if (hasVertexNormals == true)
+        vertexNormals.resize(3 * numTriangles);
+    QVector3D * vertexOut = vertices.data();
+    PackedNormal * faceNormalOut = faceNormals.data();
+    PackedNormal * normalOut = vertexNormals.data();
+    parallelForChunks(numPieces, 1, [&](qint64 i, qint64, qint64)
+    {
+        ObjChunk & chunk = chunkData[i];
+        QVector3D * vertex = vertexOut + 3 * chunk.firstTriangle;
+        PackedNormal * packed = faceNormalOut + chunk.firstTriangle;
+        PackedNormal * normal = normalOut + 3 * chunk.firstTriangle;
+        for (auto cit = chunk.corners.cbegin(); cit != chunk.corners.cend(); cit += 6, vertex += 3, ++packed)
+        {
+            vertex[0] = positionData[cit[0]];
+            vertex[1] = positionData[cit[2]];
+            vertex[2] = positionData[cit[4]];
+            const QVector3D faceNormal = QVector3D::normal(vertex[0], vertex[1], vertex[2]);
+            *packed = packNormal(faceNormal);
+            if (hasVertexNormals == true)
+            {
+                normal[0] = (cit[1] >= 0) ? packNormal(normalData[cit[1]]) : *packed;
+                normal[1] = (cit[3] >= 0) ? packNormal(normalData[cit[3]]) : *packed;
+                normal[2] = (cit[5] >= 0) ? packNormal(normalData[cit[5]]) : *packed;
+                normal += 3;
+            }
+        }
+        chunk.corners = QVector<qint32>();
+    });
+    return true;
+}
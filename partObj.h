@@ -0,0 +1,55 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef PART_OBJ_HEADER
+#define PART_OBJ_HEADER
+
+#include <QString>
+#include <QVector3D>
+#include "geometryArray.h"
+#include "part.h"
+
+class LoadProgress;
+
+class PartObj : public Part
+{
+public:
+    // Constructors.
+    PartObj();
+    PartObj(const QString & fileName, LoadProgress * progress = nullptr);
+    PartObj(const PartObj & part);
+    virtual ~PartObj() override {}
+
+    // Write out data as a binary STL file.
+    virtual bool writeData(const QString & filename, QString * errorMessage = nullptr) const override;
+
+    // Accessors.
+    QString filename() const { return m_filename; }
+
+protected:
+    // Read in a file.
+    bool readFile(LoadProgress * progress);
+
+private:
+    QString m_filename;
+};
+
+
+// Non-members.
+qint64 estimateObjNumTriangles(qint64 dataSize);
+
+bool readObjFile(const QString & fileName, GeometryArray<QVector3D> & vertices,
+                 GeometryArray<PackedNormal> & faceNormals, GeometryArray<PackedNormal> & vertexNormals,
+                 LoadProgress * progress = nullptr);
+
+bool parseObj(const char * begin, const char * end, GeometryArray<QVector3D> & vertices,
+              GeometryArray<PackedNormal> & faceNormals, GeometryArray<PackedNormal> & vertexNormals,
+              QString * errorMessage = nullptr, LoadProgress * progress = nullptr);
+
+#endif // PART_OBJ_HEADER
@@ -0,0 +1,748 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "partPly.h"
+#include "partStl.h"
+#include "decompressingDevice.h"
+#include "loadProgress.h"
+#include "parallelFor.h"
+#include "textParsing.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QtEndian>
+#include <algorithm>  // swap
+#include <cstring>    // memcpy, memchr
+
+// Number of faces decoded by a single task when reading in parallel.
+static const qint64 s_plyChunkSize = 65536;
+// Typical number of bytes of a binary PLY file per triangle: a face record
+// of 3 indices along with about half a vertex record.
+static const qint64 s_plyBytesPerTriangle = 19;
+
+// Constructors.
+PartPly::PartPly() : Part(), m_filename()
+{}
+
+PartPly::PartPly(const QString & filename, LoadProgress * progress) : Part(), m_filename(filename)
+{
+    readFile(progress);
+}
+
+PartPly::PartPly(const PartPly & plyPart) : Part(plyPart), m_filename(plyPart.filename())
+{}
+
+
+// Write out data.
+bool PartPly::writeData(const QString & filename, QString * errorMessage) const
+{
+    return writeBinaryStlFile(filename, m_positions, m_indices, m_faceNormals, errorMessage);
+}
+
+
+//=============================================================================
+// The function "readFile" reads in the PLY file of the part.
+// INPUT: "LoadProgress * progress", if given, tracks the progress of the
+// reading.
+//=============================================================================
+bool PartPly::readFile(LoadProgress * progress)
+{
+    // Take the vertex table and the triangulated faces as they are, welding
+    // them only within a positive tolerance.
+    GeometryArray<QVector3D> positions;
+    GeometryArray<quint32> indices;
+    return (readPlyFile(m_filename, positions, indices, m_faceNormals, progress) == true) &&
+            (setIndexedTriangles(positions, indices) == true);
+}
+
+
+//=============================================================================
+// The types of the scalar properties of a PLY file.
+//=============================================================================
+enum class PlyType {Invalid, Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64};
+
+//=============================================================================
+// The class "PlyProperty" describes a property of an element of a PLY file.
+//=============================================================================
+struct PlyProperty
+{
+    QByteArray name;    // name of the property
+    PlyType type;       // type of the value, or of the list items for a list
+    bool isList;        // indicates if the property is a list
+    PlyType countType;  // type of the number of list items
+};
+
+//=============================================================================
+// The class "PlyElement" describes an element of a PLY file, i.e., a sequence
+// of records with the same properties.
+//=============================================================================
+struct PlyElement
+{
+    QByteArray name;                  // name of the element
+    qint64 count;                     // number of records
+    QVector<PlyProperty> properties;  // properties of every record
+};
+
+
+//=============================================================================
+// The function "plyType" converts the name of a PLY type into the type.
+// INPUT: "const QByteArray & name" is the name of the type.
+// OUTPUT: The function returns the type, or "PlyType::Invalid" if unknown.
+// NOTE: This is a non-member function.
+//=============================================================================
+static PlyType plyType(const QByteArray & name)
+{
+    if ((name == "char") || (name == "int8"))
+        return PlyType::Int8;
+    if ((name == "uchar") || (name == "uint8"))
+        return PlyType::UInt8;
+    if ((name == "short") || (name == "int16"))
+        return PlyType::Int16;
+    if ((name == "ushort") || (name == "uint16"))
+        return PlyType::UInt16;
+    if ((name == "int") || (name == "int32"))
+        return PlyType::Int32;
+    if ((name == "uint") || (name == "uint32"))
+        return PlyType::UInt32;
+    if ((name == "float") || (name == "float32"))
+        return PlyType::Float32;
+    if ((name == "double") || (name == "float64"))
+        return PlyType::Float64;
+    return PlyType::Invalid;
+}
+
+
+//=============================================================================
+// The function "plyTypeSize" finds the number of bytes of a PLY type.
+// NOTE: This is a non-member function.
+//=============================================================================
+static int plyTypeSize(PlyType type)
+{
+    switch (type)
+    {
+    case PlyType::Int8:
+    case PlyType::UInt8:
+        return 1;
+    case PlyType::Int16:
+    case PlyType::UInt16:
+        return 2;
+    case PlyType::Int32:
+    case PlyType::UInt32:
+    case PlyType::Float32:
+        return 4;
+    case PlyType::Float64:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+
+//=============================================================================
+// The function "loadValue" loads a value of a given type stored in a given
+// byte order.
+// NOTE: This is a non-member function.
+//=============================================================================
+template <typename T>
+static inline T loadValue(const uchar * src, bool isBigEndian)
+{
+    T value;
+    memcpy(&value, src, sizeof(T));
+    if (isBigEndian == true)
+    {
+        uchar * bytes = reinterpret_cast<uchar *>(&value);
+        for (size_t i = 0; i < sizeof(T) / 2; ++i)
+            std::swap(bytes[i], bytes[sizeof(T) - 1 - i]);
+    }
+    return value;
+}
+
+
+//=============================================================================
+// The function "readPlyValue" reads a scalar value of a PLY file.
+// INPUT: "const uchar * src" points to the value.
+// "PlyType type" is the type of the value.
+// "bool isBigEndian" indicates if the file is big-endian.
+// OUTPUT: The function returns the value.
+// NOTE: This is a non-member function.
+//=============================================================================
+static inline double readPlyValue(const uchar * src, PlyType type, bool isBigEndian)
+{
+    switch (type)
+    {
+    case PlyType::Int8:
+        return static_cast<qint8>(*src);
+    case PlyType::UInt8:
+        return *src;
+    case PlyType::Int16:
+        return loadValue<qint16>(src, isBigEndian);
+    case PlyType::UInt16:
+        return loadValue<quint16>(src, isBigEndian);
+    case PlyType::Int32:
+        return loadValue<qint32>(src, isBigEndian);
+    case PlyType::UInt32:
+        return loadValue<quint32>(src, isBigEndian);
+    case PlyType::Float32:
+        return loadValue<float>(src, isBigEndian);
+    case PlyType::Float64:
+        return loadValue<double>(src, isBigEndian);
+    default:
+        return 0.0;
+    }
+}
+
+
+//=============================================================================
+// The function "readPlyIndex" reads an integer value (a list count or a
+// vertex index) of a PLY file.
+// NOTE: This is a non-member function.
+//=============================================================================
+static inline qint64 readPlyIndex(const uchar * src, PlyType type, bool isBigEndian)
+{
+    switch (type)
+    {
+    case PlyType::Int8:
+        return static_cast<qint8>(*src);
+    case PlyType::UInt8:
+        return *src;
+    case PlyType::Int16:
+        return loadValue<qint16>(src, isBigEndian);
+    case PlyType::UInt16:
+        return loadValue<quint16>(src, isBigEndian);
+    case PlyType::Int32:
+        return loadValue<qint32>(src, isBigEndian);
+    case PlyType::UInt32:
+        return loadValue<quint32>(src, isBigEndian);
+    default:
+        return static_cast<qint64>(readPlyValue(src, type, isBigEndian));
+    }
+}
+
+
+//=============================================================================
+// The function "parsePlyRecord" walks over a record of an element, possibly
+// locating one of its list properties.
+// INPUT: "const uchar * pos" points to the record.
+// "const uchar * end" is the end of the data.
+// "const PlyElement & element" describes the record.
+// "bool isBigEndian" indicates if the file is big-endian.
+// "int listProperty" is the index of the list property to be located, or -1.
+// OUTPUT: "const uchar * & listItems" and "qint64 & listCount" return the
+// first item and the number of items of the located list.
+// The function itself returns the position after the record, or null if the
+// record runs past the end of the data.
+// NOTE: This is a non-member function.
+//=============================================================================
+static const uchar * parsePlyRecord(const uchar * pos, const uchar * end, const PlyElement & element,
+                                    bool isBigEndian, int listProperty,
+                                    const uchar * & listItems, qint64 & listCount)
+{
+    // Fast path for the usual faces holding nothing but the list of indices.
+    if ((listProperty == 0) && (element.properties.size() == 1))
+    {
+        const PlyProperty & property = element.properties.front();
+        const int countSize = plyTypeSize(property.countType);
+        if (end - pos < countSize)
+            return nullptr;
+        listCount = readPlyIndex(pos, property.countType, isBigEndian);
+        listItems = pos + countSize;
+        if ((listCount < 0) || ((end - listItems) / plyTypeSize(property.type) < listCount))
+            return nullptr;
+        return listItems + listCount * plyTypeSize(property.type);
+    }
+
+    for (int k = 0; k < element.properties.size(); ++k)
+    {
+        const PlyProperty & property = element.properties[k];
+        const int size = plyTypeSize(property.type);
+        if (property.isList == true)
+        {
+            const int countSize = plyTypeSize(property.countType);
+            if (end - pos < countSize)
+                return nullptr;
+            const qint64 count = readPlyIndex(pos, property.countType, isBigEndian);
+            pos += countSize;
+            if ((count < 0) || ((end - pos) / size < count))
+                return nullptr;
+            if (k == listProperty)
+            {
+                listItems = pos;
+                listCount = count;
+            }
+            pos += count * size;
+        }
+        else
+        {
+            if (end - pos < size)
+                return nullptr;
+            pos += size;
+        }
+    }
+    return pos;
+}
+
+
+//=============================================================================
+// The function "nextToken" finds the next blank separated word of a line.
+// INPUT: "const char * & pos" is the current position, moved past the word.
+// "const char * end" is the end of the line.
+// OUTPUT: The function returns the word, empty at the end of the line.
+// NOTE: This is a non-member function.
+//=============================================================================
+static QByteArray nextToken(const char * & pos, const char * end)
+{
+    pos = skipBlanks(pos, end);
+    const char * begin = pos;
+    while ((pos != end) && (isBlank(*pos) == false))
+        ++pos;
+    return QByteArray(begin, static_cast<int>(pos - begin));
+}
+
+
+//=============================================================================
+// The function "parsePlyHeader" parses the text header of a PLY file.
+// INPUT: "const char * begin" and "const char * end" delimit the file.
+// OUTPUT: "QVector<PlyElement> & elements" returns the elements in order.
+// "bool & isBigEndian" returns the byte order of the binary data.
+// "const char * & dataBegin" returns the beginning of the binary data.
+// "QString & errorMessage" returns the reason of a failure.
+// The function itself returns "false" if the header is invalid or the data
+// is not binary, and "true" otherwise.
+// NOTE: This is a non-member function.
+//=============================================================================
+static bool parsePlyHeader(const char * begin, const char * end, QVector<PlyElement> & elements,
+                           bool & isBigEndian, const char * & dataBegin, QString & errorMessage)
+{
+    bool hasFormat = false;
+    qint64 lineNumber = 0;
+    for (const char * pos = begin; pos != end; )
+    {
+        // Find the current line.
+        const char * lineEnd = static_cast<const char *>(memchr(pos, '\n', end - pos));
+        if (lineEnd == nullptr)
+            break;
+        ++lineNumber;
+        const char * next = lineEnd + 1;
+        QByteArray keyword = nextToken(pos, lineEnd);
+
+        if (lineNumber == 1)
+        {
+            if (keyword != "ply")
+            {
+                errorMessage = "The file does not start with \"ply\".";
+                return false;
+            }
+        }
+        else if (keyword == "format")
+        {
+            const QByteArray format = nextToken(pos, lineEnd);
+            if (format == "binary_little_endian")
+                isBigEndian = false;
+            else if (format == "binary_big_endian")
+                isBigEndian = true;
+            else
+            {
+                errorMessage = "Only binary PLY files are supported.";
+                return false;
+            }
+            hasFormat = true;
+        }
+        else if (keyword == "element")
+        {
+            PlyElement element;
+            element.name = nextToken(pos, lineEnd);
+            const QByteArray count = nextToken(pos, lineEnd);
+            if (parseInteger(count.constData(), count.constData() + count.size(), element.count) == nullptr)
+                element.count = -1;
+            if (element.count < 0)
+            {
+                errorMessage = QString("Line %1: Invalid element count.").arg(lineNumber);
+                return false;
+            }
+            elements.push_back(element);
+        }
+        else if (keyword == "property")
+        {
+            if (elements.isEmpty() == true)
+            {
+                errorMessage = QString("Line %1: Property outside of an element.").arg(lineNumber);
+                return false;
+            }
+            PlyProperty property;
+            QByteArray type = nextToken(pos, lineEnd);
+            property.isList = (type == "list");
+            property.countType = PlyType::Invalid;
+            if (property.isList == true)
+            {
+                property.countType = plyType(nextToken(pos, lineEnd));
+                type = nextToken(pos, lineEnd);
+            }
+            property.type = plyType(type);
+            property.name = nextToken(pos, lineEnd);
+            if ((property.type == PlyType::Invalid) ||
+                ((property.isList == true) && ((property.countType == PlyType::Invalid) ||
+                                               (property.countType == PlyType::Float32) ||
+                                               (property.countType == PlyType::Float64))))
+            {
+                errorMessage = QString("Line %1: Invalid property type.").arg(lineNumber);
+                return false;
+            }
+            elements.back().properties.push_back(property);
+        }
+        else if (keyword == "end_header")
+        {
+            if (hasFormat == false)
+            {
+                errorMessage = "The PLY header has no format line.";
+                return false;
+            }
+            dataBegin = next;
+            return true;
+        }
+        // Comments, obj_info and unknown lines are ignored.
+        pos = next;
+    }
+    errorMessage = "The PLY header has no \"end_header\" line.";
+    return false;
+}
+
+
+//=============================================================================
+// The function "estimatePlyNumTriangles" estimates the number of triangles of
+// a PLY file from its beginning alone. The number of faces is taken from the
+// header if the header fits in the beginning, and every face is taken for a
+// single triangle.
+// INPUT: "const QByteArray & prefix" is the beginning of the (decompressed)
+// file.
+// "qint64 dataSize" is the size of the data if known, and an estimate of it
+// otherwise.
+// OUTPUT: The function returns the estimated number of triangles.
+//=============================================================================
+qint64 estimatePlyNumTriangles(const QByteArray & prefix, qint64 dataSize)
+{
+    QVector<PlyElement> elements;
+    bool isBigEndian = false;
+    const char * dataBegin = nullptr;
+    QString errorMessage;
+    if (parsePlyHeader(prefix.constData(), prefix.constData() + prefix.size(), elements,
+                       isBigEndian, dataBegin, errorMessage) == true)
+    {
+        for (auto cit = elements.cbegin(); cit != elements.cend(); ++cit)
+        {
+            if (cit->name == "face")
+                return cit->count;
+        }
+    }
+    return dataSize / s_plyBytesPerTriangle;
+}
+
+
+//=============================================================================
+// The function "readPlyFile" reads in a given PLY file, possibly gzip or zstd
+// compressed. An uncompressed file is memory-mapped and decoded in place.
+// INPUT: "const QString & fileName" is the name of the file to be read.
+// OUTPUT: "GeometryArray<QVector3D> & positions" returns the positions of the
+// vertex table.
+// "GeometryArray<quint32> & indices" returns the indices of the positions of
+// the triangles, 3 per triangle.
+// "GeometryArray<PackedNormal> & faceNormals" returns the packed normals of the
+// triangles, 1 per triangle.
+// "LoadProgress * progress", if given, tracks the progress of the reading and
+// receives the description of a failure.
+// The function itself returns "false" if any discrepancy is encountered and
+// "true" otherwise.
+//=============================================================================
+bool readPlyFile(const QString & fileName, GeometryArray<QVector3D> & positions,
+                 GeometryArray<quint32> & indices, GeometryArray<PackedNormal> & faceNormals,
+                 LoadProgress * progress)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // Map the file, or decompress a compressed one, into memory.
+    FileContents contents;
+    QString errorString;
+    if (contents.open(fileName, errorString) == false)
+    {
+        reportLoadError(progress, "Could not read the file " + fileName + ": " + errorString);
+        return false;
+    }
+    if (progress != nullptr)
+        progress->setNumBytesTotal(contents.size());
+
+    QString errorMessage;
+    bool success = decodePly(contents.data(), contents.data() + contents.size(),
+                             positions, indices, faceNormals, &errorMessage, progress);
+    if (success == true)
+        reportReadingThroughput(fileName, contents.size(), timer.nsecsElapsed());
+    else if (isLoadCanceled(progress) == true)
+        reportLoadError(progress, "Loading of " + fileName + " was canceled.");
+    else
+        reportLoadError(progress, "PLY format of " + fileName + " seems violated. " + errorMessage);
+    return success;
+}
+
+
+//=============================================================================
+// The function "decodePly" decodes a binary PLY file held in memory into an
+// indexed mesh. The vertex element is decoded in parallel chunks into the
+// table of positions. A quick sequential pass over the face element finds
+// where every chunk of faces starts and how many triangles precede it, and
+// the chunks then triangulate their polygons as fans in parallel, writing the
+// indices and the face normals straight into their final places.
+// INPUT: "const uchar * begin" and "const uchar * end" delimit the file.
+// OUTPUT: "GeometryArray<QVector3D> & positions" returns the positions of the
+// vertex table.
+// "GeometryArray<quint32> & indices" returns the indices of the positions of
+// the triangles, 3 per triangle.
+// "GeometryArray<PackedNormal> & faceNormals" returns the packed normals of the
+// triangles, 1 per triangle.
+// "QString * errorMessage", if given, returns the reason of a failure.
+// "LoadProgress * progress", if given, is advanced as the data are decoded.
+// Decoding stops early if it gets canceled.
+// The function itself returns "false" if any discrepancy is encountered or
+// decoding is canceled, and "true" otherwise.
+//=============================================================================
+bool decodePly(const uchar * begin, const uchar * end, GeometryArray<QVector3D> & positions,
+               GeometryArray<quint32> & indices, GeometryArray<PackedNormal> & faceNormals,
+               QString * errorMessage, LoadProgress * progress)
+{
+    QString message;
+    QVector<PlyElement> elements;
+    bool isBigEndian = false;
+    const char * dataBegin = nullptr;
+    if (parsePlyHeader(reinterpret_cast<const char *>(begin), reinterpret_cast<const char *>(end),
+                       elements, isBigEndian, dataBegin, message) == false)
+    {
+        if (errorMessage != nullptr)
+            *errorMessage = message;
+        return false;
+    }
+
+    // Locate the vertex and the face elements and their properties.
+    int vertexElement = -1;
+    int faceElement = -1;
+    for (int i = 0; i < elements.size(); ++i)
+    {
+        if ((elements[i].name == "vertex") && (vertexElement < 0))
+            vertexElement = i;
+        else if ((elements[i].name == "face") && (faceElement < 0))
+            faceElement = i;
+    }
+    if ((vertexElement < 0) || (faceElement < 0))
+    {
+        if (errorMessage != nullptr)
+            *errorMessage = "The file has no vertex or no face element.";
+        return false;
+    }
+
+    // The vertex records must have fixed size to be decoded in parallel.
+    const PlyElement & vertexDesc = elements[vertexElement];
+    int vertexStride = 0;
+    int coordOffsets[3] = {-1, -1, -1};
+    PlyType coordTypes[3] = {PlyType::Invalid, PlyType::Invalid, PlyType::Invalid};
+    for (auto cit = vertexDesc.properties.cbegin(); cit != vertexDesc.properties.cend(); ++cit)
+    {
+        if (cit->isList == true)
+        {
+            if (errorMessage != nullptr)
+                *errorMessage = "List properties of vertices are not supported.";
+            return false;
+        }
+        const int coord = (cit->name == "x") ? 0 : (cit->name == "y") ? 1 : (cit->name == "z") ? 2 : -1;
+        if (coord >= 0)
+        {
+            coordOffsets[coord] = vertexStride;
+            coordTypes[coord] = cit->type;
+        }
+        vertexStride += plyTypeSize(cit->type);
+    }
+    if ((coordOffsets[0] < 0) || (coordOffsets[1] < 0) || (coordOffsets[2] < 0))
+    {
+        if (errorMessage != nullptr)
+            *errorMessage = "The vertices have no x, y, or z property.";
+        return false;
+    }
+
+    // Find the list of vertex indices of the faces.
+    const PlyElement & faceDesc = elements[faceElement];
+    int indexProperty = -1;
+    for (int i = 0; i < faceDesc.properties.size(); ++i)
+    {
+        if ((faceDesc.properties[i].isList == true) &&
+            ((faceDesc.properties[i].name == "vertex_indices") || (faceDesc.properties[i].name == "vertex_index")))
+        {
+            indexProperty = i;
+            break;
+        }
+    }
+    if (indexProperty < 0)
+    {
+        if (errorMessage != nullptr)
+            *errorMessage = "The faces have no list of vertex indices.";
+        return false;
+    }
+    const PlyProperty indexDesc = faceDesc.properties[indexProperty];
+    const int indexSize = plyTypeSize(indexDesc.type);
+
+    // Walk over the elements in file order to find where the vertex and the
+    // face data start. For the faces, remember where every chunk starts and
+    // how many triangles precede it.
+    const uchar * pos = reinterpret_cast<const uchar *>(dataBegin);
+    const uchar * vertexData = nullptr;
+    const qint64 numVertices = vertexDesc.count;
+    const qint64 numFaces = faceDesc.count;
+    const qint64 numFaceChunks = numChunks(numFaces, s_plyChunkSize);
+    QVector<const uchar *> faceChunkBegins(static_cast<int>(numFaceChunks));
+    QVector<qint64> faceChunkFirstTriangles(static_cast<int>(numFaceChunks));
+    qint64 numTriangles = 0;
+    const uchar * listItems = nullptr;
+    qint64 listCount = 0;
+    for (int i = 0; (i < elements.size()) && (pos != nullptr); ++i)
+    {
+        const PlyElement & element = elements[i];
+        if (i == vertexElement)
+        {
+            if ((end - pos) / qMax(vertexStride, 1) < numVertices)
+                pos = nullptr;
+            else
+            {
+                vertexData = pos;
+                pos += numVertices * vertexStride;
+            }
+        }
+        else if (i == faceElement)
+        {
+            for (qint64 face = 0; (face < numFaces) && (pos != nullptr); ++face)
+            {
+                if (face % s_plyChunkSize == 0)
+                {
+                    faceChunkBegins[static_cast<int>(face / s_plyChunkSize)] = pos;
+                    faceChunkFirstTriangles[static_cast<int>(face / s_plyChunkSize)] = numTriangles;
+                }
+                pos = parsePlyRecord(pos, end, element, isBigEndian, indexProperty, listItems, listCount);
+                numTriangles += qMax(listCount - 2, qint64(0));
+            }
+        }
+        else
+        {
+            for (qint64 j = 0; (j < element.count) && (pos != nullptr); ++j)
+                pos = parsePlyRecord(pos, end, element, isBigEndian, -1, listItems, listCount);
+        }
+    }
+    if (pos == nullptr)
+    {
+        if (errorMessage != nullptr)
+            *errorMessage = "The file is shorter than its header claims.";
+        return false;
+    }
+
+    // The positions are indexed by 32 bits.
+    if (numVertices >= qint64(0xFFFFFFFF))
+    {
+        if (errorMessage != nullptr)
+            *errorMessage = "The file has too many vertices to be indexed.";
+        return false;
+    }
+
+    // Decode the positions of the vertices in parallel chunks.
+    positions.resize(numVertices);
+    QVector3D * positionData = positions.data();
+    parallelForChunks(numVertices, s_plyChunkSize, [&](qint64, qint64 first, qint64 last)
+    {
+        if (isLoadCanceled(progress) == true)
+            return;
+        reportLoadProgress(progress, (last - first) * vertexStride, 0);
+        const uchar * record = vertexData + first * vertexStride;
+        for (qint64 v = first; v < last; ++v, record += vertexStride)
+        {
+            positionData[v] = QVector3D(
+                        static_cast<float>(readPlyValue(record + coordOffsets[0], coordTypes[0], isBigEndian)),
+                        static_cast<float>(readPlyValue(record + coordOffsets[1], coordTypes[1], isBigEndian)),
+                        static_cast<float>(readPlyValue(record + coordOffsets[2], coordTypes[2], isBigEndian)));
+        }
+    });
+
+    // Triangulate the faces in parallel chunks, each writing into its own
+    // slice of the output vectors. A chunk records the first face with an
+    // invalid vertex index, if any.
+    indices.resize(3 * numTriangles);
+    faceNormals.resize(numTriangles);
+    quint32 * indexOut = indices.data();
+    PackedNormal * normalOut = faceNormals.data();
+    QVector<qint64> faceChunkErrors(static_cast<int>(numFaceChunks), -1);
+    parallelForChunks(numFaces, s_plyChunkSize, [&](qint64 chunk, qint64 first, qint64 last)
+    {
+        if (isLoadCanceled(progress) == true)
+            return;
+        const uchar * record = faceChunkBegins[static_cast<int>(chunk)];
+        qint64 triangle = faceChunkFirstTriangles[static_cast<int>(chunk)];
+        const uchar * const chunkBegin = record;
+        const qint64 firstTriangle = triangle;
+        const uchar * items = nullptr;
+        qint64 count = 0;
+        for (qint64 face = first; face < last; ++face)
+        {
+            record = parsePlyRecord(record, end, faceDesc, isBigEndian, indexProperty, items, count);
+            if (count < 3)
+                continue;
+
+            // Fan the polygon around its first vertex.
+            const qint64 i0 = readPlyIndex(items, indexDesc.type, isBigEndian);
+            qint64 i1 = readPlyIndex(items + indexSize, indexDesc.type, isBigEndian);
+            for (qint64 k = 2; k < count; ++k, ++triangle)
+            {
+                const qint64 i2 = readPlyIndex(items + k * indexSize, indexDesc.type, isBigEndian);
+                if ((i0 < 0) || (i0 >= numVertices) || (i1 < 0) || (i1 >= numVertices) ||
+                    (i2 < 0) || (i2 >= numVertices))
+                {
+                    faceChunkErrors[static_cast<int>(chunk)] = face;
+                    return;
+                }
+                indexOut[3 * triangle] = static_cast<quint32>(i0);
+                indexOut[3 * triangle + 1] = static_cast<quint32>(i1);
+                indexOut[3 * triangle + 2] = static_cast<quint32>(i2);
+                normalOut[triangle] = packNormal(QVector3D::normal(positionData[i0], positionData[i1],
+                                                                   positionData[i2]));
+                i1 = i2;
+            }
+        }
+        reportLoadProgress(progress, record - chunkBegin, triangle - firstTriangle);
+    });
+    if (isLoadCanceled(progress) == true)
+    {
+        positions.clear();
+        indices.clear();
+        faceNormals.clear();
+        return false;
+    }
+
+    // Report the first invalid face.
+    for (auto cit = faceChunkErrors.cbegin(); cit != faceChunkErrors.cend(); ++cit)
+    {
+        if (*cit >= 0)
+        {
+            if (errorMessage != nullptr)
+                *errorMessage = QString("Face %1 refers to a vertex that does not exist.").arg(*cit);
+            positions.clear();
+            indices.clear();
+            faceNormals.clear();
+            return false;
+        }
+    }
+    if (numTriangles == 0)
+    {
+        if (errorMessage != nullptr)
+            *errorMessage = "The file holds no triangles.";
+        return false;
+    }
+    return true;
+}
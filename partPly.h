@@ -0,0 +1,56 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef PART_PLY_HEADER
+#define PART_PLY_HEADER
+
+#include <QByteArray>
+#include <QString>
+#include <QVector3D>
+#include "geometryArray.h"
+#include "part.h"
+
+class LoadProgress;
+
+class PartPly : public Part
+{
+public:
+    // Constructors.
+    PartPly();
+    PartPly(const QString & fileName, LoadProgress * progress = nullptr);
+    PartPly(const PartPly & part);
+    virtual ~PartPly() override {}
+
+    // Write out data as a binary STL file.
+    virtual bool writeData(const QString & filename, QString * errorMessage = nullptr) const override;
+
+    // Accessors.
+    QString filename() const { return m_filename; }
+
+protected:
+    // Read in a file.
+    bool readFile(LoadProgress * progress);
+
+private:
+    QString m_filename;
+};
+
+
+// Non-members.
+qint64 estimatePlyNumTriangles(const QByteArray & prefix, qint64 dataSize);
+
+bool readPlyFile(const QString & fileName, GeometryArray<QVector3D> & positions,
+                 GeometryArray<quint32> & indices, GeometryArray<PackedNormal> & faceNormals,
+                 LoadProgress * progress = nullptr);
+
+bool decodePly(const uchar * begin, const uchar * end, GeometryArray<QVector3D> & positions,
+               GeometryArray<quint32> & indices, GeometryArray<PackedNormal> & faceNormals,
+               QString * errorMessage = nullptr, LoadProgress * progress = nullptr);
+
+#endif // PART_PLY_HEADER
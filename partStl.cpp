@@ -8,24 +8,51 @@
 //=============================================================================
 
 #include "partStl.h"
+#include "asciiStlParser.h"
+#include "decompressingDevice.h"
+#include "loadProgress.h"
+#include "parallelFor.h"
+#include "stlBatchReader.h"
+#include "stlBatchWriter.h"
+#include "textParsing.h"
 
 #include <QFile>
 #include <QString>
-#include <QStringList>
 #include <QIODevice>
-#include <QDataStream>
-#include <QTextStream>
-#include <QMessageBox>
+#include <QSaveFile>
 #include <QDebug>
-#include <algorithm>  // swap
+#include <QElapsedTimer>
+#include <QtEndian>
+#include <algorithm>  // swap, copy
+#include <cctype>     // isspace
+#include <cstring>    // memcpy, strncmp
+
+// Number of triangles decoded by a single task when reading in parallel.
+static const qint64 s_binaryStlChunkSize = 65536;
+// Number of bytes of ascii text parsed by a single task when reading in
+// parallel.
+static const qint64 s_asciiStlChunkSize = 4 * 1024 * 1024;
+// Number of bytes read from the beginning of a file to detect its format.
+static const qint64 s_stlPrefixSize = 512;
+// Number of triangles decompressed and parsed at a time when reading a
+// compressed file.
+static const int s_compressedStlBatchSize = 65536;
+// Largest ratio of the decompressed to the compressed size trusted when
+// reserving memory for the triangle count given in a compressed binary STL
+// header.
+static const qint64 s_maxCompressionRatio = 1032;
+// Typical number of bytes of an ascii STL file per triangle, with the
+// coordinates written in scientific notation.
+static const qint64 s_asciiStlBytesPerTriangle = 250;
 
 // Constructors.
 PartStl::PartStl() : Part(), m_filename()
 {}
 
-PartStl::PartStl(const QString & filename) : Part(), m_filename(filename)
+PartStl::PartStl(const QString & filename, StlFormat format, LoadProgress * progress)
+    : Part(), m_filename(filename)
 {
-    readFile();
+    readFile(format, progress);
 }
 
 PartStl::PartStl(const PartStl & stlPart) : Part(stlPart), m_filename(stlPart.filename())
@@ -33,38 +60,32 @@ PartStl::PartStl(const PartStl & stlPart) : Part(stlPart), m_filename(stlPart.fi
 
 
 // Write out data.
-void PartStl::writeData(const QString & filename) const
+bool PartStl::writeData(const QString & filename, QString * errorMessage) const
 {
-    writeBinaryFile(filename);
+    return writeBinaryFile(filename, errorMessage);
 }
 
 //=============================================================================
-// The function "readBinaryFile" reads in a given binary STL file.
+// The function "readFile" reads in the STL file of the part.
+// INPUT: "StlFormat format" is the format of the file if already known, and
+// "StlFormat::Unknown" otherwise.
+// "LoadProgress * progress", if given, tracks the progress of the reading.
 //=============================================================================
-bool PartStl::readFile()
+bool PartStl::readFile(StlFormat format, LoadProgress * progress)
 {
-    // Read in face normals and vertices from an STL file.
-    QVector<QVector3D> faceNormals;
-    bool success = readStlFile(m_filename, faceNormals, m_vertices);
-    if (success == true)
+    // Read in face normals and vertices from an STL file, and weld the
+    // vertices.
+    GeometryArray<QVector3D> faceNormals;
+    bool success = false;
     {
-        // Get the number of triangles.
-        m_numTriangles = faceNormals.size();
-
-        // Check if the face normals match the vertices.
-        if (areFaceNormalsCorrect(faceNormals, 0.001f) == false)
-        {
-            qDebug() << "Incorrect normals detected.";
-            // Set the vertex normals using the computed face normals.
-            setVertexNormals();
-            //setVertexNormalsAsCrossProducts(); // normals that are not unit but proportional to triangle area
-        }
-        else
-        {
-            // Set the vertex normals using the read face normals.
-            setFaceNormalsAsVertexNormals(faceNormals);
-        }
+        GeometryArray<QVector3D> vertices;
+        success = (readStlFile(m_filename, faceNormals, vertices, format, progress) == true) &&
+                (setTriangles(vertices) == true);
     }
+    // Keep the read face normals that match the vertices and repair the
+    // others, measuring the part on the way.
+    if (success == true)
+        prepareTriangles(faceNormals, 0.001f);
     return success;
 }
 
@@ -73,10 +94,14 @@ bool PartStl::readFile()
 // The function "writeBinaryFile" write out a given binary STL file.
 // INPUT: "const QString & filename" is the name of the binary file to be
 // written.
+// OUTPUT: "QString * errorMessage", if given, returns the reason of a
+// failure.
+// The function itself returns "false" if the file could not be written and
+// "true" otherwise.
 //=============================================================================
-void PartStl::writeBinaryFile(const QString & filename) const
+bool PartStl::writeBinaryFile(const QString & filename, QString * errorMessage) const
 {
-    writeBinaryStlFile(filename, m_vertices, m_vertexNormals, 3);
+    return writeBinaryStlFile(filename, m_positions, m_indices, m_faceNormals, errorMessage);
 }
 
 
@@ -86,24 +111,120 @@ void PartStl::writeBinaryFile(const QString & filename) const
 //=============================================================================
 void PartStl::appendPartStl(const PartStl & stlPart)
 {
+    // Vertex normals are kept for all triangles or for none.
+    if ((hasVertexNormals() == true) || (stlPart.hasVertexNormals() == true))
+    {
+        m_vertexNormals.reserve(numVertices() + stlPart.numVertices());
+        for (qint64 i = m_vertexNormals.size(); i < numVertices(); ++i)
+            m_vertexNormals.push_back(packedVertexNormal(i));
+        for (qint64 i = 0; i < stlPart.numVertices(); ++i)
+            m_vertexNormals.push_back(stlPart.packedVertexNormal(i));
+    }
+    // The indices of the appended triangles follow the positions already held.
+    const quint32 firstPosition = static_cast<quint32>(m_positions.size());
+    m_indices.reserve(m_indices.size() + stlPart.indices().size());
+    for (auto cit = stlPart.indices().cbegin(); cit != stlPart.indices().cend(); ++cit)
+        m_indices.push_back(firstPosition + *cit);
     m_numTriangles += stlPart.numTriangles();
-    for (auto cit = stlPart.vertexBeginIter(); cit != stlPart.vertexEndIter(); ++cit)
-        m_vertices.push_back(*cit);
-    for (auto cit = stlPart.vertexNormalBeginIter(); cit != stlPart.vertexNormalEndIter(); ++cit)
-        m_vertexNormals.push_back(*cit);
+    m_positions.append(stlPart.positions());
+    m_faceNormals.append(stlPart.faceNormals());
+}
+
+
+//=============================================================================
+// The function "readLittleEndianFloat" reads a 32-bit float stored in the
+// little endian byte order, as is commonly assumed for STL files.
+// INPUT: "const uchar * src" points to the first of the four bytes.
+// OUTPUT: The function returns the float value.
+// NOTE: This is a non-member function.
+//=============================================================================
+static inline float readLittleEndianFloat(const uchar * src)
+{
+    quint32 bits;
+    memcpy(&bits, src, sizeof(bits));
+    bits = qFromLittleEndian(bits);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
 }
 
 
 //=============================================================================
-// The function "readBinaryStlFile" reads in a given binary STL file.
+// The function "decodeBinaryStlTriangles" decodes a range of binary STL
+// triangle records: 12 floats followed by two attribute bytes which are
+// skipped.
+// INPUT: "const uchar * records" points to the first triangle record.
+// "qint64 begin" and "qint64 end" specify the range [begin, end) of triangles
+// to be decoded.
+// OUTPUT: "QVector3D * normals" returns the normals of the triangles.
+// "QVector3D * vertices" returns the vertices of the triangles.
+//=============================================================================
+void decodeBinaryStlTriangles(const uchar * records, qint64 begin, qint64 end,
+                              QVector3D * normals, QVector3D * vertices)
+{
+    const uchar * record = records + binaryStlTriangleSize * begin;
+    for (qint64 i = begin; i < end; ++i, record += binaryStlTriangleSize)
+    {
+        normals[i] = QVector3D(readLittleEndianFloat(record),
+                               readLittleEndianFloat(record + 4),
+                               readLittleEndianFloat(record + 8));
+        for (int k = 0; k < 3; ++k)
+        {
+            const uchar * vertex = record + 12 * (k + 1);
+            vertices[3 * i + k] = QVector3D(readLittleEndianFloat(vertex),
+                                            readLittleEndianFloat(vertex + 4),
+                                            readLittleEndianFloat(vertex + 8));
+        }
+    }
+}
+
+
+//=============================================================================
+// The function "reportReadingThroughput" prints out how fast a file was read.
+// INPUT: "const QString & fileName" is the name of the file that was read.
+// "qint64 numBytes" is the number of bytes read.
+// "qint64 numNanoseconds" is the time it took to read them.
+//=============================================================================
+void reportReadingThroughput(const QString & fileName, qint64 numBytes, qint64 numNanoseconds)
+{
+    double megabytes = numBytes / (1024.0 * 1024.0);
+    double seconds = qMax(numNanoseconds, qint64(1)) * 1e-9;
+    qDebug() << "Read" << fileName << ":" << megabytes << "MB in"
+             << seconds * 1000.0 << "ms," << megabytes / seconds << "MB/s";
+}
+
+
+//=============================================================================
+// The function "reportWritingThroughput" prints out how fast a file was
+// written.
+// INPUT: "const QString & fileName" is the name of the file that was written.
+// "qint64 numBytes" is the number of bytes written.
+// "qint64 numNanoseconds" is the time it took to write them.
+//=============================================================================
+void reportWritingThroughput(const QString & fileName, qint64 numBytes, qint64 numNanoseconds)
+{
+    double megabytes = numBytes / (1024.0 * 1024.0);
+    double seconds = qMax(numNanoseconds, qint64(1)) * 1e-9;
+    qDebug() << "Wrote" << fileName << ":" << megabytes << "MB in"
+             << seconds * 1000.0 << "ms," << megabytes / seconds << "MB/s";
+}
+
+
+//=============================================================================
+// The function "readBinaryStlFile" reads in a given binary STL file. The file
+// is memory-mapped and the fixed-size triangle records are decoded in parallel
+// chunks directly into the preallocated output vectors. The result does not
+// depend on the number of threads (see "setDoForceSingleThread").
 // INPUT: "const QString & fileName" is the name of the file to be read.
-// OUTPUT: "QVector<QVector3D> & normals" returns the normals of the triangles.
-// "QVector<QVector3D> & vertices" returns the vertices of the triangles.
+// "LoadProgress * progress", if given, tracks the progress of the reading and
+// receives the description of a failure.
+// OUTPUT: "GeometryArray<QVector3D> & normals" returns the normals of the triangles.
+// "GeometryArray<QVector3D> & vertices" returns the vertices of the triangles.
 // The function itself returns "false" if any discrepancy is encountered and
 // "true" otherwise.
 //=============================================================================
-bool readBinaryStlFile(const QString & fileName, QVector<QVector3D> & normals,
-                       QVector<QVector3D> & vertices)
+bool readBinaryStlFile(const QString & fileName, GeometryArray<QVector3D> & normals,
+                       GeometryArray<QVector3D> & vertices, LoadProgress * progress)
 {
     // The binary STL format:
     //    UINT8[80] – Header
@@ -116,78 +237,103 @@ bool readBinaryStlFile(const QString & fileName, QVector<QVector3D> & normals,
     //    REAL32[3] – Vertex 3
     //    UINT16 – Attribute byte count
     //    end
+    const qint64 headerSize = binaryStlHeaderSize;
+    const qint64 triangleSize = binaryStlTriangleSize;
+
+    QElapsedTimer timer;
+    timer.start();
 
     // Specify and open the file for reading.
     QFile file(fileName);
     if (file.open(QIODevice::ReadOnly) == false)
     {
-        QMessageBox::information(0, "Could not open the file " + fileName +
-                                 " for binary reading.", file.errorString());
+        reportLoadError(progress, "Could not open the file " + fileName +
+                        " for binary reading: " + file.errorString());
         return false;
     }
 
-    // Read the data serialized from the file.
-    QDataStream in(&file);
-
-    // Set the floating precision so that floats a 32 bits.
-    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
-
-    // Set the byte order to be the "little endian" which is commonly assumed
-    // for STL files.
-    in.setByteOrder(QDataStream::LittleEndian);
+    // Make sure the header and the number of triangles are present.
+    const qint64 fileSize = file.size();
+    if (progress != nullptr)
+        progress->setNumBytesTotal(fileSize);
+    if (fileSize < headerSize)
+    {
+        reportLoadError(progress, "The binary STL header of " + fileName + " is incomplete.");
+        return false;
+    }
 
-    // Skip the header.
-    int skipLength = 80;
-    int readBytes = in.skipRawData(skipLength);
-    if (readBytes != skipLength)
+    // Map the whole file into memory.
+    const uchar * data = file.map(0, fileSize);
+    if (data == nullptr)
+    {
+        reportLoadError(progress, "Could not map the file " + fileName +
+                        " into memory: " + file.errorString());
         return false;
+    }
 
-    // Read in the number of triangles.
+    // Read in the number of triangles and make sure the file is large enough
+    // to hold them. Trailing bytes past the last triangle are tolerated.
     quint32 numTriangles;
-    in >> numTriangles;
-
-    // Clear the output vectors.
-    normals.clear();
-    vertices.clear();
-
-    // Reserve sufficient memory to hold all normals and vertices of triangles.
-    normals.reserve(numTriangles);
-    vertices.reserve(3*numTriangles);
-
-    // Read in the triangles.
-    for (quint32 i = 0; i < numTriangles; ++i)
+    memcpy(&numTriangles, data + 80, sizeof(numTriangles));
+    numTriangles = qFromLittleEndian(numTriangles);
+    if (headerSize + triangleSize * qint64(numTriangles) > fileSize)
     {
-        // Read in a normal.
-        float x, y, z;
-        in >> x >> y >> z;
-        normals.push_back(QVector3D(x, y, z));
-
-        // Read in three vertices.
-        for (int k = 0; k < 3; ++k)
-        {
-            in >> x >> y >> z;
-            vertices.push_back(QVector3D(x, y, z));
-        }
-
-        // Skip the two attribute bytes.
-        quint16 t;
-        in >> t;
+        reportLoadError(progress, QString("The header of %1 claims %2 triangles but the file holds only %3.")
+                        .arg(fileName).arg(numTriangles).arg((fileSize - headerSize) / triangleSize));
+        return false;
     }
+    if (headerSize + triangleSize * qint64(numTriangles) < fileSize)
+        qDebug() << "Ignoring" << fileSize - headerSize - triangleSize * qint64(numTriangles)
+                 << "trailing bytes in" << fileName;
+
+    // Allocate the output vectors at their final sizes.
+    normals.resize(numTriangles);
+    vertices.resize(3 * qint64(numTriangles));
+    QVector3D * normalData = normals.data();
+    QVector3D * vertexData = vertices.data();
+
+    // Decode the triangles in parallel chunks, each writing into its own
+    // slice of the output vectors. Once canceled, the remaining chunks are
+    // skipped.
+    const uchar * records = data + headerSize;
+    parallelForChunks(numTriangles, s_binaryStlChunkSize,
+                      [=](qint64, qint64 begin, qint64 end)
+    {
+        if (isLoadCanceled(progress) == true)
+            return;
+        decodeBinaryStlTriangles(records, begin, end, normalData, vertexData);
+        reportLoadProgress(progress, (end - begin) * triangleSize, end - begin);
+    });
     file.close();
+    if (isLoadCanceled(progress) == true)
+    {
+        reportLoadError(progress, "Loading of " + fileName + " was canceled.");
+        return false;
+    }
+
+    reportReadingThroughput(fileName, fileSize, timer.nsecsElapsed());
     return true;
 }
 
 
 //=============================================================================
-// The function "writeBinaryStlFile" writes to a binary STL file.
+// The function "writeBinaryStlFile" writes to a binary STL file. The file is
+// written under a temporary name and renamed once complete, so a failure
+// never leaves a partially written file behind.
 // INPUT: "const QString & fileName" is the name of the file to be written to.
-// "QVector<QVector3D> & normals" are the normals of the triangles.
-// "QVector<QVector3D> & vertices" are the vertices of the triangles.
-// "int skipStep" indicates how many of the normals are to be skipped between
-// two writings. It is used with value of 3 when the face normals are given.
+// "GeometryArray<QVector3D> & positions" are the positions of the vertices.
+// "GeometryArray<quint32> & indices" are the indices of the positions, 3 per
+// triangle.
+// "GeometryArray<PackedNormal> & faceNormals" are the packed normals of the
+// triangles.
+// OUTPUT: "QString * errorMessage", if given, returns the reason of a
+// failure.
+// The function itself returns "false" if the file could not be written and
+// "true" otherwise.
 //=============================================================================
-void writeBinaryStlFile(const QString & fileName, const QVector<QVector3D> & vertices,
-                        const QVector<QVector3D> & normals, int skipStep)
+bool writeBinaryStlFile(const QString & fileName, const GeometryArray<QVector3D> & positions,
+                        const GeometryArray<quint32> & indices, const GeometryArray<PackedNormal> & faceNormals,
+                        QString * errorMessage)
 {
     // The binary STL format:
     //    UINT8[80] – Header
@@ -201,179 +347,377 @@ void writeBinaryStlFile(const QString & fileName, const QVector<QVector3D> & ver
     //    UINT16 – Attribute byte count
     //    end
 
+    QElapsedTimer timer;
+    timer.start();
+    const qint64 numTriangles = indices.size() / 3;
+    if (faceNormals.size() < numTriangles)
+    {
+        if (errorMessage != nullptr)
+            *errorMessage = "There are fewer normals than triangles.";
+        return false;
+    }
+
     // Specify and open the file for writing.
-    QFile file(fileName);
-    if(file.open(QIODevice::WriteOnly) == false)
+    QSaveFile file(fileName);
+    if (file.open(QIODevice::WriteOnly) == false)
     {
-        QMessageBox::information(0, "Could not open the file " + fileName +
-                                 " for writing.", file.errorString());
+        if (errorMessage != nullptr)
+            *errorMessage = "Could not open the file " + fileName + " for writing: " + file.errorString();
+        return false;
     }
 
-    // Write the data serialized to the file.
-    QDataStream out(&file);
+    // Write the header and the triangles, and put the file in place.
+    StlBatchWriter writer(&file);
+    if ((writer.writeHeader(numTriangles) == false) ||
+        (writer.writeTriangles(positions.constData(), indices.constData(), faceNormals.constData(),
+                               numTriangles) == false) ||
+        (writer.finish() == false) || (file.commit() == false))
+    {
+        if (errorMessage != nullptr)
+            *errorMessage = "Could not write the file " + fileName + ": " +
+                    ((writer.hasError() == true) ? writer.errorMessage() : file.errorString());
+        file.cancelWriting();
+        return false;
+    }
 
-    // Set the floating precision so that floats a 32 bits.
-    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    reportWritingThroughput(fileName, binaryStlHeaderSize + binaryStlTriangleSize * numTriangles,
+                            timer.nsecsElapsed());
+    return true;
+}
 
-    // Set the byte order to be the "little endian" which is commonly assumed
-    // for STL files.
-    out.setByteOrder(QDataStream::LittleEndian);
 
-    // Write an empty header.
-    qint8 t = 0;
-    for (int i = 0; i < 80; ++i)
-        out << t;
+//=============================================================================
+// The function "detectStlFormat" decides from the beginning of an STL file if
+// it is binary or ascii. A binary file is recognized by its size matching the
+// number of triangles in its header, which also catches the many binary files
+// whose 80-byte header starts with "solid". Otherwise, a file is ascii if it
+// starts with "solid" and its beginning is plain text.
+// INPUT: "const QByteArray & prefix" is the beginning of the file.
+// "qint64 fileSize" is the size of the file, or -1 if it is not known.
+// OUTPUT: The function returns the detected format, or "StlFormat::Unknown" if
+// the file is neither.
+//=============================================================================
+StlFormat detectStlFormat(const QByteArray & prefix, qint64 fileSize)
+{
+    // Check if the size matches the number of triangles of a binary file.
+    if (prefix.size() >= binaryStlHeaderSize)
+    {
+        const qint64 numTriangles = qFromLittleEndian<quint32>(
+                    reinterpret_cast<const uchar *>(prefix.constData()) + 80);
+        if (binaryStlHeaderSize + binaryStlTriangleSize * numTriangles == fileSize)
+            return StlFormat::Binary;
+    }
 
-    // Write out the number of triangles.
-    quint32 numTriangles = normals.size();
-    out << numTriangles;
+    // Check for the "solid" keyword followed by plain text only.
+    const char * pos = skipBlanks(prefix.constData(), prefix.constData() + prefix.size());
+    const char * end = prefix.constData() + prefix.size();
+    bool isText = (end - pos >= 5) && (strncmp(pos, "solid", 5) == 0) &&
+            ((end - pos == 5) || (isspace(static_cast<uchar>(pos[5])) != 0));
+    for (const char * cit = pos; (isText == true) && (cit != end); ++cit)
+    {
+        const uchar c = static_cast<uchar>(*cit);
+        isText = (c >= 0x20) || (c == '\t') || (c == '\n') || (c == '\r') || (c == '\f') || (c == '\v');
+    }
+    if (isText == true)
+        return StlFormat::Ascii;
+
+    // Otherwise, assume a binary file with extra bytes at its end, or one
+    // whose size is not known.
+    if (prefix.size() >= binaryStlHeaderSize)
+        return StlFormat::Binary;
+    return StlFormat::Unknown;
+}
 
-    // Write out the triangles.
-    for (quint32 i = 0; i < numTriangles; ++i)
+
+//=============================================================================
+// The function "estimateStlNumTriangles" estimates the number of triangles of
+// an STL file from its beginning alone. The number given in the header of a
+// binary file is trusted as far as the size of the data allows.
+// INPUT: "const QByteArray & prefix" is the beginning of the (decompressed)
+// file.
+// "qint64 fileSize" is the size of the (decompressed) data, -1 if unknown.
+// "qint64 dataSize" is the size of the data if known, and an estimate of it
+// otherwise.
+// OUTPUT: The function returns the estimated number of triangles.
+//=============================================================================
+qint64 estimateStlNumTriangles(const QByteArray & prefix, qint64 fileSize, qint64 dataSize)
+{
+    if (detectStlFormat(prefix, fileSize) == StlFormat::Binary)
     {
-        // Write out a normal.
-        out << normals[skipStep*i].x() << normals[skipStep*i].y() << normals[skipStep*i].z();
+        const qint64 numTriangles = qFromLittleEndian<quint32>(
+                    reinterpret_cast<const uchar *>(prefix.constData()) + 80);
+        if (fileSize < 0)
+            return numTriangles;
+        return qMin(numTriangles, (fileSize - binaryStlHeaderSize) / binaryStlTriangleSize);
+    }
+    return dataSize / s_asciiStlBytesPerTriangle;
+}
 
-        // Write out three vertices.
-        for (int k = 0; k < 3; ++k)
-            out << vertices[3*i + k].x() << vertices[3*i + k].y() << vertices[3*i + k].z();
 
-        // Write the two attribute bytes.
-        quint16 t = 0;
-        out << t;
+//=============================================================================
+// The function "readStlFile" reads in a given STL file (binary or ascii,
+// possibly gzip or zstd compressed).
+// INPUT: "const QString & fileName" is the name of the file to be read.
+// "StlFormat format" is the format of an uncompressed file if it is already
+// known, and "StlFormat::Unknown" if it is to be detected.
+// "LoadProgress * progress", if given, tracks the progress of the reading and
+// receives the description of a failure.
+// OUTPUT: "GeometryArray<QVector3D> & normals" returns the normals of the triangles.
+// "GeometryArray<QVector3D> & vertices" returns the vertices of the triangles.
+// The function itself returns "false" if any discrepancy is encountered and
+// "true" otherwise.
+//=============================================================================
+bool readStlFile(const QString & fileName, GeometryArray<QVector3D> & normals, GeometryArray<QVector3D> & vertices,
+                 StlFormat format, LoadProgress * progress)
+{
+    if (format == StlFormat::Unknown)
+    {
+        // Specify and open the file for reading.
+        QFile file(fileName);
+        if (file.open(QIODevice::ReadOnly) == false)
+        {
+            reportLoadError(progress, "Could not open the file " + fileName +
+                            " for reading: " + file.errorString());
+            return false;
+        }
+
+        // Decide the format from the beginning and the size of the file.
+        const QByteArray prefix = file.read(s_stlPrefixSize);
+        const qint64 fileSize = file.size();
+        file.close();
+
+        // Compressed files are decompressed on the fly while being parsed.
+        if (detectCompression(prefix) != Compression::None)
+            return readCompressedStlFile(fileName, normals, vertices, progress);
+        format = detectStlFormat(prefix, fileSize);
     }
-    file.close();
+
+    if (format == StlFormat::Ascii)
+        return readAsciiStlFile(fileName, normals, vertices, progress);
+    return readBinaryStlFile(fileName, normals, vertices, progress);
 }
 
 
 //=============================================================================
-// The function "readStlFile" reads in a given STL file (binary or ascii).
+// The function "readCompressedStlFile" reads in a given gzip or zstd
+// compressed STL file (binary or ascii). The file is decompressed on the fly
+// and parsed batch by batch, so no temporary file is written and only a small
+// window of decompressed bytes is held in memory at any time.
 // INPUT: "const QString & fileName" is the name of the file to be read.
-// OUTPUT: "QVector<QVector3D> & normals" returns the normals of the triangles.
-// "QVector<QVector3D> & vertices" returns the vertices of the triangles.
+// OUTPUT: "GeometryArray<QVector3D> & normals" returns the normals of the triangles.
+// "GeometryArray<QVector3D> & vertices" returns the vertices of the triangles.
+// "LoadProgress * progress", if given, tracks the progress of the reading and
+// receives the description of a failure.
 // The function itself returns "false" if any discrepancy is encountered and
 // "true" otherwise.
 //=============================================================================
-bool readStlFile(const QString & fileName, QVector<QVector3D> & normals, QVector<QVector3D> & vertices)
+bool readCompressedStlFile(const QString & fileName, GeometryArray<QVector3D> & normals,
+                           GeometryArray<QVector3D> & vertices, LoadProgress * progress)
 {
+    QElapsedTimer timer;
+    timer.start();
+
     // Specify and open the file for reading.
-    QFile file(fileName);
-    if (file.open(QIODevice::ReadOnly) == false)
+    DecompressingDevice device(fileName, detectCompression(fileName));
+    if (device.open(QIODevice::ReadOnly) == false)
     {
-        QMessageBox::information(0, "Could not open the file " + fileName +
-                                 " for reading.", file.errorString());
+        reportLoadError(progress, "Could not open the file " + fileName + " for reading: " + device.errorString());
+        return false;
     }
 
-    // Read in the first line of text from the file.
-    QTextStream inText(&file);
-    QString line = inText.readLine();
-    file.close();
-    // If the first line strats with the word "solid" then assume ascii.
-    bool success;
-    if (line.startsWith("solid ") == true)
+    if (progress != nullptr)
+        progress->setNumBytesTotal(device.compressedSize());
+
+    StlBatchReader reader(&device, s_compressedStlBatchSize);
+    normals.clear();
+    vertices.clear();
+    if (reader.readHeader() == true)
     {
-        success = readAsciiStlFile(fileName, normals, vertices);
-        if (success == false)
-            QMessageBox::information(0, "Read Error", "Ascii STL format seems violated.");
+        // Reserve the memory for a binary file up front unless the header
+        // claims more triangles than the compressed data can possibly hold.
+        const qint64 numTriangles = reader.numTrianglesExpected();
+        const qint64 maxNumTriangles = device.compressedSize() * s_maxCompressionRatio / binaryStlTriangleSize;
+        if ((numTriangles > 0) && (numTriangles <= maxNumTriangles))
+        {
+            normals.reserve(numTriangles);
+            vertices.reserve(3 * numTriangles);
+        }
+
+        // Append the batches as they are decompressed and parsed. Progress
+        // is measured in compressed bytes.
+        StlTriangleBatch batch;
+        qint64 compressedPos = 0;
+        while (reader.readNextBatch(batch) == true)
+        {
+            normals.append(batch.normals);
+            vertices.append(batch.vertices);
+            reportLoadProgress(progress, device.compressedPos() - compressedPos, batch.numTriangles());
+            compressedPos = device.compressedPos();
+            if (isLoadCanceled(progress) == true)
+            {
+                reportLoadError(progress, "Loading of " + fileName + " was canceled.");
+                return false;
+            }
+        }
     }
-    else
+    if (reader.hasError() == true)
     {
-        success = readBinaryStlFile(fileName, normals, vertices);
-        if (success == false)
-            QMessageBox::information(0, "Read Error", "Binary STL format seems violated.");
+        reportLoadError(progress, "Compressed STL file " + fileName + " could not be read. " + reader.errorMessage());
+        return false;
     }
-    return success;
+
+    reportReadingThroughput(fileName, reader.numBytesRead(), timer.nsecsElapsed());
+    return true;
 }
 
 
 //=============================================================================
-// The function "readAsciiStlFile" reads in a given ascii STL file.
+// The class "AsciiStlChunk" holds the result of parsing a piece of an ascii
+// STL file.
+//=============================================================================
+struct AsciiStlChunk
+{
+    const char * begin;           // beginning of the piece, at a facet
+    const char * end;             // end of the piece, at the next piece's facet
+    GeometryArray<QVector3D> normals;   // normals of the parsed triangles
+    GeometryArray<QVector3D> vertices;  // vertices of the parsed triangles
+    bool isSuccess;               // indicates if parsing succeeded
+    bool hasReachedEnd;           // indicates if "endsolid" was reached
+    const char * errorPos;        // position at which parsing failed
+    QString errorMessage;         // description of the failure
+};
+
+
+//=============================================================================
+// The function "readAsciiStlFile" reads in a given ascii STL file. The file is
+// memory-mapped, split at facet boundaries into pieces of roughly the same
+// size, and the pieces are tokenized in place in parallel. The triangles of
+// the pieces are then stitched together in file order.
 // INPUT: "const QString & fileName" is the name of the file to be read.
-// OUTPUT: "QVector<QVector3D> & normals" returns the normals of the triangles.
-// "QVector<QVector3D> & vertices" returns the vertices of the triangles.
+// OUTPUT: "GeometryArray<QVector3D> & normals" returns the normals of the triangles.
+// "GeometryArray<QVector3D> & vertices" returns the vertices of the triangles.
+// "LoadProgress * progress", if given, tracks the progress of the reading and
+// receives the line number and the reason of a parsing failure.
 // The function itself returns "false" if any discrepancy is encountered and
 // "true" otherwise.
 //=============================================================================
-bool readAsciiStlFile(const QString & fileName, QVector<QVector3D> & normals,
-                      QVector<QVector3D> & vertices)
+bool readAsciiStlFile(const QString & fileName, GeometryArray<QVector3D> & normals,
+                      GeometryArray<QVector3D> & vertices, LoadProgress * progress)
 {
-    // The ascii STL format:
-    // solid name
-    // facet normal ni nj nk
-    //     outer loop
-    //         vertex v1x v1y v1z
-    //         vertex v2x v2y v2z
-    //         vertex v3x v3y v3z
-    //     endloop
-    // endfacet
-    // endsolid name
+    QElapsedTimer timer;
+    timer.start();
 
     // Specify and open the file for reading.
     QFile file(fileName);
     if (file.open(QIODevice::ReadOnly) == false)
     {
-        QMessageBox::information(0, "Could not open the file " + fileName +
-                                 " for ascii reading.", file.errorString());
+        reportLoadError(progress, "Could not open the file " + fileName +
+                        " for ascii reading: " + file.errorString());
         return false;
     }
 
-    // Read the text from the file.
-    QTextStream in(&file);
-    // Read in the first line.
-    QString line = in.readLine();
-
-    // Define temporary storage.
-    QVector<QVector3D> tempNormals;
-    QVector<QVector3D> tempVertices;
-    QStringList fields;
-    // Read in the second line.
-    line = in.readLine();
-    // Keep reading until the end of the file or a line strating with the word
-    // "endsolid" is reached.
-    while ((in.atEnd() == false) && (line.simplified().startsWith("endsolid ") == false))
+    // Map the whole file into memory.
+    const qint64 fileSize = file.size();
+    if (progress != nullptr)
+        progress->setNumBytesTotal(fileSize);
+    const char * text = (fileSize > 0) ? reinterpret_cast<const char *>(file.map(0, fileSize)) : nullptr;
+    if (text == nullptr)
     {
-        // Split the line into space-separated strings.
-        fields = line.simplified().split(" ");
-        if ((fields.size() != 5) || (fields[0] != "facet") || (fields[1] != "normal"))
-            return false;
-        // Store the normal.
-        tempNormals.push_back(QVector3D(fields[2].toDouble(), fields[3].toDouble(), fields[4].toDouble()));
-
-        // Read in the next line.
-        line = in.readLine();
-        if (line.simplified().startsWith("outer loop") == false)
-            return false;
+        reportLoadError(progress, "Could not map the file " + fileName + " into memory.");
+        return false;
+    }
+    const char * textEnd = text + fileSize;
 
-        // Read in three vertices.
-        for (int k = 0; k < 3; ++k)
-        {
-            // Read in the next line.
-            line = in.readLine();
-            // Split the line into space-separated strings.
-            fields = line.simplified().split(" ");
-            if ((fields.size() != 4) || (fields[0] != "vertex"))
-                return false;
-            // Store the vertex.
-            tempVertices.push_back(QVector3D(fields[1].toDouble(), fields[2].toDouble(), fields[3].toDouble()));
-        }
+    // Parse the "solid" line.
+    AsciiStlParser headerParser(text, textEnd);
+    if (headerParser.parseHeader() == false)
+    {
+        reportLoadError(progress, QString("Ascii STL format of %1 seems violated. Line 1: %2.")
+                        .arg(fileName).arg(headerParser.errorMessage()));
+        return false;
+    }
 
-        // Read in the next line.
-        line = in.readLine();
-        if (line.simplified().startsWith("endloop") == false)
-            return false;
+    // Split the rest of the text into pieces starting at facets. The number of
+    // pieces depends only on the file size.
+    const char * body = headerParser.position();
+    const qint64 numPieces = qMax(numChunks(textEnd - body, s_asciiStlChunkSize), qint64(1));
+    QVector<AsciiStlChunk> chunks(static_cast<int>(numPieces));
+    chunks.first().begin = body;
+    for (qint64 i = 1; i < numPieces; ++i)
+    {
+        const char * splitPos = qMax(body + i * s_asciiStlChunkSize, chunks[i - 1].begin);
+        chunks[i].begin = AsciiStlParser::findFacetStart(splitPos, textEnd);
+        chunks[i - 1].end = chunks[i].begin;
+    }
+    chunks.last().end = textEnd;
 
-        // Read in the next line.
-        line = in.readLine();
-        if (line.simplified().startsWith("endfacet") == false)
+    // Parse the pieces in parallel.
+    AsciiStlChunk * chunkData = chunks.data();
+    parallelForChunks(numPieces, 1, [&](qint64 i, qint64, qint64)
+    {
+        AsciiStlChunk & chunk = chunkData[i];
+        AsciiStlParser parser(text, textEnd);
+        parser.setPosition(chunk.begin);
+        chunk.isSuccess = (isLoadCanceled(progress) == false) &&
+                (parser.parseFacets(chunk.end, chunk.normals, chunk.vertices) == true);
+        chunk.hasReachedEnd = parser.hasReachedEnd();
+        chunk.errorPos = parser.errorPosition();
+        chunk.errorMessage = parser.errorMessage();
+        if (chunk.isSuccess == true)
+            reportLoadProgress(progress, chunk.end - chunk.begin, chunk.normals.size());
+    });
+
+    // Only the pieces up to the first one reaching "endsolid" count. Report
+    // the first failure among them along with its line number.
+    if (isLoadCanceled(progress) == true)
+    {
+        reportLoadError(progress, "Loading of " + fileName + " was canceled.");
+        return false;
+    }
+    int numUsedPieces = 0;
+    qint64 numTriangles = 0;
+    for (const AsciiStlChunk & chunk : chunks)
+    {
+        if (chunk.isSuccess == false)
+        {
+            const qint64 lineNumber = lineNumberAt(text, chunk.errorPos);
+            reportLoadError(progress, QString("Ascii STL format of %1 seems violated. Line %2: %3.")
+                            .arg(fileName).arg(lineNumber).arg(chunk.errorMessage));
             return false;
-
-        // Read in the next line.
-        line = in.readLine();
+        }
+        ++numUsedPieces;
+        numTriangles += chunk.normals.size();
+        if (chunk.hasReachedEnd == true)
+            break;
+    }
+    // Stitch the triangles of the pieces together in file order.
+    if (numUsedPieces == 1)
+    {
+        normals.swap(chunks.first().normals);
+        vertices.swap(chunks.first().vertices);
     }
+    else
+    {
+        QVector<qint64> offsets(numUsedPieces + 1, 0);
+        for (int i = 0; i < numUsedPieces; ++i)
+            offsets[i + 1] = offsets[i] + chunks[i].normals.size();
+        normals.resize(numTriangles);
+        vertices.resize(3 * numTriangles);
+        QVector3D * normalData = normals.data();
+        QVector3D * vertexData = vertices.data();
+        const qint64 * offsetData = offsets.constData();
+        parallelForChunks(numUsedPieces, 1, [&](qint64 i, qint64, qint64)
+        {
+            AsciiStlChunk & chunk = chunkData[i];
+            std::copy(chunk.normals.cbegin(), chunk.normals.cend(), normalData + offsetData[i]);
+            std::copy(chunk.vertices.cbegin(), chunk.vertices.cend(), vertexData + 3 * offsetData[i]);
+            chunk.normals = GeometryArray<QVector3D>();
+            chunk.vertices = GeometryArray<QVector3D>();
+        });
+    }
+    file.close();
 
-    // Set up the output.
-    std::swap(normals, tempNormals);
-    std::swap(vertices, tempVertices);
+    reportReadingThroughput(fileName, fileSize, timer.nsecsElapsed());
     return true;
 }
 
@@ -381,36 +725,59 @@ bool readAsciiStlFile(const QString & fileName, QVector<QVector3D> & normals,
 //=============================================================================
 // The function "createLargeStlFile" creates a large STL file by replicating
 // the object in a given STL file as many times as necessary to achieve a
-// specified minimal number of triangles in the new STL file.
+// specified minimal number of triangles in the new STL file. The copies are
+// streamed to the new file as they are made, so only the given object is
+// held in memory.
 // INPUT: "const QString & filename" is an STL file.
-// "long int targetNumTriangles" is the desired minimal number of triangles to
+// "qint64 targetNumTriangles" is the desired minimal number of triangles to
 // be in the new STL file.
+// OUTPUT: The function returns "false" if the new file could not be written
+// and "true" otherwise.
 //=============================================================================
-void createLargeStlFile(const QString & filename, long int targetNumTriangles)
+bool createLargeStlFile(const QString & filename, qint64 targetNumTriangles)
 {
     // Read in the given file.
     PartStl stlPart(filename);
+    const qint64 numTriangles = stlPart.numTriangles();
+    if (numTriangles == 0)
+        return false;
 
     // Compute a reasonable shift that guarantees that the copies do not
     // overlap.
     QVector3D minCoord;
     QVector3D maxCoord;
-    findCoordinateRanges(stlPart.vertices(), minCoord, maxCoord);
+    stlPart.coordinateRanges(minCoord, maxCoord);
     float shiftStep = maxCoord.y() - minCoord.y() + 1.0f;
 
-    // Keep adding copies along the y-axis.
-    PartStl largeStlPart;
-    long int currNumTriangles = 0;
-    while (currNumTriangles < targetNumTriangles)
-    {
-        stlPart.shift(QVector3D(0, shiftStep, 0));
-        largeStlPart.appendPartStl(stlPart);
-        currNumTriangles += stlPart.numTriangles();
-    }
-
     // Come up with a name for the large file.
     QString largeFilename = filename;
     largeFilename.insert(filename.length() - 4, QString("Large"));
     qDebug() << largeFilename;
-    largeStlPart.writeBinaryFile(largeFilename);
+    QElapsedTimer timer;
+    timer.start();
+    QSaveFile file(largeFilename);
+    if (file.open(QIODevice::WriteOnly) == false)
+    {
+        qDebug() << "Could not open the file" << largeFilename << "for writing:" << file.errorString();
+        return false;
+    }
+
+    // Write copies shifted along the y-axis.
+    const qint64 numCopies = qMax((targetNumTriangles + numTriangles - 1) / numTriangles, qint64(1));
+    StlBatchWriter writer(&file);
+    bool isSuccess = writer.writeHeader(numCopies * numTriangles);
+    for (qint64 copy = 1; (copy <= numCopies) && (isSuccess == true); ++copy)
+        isSuccess = writer.writeTriangles(stlPart.positionConstData(), stlPart.indexConstData(),
+                                          stlPart.faceNormalConstData(), numTriangles,
+                                          QVector3D(0, copy * shiftStep, 0));
+    if ((isSuccess == false) || (writer.finish() == false) || (file.commit() == false))
+    {
+        qDebug() << "Could not write the file" << largeFilename << ":"
+                 << ((writer.hasError() == true) ? writer.errorMessage() : file.errorString());
+        file.cancelWriting();
+        return false;
+    }
+    reportWritingThroughput(largeFilename, binaryStlHeaderSize + binaryStlTriangleSize * numCopies * numTriangles,
+                            timer.nsecsElapsed());
+    return true;
 }
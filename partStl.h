@@ -10,53 +10,80 @@
 #ifndef PART_STL_HEADER
 #define PART_STL_HEADER
 
+#include <QByteArray>
 #include <QString>
-#include <QVector>
 #include <QVector3D>
+#include "geometryArray.h"
 #include "part.h"
 
+class LoadProgress;
+
+// Formats of STL files.
+enum class StlFormat {Unknown, Ascii, Binary};
+
 class PartStl : public Part
 {
 public:
     // Constructors.
     PartStl();
-    PartStl(const QString & fileName);
+    PartStl(const QString & fileName, StlFormat format = StlFormat::Unknown,
+            LoadProgress * progress = nullptr);
     PartStl(const PartStl & part);
     virtual ~PartStl() override {}
 
     // Write out data.
-    virtual void writeData(const QString & filename) const override;
+    virtual bool writeData(const QString & filename, QString * errorMessage = nullptr) const override;
 
     // Append a given stl part to this part.
     void appendPartStl(const PartStl & stlPart);
 
     // Write out a binary file.
-    void writeBinaryFile(const QString & filename) const;
+    bool writeBinaryFile(const QString & filename, QString * errorMessage = nullptr) const;
 
     // Accessors.
     QString filename() const { return m_filename; }
 
 protected:
     // Read in a file.
-    bool readFile();
+    bool readFile(StlFormat format, LoadProgress * progress);
 
 private:
     QString m_filename;
 };
 
 
+// Sizes of the header and of a single triangle record of a binary STL file.
+const qint64 binaryStlHeaderSize = 84;
+const qint64 binaryStlTriangleSize = 50;
+
 // Non-members.
-bool readStlFile(const QString & fileName, QVector<QVector3D> & normals, QVector<QVector3D> & vertices);
+bool readStlFile(const QString & fileName, GeometryArray<QVector3D> & normals, GeometryArray<QVector3D> & vertices,
+                 StlFormat format = StlFormat::Unknown, LoadProgress * progress = nullptr);
+
+StlFormat detectStlFormat(const QByteArray & prefix, qint64 fileSize);
+
+qint64 estimateStlNumTriangles(const QByteArray & prefix, qint64 fileSize, qint64 dataSize);
+
+bool readBinaryStlFile(const QString & fileName, GeometryArray<QVector3D> & normals,
+                       GeometryArray<QVector3D> & vertices, LoadProgress * progress = nullptr);
+
+bool writeBinaryStlFile(const QString & fileName, const GeometryArray<QVector3D> & positions,
+                        const GeometryArray<quint32> & indices, const GeometryArray<PackedNormal> & faceNormals,
+                        QString * errorMessage = nullptr);
+
+bool readAsciiStlFile(const QString & fileName, GeometryArray<QVector3D> & normals,
+                      GeometryArray<QVector3D> & vertices, LoadProgress * progress = nullptr);
+
+bool readCompressedStlFile(const QString & fileName, GeometryArray<QVector3D> & normals,
+                           GeometryArray<QVector3D> & vertices, LoadProgress * progress = nullptr);
 
-bool readBinaryStlFile(const QString & fileName, QVector<QVector3D> & normals,
-                       QVector<QVector3D> & vertices);
+void decodeBinaryStlTriangles(const uchar * records, qint64 begin, qint64 end,
+                              QVector3D * normals, QVector3D * vertices);
 
-void writeBinaryStlFile(const QString & fileName, const QVector<QVector3D> & vertices,
-                        const QVector<QVector3D> & normals, int skipStep);
+void reportReadingThroughput(const QString & fileName, qint64 numBytes, qint64 numNanoseconds);
 
-bool readAsciiStlFile(const QString & fileName, QVector<QVector3D> & normals,
-                      QVector<QVector3D> & vertices);
+void reportWritingThroughput(const QString & fileName, qint64 numBytes, qint64 numNanoseconds);
 
-void createLargeStlFile(const QString & filename, long int targetNumTriangles = 2000000);
+bool createLargeStlFile(const QString & filename, qint64 targetNumTriangles = 2000000);
 
 #endif // PART_STL_HEADER
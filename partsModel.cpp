@@ -9,28 +9,140 @@
 
 #include "partsModel.h"
 #include "partFactory.h"
+#include "geometryCache.h"
+#include "memoryBudget.h"
+#include "decimation.h"
 #include "boxSize.h"
 #include "packer.h"
 #include "packing.h"
+#include "parallelFor.h"
+#include "partStl.h"
+#include "stlBatchWriter.h"
+#include "threeMfWriter.h"
+#include "normalSmoothing.h"
+#include "vertexWelding.h"
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QThread>
+#include <QtConcurrent>
 #include <algorithm>   // sort, swap
+#include <atomic>      // atomic
 #include <functional>  // greater
 #include <numeric>     // iota
 
+// Interval between progress reports while reading, in milliseconds.
+static const int s_progressInterval = 100;
+// Largest number of files read at the same time. Every reading is itself
+// parallel, so a few files are enough to keep all cores busy while the
+// memory held by the readings stays bounded.
+static const int s_maxNumConcurrentLoads = 4;
+// Number of bytes a triangle of a part takes: 3 position indices, a packed
+// face normal, 3 packed smoothed vertex normals, and, as closed meshes have
+// about half as many positions as triangles, half a position. Parts whose
+// normals are not smoothed take less, as their memory size tells.
+static const qint64 s_numBytesPerTriangle = 3 * sizeof(quint32) + 4 * sizeof(PackedNormal) + sizeof(QVector3D) / 2;
+// Number of bytes a triangle takes at most while its part is read: the soup
+// of 3 vertices and a face normal, the temporary indices of the welding, and
+// the welded part.
+static const qint64 s_numBytesPerReadTriangle = 4 * sizeof(QVector3D) + 3 * sizeof(quint32) + s_numBytesPerTriangle;
+// Smallest number of triangles a part over budget is decimated to. A part
+// that would have to be coarser is refused instead.
+static const qint64 s_minNumTrianglesDecimated = 10000;
+// Delay between the last change of a file and rereading it, in milliseconds,
+// so that a file being written is reread once it is complete.
+static const int s_reloadDelay = 500;
+// Number of bytes of a file hashed by a single task.
+static const qint64 s_hashChunkSize = 4 * 1024 * 1024;
+// Number of triangles of a part written to an STL file between progress
+// reports.
+static const qint64 s_exportSliceSize = 1024 * 1024;
+
+//=============================================================================
+// This class gathers what a reading on a worker thread works with.
+//=============================================================================
+struct LoadContext
+{
+    const PartFactory * partFactory;       // factory reading the files
+    GeometryCache * geometryCache;         // prepared geometry of parts read before
+    MemoryBudget * memoryBudget;           // budget the part is admitted to, or null to admit it as it is
+    bool doDecimate;                       // indicates if a part over budget is decimated rather than refused
+};
+
 
 // Constructor.
 PartsModel::PartsModel(const BoxSize & masterBox, float minGapBetweenParts, QObject * parent)
     : QObject(parent),
       m_masterBox(masterBox),
       m_partFactory(new PartFactory()),
+      m_geometryCache(new GeometryCache()),
+      m_memoryBudget(new MemoryBudget(defaultMemoryBudget())),
+      m_doDecimateOverBudget(true),
+      m_pendingLoads(),
+      m_loadThreadPool(),
+      m_progressTimer(),
+      m_prefetchedParts(),
+      m_prefetchProgress(),
+      m_prefetchThreadPool(),
+      m_prefetchMemoryLimit(defaultPrefetchMemoryLimit),
+      m_fileWatcher(),
+      m_watchedFiles(),
+      m_changedFiles(),
+      m_reloadTimer(),
+      m_pendingReloads(),
+      m_exportFileName(),
+      m_exportProgress(),
+      m_exportWatcher(nullptr),
       m_totalVolume(0),
       m_minGapBetweenParts(minGapBetweenParts)
-{}
+{
+    m_loadThreadPool.setMaxThreadCount(qBound(1, QThread::idealThreadCount(), s_maxNumConcurrentLoads));
+    // Read ahead one file at a time.
+    m_prefetchThreadPool.setMaxThreadCount(1);
+
+    m_progressTimer.setInterval(s_progressInterval);
+    connect(&m_progressTimer, SIGNAL(timeout()), this, SLOT(reportLoadingProgress()));
+
+    // Reread the parts whose files change, once the changes settle.
+    m_reloadTimer.setInterval(s_reloadDelay);
+    m_reloadTimer.setSingleShot(true);
+    connect(&m_fileWatcher, SIGNAL(fileChanged(const QString &)), this, SLOT(scheduleReload(const QString &)));
+    connect(&m_reloadTimer, SIGNAL(timeout()), this, SLOT(reloadChangedFiles()));
+}
 
 // Destructor.
 PartsModel::~PartsModel()
 {
+    // Stop the readings still running before the factory goes away.
+    cancelLoading();
+    cancelPrefetching();
+    cancelExporting();
+    for (auto it = m_pendingReloads.begin(); it != m_pendingReloads.end(); ++it)
+        it->progress->cancel();
+    m_loadThreadPool.waitForDone();
+    m_prefetchThreadPool.waitForDone();
+    for (auto it = m_pendingLoads.begin(); it != m_pendingLoads.end(); ++it)
+        delete it->watcher;
+    m_pendingLoads.clear();
+
     delete m_partFactory;
     m_partFactory = nullptr;
+    delete m_geometryCache;
+    m_geometryCache = nullptr;
+    delete m_memoryBudget;
+    m_memoryBudget = nullptr;
+}
+
+
+//=============================================================================
+// The function "fileDialogFilter" makes a filter for file dialogs listing the
+// file formats that parts can be read from.
+//=============================================================================
+QString PartsModel::fileDialogFilter() const
+{
+    return m_partFactory->fileDialogFilter();
 }
 
 
@@ -73,30 +185,1087 @@ bool PartsModel::repack(double minGapBetweenParts)
 
 
 //=============================================================================
-// The function "addPart" adds a part to the list of managed parts.
+// The function "geometryCacheMaxSize" returns the limit of the total size of
+// the geometry cache files.
+//=============================================================================
+qint64 PartsModel::geometryCacheMaxSize() const
+{
+    return m_geometryCache->maxSize();
+}
+
+
+//=============================================================================
+// The function "setGeometryCacheMaxSize" sets the limit of the total size of
+// the geometry cache files.
+// INPUT: "qint64 maxSize" is the limit in bytes; 0 disables the cache.
+//=============================================================================
+void PartsModel::setGeometryCacheMaxSize(qint64 maxSize)
+{
+    m_geometryCache->setMaxSize(maxSize);
+}
+
+
+//=============================================================================
+// The function "weldTolerance" returns the tolerance within which the
+// vertices of the parts read are welded.
+//=============================================================================
+float PartsModel::weldTolerance() const
+{
+    return ::weldTolerance();
+}
+
+
+//=============================================================================
+// The function "setWeldTolerance" sets the tolerance within which the
+// vertices of the parts read from now on are welded. The parts already read
+// are kept as they are.
+// INPUT: "float tolerance" is the largest distance in millimeters between two
+// vertices welded together, which also welds chains of such vertices; 0 welds
+// only the vertices at exactly the same position.
+//=============================================================================
+void PartsModel::setWeldTolerance(float tolerance)
+{
+    ::setWeldTolerance(tolerance);
+}
+
+
+//=============================================================================
+// The function "creaseAngle" returns the crease angle within which the vertex
+// normals of the parts read are smoothed.
+//=============================================================================
+float PartsModel::creaseAngle() const
+{
+    return ::creaseAngle();
+}
+
+
+//=============================================================================
+// The function "setCreaseAngle" sets the crease angle within which the vertex
+// normals of the parts read from now on are smoothed. The parts already read
+// are kept as they are.
+// INPUT: "float creaseAngle" is the angle in degrees; 0 keeps the face normals.
+//=============================================================================
+void PartsModel::setCreaseAngle(float creaseAngle)
+{
+    ::setCreaseAngle(creaseAngle);
+}
+
+
+//=============================================================================
+// The function "memoryBudget" returns the limit of the memory the parts may
+// take, or 0 if there is no limit.
+//=============================================================================
+qint64 PartsModel::memoryBudget() const
+{
+    return m_memoryBudget->limit();
+}
+
+
+//=============================================================================
+// The function "setMemoryBudget" sets the limit of the memory the parts may
+// take. The parts loaded already are kept even if they exceed it.
+// INPUT: "qint64 memoryBudget" is the limit in bytes; 0 means no limit.
+//=============================================================================
+void PartsModel::setMemoryBudget(qint64 memoryBudget)
+{
+    m_memoryBudget->setLimit(qMax(memoryBudget, qint64(0)));
+}
+
+
+//=============================================================================
+// The function "memoryUsed" returns the memory taken by the loaded parts and
+// reserved for the parts being read, in bytes.
+//=============================================================================
+qint64 PartsModel::memoryUsed() const
+{
+    return m_memoryBudget->numBytesUsed();
+}
+
+
+//=============================================================================
+// The function "loadedMemorySize" finds the memory a loaded part takes: its
+// vertices and normals, and their copy in the OpenGL vertex buffers.
+// INPUT: "const Part & part" is the part.
+// OUTPUT: The function returns the memory in bytes.
+// NOTE: This is a non-member function.
+//=============================================================================
+static qint64 loadedMemorySize(const Part & part)
+{
+    return part.memorySize() + numBytesPerBufferVertex * part.numVertices();
+}
+
+
+//=============================================================================
+// The function "stagingMemorySize" finds the memory of the staging buffer the
+// vertices of a part are interleaved in while its OpenGL vertex buffers are
+// filled.
+// INPUT: "qint64 numVertices" is the number of vertices of the part.
+// OUTPUT: The function returns the memory in bytes.
+// NOTE: This is a non-member function.
+//=============================================================================
+static qint64 stagingMemorySize(qint64 numVertices)
+{
+    return numBytesPerBufferVertex * qMin(numVertices, maxNumVerticesPerBuffer);
+}
+
+
+//=============================================================================
+// The function "requiredMemorySize" finds the memory needed to load a part of
+// a given number of triangles, including its staging buffer.
+// INPUT: "qint64 numTriangles" is the number of triangles.
+// OUTPUT: The function returns the memory in bytes.
+// NOTE: This is a non-member function.
+//=============================================================================
+static qint64 requiredMemorySize(qint64 numTriangles)
+{
+    return numTriangles * (s_numBytesPerTriangle + 3 * numBytesPerBufferVertex) +
+            stagingMemorySize(3 * numTriangles);
+}
+
+
+//=============================================================================
+// The function "numTrianglesFitting" finds the largest number of triangles of
+// a part that can be loaded in a given amount of memory.
+// INPUT: "qint64 numBytes" is the amount of memory.
+// OUTPUT: The function returns the number of triangles.
+// NOTE: This is a non-member function.
+//=============================================================================
+static qint64 numTrianglesFitting(qint64 numBytes)
+{
+    // Up to the size of a single buffer, the staging buffer grows with the
+    // part as well.
+    const qint64 numBytesPerTriangle = s_numBytesPerTriangle + 3 * numBytesPerBufferVertex;
+    const qint64 numTriangles = numBytes / (numBytesPerTriangle + 3 * numBytesPerBufferVertex);
+    if (3 * numTriangles <= maxNumVerticesPerBuffer)
+        return numTriangles;
+    return qMax((numBytes - stagingMemorySize(maxNumVerticesPerBuffer)) / numBytesPerTriangle, qint64(0));
+}
+
+
+//=============================================================================
+// The function "memorySize" returns the memory a loaded part takes: its
+// vertices and normals, and their copy in the OpenGL vertex buffers.
+// INPUT: "int i" is the index of the part.
+// OUTPUT: The function returns the memory in bytes.
+//=============================================================================
+qint64 PartsModel::memorySize(int i) const
+{
+    assert((0 <= i) && (i < m_parts.size()));
+    return loadedMemorySize(*m_parts[i].part());
+}
+
+
+//=============================================================================
+// The function "overBudgetMessage" describes why a part is refused for lack
+// of memory.
+// INPUT: "qint64 numBytesRequired" is the memory the part would take.
+// "const MemoryBudget & memoryBudget" is the budget it does not fit in.
+// OUTPUT: The function returns the description.
+// NOTE: This is a non-member function.
+//=============================================================================
+static QString overBudgetMessage(qint64 numBytesRequired, const MemoryBudget & memoryBudget)
+{
+    const qint64 numBytesPerMegabyte = 1024 * 1024;
+    return QString("Loading the part would take about %1 MB of memory, but only %2 MB of the "
+                   "memory budget of %3 MB are left. Unload some parts or raise the budget.")
+            .arg((numBytesRequired + numBytesPerMegabyte - 1) / numBytesPerMegabyte)
+            .arg(memoryBudget.numBytesLeft() / numBytesPerMegabyte)
+            .arg(memoryBudget.limit() / numBytesPerMegabyte);
+}
+
+
+//=============================================================================
+// The function "reserveLoadMemory" reserves in the memory budget the memory a
+// part is expected to take before it is read, estimated from the number of
+// triangles of its file, so that parts read at the same time do not count on
+// the same memory. If the part does not fit, then the memory left is
+// reserved for a decimated copy of it instead, if allowed. A part that would
+// have to be decimated too much, or that would not fit in the physical memory
+// for the time it is read, is refused. It runs on a worker thread.
+// INPUT: "const LoadContext & context" holds the budget.
+// "const QString & fileName" is the name of the file.
+// "LoadProgress * progress" receives the description of a refusal.
+// OUTPUT: "qint64 & numBytesReserved" returns the memory reserved.
+// The function itself returns "false" if the part is refused, and "true"
+// otherwise.
+// NOTE: This is a non-member function.
+//=============================================================================
+static bool reserveLoadMemory(const LoadContext & context, const QString & fileName, LoadProgress * progress,
+                              qint64 & numBytesReserved)
+{
+    numBytesReserved = 0;
+    MemoryBudget * memoryBudget = context.memoryBudget;
+    if (memoryBudget == nullptr)
+        return true;
+
+    // The cache knows the number of triangles exactly, the file roughly. A
+    // part whose size is not known is checked once it is read.
+    qint64 numTriangles = context.geometryCache->numTriangles(fileName);
+    if (numTriangles < 0)
+        numTriangles = context.partFactory->estimateNumTriangles(fileName);
+    if (numTriangles < 0)
+        return true;
+    const qint64 numBytesRequired = requiredMemorySize(numTriangles);
+    if (memoryBudget->tryReserve(numBytesRequired) == true)
+    {
+        numBytesReserved = numBytesRequired;
+        return true;
+    }
+
+    const qint64 numBytesLeft = memoryBudget->numBytesLeft();
+    const bool isReadable =
+            (numTriangles * s_numBytesPerReadTriangle <= physicalMemorySize() - memoryBudget->numBytesUsed());
+    if ((context.doDecimate == true) && (isReadable == true) &&
+        (numTrianglesFitting(numBytesLeft) >= s_minNumTrianglesDecimated) &&
+        (memoryBudget->tryReserve(numBytesLeft) == true))
+    {
+        numBytesReserved = numBytesLeft;
+        return true;
+    }
+    reportLoadError(progress, overBudgetMessage(numBytesRequired, *memoryBudget));
+    return false;
+}
+
+
+//=============================================================================
+// The function "admitManagedPart" reserves in the memory budget the memory a
+// part that has been read takes, provided there is room for its staging
+// buffer as well. A part that does not fit is replaced by a decimated copy
+// that does, if allowed, and refused otherwise. It runs on a worker thread.
+// INPUT: "const LoadContext & context" holds the budget.
+// "std::shared_ptr<ManagedPart> managedPart" is the part.
+// "LoadProgress * progress" receives the description of a refusal.
+// OUTPUT: The function returns the part or its decimated copy, or null if
+// the part is refused.
+// NOTE: This is a non-member function.
+//=============================================================================
+static std::shared_ptr<ManagedPart> admitManagedPart(const LoadContext & context,
+                                                     std::shared_ptr<ManagedPart> managedPart,
+                                                     LoadProgress * progress)
+{
+    MemoryBudget * memoryBudget = context.memoryBudget;
+    if (memoryBudget == nullptr)
+        return managedPart;
+
+    // The staging buffer is needed only until the part is drawn for the
+    // first time.
+    const Part & part = *managedPart->part();
+    const qint64 numStagingBytes = stagingMemorySize(part.numVertices());
+    if (memoryBudget->tryReserve(loadedMemorySize(part) + numStagingBytes) == true)
+    {
+        memoryBudget->release(numStagingBytes);
+        return managedPart;
+    }
+
+    const qint64 maxNumTriangles = numTrianglesFitting(memoryBudget->numBytesLeft());
+    if ((context.doDecimate == true) && (maxNumTriangles >= s_minNumTrianglesDecimated))
+    {
+        std::shared_ptr<Part> decimatedPart = decimatePart(part, maxNumTriangles);
+        const qint64 numDecimatedStagingBytes =
+                (decimatedPart != nullptr) ? stagingMemorySize(decimatedPart->numVertices()) : 0;
+        // The copy is prepared, smoothing included, before its memory size
+        // is known.
+        auto decimatedManagedPart = (decimatedPart != nullptr) ? std::make_shared<ManagedPart>(decimatedPart) :
+                                                                 std::shared_ptr<ManagedPart>(nullptr);
+        if ((decimatedManagedPart != nullptr) &&
+            (memoryBudget->tryReserve(loadedMemorySize(*decimatedPart) + numDecimatedStagingBytes) == true))
+        {
+            memoryBudget->release(numDecimatedStagingBytes);
+            decimatedManagedPart->setIsDecimated(true);
+            return decimatedManagedPart;
+        }
+    }
+    reportLoadError(progress, overBudgetMessage(requiredMemorySize(part.numTriangles()), *memoryBudget));
+    return std::shared_ptr<ManagedPart>(nullptr);
+}
+
+
+//=============================================================================
+// The function "loadManagedPart" reads a part from a given file and prepares
+// it for management, or restores it from the geometry cache if it has been
+// read before. The part is admitted to the memory budget, if any, and is
+// decimated or refused if it does not fit. It runs on a worker thread.
+// INPUT: "LoadContext context" holds the factory reading the file, the cache
+// of parts read before and the memory budget.
+// "const QString & fileName" is the name of the file.
+// "std::shared_ptr<LoadProgress> progress" tracks the progress of the reading.
+// "std::shared_ptr<ManagedPart> prefetchedPart" is the part if it has been
+// read ahead of time, and null otherwise.
+// OUTPUT: The function returns the part, or null on failure.
+// NOTE: This is a non-member function.
+//=============================================================================
+static std::shared_ptr<ManagedPart> loadManagedPart(LoadContext context, const QString & fileName,
+                                                    std::shared_ptr<LoadProgress> progress,
+                                                    std::shared_ptr<ManagedPart> prefetchedPart)
+{
+    if (prefetchedPart != nullptr)
+        return admitManagedPart(context, prefetchedPart, progress.get());
+
+    // Hold the memory the part is expected to take while it is read.
+    qint64 numBytesReserved = 0;
+    if (reserveLoadMemory(context, fileName, progress.get(), numBytesReserved) == false)
+        return std::shared_ptr<ManagedPart>(nullptr);
+
+    std::shared_ptr<ManagedPart> managedPart = context.geometryCache->load(fileName, progress.get());
+    if ((managedPart == nullptr) && (isLoadCanceled(progress.get()) == false))
+    {
+        std::shared_ptr<Part> part = context.partFactory->makePart(fileName, progress.get());
+        if (part != nullptr)
+            managedPart = std::make_shared<ManagedPart>(part);
+    }
+    if (context.memoryBudget != nullptr)
+        context.memoryBudget->release(numBytesReserved);
+    if ((managedPart == nullptr) || (isLoadCanceled(progress.get()) == true))
+        return std::shared_ptr<ManagedPart>(nullptr);
+    return admitManagedPart(context, managedPart, progress.get());
+}
+
+
+//=============================================================================
+// The function "storeManagedPart" adds a part that has been read to the
+// geometry cache. It runs on a worker thread.
+// INPUT: "GeometryCache * geometryCache" is the cache of parts read before.
+// "const QString & fileName" is the name of the file the part was read from.
+// "std::shared_ptr<ManagedPart> managedPart" is the part.
+// NOTE: This is a non-member function.
+//=============================================================================
+static void storeManagedPart(GeometryCache * geometryCache, const QString & fileName,
+                             std::shared_ptr<ManagedPart> managedPart)
+{
+    geometryCache->store(fileName, *managedPart);
+}
+
+
+//=============================================================================
+// The function "prefetchManagedPart" reads a part ahead of time, in case the
+// user is about to open it. The part is added to the geometry cache, and is
+// kept in memory if it fits both in the memory left for reading ahead and in
+// the memory budget, which is charged with the memory the part holds until
+// it is taken or dropped. It runs on a single worker thread of low priority,
+// so that it does not slow down the work the user is waiting for.
+// INPUT: "LoadContext context" holds the factory reading the file, the cache
+// of parts read before, and the memory budget.
+// "const QString & fileName" is the name of the file.
+// "std::shared_ptr<LoadProgress> progress" allows to cancel the reading.
+// "std::shared_ptr<std::atomic<qint64> > memoryLeft" is the memory left for
+// parts read ahead, in bytes; it is reduced by the memory the part holds.
+// OUTPUT: The function returns the part if it is to be kept in memory, and
+// null otherwise.
+// NOTE: This is a non-member function.
+//=============================================================================
+static std::shared_ptr<ManagedPart> prefetchManagedPart(LoadContext context, const QString & fileName,
+                                                        std::shared_ptr<LoadProgress> progress,
+                                                        std::shared_ptr<std::atomic<qint64> > memoryLeft)
+{
+    // Skip files that could not fit in the memory left anyway, as reading
+    // them would take that much memory for a while.
+    if ((isLoadCanceled(progress.get()) == true) || (QFileInfo(fileName).size() > *memoryLeft))
+        return std::shared_ptr<ManagedPart>(nullptr);
+
+    // The thread belongs to the pool reading ahead, so it is kept at low
+    // priority and reads on its own rather than on the global thread pool.
+    QThread::currentThread()->setPriority(QThread::LowestPriority);
+    setDoForceSingleThreadOnCurrentThread(true);
+
+    // Restore the part from the geometry cache, or read it and add it there
+    // for the next time.
+    std::shared_ptr<ManagedPart> managedPart = context.geometryCache->load(fileName, progress.get());
+    if ((managedPart == nullptr) && (isLoadCanceled(progress.get()) == false))
+    {
+        std::shared_ptr<Part> part = context.partFactory->makePart(fileName, progress.get());
+        if ((part != nullptr) && (isLoadCanceled(progress.get()) == false))
+        {
+            managedPart = std::make_shared<ManagedPart>(part);
+            context.geometryCache->store(fileName, *managedPart);
+        }
+    }
+    if ((managedPart == nullptr) || (isLoadCanceled(progress.get()) == true))
+        return std::shared_ptr<ManagedPart>(nullptr);
+
+    // Keep the part in memory only if it fits.
+    const qint64 numBytes = managedPart->part()->memorySize();
+    if ((numBytes > *memoryLeft) || (context.memoryBudget->tryReserve(numBytes) == false))
+        return std::shared_ptr<ManagedPart>(nullptr);
+    *memoryLeft -= numBytes;
+    return managedPart;
+}
+
+
+//=============================================================================
+// The function "hashFileContents" computes a hash of the contents of a file.
+// The file is hashed in parallel chunks whose hashes are hashed in turn, so
+// the result does not depend on the number of threads.
+// INPUT: "const QString & fileName" is the name of the file.
+// OUTPUT: The function returns the hash, or an empty array if the file can
+// not be read.
+// NOTE: This is a non-member function.
+//=============================================================================
+static QByteArray hashFileContents(const QString & fileName)
+{
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly) == false)
+        return QByteArray();
+    const qint64 fileSize = file.size();
+    const uchar * data = (fileSize > 0) ? file.map(0, fileSize) : nullptr;
+    if ((data == nullptr) && (fileSize > 0))
+        return QByteArray();
+
+    QVector<QByteArray> chunkHashes(static_cast<int>(numChunks(fileSize, s_hashChunkSize)));
+    QByteArray * chunkHashData = chunkHashes.data();
+    parallelForChunks(fileSize, s_hashChunkSize, [=](qint64 chunkIndex, qint64 begin, qint64 end)
+    {
+        chunkHashData[chunkIndex] = QCryptographicHash::hash(
+                    QByteArray::fromRawData(reinterpret_cast<const char *>(data + begin), static_cast<int>(end - begin)),
+                    QCryptographicHash::Md5);
+    });
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    for (auto cit = chunkHashes.cbegin(); cit != chunkHashes.cend(); ++cit)
+        hash.addData(*cit);
+    return hash.result();
+}
+
+
+//=============================================================================
+// The function "hashWatchedFile" computes the hash of the contents of a file
+// parts have been read from, provided the file has not changed since. It
+// runs on a worker thread.
+// INPUT: "WatchedFile file" is the file as it was when the parts were read.
+// OUTPUT: The function returns the file with its hash, which is left empty if
+// the file has changed.
+// NOTE: This is a non-member function.
+//=============================================================================
+static WatchedFile hashWatchedFile(WatchedFile file)
+{
+    QFileInfo fileInfo(file.fileName);
+    if ((fileInfo.size() == file.fileSize) && (fileInfo.lastModified() == file.lastModified))
+        file.contentHash = hashFileContents(file.fileName);
+    return file;
+}
+
+
+//=============================================================================
+// The function "reloadManagedPart" rereads a part from a file that has
+// changed. A file whose contents turn out to be the same, e.g., one that has
+// merely been touched, is not reread. The part is admitted to the memory
+// budget like a part read for the first time, the memory of the parts read
+// before having been freed for it. It runs on a worker thread.
+// INPUT: "LoadContext context" holds the factory reading the file, the cache
+// of parts read before, and the budget the part is admitted to.
+// "WatchedFile file" is the file as it was when the part was read last.
+// "std::shared_ptr<LoadProgress> progress" tracks the progress of the reading.
+// OUTPUT: The function returns the file as it is now along with the part
+// read, or with a null part if the contents did not change or reading failed.
+// NOTE: This is a non-member function.
+//=============================================================================
+static ReloadedPart reloadManagedPart(LoadContext context, WatchedFile file, std::shared_ptr<LoadProgress> progress)
+{
+    ReloadedPart reloaded;
+    QFileInfo fileInfo(file.fileName);
+    reloaded.file.fileName = file.fileName;
+    reloaded.file.fileSize = fileInfo.size();
+    reloaded.file.lastModified = fileInfo.lastModified();
+    reloaded.file.contentHash = hashFileContents(file.fileName);
+    if ((reloaded.file.contentHash.isEmpty() == true) || (reloaded.file.contentHash != file.contentHash))
+        reloaded.managedPart = loadManagedPart(context, file.fileName, progress, nullptr);
+    return reloaded;
+}
+
+
+//=============================================================================
+// The function "addPart" starts reading a part on a worker thread. The part
+// is added to the list of managed parts by "finishLoading" once it is read.
 // INPUT: "const QString & fileName" is the name of the file from which the new
 // part is to be read.
 //=============================================================================
 void PartsModel::addPart(const QString & fileName)
 {
-    // Create and add a new part.
-    m_parts.push_back(ManagedPart(m_partFactory->makePart(fileName)));
+    addParts(QStringList(fileName));
+}
 
-    bool isSuccess = repack(m_minGapBetweenParts);
 
-    // If packing failed, then signal it and return.
-    if (isSuccess == false)
+//=============================================================================
+// The function "addParts" starts reading a number of parts concurrently on
+// worker threads. The parts are added to the list of managed parts together,
+// with a single repacking, once all readings have finished.
+// INPUT: "const QStringList & fileNames" are the names of the files from which
+// the new parts are to be read.
+//=============================================================================
+void PartsModel::addParts(const QStringList & fileNames)
+{
+    if (fileNames.isEmpty() == true)
+        return;
+
+    // Reading ahead makes way for the files asked for. The parts read ahead
+    // already are taken as they are.
+    cancelPrefetching();
+
+    LoadContext context;
+    context.partFactory = m_partFactory;
+    context.geometryCache = m_geometryCache;
+    context.memoryBudget = m_memoryBudget;
+    context.doDecimate = m_doDecimateOverBudget;
+    const bool wasLoading = isLoading();
+    for (auto cit = fileNames.cbegin(); cit != fileNames.cend(); ++cit)
+    {
+        PendingLoad load;
+        load.fileName = *cit;
+        // Remember the state of the file, so that changes made while it is
+        // being read are noticed.
+        QFileInfo fileInfo(*cit);
+        load.fileSize = fileInfo.size();
+        load.lastModified = fileInfo.lastModified();
+        load.progress = std::make_shared<LoadProgress>();
+        load.watcher = new QFutureWatcher<std::shared_ptr<ManagedPart> >(this);
+        load.isFinished = false;
+        connect(load.watcher, SIGNAL(finished()), this, SLOT(finishLoading()));
+        load.watcher->setFuture(QtConcurrent::run(&m_loadThreadPool, loadManagedPart, context,
+                                                  *cit, load.progress, takePrefetchedPart(*cit)));
+        m_pendingLoads.push_back(load);
+    }
+    if (wasLoading == false)
+    {
+        if (isExporting() == false)
+            m_progressTimer.start();
+        emit loadingStarted();
+    }
+}
+
+
+//=============================================================================
+// The function "cancelLoading" cancels the reading of all parts being read.
+// Readings still waiting for a thread finish right away.
+//=============================================================================
+void PartsModel::cancelLoading()
+{
+    for (auto it = m_pendingLoads.begin(); it != m_pendingLoads.end(); ++it)
+        it->progress->cancel();
+}
+
+
+//=============================================================================
+// The function "prefetchParts" starts reading parts ahead of time in the
+// background, in case the user is about to open them, e.g., the most recent
+// files at startup. The parts read before by this function are dropped. The
+// reading is canceled as soon as the user asks for any part.
+// INPUT: "const QStringList & fileNames" are the names of the files to be read
+// ahead, the most likely to be opened first.
+//=============================================================================
+void PartsModel::prefetchParts(const QStringList & fileNames)
+{
+    cancelPrefetching();
+    for (auto cit = m_prefetchedParts.cbegin(); cit != m_prefetchedParts.cend(); ++cit)
+    {
+        if (cit->managedPart != nullptr)
+            m_memoryBudget->release(cit->managedPart->part()->memorySize());
+    }
+    m_prefetchedParts.clear();
+    if (m_prefetchMemoryLimit <= 0)
+        return;
+
+    LoadContext context;
+    context.partFactory = m_partFactory;
+    context.geometryCache = m_geometryCache;
+    context.memoryBudget = m_memoryBudget;
+    context.doDecimate = false;
+    m_prefetchProgress = std::make_shared<LoadProgress>();
+    auto memoryLeft = std::make_shared<std::atomic<qint64> >(m_prefetchMemoryLimit);
+    for (auto cit = fileNames.cbegin(); cit != fileNames.cend(); ++cit)
+    {
+        // Remember the state of the file, so that a part read from a file
+        // changed since is not taken.
+        QFileInfo fileInfo(*cit);
+        if (fileInfo.isFile() == false)
+            continue;
+        PrefetchedPart prefetched;
+        prefetched.fileName = *cit;
+        prefetched.fileSize = fileInfo.size();
+        prefetched.lastModified = fileInfo.lastModified();
+        prefetched.watcher = new QFutureWatcher<std::shared_ptr<ManagedPart> >(this);
+        connect(prefetched.watcher, SIGNAL(finished()), this, SLOT(finishPrefetching()));
+        prefetched.watcher->setFuture(QtConcurrent::run(&m_prefetchThreadPool, prefetchManagedPart, context,
+                                                        *cit, m_prefetchProgress, memoryLeft));
+        m_prefetchedParts.push_back(prefetched);
+    }
+}
+
+
+//=============================================================================
+// The function "cancelPrefetching" cancels reading parts ahead of time. The
+// parts read ahead already are kept.
+//=============================================================================
+void PartsModel::cancelPrefetching()
+{
+    if (m_prefetchProgress != nullptr)
+        m_prefetchProgress->cancel();
+
+    // Forget the parts still being read; their watchers are deleted once the
+    // readings finish.
+    for (int i = m_prefetchedParts.size() - 1; i >= 0; --i)
+    {
+        if (m_prefetchedParts[i].watcher != nullptr)
+            m_prefetchedParts.removeAt(i);
+    }
+}
+
+
+//=============================================================================
+// The function "finishPrefetching" records a part that has been read ahead of
+// time on a worker thread. A part whose reading has been canceled meanwhile
+// is dropped, and its memory released. It runs on the GUI thread.
+//=============================================================================
+void PartsModel::finishPrefetching()
+{
+    auto watcher = static_cast<QFutureWatcher<std::shared_ptr<ManagedPart> > *>(sender());
+    watcher->deleteLater();
+    std::shared_ptr<ManagedPart> managedPart = watcher->result();
+    for (int i = 0; i < m_prefetchedParts.size(); ++i)
+    {
+        if (m_prefetchedParts[i].watcher != watcher)
+            continue;
+        // Forget the part if it was not kept in memory.
+        if (managedPart == nullptr)
+        {
+            m_prefetchedParts.removeAt(i);
+            return;
+        }
+        m_prefetchedParts[i].managedPart = managedPart;
+        m_prefetchedParts[i].watcher = nullptr;
+        return;
+    }
+    if (managedPart != nullptr)
+        m_memoryBudget->release(managedPart->part()->memorySize());
+}
+
+
+//=============================================================================
+// The function "takePrefetchedPart" hands over a part that has been read ahead
+// of time from a given file, provided the file has not changed since. The
+// memory it holds is released, as the part is admitted to the memory budget
+// anew once it is taken.
+// INPUT: "const QString & fileName" is the name of the file.
+// OUTPUT: The function returns the part, or null if there is none.
+//=============================================================================
+std::shared_ptr<ManagedPart> PartsModel::takePrefetchedPart(const QString & fileName)
+{
+    for (int i = 0; i < m_prefetchedParts.size(); ++i)
+    {
+        const PrefetchedPart & prefetched = m_prefetchedParts[i];
+        if ((prefetched.fileName != fileName) || (prefetched.managedPart == nullptr))
+            continue;
+        std::shared_ptr<ManagedPart> managedPart = prefetched.managedPart;
+        QFileInfo fileInfo(fileName);
+        const bool isUnchanged = (fileInfo.size() == prefetched.fileSize) &&
+                                 (fileInfo.lastModified() == prefetched.lastModified);
+        m_memoryBudget->release(managedPart->part()->memorySize());
+        m_prefetchedParts.removeAt(i);
+        return (isUnchanged == true) ? managedPart : std::shared_ptr<ManagedPart>(nullptr);
+    }
+    return std::shared_ptr<ManagedPart>(nullptr);
+}
+
+
+//=============================================================================
+// The function "reportLoadingProgress" sums up the progress of all parts being
+// read and signals it, and signals the progress of the plate being exported.
+//=============================================================================
+void PartsModel::reportLoadingProgress()
+{
+    if (isExporting() == true)
+        emit exportingProgressed(m_exportProgress->numBytesRead(), m_exportProgress->numBytesTotal(),
+                                 m_exportProgress->numTrianglesRead());
+    if (isLoading() == false)
+        return;
+
+    qint64 numBytesRead = 0;
+    qint64 numBytesTotal = 0;
+    qint64 numTrianglesRead = 0;
+    for (auto cit = m_pendingLoads.cbegin(); cit != m_pendingLoads.cend(); ++cit)
+    {
+        numBytesRead += cit->progress->numBytesRead();
+        numBytesTotal += cit->progress->numBytesTotal();
+        numTrianglesRead += cit->progress->numTrianglesRead();
+    }
+    emit loadingProgressed(numBytesRead, numBytesTotal, numTrianglesRead);
+}
+
+
+//=============================================================================
+// The function "finishLoading" records a part that has been read on a worker
+// thread. Once all pending readings have finished, the parts read are added
+// to the list of managed parts in the order they were requested. It runs on
+// the GUI thread.
+//=============================================================================
+void PartsModel::finishLoading()
+{
+    // Mark the reading that has finished.
+    auto watcher = static_cast<QFutureWatcher<std::shared_ptr<ManagedPart> > *>(sender());
+    bool isAllFinished = true;
+    for (auto it = m_pendingLoads.begin(); it != m_pendingLoads.end(); ++it)
+    {
+        if (it->watcher == watcher)
+            it->isFinished = true;
+        isAllFinished = isAllFinished && it->isFinished;
+    }
+    if (isAllFinished == false)
+        return;
+
+    // Collect the parts read, and signal the failures unless the reading was
+    // canceled on purpose.
+    QList<PendingLoad> loads;
+    loads.swap(m_pendingLoads);
+    if (isExporting() == false)
+        m_progressTimer.stop();
+    emit loadingFinished();
+    QList<ManagedPart> managedParts;
+    QList<WatchedFile> files;
+    for (auto cit = loads.cbegin(); cit != loads.cend(); ++cit)
+    {
+        std::shared_ptr<ManagedPart> managedPart = cit->watcher->result();
+        cit->watcher->deleteLater();
+        if (managedPart != nullptr)
+        {
+            managedPart->setFileName(cit->fileName);
+            managedParts.push_back(*managedPart);
+            WatchedFile file;
+            file.fileName = cit->fileName;
+            file.fileSize = cit->fileSize;
+            file.lastModified = cit->lastModified;
+            files.push_back(file);
+            // Keep the part in the cache for the next time, unless it is
+            // there already or is only a decimated copy.
+            if (managedPart->isDecimated() == true)
+                emit loadingPartDecimated(cit->fileName, managedPart->part()->numTriangles());
+            else
+                QtConcurrent::run(&m_loadThreadPool, storeManagedPart, m_geometryCache, cit->fileName, managedPart);
+        }
+        else if (cit->progress->isCanceled() == false)
+            emit loadingPartFailed(cit->fileName, cit->progress->errorMessage());
+    }
+    addManagedParts(managedParts);
+
+    // Watch the files of the parts that have been added for changes.
+    for (auto cit = files.cbegin(); cit != files.cend(); ++cit)
+    {
+        for (auto citPart = m_parts.cbegin(); citPart != m_parts.cend(); ++citPart)
+        {
+            if (citPart->fileName() == cit->fileName)
+            {
+                watchFile(*cit);
+                break;
+            }
+        }
+    }
+}
+
+
+//=============================================================================
+// The function "addManagedParts" adds parts that have been read to the list
+// of managed parts, and repacks all parts once. If the new parts do not fit,
+// then they are dropped one by one from the end until the rest fit.
+// INPUT: "const QList<ManagedPart> & managedParts" are the parts to be added.
+//=============================================================================
+void PartsModel::addManagedParts(const QList<ManagedPart> & managedParts)
+{
+    if (managedParts.isEmpty() == true)
+        return;
+
+    const int numOldParts = m_parts.size();
+    m_parts.append(managedParts);
+    bool isSuccess = repack(m_minGapBetweenParts);
+    while ((isSuccess == false) && (m_parts.size() > numOldParts))
     {
-        // Remove the last part that did not be fit.
+        // Remove the last part that did not fit, and release its memory.
+        m_memoryBudget->release(loadedMemorySize(*m_parts.last().part()));
         m_parts.removeLast();
+        isSuccess = (m_parts.size() == numOldParts) || (repack(m_minGapBetweenParts) == true);
+    }
+
+    // Compute the new total volume of the parts.
+    for (int i = numOldParts; i < m_parts.size(); ++i)
+        m_totalVolume += m_parts[i].volume();
+
+    // If some parts could not be fit, then signal it.
+    if (m_parts.size() < numOldParts + managedParts.size())
         emit addingPartFailed();
+    if (m_parts.size() > numOldParts)
+        emit partAdded();
+}
+
+
+//=============================================================================
+// The function "watchFile" starts watching the file of newly added parts for
+// changes, and computes the hash of its contents in the background.
+// INPUT: "const WatchedFile & file" is the file as it was when the parts were
+// read.
+//=============================================================================
+void PartsModel::watchFile(const WatchedFile & file)
+{
+    if (m_watchedFiles.contains(file.fileName) == true)
         return;
+    m_watchedFiles.insert(file.fileName, file);
+    m_fileWatcher.addPath(file.fileName);
+
+    auto watcher = new QFutureWatcher<WatchedFile>(this);
+    connect(watcher, SIGNAL(finished()), this, SLOT(finishHashing()));
+    watcher->setFuture(QtConcurrent::run(&m_loadThreadPool, hashWatchedFile, file));
+
+    // Reread the parts right away if the file changed while they were read.
+    QFileInfo fileInfo(file.fileName);
+    if ((fileInfo.size() != file.fileSize) || (fileInfo.lastModified() != file.lastModified))
+        scheduleReload(file.fileName);
+}
+
+
+//=============================================================================
+// The function "unwatchFile" stops watching a file for changes unless some
+// loaded parts have been read from it.
+// INPUT: "const QString & fileName" is the name of the file.
+//=============================================================================
+void PartsModel::unwatchFile(const QString & fileName)
+{
+    for (auto cit = m_parts.cbegin(); cit != m_parts.cend(); ++cit)
+    {
+        if (cit->fileName() == fileName)
+            return;
     }
+    if (m_watchedFiles.remove(fileName) > 0)
+        m_fileWatcher.removePath(fileName);
+    m_changedFiles.remove(fileName);
+}
 
-    // Compute the new total volume of the parts.
-    m_totalVolume += m_parts.back().volume();
 
-    emit partAdded();
+//=============================================================================
+// The function "finishHashing" records the hash of the contents of a watched
+// file computed on a worker thread. It runs on the GUI thread.
+//=============================================================================
+void PartsModel::finishHashing()
+{
+    auto watcher = static_cast<QFutureWatcher<WatchedFile> *>(sender());
+    watcher->deleteLater();
+    const WatchedFile file = watcher->result();
+    auto it = m_watchedFiles.find(file.fileName);
+    if ((it != m_watchedFiles.end()) && (it->fileSize == file.fileSize) &&
+        (it->lastModified == file.lastModified) && (it->contentHash.isEmpty() == true))
+        it->contentHash = file.contentHash;
+}
+
+
+//=============================================================================
+// The function "scheduleReload" notes that a watched file has changed. The
+// parts read from it are reread once no further changes have been noted for
+// a little while, so that a file being written is reread once.
+// INPUT: "const QString & fileName" is the name of the file.
+//=============================================================================
+void PartsModel::scheduleReload(const QString & fileName)
+{
+    m_changedFiles.insert(fileName);
+    m_reloadTimer.start();
+}
+
+
+//=============================================================================
+// The function "reloadChangedFiles" starts rereading the parts whose files
+// have changed on worker threads. It runs on the GUI thread.
+//=============================================================================
+void PartsModel::reloadChangedFiles()
+{
+    QSet<QString> changedFiles;
+    changedFiles.swap(m_changedFiles);
+    for (auto cit = changedFiles.cbegin(); cit != changedFiles.cend(); ++cit)
+    {
+        auto it = m_watchedFiles.find(*cit);
+        if (it == m_watchedFiles.end())
+            continue;
+
+        // Editors often replace a file rather than overwrite it, in which
+        // case the watcher drops it. Wait for a missing file to show up
+        // again, and then watch it anew.
+        QFileInfo fileInfo(*cit);
+        if (fileInfo.isFile() == false)
+        {
+            scheduleReload(*cit);
+            continue;
+        }
+        if (m_fileWatcher.files().contains(*cit) == false)
+            m_fileWatcher.addPath(*cit);
+        if ((fileInfo.size() == it->fileSize) && (fileInfo.lastModified() == it->lastModified))
+            continue;
+
+        // Drop a rereading of the file still running, as it is outdated,
+        // taking over the memory freed for it.
+        qint64 numBytesReleased = 0;
+        for (int i = m_pendingReloads.size() - 1; i >= 0; --i)
+        {
+            if (m_pendingReloads[i].fileName == *cit)
+            {
+                numBytesReleased += m_pendingReloads[i].numBytesReleased;
+                m_pendingReloads[i].progress->cancel();
+                m_pendingReloads.removeAt(i);
+            }
+        }
+
+        // Free the memory of the parts read from the file, so that the part
+        // reread is admitted to the budget in their place, and decimated if
+        // it does not fit, just like a part read for the first time.
+        PendingReload reload;
+        reload.numBytesReleased = 0;
+        bool isDecimated = false;
+        for (auto citPart = m_parts.cbegin(); citPart != m_parts.cend(); ++citPart)
+        {
+            if (citPart->fileName() != *cit)
+                continue;
+            reload.numBytesReleased += loadedMemorySize(*citPart->part());
+            isDecimated = isDecimated || citPart->isDecimated();
+        }
+        m_memoryBudget->release(reload.numBytesReleased - numBytesReleased);
+
+        LoadContext context;
+        context.partFactory = m_partFactory;
+        context.geometryCache = m_geometryCache;
+        context.memoryBudget = m_memoryBudget;
+        context.doDecimate = (m_doDecimateOverBudget == true) || (isDecimated == true);
+        reload.fileName = *cit;
+        reload.progress = std::make_shared<LoadProgress>();
+        reload.watcher = new QFutureWatcher<ReloadedPart>(this);
+        connect(reload.watcher, SIGNAL(finished()), this, SLOT(finishReloading()));
+        reload.watcher->setFuture(QtConcurrent::run(&m_loadThreadPool, reloadManagedPart, context, *it,
+                                                    reload.progress));
+        m_pendingReloads.push_back(reload);
+    }
+}
+
+
+//=============================================================================
+// The function "finishReloading" puts a part that has been reread on a worker
+// thread in place of the parts read from the same file before. It runs on
+// the GUI thread.
+//=============================================================================
+void PartsModel::finishReloading()
+{
+    auto watcher = static_cast<QFutureWatcher<ReloadedPart> *>(sender());
+    watcher->deleteLater();
+    PendingReload reload;
+    reload.watcher = nullptr;
+    for (int i = 0; i < m_pendingReloads.size(); ++i)
+    {
+        if (m_pendingReloads[i].watcher == watcher)
+        {
+            reload = m_pendingReloads.takeAt(i);
+            break;
+        }
+    }
+    // Ignore a rereading that has been dropped or whose parts have been
+    // removed meanwhile, giving back the memory the part read took. The
+    // memory freed for a dropped rereading has been taken over by the one
+    // replacing it, and that of removed parts released along with them.
+    const ReloadedPart reloaded = watcher->result();
+    auto it = m_watchedFiles.find(reload.fileName);
+    if ((reload.watcher == nullptr) || (it == m_watchedFiles.end()))
+    {
+        if (reloaded.managedPart != nullptr)
+            m_memoryBudget->release(loadedMemorySize(*reloaded.managedPart->part()));
+        if (reload.watcher != nullptr)
+            m_memoryBudget->reserve(reload.numBytesReleased);
+        return;
+    }
+
+    if (reloaded.managedPart == nullptr)
+    {
+        // The parts read before stay, and take their memory back.
+        m_memoryBudget->reserve(reload.numBytesReleased);
+        // A file whose contents did not change is merely noted as it is now.
+        if ((reloaded.file.contentHash.isEmpty() == false) && (reloaded.file.contentHash == it->contentHash))
+            *it = reloaded.file;
+        else if (reload.progress->isCanceled() == false)
+            emit loadingPartFailed(reload.fileName, reload.progress->errorMessage());
+        return;
+    }
+
+    *it = reloaded.file;
+    reloaded.managedPart->setFileName(reload.fileName);
+    if (replaceManagedParts(*reloaded.managedPart, reload.numBytesReleased) == false)
+        return;
+    // Keep the part in the cache for the next time, unless it is only a
+    // decimated copy.
+    if (reloaded.managedPart->isDecimated() == true)
+        emit loadingPartDecimated(reload.fileName, reloaded.managedPart->part()->numTriangles());
+    else
+        QtConcurrent::run(&m_loadThreadPool, storeManagedPart, m_geometryCache, reload.fileName, reloaded.managedPart);
+}
+
+
+//=============================================================================
+// The function "replaceManagedParts" puts a part that has been reread in place
+// of the parts read from the same file before. A part keeps its place if it
+// still fits in the bounding box of its old version. Otherwise, all parts are
+// repacked, and if they do not fit anymore, the old version is kept. The
+// part reread has been admitted to the memory budget once, in place of the
+// old parts; every further part read from the file needs memory of its own,
+// and if there is not enough, the old version is kept as well.
+// INPUT: "const ManagedPart & managedPart" is the part that has been reread.
+// "qint64 numBytesReleased" is the memory of the old parts freed for the
+// rereading.
+// OUTPUT: The function returns "true" if the part has been replaced, and
+// "false" otherwise.
+//=============================================================================
+bool PartsModel::replaceManagedParts(const ManagedPart & managedPart, qint64 numBytesReleased)
+{
+    const QList<ManagedPart> oldParts = m_parts;
+    const double oldTotalVolume = m_totalVolume;
+    const BoxSize & newBox = managedPart.boxSize();
+    const qint64 numNewBytes = loadedMemorySize(*managedPart.part());
+    QList<int> partIndices;
+    qint64 numOldBytes = 0;
+    bool doRepack = false;
+    for (int i = 0; i < m_parts.size(); ++i)
+    {
+        if (m_parts[i].fileName() != managedPart.fileName())
+            continue;
+        const BoxSize & oldBox = m_parts[i].boxSize();
+        doRepack = doRepack || (newBox.x() > oldBox.x()) || (newBox.y() > oldBox.y()) || (newBox.z() > oldBox.z());
+        numOldBytes += loadedMemorySize(*m_parts[i].part());
+        partIndices.push_back(i);
+    }
+    if (partIndices.isEmpty() == true)
+    {
+        m_memoryBudget->release(numNewBytes);
+        return false;
+    }
+
+    // Free the memory of the old parts not freed yet, and reserve it back
+    // if the old parts are kept after all.
+    m_memoryBudget->release(numOldBytes - numBytesReleased);
+    if (m_memoryBudget->tryReserve((partIndices.size() - 1) * numNewBytes) == false)
+    {
+        m_memoryBudget->release(numNewBytes);
+        m_memoryBudget->reserve(numOldBytes);
+        emit loadingPartFailed(managedPart.fileName(), "The changed part " + managedPart.fileName() +
+                               " no longer fits in the memory budget along with the other parts.");
+        return false;
+    }
+
+    for (auto cit = partIndices.cbegin(); cit != partIndices.cend(); ++cit)
+    {
+        ManagedPart newPart = managedPart;
+        newPart.setDrawingPosition(m_parts[*cit].drawingPosition());
+        newPart.setDoRotateBeforeDrawing(m_parts[*cit].doRotateBeforeDrawing());
+        m_totalVolume += newPart.volume() - m_parts[*cit].volume();
+        m_parts[*cit] = newPart;
+    }
+
+    if ((doRepack == true) && (repack(m_minGapBetweenParts) == false))
+    {
+        m_memoryBudget->release(partIndices.size() * numNewBytes);
+        m_memoryBudget->reserve(numOldBytes);
+        m_parts = oldParts;
+        m_totalVolume = oldTotalVolume;
+        emit loadingPartFailed(managedPart.fileName(), "The changed part " + managedPart.fileName() +
+                               " no longer fits in the printing area along with the other parts.");
+        return false;
+    }
+    for (auto cit = partIndices.cbegin(); cit != partIndices.cend(); ++cit)
+        emit partReplaced(*cit);
+    return true;
 }
 
 
@@ -109,11 +1278,25 @@ void PartsModel::removePart(int partIndex)
 {
     if ((0 <= partIndex) && (partIndex < m_parts.size()))
     {
-        // Adjust the total volume.
+        // Adjust the total volume and release the memory of the part, as
+        // far as it has not been freed already for rereading its file.
+        const QString fileName = m_parts[partIndex].fileName();
         m_totalVolume -= m_parts[partIndex].volume();
+        qint64 numBytes = loadedMemorySize(*m_parts[partIndex].part());
+        for (auto it = m_pendingReloads.begin(); it != m_pendingReloads.end(); ++it)
+        {
+            if (it->fileName != fileName)
+                continue;
+            const qint64 numBytesFreed = qMin(numBytes, it->numBytesReleased);
+            it->numBytesReleased -= numBytesFreed;
+            numBytes -= numBytesFreed;
+        }
+        m_memoryBudget->release(numBytes);
 
-        // Remove the part.
+        // Remove the part, and stop watching its file unless other parts
+        // have been read from it.
         m_parts.removeAt(partIndex);
+        unwatchFile(fileName);
 
         emit partRemoved(partIndex);
     }
@@ -147,9 +1330,9 @@ void PartsModel::removeParts(const QSet<int> & partIndices)
 // INPUT: "const QSet<int> & indices" are the indices of the parts.
 // OUTPUT: The function returns total number of vertices of specified parts.
 //=============================================================================
-long int PartsModel::numVertices(const QSet<int> & indices) const
+qint64 PartsModel::numVertices(const QSet<int> & indices) const
 {
-    long int numVertices = 0;
+    qint64 numVertices = 0;
     for (auto i : indices)
     {
         numVertices += m_parts[i].part()->numVertices();
@@ -163,9 +1346,9 @@ long int PartsModel::numVertices(const QSet<int> & indices) const
 // parts in the model.
 // OUTPUT: The function returns total number of vertices.
 //=============================================================================
-long int PartsModel::totalNumVertices() const
+qint64 PartsModel::totalNumVertices() const
 {
-    long int numVertices = 0;
+    qint64 numVertices = 0;
     for (auto part : m_parts)
     {
         numVertices += part.part()->numVertices();
@@ -208,6 +1391,211 @@ double PartsModel::volume(const QSet<int> & indices) const
 }
 
 
+//=============================================================================
+// The function "numUntrustedVolumes" counts the parts of a collection whose
+// surfaces are open or inconsistently oriented, so that their volumes can not
+// be trusted.
+// INPUT: "const QSet<int> & indices" are the indices of the parts.
+// OUTPUT: The function returns the number of such parts.
+//=============================================================================
+int PartsModel::numUntrustedVolumes(const QSet<int> & indices) const
+{
+    int numUntrusted = 0;
+    for (auto i : indices)
+    {
+        if (m_parts[i].isVolumeTrusted() == false)
+            ++numUntrusted;
+    }
+    return numUntrusted;
+}
+
+
+//=============================================================================
+// The function "totalNumUntrustedVolumes" counts the parts in the model whose
+// volumes can not be trusted.
+// OUTPUT: The function returns the number of such parts.
+//=============================================================================
+int PartsModel::totalNumUntrustedVolumes() const
+{
+    int numUntrusted = 0;
+    for (const auto & part : m_parts)
+    {
+        if (part.isVolumeTrusted() == false)
+            ++numUntrusted;
+    }
+    return numUntrusted;
+}
+
+
+//=============================================================================
+// The function "writeStlPlate" writes parts, as they are placed in the master
+// box, to a single binary STL file. Every part is rotated and shifted into its
+// place while being written, so no merged copy of the parts is ever held in
+// memory. The parts are written in slices, between which the progress is
+// reported and cancellation checked. The file is written under a temporary
+// name and renamed once complete.
+// INPUT: "const QString & fileName" is the name of the file to be written to.
+// "const QList<ManagedPart> & parts" are the parts.
+// OUTPUT: "QString * errorMessage", if given, returns the reason of a
+// failure.
+// "LoadProgress * progress", if given, is advanced as the triangles are
+// written. Writing stops early if it gets canceled.
+// The function itself returns "false" if the file could not be written or
+// writing was canceled, and "true" otherwise.
+// NOTE: This is a non-member function.
+//=============================================================================
+static bool writeStlPlate(const QString & fileName, const QList<ManagedPart> & parts, QString * errorMessage,
+                          LoadProgress * progress)
+{
+    QElapsedTimer timer;
+    timer.start();
+    qint64 numTriangles = 0;
+    for (auto cit = parts.cbegin(); cit != parts.cend(); ++cit)
+        numTriangles += cit->part()->numTriangles();
+    if (progress != nullptr)
+        progress->setNumBytesTotal(binaryStlHeaderSize + binaryStlTriangleSize * numTriangles);
+
+    // Specify and open the file for writing.
+    QSaveFile file(fileName);
+    if (file.open(QIODevice::WriteOnly) == false)
+    {
+        if (errorMessage != nullptr)
+            *errorMessage = "Could not open the file " + fileName + " for writing: " + file.errorString();
+        return false;
+    }
+
+    // Write the parts one after another, each with its lower left corner
+    // moved to the origin. A rotated part is turned 90 degrees
+    // counterclockwise about that corner and then slid right until the corner
+    // is back at the origin, just as it is drawn.
+    StlBatchWriter writer(&file);
+    bool isSuccess = writer.writeHeader(numTriangles);
+    reportLoadProgress(progress, binaryStlHeaderSize, 0);
+    for (auto cit = parts.cbegin(); (cit != parts.cend()) && (isSuccess == true); ++cit)
+    {
+        const Part & part = *(cit->part());
+        QVector3D offset = cit->drawingPosition();
+        if (cit->doRotateBeforeDrawing() == true)
+            offset += QVector3D(cit->boxSize().y(), 0.0f, 0.0f);
+        for (qint64 first = 0; (first < part.numTriangles()) && (isSuccess == true); first += s_exportSliceSize)
+        {
+            const qint64 numSliceTriangles = qMin(part.numTriangles() - first, s_exportSliceSize);
+            isSuccess = (isLoadCanceled(progress) == false) &&
+                    (writer.writeTriangles(part.positionConstData(), part.indexConstData() + 3 * first,
+                                           part.faceNormalConstData() + first, numSliceTriangles, offset,
+                                           cit->doRotateBeforeDrawing(), cit->origin()) == true);
+            if (isSuccess == true)
+                reportLoadProgress(progress, binaryStlTriangleSize * numSliceTriangles, numSliceTriangles);
+        }
+    }
+    if ((isSuccess == false) || (writer.finish() == false) || (file.commit() == false))
+    {
+        if (errorMessage != nullptr)
+        {
+            if (isLoadCanceled(progress) == true)
+                *errorMessage = "Writing of " + fileName + " was canceled.";
+            else
+                *errorMessage = "Could not write the file " + fileName + ": " +
+                        ((writer.hasError() == true) ? writer.errorMessage() : file.errorString());
+        }
+        file.cancelWriting();
+        return false;
+    }
+
+    reportWritingThroughput(fileName, binaryStlHeaderSize + binaryStlTriangleSize * numTriangles,
+                            timer.nsecsElapsed());
+    return true;
+}
+
+
+//=============================================================================
+// The function "writePlate" writes parts, as they are placed in the master
+// box, to a single file: a 3MF file if its name ends with ".3mf", and a binary
+// STL file otherwise. Writing is refused if any part is held as a decimated
+// copy, as the file would silently get its coarser mesh. It runs on a worker
+// thread.
+// INPUT: "const QString & fileName" is the name of the file to be written to.
+// "QList<ManagedPart> parts" are the parts, copied so that the parts may be
+// repacked or removed meanwhile; the copies share the meshes of the parts.
+// "std::shared_ptr<LoadProgress> progress" tracks the progress of the writing
+// and receives the description of a failure.
+// OUTPUT: The function returns "false" if the file could not be written, a
+// part is decimated or writing was canceled, and "true" otherwise.
+// NOTE: This is a non-member function.
+//=============================================================================
+static bool writePlate(const QString & fileName, QList<ManagedPart> parts, std::shared_ptr<LoadProgress> progress)
+{
+    QString errorMessage;
+    bool isSuccess = false;
+    const QStringList decimated = decimatedFileNames(parts);
+    if (decimated.isEmpty() == false)
+        errorMessage = "The parts of the following files are decimated to fit in memory, and exporting "
+                       "them would write their coarser copies: " + decimated.join(", ");
+    else if (QFileInfo(fileName).suffix().compare("3mf", Qt::CaseInsensitive) == 0)
+        isSuccess = writeThreeMfFile(fileName, parts, &errorMessage, progress.get());
+    else
+        isSuccess = writeStlPlate(fileName, parts, &errorMessage, progress.get());
+    if (isSuccess == false)
+        reportLoadError(progress.get(), errorMessage);
+    return isSuccess;
+}
+
+
+//=============================================================================
+// The function "exportPlate" starts writing all parts, as they are placed in
+// the master box, to a single STL or 3MF file on a worker thread. Its
+// progress is signaled like that of reading parts. Nothing is started if a
+// plate is being exported already.
+// INPUT: "const QString & fileName" is the name of the file to be written to.
+//=============================================================================
+void PartsModel::exportPlate(const QString & fileName)
+{
+    if (isExporting() == true)
+        return;
+
+    m_exportFileName = fileName;
+    m_exportProgress = std::make_shared<LoadProgress>();
+    m_exportWatcher = new QFutureWatcher<bool>(this);
+    connect(m_exportWatcher, SIGNAL(finished()), this, SLOT(finishExporting()));
+    m_exportWatcher->setFuture(QtConcurrent::run(&m_loadThreadPool, writePlate, fileName, m_parts,
+                                                 m_exportProgress));
+    if (isLoading() == false)
+        m_progressTimer.start();
+    emit exportingStarted();
+}
+
+
+//=============================================================================
+// The function "cancelExporting" cancels writing the plate, if it is being
+// written. The file is left as it was.
+//=============================================================================
+void PartsModel::cancelExporting()
+{
+    if (m_exportProgress != nullptr)
+        m_exportProgress->cancel();
+}
+
+
+//=============================================================================
+// The function "finishExporting" signals the outcome of writing the plate on
+// a worker thread. A failure is not reported as such if the writing was
+// canceled on purpose. It runs on the GUI thread.
+//=============================================================================
+void PartsModel::finishExporting()
+{
+    const bool isSuccess = m_exportWatcher->result();
+    m_exportWatcher->deleteLater();
+    m_exportWatcher = nullptr;
+    std::shared_ptr<LoadProgress> progress;
+    progress.swap(m_exportProgress);
+    if (isLoading() == false)
+        m_progressTimer.stop();
+    const QString errorMessage = ((isSuccess == false) && (progress->isCanceled() == false)) ?
+                progress->errorMessage() : QString();
+    emit exportingFinished(m_exportFileName, isSuccess, errorMessage);
+}
+
+
 //=============================================================================
 // The function "resizeMasterBox" changes the size of the master box and
 // repacks the loaded parts, if possible.
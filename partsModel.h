@@ -11,17 +11,90 @@
 #define PARTS_MODEL_HEADER
 
 #include <QObject>
+#include <QByteArray>
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QHash>
 #include <QSet>
 #include <QList>
+#include <QStringList>
+#include <QFutureWatcher>
+#include <QThreadPool>
+#include <QTimer>
 #include <vector>   // vector
 #include <memory>   // shared_ptr
 #include <cassert>  // assert
 #include "boxSize.h"
 #include "managedPart.h"
+#include "loadProgress.h"
 
 using std::vector;
 
 class PartFactory;
+class GeometryCache;
+class MemoryBudget;
+
+//=============================================================================
+// This class holds a part being read on a worker thread.
+//=============================================================================
+struct PendingLoad
+{
+    QString fileName;                                          // name of the file being read
+    qint64 fileSize;                                           // size of the file when reading started
+    QDateTime lastModified;                                    // modification time of the file when reading started
+    std::shared_ptr<LoadProgress> progress;                    // progress of the reading
+    QFutureWatcher<std::shared_ptr<ManagedPart> > * watcher;   // watches the reading
+    bool isFinished;                                           // indicates if the reading has finished
+};
+
+//=============================================================================
+// This class describes a file loaded parts have been read from, as it was
+// when they were read.
+//=============================================================================
+struct WatchedFile
+{
+    QString fileName;         // name of the file
+    qint64 fileSize;          // size of the file
+    QDateTime lastModified;   // modification time of the file
+    QByteArray contentHash;   // hash of the contents of the file, or empty if not known yet
+};
+
+//=============================================================================
+// This class holds the result of rereading a file that has changed.
+//=============================================================================
+struct ReloadedPart
+{
+    WatchedFile file;                           // the file as it was reread
+    std::shared_ptr<ManagedPart> managedPart;   // part read, or null if the contents did not change or reading failed
+};
+
+//=============================================================================
+// This class holds a part being reread on a worker thread after its file
+// changed.
+//=============================================================================
+struct PendingReload
+{
+    QString fileName;                           // name of the file being reread
+    std::shared_ptr<LoadProgress> progress;     // progress of the reading
+    QFutureWatcher<ReloadedPart> * watcher;     // watches the reading
+    qint64 numBytesReleased;                    // memory of the parts read before, freed for the rereading
+};
+
+//=============================================================================
+// This class holds a part read ahead of time in the background, in case the
+// user is about to open it.
+//=============================================================================
+struct PrefetchedPart
+{
+    QString fileName;                                          // name of the file read
+    qint64 fileSize;                                           // size of the file when reading started
+    QDateTime lastModified;                                    // modification time of the file when reading started
+    std::shared_ptr<ManagedPart> managedPart;                  // part read, or null if not read (yet)
+    QFutureWatcher<std::shared_ptr<ManagedPart> > * watcher;   // watches the reading, or null once finished
+};
+
+// Default limit of the memory held by parts read ahead of time, in bytes.
+const qint64 defaultPrefetchMemoryLimit = Q_INT64_C(1024) * 1024 * 1024;
 
 class PartsModel : public QObject
 {
@@ -33,19 +106,43 @@ public:
 
     // Accessors.
     int numParts() const { return m_parts.size(); }
-    long int numVertices(int i) const { return m_parts[i].part()->numVertices(); }
-    long int numVertices(const QSet<int> & indices) const;
-    long int totalNumVertices() const;
+    qint64 numVertices(int i) const { return m_parts[i].part()->numVertices(); }
+    qint64 numVertices(const QSet<int> & indices) const;
+    qint64 totalNumVertices() const;
 
-    QVector<QVector3D>::const_iterator vertexBeginIter(int i) const { return m_parts[i].part()->vertexBeginIter(); }
-    QVector<QVector3D>::const_iterator vertexNormalBeginIter(int i) const { return m_parts[i].part()->vertexNormalBeginIter(); }
+    const QVector3D * positionBeginIter(int i) const { return m_parts[i].part()->positionConstData(); }
+    const QVector3D & origin(int i) const { return m_parts[i].origin(); }
+    const quint32 * indexBeginIter(int i) const { return m_parts[i].part()->indexConstData(); }
+    const PackedNormal * faceNormalBeginIter(int i) const { return m_parts[i].part()->faceNormalConstData(); }
+    const PackedNormal * vertexNormalBeginIter(int i) const { return m_parts[i].part()->vertexNormalConstData(); }
 
     BoxSize masterBox() const { return m_masterBox; }
     std::vector<BoxSize> boxes() const;
     double volume(int i) const { assert((0 <= i) && (i < m_parts.size())); return m_parts[i].volume(); }
     double volume(const QSet<int> & indices) const;
     double totalVolume() const { return m_totalVolume; }
+    const MeshIntegrity & integrity(int i) const { return m_parts[i].integrity(); }
+    bool isVolumeTrusted(int i) const { return m_parts[i].isVolumeTrusted(); }
+    int numUntrustedVolumes(const QSet<int> & indices) const;
+    int totalNumUntrustedVolumes() const;
     float minGapBetweenParts() const { return m_minGapBetweenParts; }
+    qint64 geometryCacheMaxSize() const;
+    qint64 prefetchMemoryLimit() const { return m_prefetchMemoryLimit; }
+    qint64 memoryBudget() const;
+    qint64 memoryUsed() const;
+    qint64 memorySize(int i) const;
+    bool doDecimateOverBudget() const { return m_doDecimateOverBudget; }
+    float weldTolerance() const;
+    float creaseAngle() const;
+
+    // A filter for file dialogs listing the supported file formats.
+    QString fileDialogFilter() const;
+
+    // Indicates if any part is being read.
+    bool isLoading() const { return m_pendingLoads.isEmpty() == false; }
+
+    // Indicates if the plate is being exported.
+    bool isExporting() const { return m_exportWatcher != nullptr; }
 
     const BoxSize & boxSize(int i) const { return m_parts[i].boxSize(); }
     const Position & position(int i) const { return m_parts[i].drawingPosition(); }
@@ -54,24 +151,79 @@ public:
 public slots:
     bool repack(double minGapBetweenParts);
     void addPart(const QString & fileName);
+    void addParts(const QStringList & fileNames);
+    void cancelLoading();
+    void exportPlate(const QString & fileName);
+    void cancelExporting();
     void removePart(int partIndex);
     void removeParts(const QSet<int> & partIndices);
     void setMinGapBetweenParts(float minGapBetweenParts) { m_minGapBetweenParts = minGapBetweenParts; }
     void updateMinimalGap(double minGap) { m_minGapBetweenParts = static_cast<float>(minGap); }
+    void setGeometryCacheMaxSize(qint64 maxSize);
+    void prefetchParts(const QStringList & fileNames);
+    void cancelPrefetching();
+    void setPrefetchMemoryLimit(qint64 memoryLimit) { m_prefetchMemoryLimit = memoryLimit; }
+    void setMemoryBudget(qint64 memoryBudget);
+    void setDoDecimateOverBudget(bool doDecimate) { m_doDecimateOverBudget = doDecimate; }
+    void setWeldTolerance(float tolerance);
+    void setCreaseAngle(float creaseAngle);
     void resizeMasterBox(BoxSize newMasterSize);
 
 signals:
     void partAdded();
+    void partReplaced(int partIndex);
     void addingPartFailed();
+    void loadingStarted();
+    void loadingProgressed(qint64 numBytesRead, qint64 numBytesTotal, qint64 numTrianglesRead);
+    void loadingPartFailed(const QString & fileName, const QString & errorMessage);
+    void loadingPartDecimated(const QString & fileName, qint64 numTriangles);
+    void loadingFinished();
+    void exportingStarted();
+    void exportingProgressed(qint64 numBytesWritten, qint64 numBytesTotal, qint64 numTrianglesWritten);
+    void exportingFinished(const QString & fileName, bool isSuccess, const QString & errorMessage);
     void partRemoved(int partIndex);
     void repackingFailed();
     void resettingGapNeeded(double value);
     void masterBoxResized();
 
+private slots:
+    void finishLoading();
+    void reportLoadingProgress();
+    void finishPrefetching();
+    void scheduleReload(const QString & fileName);
+    void reloadChangedFiles();
+    void finishReloading();
+    void finishHashing();
+    void finishExporting();
+
 private:
+    void addManagedParts(const QList<ManagedPart> & managedParts);
+    std::shared_ptr<ManagedPart> takePrefetchedPart(const QString & fileName);
+    void watchFile(const WatchedFile & file);
+    void unwatchFile(const QString & fileName);
+    bool replaceManagedParts(const ManagedPart & managedPart, qint64 numBytesReleased);
+
     BoxSize m_masterBox;
     PartFactory * m_partFactory;
+    GeometryCache * m_geometryCache;     // prepared geometry of parts read before
+    MemoryBudget * m_memoryBudget;       // memory taken by the parts, loaded or being read
+    bool m_doDecimateOverBudget;         // indicates if parts over budget are decimated rather than refused
     QList<ManagedPart> m_parts;
+    QList<PendingLoad> m_pendingLoads;   // parts being read, in the order requested
+    QThreadPool m_loadThreadPool;        // threads reading the files, a few at a time
+    QTimer m_progressTimer;              // triggers progress reports while reading
+    QList<PrefetchedPart> m_prefetchedParts;            // parts read ahead of time
+    std::shared_ptr<LoadProgress> m_prefetchProgress;   // progress of reading ahead, shared by all parts
+    QThreadPool m_prefetchThreadPool;                   // single thread reading ahead
+    qint64 m_prefetchMemoryLimit;                       // limit of the memory held by parts read ahead
+    QFileSystemWatcher m_fileWatcher;                   // watches the files of the loaded parts for changes
+    QHash<QString, WatchedFile> m_watchedFiles;         // files of the loaded parts, by name
+    QSet<QString> m_changedFiles;                       // files changed since the last rereading
+    QTimer m_reloadTimer;                               // delays rereading until the files are written
+    QList<PendingReload> m_pendingReloads;              // parts being reread after their files changed
+    QString m_exportFileName;                           // name of the file the plate is exported to
+    std::shared_ptr<LoadProgress> m_exportProgress;     // progress of exporting the plate
+    QFutureWatcher<bool> * m_exportWatcher;             // watches the exporting, or null if not exporting
     double m_totalVolume;
     float m_minGapBetweenParts;
 };
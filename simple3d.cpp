@@ -11,16 +11,28 @@
 #include "partsModel.h"
 #include "openGLWidget.h"
 #include "dimEditDialog.h"
+#include "geometryCache.h"
+#include "memoryBudget.h"
+#include "normalSmoothing.h"
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QString>
 #include <QMessageBox>
+#include <QProgressBar>
+#include <QPushButton>
 #include <QSettings>
 #include <QCloseEvent>
+#include <QTimer>
+
+// Delay after startup before the most recent files are read ahead, in
+// milliseconds, so that the window is up and idle by then.
+static const int s_prefetchDelay = 500;
+// Default number of the most recent files read ahead at startup.
+static const int s_numPrefetchedFiles = 3;
 
 
 // Constructor.
-Simple3D::Simple3D(PartsModel * partsModel) : m_partsModel(partsModel)
+Simple3D::Simple3D(PartsModel * partsModel) : m_partsModel(partsModel), m_numPrefetchedFiles(s_numPrefetchedFiles)
 {
     // Set up the GUI as designed in the Qt Designer.
     setupUi(this);
@@ -39,10 +51,20 @@ Simple3D::Simple3D(PartsModel * partsModel) : m_partsModel(partsModel)
     // Disable the "unload" button.
     unloadPushButton->setEnabled(false);
 
+    // Add a progress bar and a cancel button for reading parts and exporting
+    // the plate to the status bar. Both are shown only while either runs.
+    m_loadProgressBar = new QProgressBar(this);
+    m_loadProgressBar->setMaximumWidth(200);
+    m_loadProgressBar->setVisible(false);
+    statusbar->addPermanentWidget(m_loadProgressBar);
+    m_cancelLoadButton = new QPushButton(tr("Cancel"), this);
+    m_cancelLoadButton->setVisible(false);
+    statusbar->addPermanentWidget(m_cancelLoadButton);
+
     // Launch browsing for a part file.
     connect(loadPushButton, SIGNAL(clicked()), actionLoad, SIGNAL(triggered()));
-    // Add the selected part file.
-    connect(this, SIGNAL(partFileSelected(const QString &)), m_partsModel, SLOT(addPart(const QString &)));
+    // Add the selected part files.
+    connect(this, SIGNAL(partFilesSelected(const QStringList &)), m_partsModel, SLOT(addParts(const QStringList &)));
     // Remove the currently selected parts.
     connect(unloadPushButton, SIGNAL(clicked()), actionUnload, SIGNAL(triggered()));
     // Restore the focus on the drawings.
@@ -55,8 +77,32 @@ Simple3D::Simple3D(PartsModel * partsModel) : m_partsModel(partsModel)
     // Update the list of buffers once a part is added or removed.
     connect(m_partsModel, SIGNAL(partAdded()), m_openGLWidget, SLOT(addBuffer()));
     connect(m_partsModel, SIGNAL(partRemoved(int)), m_openGLWidget, SLOT(removeBuffer(int)));
+    // Update the GUI and the buffers of a part once it is reread after its
+    // file changed.
+    connect(m_partsModel, SIGNAL(partReplaced(int)), this, SLOT(updateGui()));
+    connect(m_partsModel, SIGNAL(partReplaced(int)), m_openGLWidget, SLOT(replaceBuffer(int)));
     // Invoke a message box when a new part can not be fit.
     connect(m_partsModel, SIGNAL(addingPartFailed()), this, SLOT(informOfPartFailure()));
+    // Invoke a message box when a new part can not be read.
+    connect(m_partsModel, SIGNAL(loadingPartFailed(const QString &, const QString &)),
+            this, SLOT(informOfLoadingFailure(const QString &, const QString &)));
+    // Invoke a message box when a new part is decimated to fit in memory.
+    connect(m_partsModel, SIGNAL(loadingPartDecimated(const QString &, qint64)),
+            this, SLOT(informOfDecimation(const QString &, qint64)));
+
+    // Show the progress of reading parts, and let the user cancel it.
+    connect(m_partsModel, SIGNAL(loadingStarted()), this, SLOT(showLoadingStarted()));
+    connect(m_partsModel, SIGNAL(loadingProgressed(qint64, qint64, qint64)),
+            this, SLOT(showLoadingProgress(qint64, qint64, qint64)));
+    connect(m_partsModel, SIGNAL(loadingFinished()), this, SLOT(showLoadingFinished()));
+    connect(m_cancelLoadButton, SIGNAL(clicked()), m_partsModel, SLOT(cancelLoading()));
+    // Show the progress of exporting the plate the same way.
+    connect(m_partsModel, SIGNAL(exportingStarted()), this, SLOT(showExportingStarted()));
+    connect(m_partsModel, SIGNAL(exportingProgressed(qint64, qint64, qint64)),
+            this, SLOT(showExportingProgress(qint64, qint64, qint64)));
+    connect(m_partsModel, SIGNAL(exportingFinished(const QString &, bool, const QString &)),
+            this, SLOT(showExportingFinished(const QString &, bool, const QString &)));
+    connect(m_cancelLoadButton, SIGNAL(clicked()), m_partsModel, SLOT(cancelExporting()));
 
     // Enable the "Unload" button when a part is selected.
     connect(m_openGLWidget, SIGNAL(selectedPartsChanged()), this, SLOT(enableOrDisableUnloadButton()));
@@ -76,6 +122,9 @@ Simple3D::Simple3D(PartsModel * partsModel) : m_partsModel(partsModel)
 
     // Connect menu actions to the corresponding slots that actually do the work.
     connectMenuActions();
+
+    // Start reading the most recent files ahead once the window is up.
+    QTimer::singleShot(s_prefetchDelay, this, SLOT(prefetchRecentFiles()));
 }
 
 
@@ -88,45 +137,86 @@ Simple3D::~Simple3D()
 
 
 //=============================================================================
-// The function "browseForPartFile" opens a file dialog allowing the user to
-// select a part file.
+// The function "browseForPartFiles" opens a file dialog allowing the user to
+// select one or more part files.
 //=============================================================================
-void Simple3D::browseForPartFile()
+void Simple3D::browseForPartFiles()
 {
-    // Open a dialog allowing the user to select a source file.
-    QString partFileName = QFileDialog::getOpenFileName(
-                this, tr("Open File"), m_lastSourceDir, tr("STL (*.stl)"));
+    // Open a dialog allowing the user to select source files.
+    QStringList partFileNames = QFileDialog::getOpenFileNames(
+                this, tr("Open Files"), m_lastSourceDir, m_partsModel->fileDialogFilter());
 
     // If no source was selected, then there is nothing to do.
-    if (partFileName.isNull() == true)
+    if (partFileNames.isEmpty() == true)
         return;
 
     // Store the last source directory.
-    m_lastSourceDir = QFileInfo(partFileName).dir().absolutePath();
+    m_lastSourceDir = QFileInfo(partFileNames.first()).dir().absolutePath();
 
-    // Add the source to the list of recent files.
-    m_recentFilesMenu->addFile(partFileName);
+    // Add the sources to the list of recent files.
+    for (auto cit = partFileNames.cbegin(); cit != partFileNames.cend(); ++cit)
+        m_recentFilesMenu->addFile(*cit);
 
-    // Emit signal that a part file is selected.
-    emit partFileSelected(partFileName);
+    // Emit signal that part files are selected.
+    emit partFilesSelected(partFileNames);
+}
+
+
+//=============================================================================
+// The function "exportPlate" asks the user for a file name and starts writing
+// all loaded parts, as they are packed in the workspace, to a single STL or
+// 3MF file in the background.
+//=============================================================================
+void Simple3D::exportPlate()
+{
+    if (m_partsModel->isExporting() == true)
+        return;
+
+    // Open a dialog allowing the user to name the file and pick its format.
+    const QString stlFilter = tr("STL files (*.stl)");
+    const QString threeMfFilter = tr("3MF files (*.3mf)");
+    QString selectedFilter = stlFilter;
+    QString fileName = QFileDialog::getSaveFileName(
+                this, tr("Export Plate"), m_lastSourceDir, stlFilter + ";;" + threeMfFilter, &selectedFilter);
+
+    // If no file was named, then there is nothing to do.
+    if (fileName.isEmpty() == true)
+        return;
+    // The format is told by the extension, which is added if missing.
+    if (QFileInfo(fileName).suffix().isEmpty() == true)
+        fileName += (selectedFilter == threeMfFilter) ? ".3mf" : ".stl";
+
+    m_partsModel->exportPlate(fileName);
 }
 
 
 //=============================================================================
 // The function "updateGui" updates the labels showing volume and number of
-// triangles.
+// triangles. A volume including parts that are open or inconsistently
+// oriented, whose computed volumes mean little, is marked with an asterisk.
 //=============================================================================
 void Simple3D::updateGui()
 {
     QLocale locale;
+    const int numUntrustedSelected = m_partsModel->numUntrustedVolumes(m_openGLWidget->selectedParts());
+    const int numUntrusted = m_partsModel->totalNumUntrustedVolumes();
     volumeValueLabel->setText(locale.toString(m_partsModel->volume(m_openGLWidget->selectedParts()), 'f', 1) +
+                              ((numUntrustedSelected > 0) ? QStringLiteral("*") : QString()) +
                               QStringLiteral("/") +
                               locale.toString(m_partsModel->totalVolume(), 'f', 1) +
+                              ((numUntrusted > 0) ? QStringLiteral("*") : QString()) +
                               QStringLiteral(" mL"));
+    volumeValueLabel->setToolTip((numUntrusted > 0) ?
+            tr("%n part(s) have holes, edges shared by more than two triangles, or triangles facing the "
+               "wrong way, so the volumes marked with * can not be trusted.", nullptr, numUntrusted) :
+            QString());
     facesValueLabel->setText(QStringLiteral("%L1").arg(m_partsModel->numVertices(m_openGLWidget->selectedParts()) / 3) +
                              QStringLiteral("/") +
                              QStringLiteral("%L1").arg(m_partsModel->totalNumVertices() / 3));
     gapDoubleSpinBox->setValue(m_partsModel->minGapBetweenParts());
+    // There is a plate to export only once a part is loaded, and one plate is
+    // exported at a time.
+    actionExportPlate->setEnabled((m_partsModel->numParts() > 0) && (m_partsModel->isExporting() == false));
 }
 
 
@@ -190,21 +280,168 @@ void Simple3D::informOfFailureToRepackAll() const
 }
 
 
+//=============================================================================
+// The function "informOfLoadingFailure" opens a message box to inform the user
+// that a part file could not be read.
+// INPUT: "const QString & fileName" is the name of the file.
+// "const QString & errorMessage" describes the failure.
+//=============================================================================
+void Simple3D::informOfLoadingFailure(const QString & fileName, const QString & errorMessage) const
+{
+    QString text = "The file " + fileName + " could not be read.\n\n" + errorMessage;
+    QMessageBox messageBox(QMessageBox::Warning, QStringLiteral("Read Error"), text, QMessageBox::Ok);
+    messageBox.exec();
+}
+
+
+//=============================================================================
+// The function "informOfDecimation" opens a message box to inform the user
+// that a part has been replaced by a coarser copy to fit in the memory
+// budget.
+// INPUT: "const QString & fileName" is the name of the file of the part.
+// "qint64 numTriangles" is the number of triangles of the coarser copy.
+//=============================================================================
+void Simple3D::informOfDecimation(const QString & fileName, qint64 numTriangles) const
+{
+    QString text = "The part in the file " + fileName + " does not fit in the memory budget, "
+                   "so it has been simplified to " + QString::number(numTriangles) + " triangles.\n\n"
+                   "Unload some parts and load it again to see it in full detail.";
+    QMessageBox messageBox(QMessageBox::Information, QStringLiteral("Part Simplified"), text, QMessageBox::Ok);
+    messageBox.exec();
+}
+
+
+//=============================================================================
+// The function "showLoadingStarted" shows the progress bar and the cancel
+// button once parts start being read.
+//=============================================================================
+void Simple3D::showLoadingStarted()
+{
+    m_loadProgressBar->setRange(0, 0);
+    m_loadProgressBar->setVisible(true);
+    m_cancelLoadButton->setVisible(true);
+}
+
+
+//=============================================================================
+// The function "showLoadingProgress" shows the progress of reading parts.
+// INPUT: "qint64 numBytesRead" is the number of bytes processed so far.
+// "qint64 numBytesTotal" is the number of bytes to be processed, 0 if still
+// unknown.
+// "qint64 numTrianglesRead" is the number of triangles read so far.
+//=============================================================================
+void Simple3D::showLoadingProgress(qint64 numBytesRead, qint64 numBytesTotal, qint64 numTrianglesRead)
+{
+    // Show a busy indicator until the size of the data is known.
+    if (numBytesTotal <= 0)
+        m_loadProgressBar->setRange(0, 0);
+    else
+    {
+        m_loadProgressBar->setRange(0, 1000);
+        m_loadProgressBar->setValue(static_cast<int>(1000 * qMin(numBytesRead, numBytesTotal) / numBytesTotal));
+    }
+    statusbar->showMessage(QStringLiteral("Reading... %L1 triangles").arg(numTrianglesRead));
+}
+
+
+//=============================================================================
+// The function "showLoadingFinished" hides the progress bar and the cancel
+// button once all parts are read.
+//=============================================================================
+void Simple3D::showLoadingFinished()
+{
+    if (m_partsModel->isExporting() == true)
+        return;
+    m_loadProgressBar->setVisible(false);
+    m_cancelLoadButton->setVisible(false);
+    statusbar->clearMessage();
+}
+
+
+//=============================================================================
+// The function "showExportingStarted" shows the progress bar and the cancel
+// button once the plate starts being exported, and disables exporting another
+// one meanwhile.
+//=============================================================================
+void Simple3D::showExportingStarted()
+{
+    actionExportPlate->setEnabled(false);
+    m_loadProgressBar->setRange(0, 0);
+    m_loadProgressBar->setVisible(true);
+    m_cancelLoadButton->setVisible(true);
+}
+
+
+//=============================================================================
+// The function "showExportingProgress" shows the progress of exporting the
+// plate, unless parts are being read, whose progress is shown instead.
+// INPUT: "qint64 numBytesWritten" is the number of bytes written so far.
+// "qint64 numBytesTotal" is the number of bytes to be written, 0 if not known
+// in advance.
+// "qint64 numTrianglesWritten" is the number of triangles written so far.
+//=============================================================================
+void Simple3D::showExportingProgress(qint64 numBytesWritten, qint64 numBytesTotal, qint64 numTrianglesWritten)
+{
+    if (m_partsModel->isLoading() == true)
+        return;
+    if (numBytesTotal <= 0)
+        m_loadProgressBar->setRange(0, 0);
+    else
+    {
+        m_loadProgressBar->setRange(0, 1000);
+        m_loadProgressBar->setValue(static_cast<int>(1000 * qMin(numBytesWritten, numBytesTotal) / numBytesTotal));
+    }
+    statusbar->showMessage(QStringLiteral("Writing... %L1 triangles").arg(numTrianglesWritten));
+}
+
+
+//=============================================================================
+// The function "showExportingFinished" hides the progress bar and the cancel
+// button once the plate is exported, unless parts are still being read, and
+// informs the user of a failure.
+// INPUT: "const QString & fileName" is the name of the file written to.
+// "bool isSuccess" indicates if the file has been written.
+// "const QString & errorMessage" describes the failure, empty if the
+// exporting was canceled.
+//=============================================================================
+void Simple3D::showExportingFinished(const QString & fileName, bool isSuccess, const QString & errorMessage)
+{
+    actionExportPlate->setEnabled(m_partsModel->numParts() > 0);
+    if (m_partsModel->isLoading() == false)
+    {
+        m_loadProgressBar->setVisible(false);
+        m_cancelLoadButton->setVisible(false);
+        statusbar->clearMessage();
+    }
+    if ((isSuccess == false) && (errorMessage.isEmpty() == false))
+    {
+        QString text = "The plate could not be exported to " + fileName + ".\n\n" + errorMessage;
+        QMessageBox messageBox(QMessageBox::Warning, QStringLiteral("Write Error"), text, QMessageBox::Ok);
+        messageBox.exec();
+    }
+}
+
+
 //=============================================================================
 // The function "connectMenuActions" connects menu actions to the corresponding
 // slots that actually do the work.
 //=============================================================================
 void Simple3D::connectMenuActions()
 {
-    // Load an STL file.
-    actionLoad->setStatusTip(tr("Load an STL file"));
+    // Load part files.
+    actionLoad->setStatusTip(tr("Load one or more part files"));
     actionLoad->setIcon(QApplication::style()->standardIcon(QStyle::SP_FileDialogStart));
-    connect(actionLoad, SIGNAL(triggered()), this, SLOT(browseForPartFile()));
+    connect(actionLoad, SIGNAL(triggered()), this, SLOT(browseForPartFiles()));
 
     // Unload selected models.
     actionUnload->setStatusTip(tr("Unload selected models"));
     connect(actionUnload, SIGNAL(triggered()), this, SLOT(removeSelectedParts()));
 
+    // Export the packed parts.
+    actionExportPlate->setStatusTip(tr("Export the packed parts to a single STL or 3MF file"));
+    actionExportPlate->setIcon(QApplication::style()->standardIcon(QStyle::SP_DialogSaveButton));
+    connect(actionExportPlate, SIGNAL(triggered()), this, SLOT(exportPlate()));
+
     // Access recent files menu.
     actionRecentFiles->setMenu(m_recentFilesMenu);
     connect(m_recentFilesMenu, SIGNAL(sourceSelected(const QString &)), m_partsModel, SLOT(addPart(const QString &)));
@@ -269,6 +506,13 @@ void Simple3D::writeSettings()
     settings.setValue("recentFilesList", m_recentFilesMenu->files());
     settings.setValue("masterBox", m_partsModel->masterBox());
     settings.setValue("minGapBetweenParts", m_partsModel->minGapBetweenParts());
+    settings.setValue("geometryCacheMaxSize", m_partsModel->geometryCacheMaxSize());
+    settings.setValue("numPrefetchedFiles", m_numPrefetchedFiles);
+    settings.setValue("prefetchMemoryLimit", m_partsModel->prefetchMemoryLimit());
+    settings.setValue("memoryBudget", m_partsModel->memoryBudget());
+    settings.setValue("doDecimateOverBudget", m_partsModel->doDecimateOverBudget());
+    settings.setValue("weldTolerance", m_partsModel->weldTolerance());
+    settings.setValue("creaseAngle", m_partsModel->creaseAngle());
     settings.endGroup();
 }
 
@@ -295,10 +539,38 @@ void Simple3D::readSettings()
     m_partsModel->resizeMasterBox(BoxSize(v.value<QVector3D>()));
     // Set the munimal gap between parts.
     m_partsModel->setMinGapBetweenParts(settings.value("minGapBetweenParts", 1.0f).toFloat());
+    // Set the limit of the size of the geometry cache; 0 disables it.
+    m_partsModel->setGeometryCacheMaxSize(settings.value("geometryCacheMaxSize",
+                                                         defaultGeometryCacheMaxSize).toLongLong());
+    // Set how many recent files are read ahead at startup, and the limit of
+    // the memory they may hold; 0 disables reading ahead.
+    m_numPrefetchedFiles = settings.value("numPrefetchedFiles", s_numPrefetchedFiles).toInt();
+    m_partsModel->setPrefetchMemoryLimit(settings.value("prefetchMemoryLimit",
+                                                        defaultPrefetchMemoryLimit).toLongLong());
+    // Set the limit of the memory the parts may take, by default half of the
+    // physical memory, and whether parts over it are decimated or refused.
+    m_partsModel->setMemoryBudget(settings.value("memoryBudget", defaultMemoryBudget()).toLongLong());
+    m_partsModel->setDoDecimateOverBudget(settings.value("doDecimateOverBudget", true).toBool());
+    // Set the tolerance within which the vertices of the parts read are
+    // welded; 0 welds only the vertices at exactly the same position.
+    m_partsModel->setWeldTolerance(settings.value("weldTolerance", 0.0f).toFloat());
+    m_partsModel->setCreaseAngle(settings.value("creaseAngle", defaultCreaseAngle).toFloat());
     settings.endGroup();
 }
 
 
+//=============================================================================
+// The function "prefetchRecentFiles" starts reading the most recent files
+// ahead of time in the background, as the user is likely to reopen one of
+// them. Opening any file cancels it.
+//=============================================================================
+void Simple3D::prefetchRecentFiles()
+{
+    if (m_numPrefetchedFiles > 0)
+        m_partsModel->prefetchParts(m_recentFilesMenu->files().mid(0, m_numPrefetchedFiles));
+}
+
+
 //=============================================================================
 // The function "closeEvent" finishes everything that needs to be done before
 // the application is closed (e.g., updates and saves preferences, saves the
@@ -310,6 +582,9 @@ void Simple3D::closeEvent(QCloseEvent *event)
 {
     // Save the current settings.
     writeSettings();
+    // Stop reading parts.
+    m_partsModel->cancelLoading();
+    m_partsModel->cancelPrefetching();
     // Accept the close event, i.e., the application is going to close.
     event->accept();
 }
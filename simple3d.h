@@ -20,6 +20,8 @@ namespace Ui { class Simple3D; }
 
 class OpenGLWidget;
 class PartsModel;
+class QProgressBar;
+class QPushButton;
 
 class Simple3D : public QMainWindow, private Ui::Simple3D
 {
@@ -30,22 +32,32 @@ public:
     ~Simple3D();
 
 signals:
-    void partFileSelected(const QString & partFileName);
+    void partFilesSelected(const QStringList & partFileNames);
     void workspaceResized(BoxSize newSize);
 
 public slots:
-    void browseForPartFile();
+    void browseForPartFiles();
+    void exportPlate();
     void updateGui();
     void removeSelectedParts();
     void enableOrDisableUnloadButton();
     void informOfPartFailure() const;
     void informOfFailureToRepackAll() const;
+    void informOfLoadingFailure(const QString & fileName, const QString & errorMessage) const;
+    void informOfDecimation(const QString & fileName, qint64 numTriangles) const;
+    void showLoadingStarted();
+    void showLoadingProgress(qint64 numBytesRead, qint64 numBytesTotal, qint64 numTrianglesRead);
+    void showLoadingFinished();
+    void showExportingStarted();
+    void showExportingProgress(qint64 numBytesWritten, qint64 numBytesTotal, qint64 numTrianglesWritten);
+    void showExportingFinished(const QString & fileName, bool isSuccess, const QString & errorMessage);
     void resizeWorkspace();
 
 private slots:
     void openAbout();
     void writeSettings();
     void readSettings();
+    void prefetchRecentFiles();
 
 private: // member functions
     void connectMenuActions();
@@ -56,6 +68,9 @@ private: // member variables
     PartsModel * m_partsModel;
     QString m_lastSourceDir;
     RecentFilesQMenu * m_recentFilesMenu;     // recent files menu
+    QProgressBar * m_loadProgressBar;         // progress of reading parts or exporting the plate
+    QPushButton * m_cancelLoadButton;         // cancels reading parts or exporting the plate
+    int m_numPrefetchedFiles;                 // number of recent files read ahead at startup
     QMessageBox m_aboutBox;
 };
 
@@ -0,0 +1,250 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "stlBatchReader.h"
+#include "asciiStlParser.h"
+#include "partStl.h"
+#include "textParsing.h"
+
+#include <QIODevice>
+#include <QtEndian>
+#include <algorithm>  // count
+#include <cstring>    // memcpy
+
+// Number of bytes read from the beginning of the device to detect the format.
+static const qint64 s_prefixSize = 512;
+// Number of bytes requested from the device at once when reading ascii text.
+static const int s_asciiReadSize = 1024 * 1024;
+// Size of ascii text without any facet start beyond which it is parsed anyway.
+static const int s_maxAsciiBufferSize = 16 * 1024 * 1024;
+
+// Constructor.
+StlBatchReader::StlBatchReader(QIODevice * device, int batchSize)
+    : m_device(device), m_batchSize(qMax(batchSize, 1)), m_isAscii(false),
+      m_atEnd(false), m_isDeviceAtEnd(false), m_errorMessage(),
+      m_numTrianglesExpected(-1), m_numTrianglesRead(0), m_numBytesRead(0),
+      m_buffer(), m_bufferPos(0), m_numLinesDiscarded(0)
+{}
+
+
+//=============================================================================
+// The function "readHeader" reads the beginning of the device and detects if
+// it holds a binary or an ascii STL file (see "detectStlFormat"). For a
+// binary file, the 80-byte header and the number of triangles are consumed;
+// for an ascii file, the "solid" line is.
+// OUTPUT: The function returns "false" if the header can not be read and
+// "true" otherwise.
+//=============================================================================
+bool StlBatchReader::readHeader()
+{
+    // Read in the beginning of the device.
+    m_buffer.resize(static_cast<int>(s_prefixSize));
+    const qint64 numRead = readFully(m_buffer.data(), s_prefixSize);
+    m_buffer.resize(static_cast<int>(numRead));
+    m_isDeviceAtEnd = (numRead < s_prefixSize);
+
+    // Detect the format, validating the size of a binary file if known.
+    const qint64 deviceSize = (m_device->isSequential() == true) ? -1 : m_device->size();
+    const StlFormat format = detectStlFormat(m_buffer, deviceSize);
+    m_isAscii = (format == StlFormat::Ascii);
+    if (m_isAscii == true)
+    {
+        // Make sure the whole "solid" line is in the buffer.
+        while ((m_isDeviceAtEnd == false) && (m_buffer.indexOf('\n') < 0))
+            fillBuffer();
+        AsciiStlParser lineParser(m_buffer.constData(), m_buffer.constData() + m_buffer.size());
+        lineParser.parseHeader();
+        m_bufferPos = static_cast<int>(lineParser.position() - m_buffer.constData());
+        return hasError() == false;
+    }
+
+    // Read in the number of triangles of a binary file, keeping the bytes
+    // after the header for the first batch.
+    if (format == StlFormat::Unknown)
+        return fail("The binary STL header is incomplete.");
+    quint32 numTriangles;
+    memcpy(&numTriangles, m_buffer.constData() + 80, sizeof(numTriangles));
+    m_numTrianglesExpected = qFromLittleEndian(numTriangles);
+    m_bufferPos = static_cast<int>(binaryStlHeaderSize);
+    m_atEnd = (m_numTrianglesExpected == 0);
+    return true;
+}
+
+
+//=============================================================================
+// The function "readNextBatch" reads the next batch of triangles.
+// OUTPUT: "StlTriangleBatch & batch" returns the triangles. Its vectors are
+// reused so that passing the same batch repeatedly does not reallocate.
+// The function itself returns "false" if there are no more triangles or an
+// error occurred (see "hasError"), and "true" otherwise.
+//=============================================================================
+bool StlBatchReader::readNextBatch(StlTriangleBatch & batch)
+{
+    batch.firstTriangle = m_numTrianglesRead;
+    batch.normals.resize(0);
+    batch.vertices.resize(0);
+    if ((m_atEnd == true) || (hasError() == true))
+        return false;
+
+    bool isSuccess = (m_isAscii == true) ? readAsciiBatch(batch) : readBinaryBatch(batch);
+    m_numTrianglesRead += batch.numTriangles();
+    return (isSuccess == true) && (batch.numTriangles() > 0);
+}
+
+
+//=============================================================================
+// The function "readBinaryBatch" reads and decodes the next batch of binary
+// triangle records.
+// OUTPUT: "StlTriangleBatch & batch" returns the triangles.
+// The function itself returns "false" if the device ends prematurely and
+// "true" otherwise.
+//=============================================================================
+bool StlBatchReader::readBinaryBatch(StlTriangleBatch & batch)
+{
+    // Read in the records of the batch after the bytes left in the buffer.
+    const qint64 numTriangles = qMin(qint64(m_batchSize), m_numTrianglesExpected - m_numTrianglesRead);
+    const int numBytes = static_cast<int>(numTriangles * binaryStlTriangleSize);
+    m_buffer.remove(0, m_bufferPos);
+    m_bufferPos = 0;
+    qint64 numAvailable = m_buffer.size();
+    if (numAvailable < numBytes)
+    {
+        m_buffer.resize(numBytes);
+        numAvailable += readFully(m_buffer.data() + numAvailable, numBytes - numAvailable);
+    }
+    if (numAvailable < numBytes)
+        return fail(QString("The binary STL file ends after %1 of %2 triangles.")
+                    .arg(m_numTrianglesRead + numAvailable / binaryStlTriangleSize)
+                    .arg(m_numTrianglesExpected));
+    m_bufferPos = numBytes;
+
+    // Decode them.
+    batch.normals.resize(numTriangles);
+    batch.vertices.resize(3 * numTriangles);
+    decodeBinaryStlTriangles(reinterpret_cast<const uchar *>(m_buffer.constData()), 0, numTriangles,
+                             batch.normals.data(), batch.vertices.data());
+    m_atEnd = (m_numTrianglesRead + numTriangles == m_numTrianglesExpected);
+    return true;
+}
+
+
+//=============================================================================
+// The function "readAsciiBatch" parses the next batch of ascii facets. Only
+// facets known to be complete in the buffer are parsed, i.e., those followed
+// by the beginning of another facet, unless the whole device has been read.
+// OUTPUT: "StlTriangleBatch & batch" returns the triangles.
+// The function itself returns "false" if any discrepancy is encountered and
+// "true" otherwise.
+//=============================================================================
+bool StlBatchReader::readAsciiBatch(StlTriangleBatch & batch)
+{
+    while (batch.numTriangles() < m_batchSize)
+    {
+        const char * bufferBegin = m_buffer.constData();
+        const char * begin = bufferBegin + m_bufferPos;
+        const char * end = bufferBegin + m_buffer.size();
+        const char * stop = (m_isDeviceAtEnd == true) ? end : AsciiStlParser::findLastFacetStart(begin, end);
+        // Text that does not even hold a facet start is bound to fail, so
+        // parse it rather than keep buffering it.
+        if ((stop == begin) && (end - begin > s_maxAsciiBufferSize))
+            stop = end;
+
+        // Parse the complete facets.
+        AsciiStlParser parser(begin, end);
+        const bool isSuccess = parser.parseFacets(stop, batch.normals, batch.vertices,
+                                                  m_batchSize - batch.numTriangles());
+        if (isSuccess == false)
+        {
+            const qint64 lineNumber = m_numLinesDiscarded + lineNumberAt(bufferBegin, parser.errorPosition());
+            return fail(QString("Line %1: %2.").arg(lineNumber).arg(parser.errorMessage()));
+        }
+        m_bufferPos = static_cast<int>(parser.position() - bufferBegin);
+
+        // Stop at the word "endsolid" or the end of the device.
+        if ((parser.hasReachedEndSolid() == true) ||
+            ((parser.hasReachedEnd() == true) && (m_isDeviceAtEnd == true)))
+        {
+            m_atEnd = true;
+            break;
+        }
+
+        // Read in more text once all complete facets are parsed.
+        if ((parser.position() >= stop) && (fillBuffer() == false))
+            break;
+    }
+    return hasError() == false;
+}
+
+
+//=============================================================================
+// The function "fillBuffer" drops the parsed bytes from the buffer and
+// appends the next block of bytes from the device.
+// OUTPUT: The function returns "false" if the device is exhausted or fails
+// and "true" otherwise.
+//=============================================================================
+bool StlBatchReader::fillBuffer()
+{
+    if (m_isDeviceAtEnd == true)
+        return false;
+
+    // Drop the parsed bytes keeping track of the lines they held.
+    m_numLinesDiscarded += std::count(m_buffer.constData(), m_buffer.constData() + m_bufferPos, '\n');
+    m_buffer.remove(0, m_bufferPos);
+    m_bufferPos = 0;
+
+    // Append the next block.
+    const int oldSize = m_buffer.size();
+    m_buffer.resize(oldSize + s_asciiReadSize);
+    const qint64 numRead = readFully(m_buffer.data() + oldSize, s_asciiReadSize);
+    m_buffer.resize(oldSize + static_cast<int>(qMax(numRead, qint64(0))));
+    m_isDeviceAtEnd = (numRead < s_asciiReadSize);
+    return hasError() == false;
+}
+
+
+//=============================================================================
+// The function "readFully" reads from the device until a given number of
+// bytes is read or the device ends. Sequential devices may deliver fewer
+// bytes per call than requested.
+// INPUT: "qint64 maxSize" is the number of bytes to be read.
+// OUTPUT: "char * data" returns the bytes.
+// The function itself returns the number of bytes actually read.
+//=============================================================================
+qint64 StlBatchReader::readFully(char * data, qint64 maxSize)
+{
+    qint64 numRead = 0;
+    while (numRead < maxSize)
+    {
+        const qint64 count = m_device->read(data + numRead, maxSize - numRead);
+        if (count < 0)
+        {
+            fail("Reading failed: " + m_device->errorString());
+            break;
+        }
+        if (count == 0)
+            break;
+        numRead += count;
+    }
+    m_numBytesRead += numRead;
+    return numRead;
+}
+
+
+//=============================================================================
+// The function "fail" records the reason of a failure.
+// INPUT: "const QString & message" describes the failure.
+// OUTPUT: The function always returns "false".
+//=============================================================================
+bool StlBatchReader::fail(const QString & message)
+{
+    if (m_errorMessage.isEmpty() == true)
+        m_errorMessage = message;
+    return false;
+}
+
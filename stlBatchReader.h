@@ -0,0 +1,85 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef STL_BATCH_READER_HEADER
+#define STL_BATCH_READER_HEADER
+
+#include <QByteArray>
+#include <QString>
+#include <QVector3D>
+#include "geometryArray.h"
+
+class QIODevice;
+
+//=============================================================================
+// This class holds a batch of consecutive triangles of an STL file.
+//=============================================================================
+struct StlTriangleBatch
+{
+    qint64 firstTriangle;          // index of the first triangle of the batch in the file
+    GeometryArray<QVector3D> normals;    // normals of the triangles, one per triangle
+    GeometryArray<QVector3D> vertices;   // vertices of the triangles, three per triangle
+
+    qint64 numTriangles() const { return normals.size(); }
+};
+
+
+//=============================================================================
+// This class reads a binary or ascii STL file sequentially from a device and
+// hands out its triangles in batches of a fixed size. It serves devices that
+// can not be mapped into memory, such as a decompressing one: the reader keeps
+// only the current batch and a bounded read buffer, while the triangles it
+// hands out are kept by the caller. Loading a compressed file appends every
+// batch to the arrays of the part.
+//=============================================================================
+class StlBatchReader
+{
+public:
+    explicit StlBatchReader(QIODevice * device, int batchSize = 65536);
+    ~StlBatchReader() {}
+
+    // Read the header and detect the format.
+    bool readHeader();
+
+    // Read the next batch of triangles.
+    bool readNextBatch(StlTriangleBatch & batch);
+
+    // Accessors.
+    bool isAscii() const { return m_isAscii; }
+    bool atEnd() const { return m_atEnd; }
+    bool hasError() const { return m_errorMessage.isEmpty() == false; }
+    const QString & errorMessage() const { return m_errorMessage; }
+    qint64 numTrianglesRead() const { return m_numTrianglesRead; }
+    qint64 numBytesRead() const { return m_numBytesRead; }
+    // The number of triangles from a binary STL header, -1 for ascii STL.
+    qint64 numTrianglesExpected() const { return m_numTrianglesExpected; }
+
+private:
+    bool readBinaryBatch(StlTriangleBatch & batch);
+    bool readAsciiBatch(StlTriangleBatch & batch);
+    qint64 readFully(char * data, qint64 maxSize);
+    bool fillBuffer();
+    bool fail(const QString & message);
+
+private:
+    QIODevice * m_device;           // device to read from
+    int m_batchSize;                // maximal number of triangles per batch
+    bool m_isAscii;                 // indicates if the file is an ascii STL file
+    bool m_atEnd;                   // indicates if all triangles were read
+    bool m_isDeviceAtEnd;           // indicates if all bytes of the device were read
+    QString m_errorMessage;         // description of a failure, if any
+    qint64 m_numTrianglesExpected;  // number of triangles in a binary STL file
+    qint64 m_numTrianglesRead;      // number of triangles handed out so far
+    qint64 m_numBytesRead;          // number of bytes read from the device so far
+    QByteArray m_buffer;            // bytes read but not yet parsed, starting at m_bufferPos
+    int m_bufferPos;                // position of the first unparsed byte in the buffer
+    qint64 m_numLinesDiscarded;     // number of ascii lines dropped from the buffer
+};
+
+#endif // STL_BATCH_READER_HEADER
@@ -0,0 +1,355 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "stlBatchWriter.h"
+#include "parallelFor.h"
+#include "part.h"
+#include "partStl.h"
+
+#include <QIODevice>
+#include <QtConcurrent>
+#include <QtEndian>
+#include <cstring>    // memcpy, memset
+#include <limits>     // numeric_limits
+
+// SSE2 is part of every x86-64 processor, which is also little endian, so
+// that the floats can be stored as they are.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define STL_WRITER_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+// Number of triangles encoded by a single task.
+static const qint64 s_stlEncodeChunkSize = 65536;
+
+
+// Constructor.
+StlBatchWriter::StlBatchWriter(QIODevice * device, int blockSize)
+    : m_device(device), m_blockSize(qMax(blockSize, 1)), m_currentBlock(0), m_numBlockTriangles(0),
+      m_writeThreadPool(), m_pendingWrite(), m_pendingWriteSize(0), m_numTrianglesExpected(-1),
+      m_numTrianglesWritten(0), m_errorMessage()
+{
+    m_writeThreadPool.setMaxThreadCount(1);
+    m_blocks[0].resize(static_cast<size_t>(binaryStlTriangleSize * m_blockSize));
+    m_blocks[1].resize(static_cast<size_t>(binaryStlTriangleSize * m_blockSize));
+}
+
+// Destructor.
+StlBatchWriter::~StlBatchWriter()
+{
+    // The block being written must stay alive until it is written.
+    waitForWrite();
+}
+
+
+//=============================================================================
+// The function "writeBlockData" writes a block of encoded triangles to a
+// device. It runs on the thread writing the blocks.
+// INPUT: "QIODevice * device" is the device.
+// "const char * data" and "qint64 size" are the block.
+// OUTPUT: The function returns the number of bytes written, or -1 on failure.
+// NOTE: This is a non-member function.
+//=============================================================================
+static qint64 writeBlockData(QIODevice * device, const char * data, qint64 size)
+{
+    return device->write(data, size);
+}
+
+
+#ifdef STL_WRITER_USE_SSE2
+//=============================================================================
+// The function "loadVector" loads a 3D vector into the lower three lanes of a
+// register without reading past its last coordinate.
+// INPUT: "const QVector3D & v" is the vector.
+// OUTPUT: The function returns the register (x, y, z, 0).
+// NOTE: This is a non-member function.
+//=============================================================================
+static inline __m128 loadVector(const QVector3D & v)
+{
+    const float * p = reinterpret_cast<const float *>(&v);
+    return _mm_movelh_ps(_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64 *>(p)), _mm_load_ss(p + 2));
+}
+
+
+//=============================================================================
+// The function "encodeBinaryStlTrianglesSse2" is the SSE2 version of
+// "encodeBinaryStlTriangles". Every vector is moved, rotated and shifted as a
+// whole in a register, and stored with a single 16-byte store which the store of
+// the next vector partly overwrites; the last vertex is stored as 8 plus 4
+// bytes so as not to touch the next record.
+// NOTE: This is a non-member function.
+//=============================================================================
+static void encodeBinaryStlTrianglesSse2(const QVector3D * positions, const quint32 * indices,
+                                         const PackedNormal * faceNormals, const QVector3D & origin,
+                                         const QVector3D & offset, bool doRotate, qint64 begin, qint64 end,
+                                         uchar * records)
+{
+    // Adding a zero offset would turn negative zeros into positive ones.
+    const bool hasOffset = (offset.isNull() == false);
+    const __m128 originVector = loadVector(origin);
+    const __m128 offsetVector = loadVector(offset);
+    // Rotating maps (x, y, z) to (-y, x, z).
+    const __m128 rotationSign = _mm_set_ps(0.0f, 0.0f, 0.0f, -0.0f);
+
+    uchar * record = records + binaryStlTriangleSize * begin;
+    for (qint64 i = begin; i < end; ++i, record += binaryStlTriangleSize)
+    {
+        __m128 v[4];
+        v[0] = loadVector(unpackNormal(faceNormals[i]));
+        for (int k = 0; k < 3; ++k)
+            v[k + 1] = _mm_sub_ps(loadVector(positions[indices[3 * i + k]]), originVector);
+        if (doRotate == true)
+        {
+            for (int k = 0; k < 4; ++k)
+                v[k] = _mm_xor_ps(_mm_shuffle_ps(v[k], v[k], _MM_SHUFFLE(3, 2, 0, 1)), rotationSign);
+        }
+        if (hasOffset == true)
+        {
+            for (int k = 1; k < 4; ++k)
+                v[k] = _mm_add_ps(v[k], offsetVector);
+        }
+        float * dst = reinterpret_cast<float *>(record);
+        _mm_storeu_ps(dst, v[0]);
+        _mm_storeu_ps(dst + 3, v[1]);
+        _mm_storeu_ps(dst + 6, v[2]);
+        _mm_storel_pi(reinterpret_cast<__m64 *>(dst + 9), v[3]);
+        _mm_store_ss(dst + 11, _mm_movehl_ps(v[3], v[3]));
+        record[48] = 0;
+        record[49] = 0;
+    }
+}
+#else
+//=============================================================================
+// The function "writeLittleEndianFloat" stores a 32-bit float in the little
+// endian byte order, as is commonly assumed for STL files.
+// INPUT: "float value" is the value.
+// OUTPUT: "uchar * dst" returns the four bytes.
+// NOTE: This is a non-member function.
+//=============================================================================
+static inline void writeLittleEndianFloat(float value, uchar * dst)
+{
+    quint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bits = qToLittleEndian(bits);
+    memcpy(dst, &bits, sizeof(bits));
+}
+
+
+//=============================================================================
+// The function "writeLittleEndianVector" stores a 3D vector, optionally
+// rotated 90 degrees counterclockwise in the xy-plane and shifted, as three
+// little endian floats.
+// INPUT: "const QVector3D & v" is the vector.
+// "bool doRotate" indicates if the vector is rotated.
+// "const QVector3D * offset" is added to the rotated vector, unless null.
+// OUTPUT: "uchar * dst" returns the twelve bytes.
+// NOTE: This is a non-member function.
+//=============================================================================
+static inline void writeLittleEndianVector(const QVector3D & v, bool doRotate, const QVector3D * offset,
+                                           uchar * dst)
+{
+    QVector3D u = v;
+    if (doRotate == true)
+        rotate(u);
+    if (offset != nullptr)
+        u += *offset;
+    writeLittleEndianFloat(u.x(), dst);
+    writeLittleEndianFloat(u.y(), dst + 4);
+    writeLittleEndianFloat(u.z(), dst + 8);
+}
+#endif // STL_WRITER_USE_SSE2
+
+
+//=============================================================================
+// The function "encodeBinaryStlTriangles" encodes a range of triangles into
+// binary STL triangle records: 12 floats followed by two zero attribute
+// bytes. The triangles may be placed on the way, as parts are placed on the
+// build plate: moved so that a given origin goes to the origin, rotated 90
+// degrees counterclockwise in the xy-plane, and then shifted.
+// INPUT: "const QVector3D * positions" are the positions of the vertices.
+// "const quint32 * indices" are the indices of the positions, 3 per triangle.
+// "const PackedNormal * faceNormals" are the packed normals, 1 per triangle.
+// "const QVector3D & origin" is subtracted from every vertex.
+// "const QVector3D & offset" is added to every (rotated) vertex.
+// "bool doRotate" indicates if the vertices and normals are rotated.
+// "qint64 begin" and "qint64 end" specify the range [begin, end) of triangles
+// to be encoded.
+// OUTPUT: "uchar * records" returns the records, that of triangle "i" at
+// "binaryStlTriangleSize * i".
+//=============================================================================
+void encodeBinaryStlTriangles(const QVector3D * positions, const quint32 * indices,
+                              const PackedNormal * faceNormals, const QVector3D & origin, const QVector3D & offset,
+                              bool doRotate, qint64 begin, qint64 end, uchar * records)
+{
+#ifdef STL_WRITER_USE_SSE2
+    encodeBinaryStlTrianglesSse2(positions, indices, faceNormals, origin, offset, doRotate, begin, end, records);
+#else
+    // Adding a zero offset would turn negative zeros into positive ones.
+    const QVector3D * vertexOffset = (offset.isNull() == false) ? &offset : nullptr;
+    uchar * record = records + binaryStlTriangleSize * begin;
+    for (qint64 i = begin; i < end; ++i, record += binaryStlTriangleSize)
+    {
+        writeLittleEndianVector(unpackNormal(faceNormals[i]), doRotate, nullptr, record);
+        for (int k = 0; k < 3; ++k)
+        {
+            writeLittleEndianVector(positions[indices[3 * i + k]] - origin, doRotate, vertexOffset,
+                                    record + 12 * (k + 1));
+        }
+        record[48] = 0;
+        record[49] = 0;
+    }
+#endif
+}
+
+
+//=============================================================================
+// The function "writeHeader" writes an empty 80-byte header followed by the
+// number of triangles. It is to be called once, before any triangles.
+// INPUT: "qint64 numTriangles" is the number of triangles to be written.
+// OUTPUT: The function returns "false" if writing failed and "true"
+// otherwise.
+//=============================================================================
+bool StlBatchWriter::writeHeader(qint64 numTriangles)
+{
+    if (hasError() == true)
+        return false;
+    if ((numTriangles < 0) || (numTriangles > qint64(std::numeric_limits<quint32>::max())))
+        return fail(QString("A binary STL file can not hold %1 triangles.").arg(numTriangles));
+
+    char header[binaryStlHeaderSize];
+    memset(header, 0, sizeof(header));
+    const quint32 count = qToLittleEndian(static_cast<quint32>(numTriangles));
+    memcpy(header + 80, &count, sizeof(count));
+    if (m_device->write(header, binaryStlHeaderSize) != binaryStlHeaderSize)
+        return fail("Could not write the header: " + m_device->errorString());
+    m_numTrianglesExpected = numTriangles;
+    return true;
+}
+
+
+//=============================================================================
+// The function "writeTriangles" encodes a range of triangles into the current
+// block in parallel chunks, and writes out every block that fills up.
+// INPUT: "const QVector3D * positions" are the positions of the vertices.
+// "const quint32 * indices" are the indices of the positions, 3 per triangle.
+// "const PackedNormal * faceNormals" are the packed normals, 1 per triangle.
+// "qint64 numTriangles" is the number of triangles.
+// "const QVector3D & offset" is added to every (rotated) vertex.
+// "bool doRotate" indicates if the triangles are rotated 90 degrees
+// counterclockwise in the xy-plane before being shifted.
+// "const QVector3D & origin" is subtracted from every vertex first.
+// OUTPUT: The function returns "false" if writing failed and "true"
+// otherwise.
+//=============================================================================
+bool StlBatchWriter::writeTriangles(const QVector3D * positions, const quint32 * indices,
+                                    const PackedNormal * faceNormals, qint64 numTriangles,
+                                    const QVector3D & offset, bool doRotate, const QVector3D & origin)
+{
+    if (hasError() == true)
+        return false;
+    if (m_numTrianglesExpected < 0)
+        return fail("The triangles are written before the header.");
+    if (m_numTrianglesWritten + numTriangles > m_numTrianglesExpected)
+        return fail(QString("More triangles are written than the %1 announced.").arg(m_numTrianglesExpected));
+
+    for (qint64 first = 0; first < numTriangles; )
+    {
+        const qint64 numPieceTriangles = qMin(numTriangles - first, m_blockSize - m_numBlockTriangles);
+        uchar * records = reinterpret_cast<uchar *>(m_blocks[m_currentBlock].data()) +
+                binaryStlTriangleSize * m_numBlockTriangles;
+        const quint32 * pieceIndices = indices + 3 * first;
+        const PackedNormal * pieceNormals = faceNormals + first;
+        parallelForChunks(numPieceTriangles, s_stlEncodeChunkSize, [=](qint64, qint64 begin, qint64 end)
+        {
+            encodeBinaryStlTriangles(positions, pieceIndices, pieceNormals, origin, offset, doRotate, begin, end,
+                                     records);
+        });
+        first += numPieceTriangles;
+        m_numBlockTriangles += numPieceTriangles;
+        m_numTrianglesWritten += numPieceTriangles;
+        if ((m_numBlockTriangles == m_blockSize) && (writeBlock() == false))
+            return false;
+    }
+    return true;
+}
+
+
+//=============================================================================
+// The function "finish" writes out the last block, which may be partially
+// filled, and waits until all blocks are written.
+// OUTPUT: The function returns "false" if writing failed or fewer triangles
+// were written than announced, and "true" otherwise.
+//=============================================================================
+bool StlBatchWriter::finish()
+{
+    if (hasError() == true)
+        return false;
+    if ((m_numBlockTriangles > 0) && (writeBlock() == false))
+        return false;
+    if (waitForWrite() == false)
+        return false;
+    if (m_numTrianglesWritten != m_numTrianglesExpected)
+        return fail(QString("Only %1 of the %2 announced triangles are written.")
+                    .arg(m_numTrianglesWritten).arg(qMax(m_numTrianglesExpected, qint64(0))));
+    return true;
+}
+
+
+//=============================================================================
+// The function "writeBlock" hands the current block over to the thread
+// writing the blocks, once the previous block is written, and moves on to
+// the other block.
+// OUTPUT: The function returns "false" if writing the previous block failed
+// and "true" otherwise.
+//=============================================================================
+bool StlBatchWriter::writeBlock()
+{
+    if (waitForWrite() == false)
+        return false;
+    m_pendingWriteSize = binaryStlTriangleSize * m_numBlockTriangles;
+    m_pendingWrite = QtConcurrent::run(&m_writeThreadPool, writeBlockData, m_device,
+                                       static_cast<const char *>(m_blocks[m_currentBlock].data()),
+                                       m_pendingWriteSize);
+    m_currentBlock = 1 - m_currentBlock;
+    m_numBlockTriangles = 0;
+    return true;
+}
+
+
+//=============================================================================
+// The function "waitForWrite" waits until the block being written, if any,
+// is written.
+// OUTPUT: The function returns "false" if writing the block failed and "true"
+// otherwise.
+//=============================================================================
+bool StlBatchWriter::waitForWrite()
+{
+    if (m_pendingWriteSize == 0)
+        return true;
+    const qint64 numBytesWritten = m_pendingWrite.result();
+    const qint64 numBytesExpected = m_pendingWriteSize;
+    m_pendingWriteSize = 0;
+    if (numBytesWritten != numBytesExpected)
+        return fail("Could not write the triangles: " + m_device->errorString());
+    return true;
+}
+
+
+//=============================================================================
+// The function "fail" records the description of a failure unless one has
+// already been recorded.
+// INPUT: "const QString & message" describes the failure.
+// OUTPUT: The function returns "false" for convenience.
+//=============================================================================
+bool StlBatchWriter::fail(const QString & message)
+{
+    if (m_errorMessage.isEmpty() == true)
+        m_errorMessage = message;
+    return false;
+}
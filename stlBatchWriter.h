@@ -0,0 +1,81 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef STL_BATCH_WRITER_HEADER
+#define STL_BATCH_WRITER_HEADER
+
+#include <QFuture>
+#include <QString>
+#include <QThreadPool>
+#include <QVector3D>
+#include <vector>
+#include "packedNormal.h"
+
+class QIODevice;
+
+// Default number of triangles encoded into a block before it is written.
+// The block, 50 bytes per triangle, is a whole number of 4 KB pages.
+const int defaultStlWriteBlockSize = 256 * 1024;
+
+//=============================================================================
+// This class writes a binary STL file sequentially to a device. The
+// triangles are encoded in parallel into large blocks, and every full block
+// is written out on a dedicated thread while the next one is being encoded,
+// so that the disk is kept busy. Two blocks are kept in memory, whatever
+// the size of the file.
+//=============================================================================
+class StlBatchWriter
+{
+public:
+    explicit StlBatchWriter(QIODevice * device, int blockSize = defaultStlWriteBlockSize);
+    ~StlBatchWriter();
+
+    // Write the header, announcing the number of triangles to follow.
+    bool writeHeader(qint64 numTriangles);
+
+    // Write a range of triangles, each moved by minus a given origin,
+    // optionally rotated, and then shifted by a given offset.
+    bool writeTriangles(const QVector3D * positions, const quint32 * indices, const PackedNormal * faceNormals,
+                        qint64 numTriangles, const QVector3D & offset = QVector3D(), bool doRotate = false,
+                        const QVector3D & origin = QVector3D());
+
+    // Write out the last block and wait until all blocks are written.
+    bool finish();
+
+    // Accessors.
+    bool hasError() const { return m_errorMessage.isEmpty() == false; }
+    const QString & errorMessage() const { return m_errorMessage; }
+    qint64 numTrianglesWritten() const { return m_numTrianglesWritten; }
+
+private:
+    bool writeBlock();
+    bool waitForWrite();
+    bool fail(const QString & message);
+
+private:
+    QIODevice * m_device;             // device to write to
+    int m_blockSize;                  // number of triangles per block
+    std::vector<char> m_blocks[2];    // block being encoded and block being written
+    int m_currentBlock;               // index of the block being encoded
+    qint64 m_numBlockTriangles;       // number of triangles encoded into the current block
+    QThreadPool m_writeThreadPool;    // single thread writing the blocks
+    QFuture<qint64> m_pendingWrite;   // block being written, if any
+    qint64 m_pendingWriteSize;        // size of the block being written, or 0 if none
+    qint64 m_numTrianglesExpected;    // number of triangles announced in the header, -1 before it
+    qint64 m_numTrianglesWritten;     // number of triangles encoded so far
+    QString m_errorMessage;           // description of a failure, if any
+};
+
+
+// Non-members.
+void encodeBinaryStlTriangles(const QVector3D * positions, const quint32 * indices,
+                              const PackedNormal * faceNormals, const QVector3D & origin, const QVector3D & offset,
+                              bool doRotate, qint64 begin, qint64 end, uchar * records);
+
+#endif // STL_BATCH_WRITER_HEADER
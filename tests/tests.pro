@@ -0,0 +1,61 @@
+#-------------------------------------------------
+#
+# Tests of the parts whose geometry exceeds the limits of the Qt containers.
+# They run with "make check".
+#
+#-------------------------------------------------
+
+QT       += core gui concurrent testlib
+
+TARGET = tst_largeParts
+TEMPLATE = app
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+include(../libraries.pri)
+
+INCLUDEPATH += ..
+DEPENDPATH += ..
+
+SOURCES += \
+    tst_largeParts.cpp \
+    ../asciiStlParser.cpp \
+    ../boxSize.cpp \
+    ../decompressingDevice.cpp \
+    ../geometryArray.cpp \
+    ../geometryKernels.cpp \
+    ../loadProgress.cpp \
+    ../memoryBudget.cpp \
+    ../meshAdjacency.cpp \
+    ../meshIntegrity.cpp \
+    ../normalSmoothing.cpp \
+    ../parallelFor.cpp \
+    ../part.cpp \
+    ../partMesh.cpp \
+    ../partStl.cpp \
+    ../stlBatchReader.cpp \
+    ../stlBatchWriter.cpp \
+    ../textParsing.cpp \
+    ../vertexWelding.cpp
+
+HEADERS  += \
+    ../asciiStlParser.h \
+    ../boxSize.h \
+    ../decompressingDevice.h \
+    ../disjointSets.h \
+    ../geometryArray.h \
+    ../geometryKernels.h \
+    ../loadProgress.h \
+    ../memoryBudget.h \
+    ../meshAdjacency.h \
+    ../meshIntegrity.h \
+    ../normalSmoothing.h \
+    ../packedNormal.h \
+    ../parallelFor.h \
+    ../part.h \
+    ../partMesh.h \
+    ../partStl.h \
+    ../stlBatchReader.h \
+    ../stlBatchWriter.h \
+    ../textParsing.h \
+    ../vertexWelding.h
@@ -0,0 +1,234 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include <QtTest>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QVector3D>
+#include "geometryArray.h"
+#include "memoryBudget.h"
+#include "partMesh.h"
+#include "partStl.h"
+
+#include <climits>   // INT_MAX
+#include <cstring>   // memcpy, memset, strcpy
+#include <new>       // bad_alloc
+#include <utility>   // move
+
+// Size in bytes the geometry of the tested parts exceeds: the limit of the
+// int-sized Qt containers.
+static const qint64 s_numLargeBytes = Q_INT64_C(1) << 31;
+// Memory taken by every triangle at the peak of reading a binary STL file,
+// i.e., the triangle soup, its normals, and the arrays of the welding, and
+// the memory left to the system on top of it.
+static const qint64 s_numBytesPerReadTriangle = 100;
+static const qint64 s_numSpareBytes = Q_INT64_C(1) << 30;
+
+//=============================================================================
+// This class tests the parts whose geometry takes more than 2^31 bytes. The
+// parts are made of zero-filled arrays, most of whose triangles collapse at a
+// single position, and of one last triangle whose corners are known, so the
+// arrays need not be filled and the results are easy to check.
+//=============================================================================
+class LargePartsTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void indexBeyondIntMax();
+    void measureLargeMesh();
+    void readLargeStlFile();
+};
+
+
+//=============================================================================
+// The function "lastCorners" returns the corners of the last triangle of the
+// tested parts.
+// OUTPUT: "QVector3D corners[3]" returns the corners.
+// NOTE: This is a non-member function.
+//=============================================================================
+static void lastCorners(QVector3D corners[3])
+{
+    corners[0] = QVector3D(-5.0f, 0.0f, 0.0f);
+    corners[1] = QVector3D(0.0f, 7.0f, 0.0f);
+    corners[2] = QVector3D(0.0f, 0.0f, 9.0f);
+}
+
+
+//=============================================================================
+// The function "lastTriangleArea" returns the area of the last triangle of
+// the tested parts, the only one that is not degenerate.
+// NOTE: This is a non-member function.
+//=============================================================================
+static double lastTriangleArea()
+{
+    QVector3D corners[3];
+    lastCorners(corners);
+    return 0.5 * QVector3D::crossProduct(corners[1] - corners[0], corners[2] - corners[0]).length();
+}
+
+
+//=============================================================================
+// The function "putFloat" stores a float in little-endian byte order, as in
+// a binary STL file.
+// INPUT: "float value" is the float.
+// OUTPUT: "char * dst" returns the 4 bytes of the float.
+// NOTE: This is a non-member function.
+//=============================================================================
+static void putFloat(char * dst, float value)
+{
+    quint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bits = qToLittleEndian(bits);
+    memcpy(dst, &bits, sizeof(bits));
+}
+
+
+//=============================================================================
+// The function "indexBeyondIntMax" checks that a geometry array holds more
+// than INT_MAX elements and that the elements past INT_MAX are written and
+// read back at their own places.
+//=============================================================================
+void LargePartsTest::indexBeyondIntMax()
+{
+    const qint64 size = qint64(INT_MAX) + 4097;
+    GeometryArray<quint8> array;
+    try
+    {
+        array.resize(size);
+    }
+    catch (const std::bad_alloc &)
+    {
+        QSKIP("Not enough memory for an array of more than INT_MAX bytes.");
+    }
+    QCOMPARE(array.size(), size);
+    QCOMPARE(qint64(array.end() - array.begin()), size);
+
+    const qint64 beyond = qint64(INT_MAX) + 1;
+    array[beyond] = 0xA5;
+    array[size - 1] = 0x5A;
+    QCOMPARE(array[beyond - 1], quint8(0));
+    QCOMPARE(array[beyond], quint8(0xA5));
+    QCOMPARE(array.at(size - 1), quint8(0x5A));
+    QCOMPARE(array.constData()[beyond], quint8(0xA5));
+    // An index wrapped around to 32 bits would have written these instead.
+    QCOMPARE(array[beyond - (Q_INT64_C(1) << 31)], quint8(0));
+    QCOMPARE(array[0], quint8(0));
+}
+
+
+//=============================================================================
+// The function "measureLargeMesh" checks a mesh whose indices and face
+// normals take more than 2^31 bytes: its size, its last vertices, and the
+// ranges and the area found by measuring all its triangles. The zero-filled
+// arrays are mapped from the system and only read, so they take little
+// physical memory.
+//=============================================================================
+void LargePartsTest::measureLargeMesh()
+{
+    // Every triangle takes 3 indices and a face normal.
+    const qint64 numBytesPerTriangle = 3 * qint64(sizeof(quint32)) + qint64(sizeof(PackedNormal));
+    const qint64 numTriangles = s_numLargeBytes / numBytesPerTriangle + (1 << 20);
+    QVector3D corners[3];
+    lastCorners(corners);
+
+    GeometryArray<QVector3D> positions;
+    GeometryArray<quint32> indices;
+    GeometryArray<PackedNormal> faceNormals;
+    try
+    {
+        positions.resize(4);
+        indices.resize(3 * numTriangles);
+        faceNormals.resize(numTriangles);
+    }
+    catch (const std::bad_alloc &)
+    {
+        QSKIP("Not enough memory for a mesh of more than 2^31 bytes.");
+    }
+    // The degenerate triangles are at position 0, the last one uses the
+    // positions 1 to 3.
+    positions[0] = QVector3D(1.0f, 1.0f, 1.0f);
+    for (int k = 0; k < 3; ++k)
+    {
+        positions[k + 1] = corners[k];
+        indices[3 * (numTriangles - 1) + k] = quint32(k + 1);
+    }
+
+    PartMesh part(std::move(positions), std::move(indices), std::move(faceNormals));
+    QCOMPARE(part.numTriangles(), numTriangles);
+    QVERIFY(part.memorySize() > s_numLargeBytes);
+    QCOMPARE(part.vertex(part.numVertices() - 4), QVector3D(1.0f, 1.0f, 1.0f));
+    for (int k = 0; k < 3; ++k)
+        QCOMPARE(part.vertex(part.numVertices() - 3 + k), corners[k]);
+
+    const TriangleMeasures measures = part.measureTriangles();
+    QCOMPARE(measures.minCoord, QVector3D(-5.0f, 0.0f, 0.0f));
+    QCOMPARE(measures.maxCoord, QVector3D(1.0f, 7.0f, 9.0f));
+    QVERIFY(qAbs(measures.area - lastTriangleArea()) < 1e-6 * lastTriangleArea());
+}
+
+
+//=============================================================================
+// The function "readLargeStlFile" checks reading a binary STL file of more
+// than 2^31 bytes. The file is sparse, i.e., all its triangles but the last
+// one are zero and take no disk space.
+//=============================================================================
+void LargePartsTest::readLargeStlFile()
+{
+    const qint64 numTriangles = s_numLargeBytes / binaryStlTriangleSize + 1000;
+    const qint64 fileSize = binaryStlHeaderSize + numTriangles * binaryStlTriangleSize;
+    if (physicalMemorySize() < s_numBytesPerReadTriangle * numTriangles + s_numSpareBytes)
+        QSKIP("Not enough physical memory to read an STL file of more than 2^31 bytes.");
+
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid() == true);
+    const QString fileName = directory.path() + "/large.stl";
+    {
+        // The header must not start with "solid", which marks an ascii file.
+        char header[binaryStlHeaderSize];
+        memset(header, 0, sizeof(header));
+        strcpy(header, "Simple3D large part test");
+        const quint32 count = qToLittleEndian(static_cast<quint32>(numTriangles));
+        memcpy(header + 80, &count, sizeof(count));
+
+        char triangle[binaryStlTriangleSize];
+        memset(triangle, 0, sizeof(triangle));
+        QVector3D corners[3];
+        lastCorners(corners);
+        for (int k = 0; k < 3; ++k)
+        {
+            for (int c = 0; c < 3; ++c)
+                putFloat(triangle + 12 * (k + 1) + 4 * c, corners[k][c]);
+        }
+
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::WriteOnly) == true);
+        QCOMPARE(file.write(header, binaryStlHeaderSize), binaryStlHeaderSize);
+        QVERIFY(file.resize(fileSize) == true);
+        QVERIFY(file.seek(fileSize - binaryStlTriangleSize) == true);
+        QCOMPARE(file.write(triangle, binaryStlTriangleSize), binaryStlTriangleSize);
+        file.close();
+    }
+    QCOMPARE(QFileInfo(fileName).size(), fileSize);
+
+    PartStl part(fileName, StlFormat::Binary);
+    QCOMPARE(part.numTriangles(), numTriangles);
+    // The zero triangles weld into the origin.
+    QCOMPARE(part.numPositions(), qint64(4));
+    const TriangleMeasures measures = part.measureTriangles();
+    QCOMPARE(measures.minCoord, QVector3D(-5.0f, 0.0f, 0.0f));
+    QCOMPARE(measures.maxCoord, QVector3D(0.0f, 7.0f, 9.0f));
+    QVERIFY(qAbs(measures.area - lastTriangleArea()) < 1e-6 * lastTriangleArea());
+}
+
+
+QTEST_GUILESS_MAIN(LargePartsTest)
+
+#include "tst_largeParts.moc"
@@ -0,0 +1,362 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "textParsing.h"
+
+#include <QByteArray>
+#include <algorithm>  // count
+#include <cmath>      // floor, log10, pow
+#include <cstring>    // memchr, memcpy
+#include <limits>     // numeric_limits
+
+// Powers of 10 that are exactly representable as doubles.
+static const double s_exactPowersOf10[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+// Fewest and most significant digits a float is written with; 9 digits are
+// always enough to read it back exactly.
+static const int s_minNumFloatDigits = 6;
+static const int s_maxNumFloatDigits = 9;
+
+
+//=============================================================================
+// The function "skipLine" skips everything up to and including the end of the
+// current line.
+// INPUT: "const char * pos" is the current position in the text.
+// "const char * end" is the end of the text.
+// OUTPUT: The function returns the beginning of the next line or "end".
+//=============================================================================
+const char * skipLine(const char * pos, const char * end)
+{
+    const void * eol = memchr(pos, '\n', end - pos);
+    return (eol == nullptr) ? end : static_cast<const char *>(eol) + 1;
+}
+
+
+//=============================================================================
+// The function "isLetterMatch" compares, ignoring the case, the text at a
+// given position with a given lower-case word.
+// NOTE: This is a non-member function.
+//=============================================================================
+static bool isLetterMatch(const char * pos, const char * end, const char * word)
+{
+    for (; *word != '\0'; ++pos, ++word)
+    {
+        if ((pos == end) || ((*pos | 0x20) != *word))
+            return false;
+    }
+    return true;
+}
+
+
+//=============================================================================
+// The function "parseDouble" parses a floating point number written in the
+// "C" locale, i.e., with a decimal point regardless of the system locale, and
+// an optional exponent. The words "nan" and "inf" are accepted too. Numbers
+// with up to 19 significant digits and a moderate exponent are converted
+// exactly on the fast path; all others are handed to QByteArray::toDouble()
+// which gives the same result as QString::toDouble().
+// INPUT: "const char * pos" is the beginning of the number.
+// "const char * end" is the end of the text.
+// OUTPUT: "double & value" returns the parsed number.
+// The function itself returns the position past the number, or "nullptr" if
+// no number is found at the given position.
+//=============================================================================
+const char * parseDouble(const char * pos, const char * end, double & value)
+{
+    const char * begin = pos;
+    bool isNegative = false;
+    if ((pos != end) && ((*pos == '-') || (*pos == '+')))
+    {
+        isNegative = (*pos == '-');
+        ++pos;
+    }
+
+    // Handle the special values.
+    if ((pos != end) && ((*pos == 'n') || (*pos == 'N') || (*pos == 'i') || (*pos == 'I')))
+    {
+        if (isLetterMatch(pos, end, "nan") == true)
+        {
+            value = std::numeric_limits<double>::quiet_NaN();
+            return pos + 3;
+        }
+        if (isLetterMatch(pos, end, "inf") == true)
+        {
+            pos += isLetterMatch(pos, end, "infinity") ? 8 : 3;
+            value = isNegative ? -std::numeric_limits<double>::infinity()
+                               : std::numeric_limits<double>::infinity();
+            return pos;
+        }
+        return nullptr;
+    }
+
+    // Accumulate up to 19 significant digits of the mantissa; further
+    // digits only shift the decimal exponent.
+    quint64 mantissa = 0;
+    int numSignificantDigits = 0;
+    int decimalExponent = 0;
+    int numDigits = 0;
+    bool isExact = true;
+    for (; (pos != end) && (*pos >= '0') && (*pos <= '9'); ++pos, ++numDigits)
+    {
+        if (numSignificantDigits < 19)
+        {
+            mantissa = 10 * mantissa + (*pos - '0');
+            if (mantissa != 0)
+                ++numSignificantDigits;
+        }
+        else
+        {
+            ++decimalExponent;
+            isExact = isExact && (*pos == '0');
+        }
+    }
+    if ((pos != end) && (*pos == '.'))
+    {
+        for (++pos; (pos != end) && (*pos >= '0') && (*pos <= '9'); ++pos, ++numDigits)
+        {
+            if (numSignificantDigits < 19)
+            {
+                mantissa = 10 * mantissa + (*pos - '0');
+                --decimalExponent;
+                if (mantissa != 0)
+                    ++numSignificantDigits;
+            }
+            else
+            {
+                isExact = isExact && (*pos == '0');
+            }
+        }
+    }
+    if (numDigits == 0)
+        return nullptr;
+
+    // Read in the exponent, if any.
+    if ((pos != end) && ((*pos == 'e') || (*pos == 'E')))
+    {
+        const char * expPos = pos + 1;
+        bool isExpNegative = false;
+        if ((expPos != end) && ((*expPos == '-') || (*expPos == '+')))
+        {
+            isExpNegative = (*expPos == '-');
+            ++expPos;
+        }
+        if ((expPos == end) || (*expPos < '0') || (*expPos > '9'))
+            return nullptr;
+        int exponent = 0;
+        for (; (expPos != end) && (*expPos >= '0') && (*expPos <= '9'); ++expPos)
+        {
+            if (exponent < 100000)
+                exponent = 10 * exponent + (*expPos - '0');
+        }
+        decimalExponent += isExpNegative ? -exponent : exponent;
+        pos = expPos;
+    }
+
+    // Use the exact fast path when both the mantissa and the power of 10 are
+    // exactly representable as doubles; the single multiplication or division
+    // is then correctly rounded.
+    if ((isExact == true) && (mantissa <= (quint64(1) << 53)) &&
+        (decimalExponent >= -22) && (decimalExponent <= 22))
+    {
+        double result = static_cast<double>(mantissa);
+        if (decimalExponent < 0)
+            result /= s_exactPowersOf10[-decimalExponent];
+        else
+            result *= s_exactPowersOf10[decimalExponent];
+        value = isNegative ? -result : result;
+        return pos;
+    }
+
+    // Fall back to the slow but locale-independent conversion.
+    bool ok = false;
+    value = QByteArray::fromRawData(begin, static_cast<int>(pos - begin)).toDouble(&ok);
+    return (ok == true) ? pos : nullptr;
+}
+
+
+//=============================================================================
+// The function "parseFloat" parses a floating point number written in the
+// "C" locale and rounds it to a float.
+// INPUT: "const char * pos" is the beginning of the number.
+// "const char * end" is the end of the text.
+// OUTPUT: "float & value" returns the parsed number.
+// The function itself returns the position past the number, or "nullptr" if
+// no number is found at the given position.
+//=============================================================================
+const char * parseFloat(const char * pos, const char * end, float & value)
+{
+    double result;
+    pos = parseDouble(pos, end, result);
+    value = static_cast<float>(result);
+    return pos;
+}
+
+
+//=============================================================================
+// The function "parseInteger" parses a (possibly signed) decimal integer.
+// INPUT: "const char * pos" is the beginning of the number.
+// "const char * end" is the end of the text.
+// OUTPUT: "qint64 & value" returns the parsed number.
+// The function itself returns the position past the number, or "nullptr" if
+// no number is found at the given position or it does not fit in 64 bits.
+//=============================================================================
+const char * parseInteger(const char * pos, const char * end, qint64 & value)
+{
+    bool isNegative = false;
+    if ((pos != end) && ((*pos == '-') || (*pos == '+')))
+    {
+        isNegative = (*pos == '-');
+        ++pos;
+    }
+    const char * digits = pos;
+    quint64 result = 0;
+    for (; (pos != end) && (*pos >= '0') && (*pos <= '9'); ++pos)
+    {
+        if (result > (quint64(std::numeric_limits<qint64>::max()) - 9) / 10)
+            return nullptr;
+        result = 10 * result + (*pos - '0');
+    }
+    if (pos == digits)
+        return nullptr;
+    value = isNegative ? -static_cast<qint64>(result) : static_cast<qint64>(result);
+    return pos;
+}
+
+
+//=============================================================================
+// The function "lineNumberAt" finds the (1-based) number of the line holding
+// a given position in a text. It is meant for error reporting only.
+// INPUT: "const char * begin" is the beginning of the text.
+// "const char * pos" is a position in the text.
+// OUTPUT: The function returns the line number.
+//=============================================================================
+qint64 lineNumberAt(const char * begin, const char * pos)
+{
+    return 1 + std::count(begin, pos, '\n');
+}
+
+
+//=============================================================================
+// The function "scaleByPowerOf10" multiplies a number by a power of 10,
+// exactly rounded when the power is exactly representable.
+// INPUT: "double value" is the number.
+// "int exponent" is the exponent of the power of 10.
+// OUTPUT: The function returns the product.
+// NOTE: This is a non-member function.
+//=============================================================================
+static inline double scaleByPowerOf10(double value, int exponent)
+{
+    if ((exponent >= 0) && (exponent <= 22))
+        return value * s_exactPowersOf10[exponent];
+    if ((exponent < 0) && (exponent >= -22))
+        return value / s_exactPowersOf10[-exponent];
+    return value * std::pow(10.0, exponent);
+}
+
+
+//=============================================================================
+// The function "formatFloat" writes a floating point number in the "C"
+// locale, with as few significant digits, 6 to 9, as read back to the very
+// same float by "parseFloat". Like "%g", it switches to an exponent for very
+// small or large numbers. No terminating zero is written.
+// INPUT: "float value" is the number.
+// OUTPUT: "char * dst" returns the text; it must have room for 16 characters.
+// The function itself returns the position past the text.
+//=============================================================================
+char * formatFloat(float value, char * dst)
+{
+    // Handle the special values.
+    if (value != value)
+    {
+        memcpy(dst, "nan", 3);
+        return dst + 3;
+    }
+    if (std::signbit(value) == true)
+        *dst++ = '-';
+    const double magnitude = std::fabs(static_cast<double>(value));
+    if (magnitude == 0.0)
+    {
+        *dst = '0';
+        return dst + 1;
+    }
+    if (magnitude == std::numeric_limits<double>::infinity())
+    {
+        memcpy(dst, "inf", 3);
+        return dst + 3;
+    }
+
+    // Find the fewest significant digits that read back exactly. The number
+    // is "mantissa" times 10 to the power of "exponent - numDigits + 1".
+    int exponent = static_cast<int>(std::floor(std::log10(magnitude)));
+    quint64 mantissa = 0;
+    int numDigits = s_minNumFloatDigits;
+    for (; numDigits <= s_maxNumFloatDigits; ++numDigits)
+    {
+        mantissa = static_cast<quint64>(scaleByPowerOf10(magnitude, numDigits - 1 - exponent) + 0.5);
+        // Correct an exponent off by one, e.g., after rounding up to 10.
+        const quint64 upperBound = static_cast<quint64>(s_exactPowersOf10[numDigits]);
+        if ((mantissa >= upperBound) || (mantissa < upperBound / 10))
+        {
+            exponent += (mantissa >= upperBound) ? 1 : -1;
+            mantissa = static_cast<quint64>(scaleByPowerOf10(magnitude, numDigits - 1 - exponent) + 0.5);
+        }
+        const int scale = numDigits - 1 - exponent;
+        if ((numDigits == s_maxNumFloatDigits) || ((scale >= -22) && (scale <= 22) &&
+            (static_cast<float>(scaleByPowerOf10(static_cast<double>(mantissa), -scale)) == static_cast<float>(magnitude))))
+            break;
+    }
+    while ((numDigits > 1) && (mantissa % 10 == 0))
+    {
+        mantissa /= 10;
+        --numDigits;
+    }
+    char digits[s_maxNumFloatDigits];
+    for (int i = numDigits - 1; i >= 0; --i, mantissa /= 10)
+        digits[i] = static_cast<char>('0' + mantissa % 10);
+
+    // Write the digits with an exponent, as "%g" does, ...
+    if ((exponent < -4) || (exponent >= s_maxNumFloatDigits))
+    {
+        *dst++ = digits[0];
+        if (numDigits > 1)
+        {
+            *dst++ = '.';
+            memcpy(dst, digits + 1, numDigits - 1);
+            dst += numDigits - 1;
+        }
+        *dst++ = 'e';
+        *dst++ = (exponent < 0) ? '-' : '+';
+        const int absExponent = (exponent < 0) ? -exponent : exponent;
+        *dst++ = static_cast<char>('0' + absExponent / 10);
+        *dst++ = static_cast<char>('0' + absExponent % 10);
+        return dst;
+    }
+    // ... or with the decimal point in place.
+    if (exponent < 0)
+    {
+        *dst++ = '0';
+        *dst++ = '.';
+        for (int i = -1; i > exponent; --i)
+            *dst++ = '0';
+        memcpy(dst, digits, numDigits);
+        return dst + numDigits;
+    }
+    for (int i = 0; i <= exponent; ++i)
+        *dst++ = (i < numDigits) ? digits[i] : '0';
+    if (numDigits > exponent + 1)
+    {
+        *dst++ = '.';
+        memcpy(dst, digits + exponent + 1, numDigits - exponent - 1);
+        dst += numDigits - exponent - 1;
+    }
+    return dst;
+}
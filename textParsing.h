@@ -0,0 +1,46 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef TEXT_PARSING_HEADER
+#define TEXT_PARSING_HEADER
+
+#include <QtGlobal>
+
+// Check if a character is a white space other than the end of a line.
+inline bool isBlank(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\f') || (c == '\v');
+}
+
+// Skip white spaces other than the end of a line.
+inline const char * skipBlanks(const char * pos, const char * end)
+{
+    while ((pos != end) && (isBlank(*pos) == true))
+        ++pos;
+    return pos;
+}
+
+// Skip everything up to and including the end of the current line.
+const char * skipLine(const char * pos, const char * end);
+
+// Parse a floating point number written in the "C" locale.
+const char * parseDouble(const char * pos, const char * end, double & value);
+const char * parseFloat(const char * pos, const char * end, float & value);
+
+// Write a floating point number in the "C" locale, with as few digits as
+// read back exactly.
+char * formatFloat(float value, char * dst);
+
+// Parse a (possibly signed) integer.
+const char * parseInteger(const char * pos, const char * end, qint64 & value);
+
+// Count the lines preceding a given position in a text.
+qint64 lineNumberAt(const char * begin, const char * pos);
+
+#endif // TEXT_PARSING_HEADER
@@ -0,0 +1,399 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "threeMfWriter.h"
+#include "loadProgress.h"
+#include "parallelFor.h"
+#include "partStl.h"
+#include "textParsing.h"
+#include "zipWriter.h"
+
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <cstring>         // memcmp
+#include <functional>      // function
+#include <string>
+#include <vector>
+
+// Number of vertices or triangles formatted by a single task.
+static const qint64 s_xmlChunkSize = 16384;
+// Number of vertices or triangles formatted before being written, which
+// bounds the memory held by the text.
+static const qint64 s_xmlBatchSize = 64 * s_xmlChunkSize;
+
+// The parts of the package besides the model, the same for every file.
+static const char * const s_contentTypes =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+        "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+        "<Default Extension=\"model\" ContentType=\"application/vnd.ms-package.3dmanufacturing-3dmodel+xml\"/>"
+        "</Types>\n";
+static const char * const s_relationships =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+        "<Relationship Target=\"/3D/3dmodel.model\" Id=\"rel0\" "
+        "Type=\"http://schemas.microsoft.com/3dmanufacturing/2013/01/3dmodel\"/>"
+        "</Relationships>\n";
+static const char * const s_modelName = "3D/3dmodel.model";
+
+//=============================================================================
+// The function "isSameMesh" checks if two parts have the very same positions
+// and triangles, e.g., being copies read from the same file.
+// INPUT: "const Part & part1" and "const Part & part2" are the parts.
+// OUTPUT: The function returns "true" if the triangles are the same and
+// "false" otherwise.
+// NOTE: This is a non-member function.
+//=============================================================================
+static bool isSameMesh(const Part & part1, const Part & part2)
+{
+    if (&part1 == &part2)
+        return true;
+    if ((part1.numPositions() != part2.numPositions()) || (part1.numTriangles() != part2.numTriangles()))
+        return false;
+    return (memcmp(part1.positionConstData(), part2.positionConstData(),
+                   part1.numPositions() * sizeof(QVector3D)) == 0) &&
+            (memcmp(part1.indexConstData(), part2.indexConstData(),
+                    part1.numVertices() * sizeof(quint32)) == 0);
+}
+
+
+//=============================================================================
+// The function "isProperTriangle" checks if a triangle has 3 distinct
+// vertices, as a 3MF file requires.
+// INPUT: "const quint32 * corners" are the indices of the 3 vertices.
+// NOTE: This is a non-member function.
+//=============================================================================
+static inline bool isProperTriangle(const quint32 * corners)
+{
+    return (corners[0] != corners[1]) && (corners[1] != corners[2]) && (corners[2] != corners[0]);
+}
+
+
+//=============================================================================
+// The function "appendNumber" appends a coordinate to a text, with as few
+// digits as keep it exact and a period as the decimal point.
+// INPUT: "float value" is the coordinate.
+// OUTPUT: "std::string & text" returns the text with the coordinate appended.
+// NOTE: This is a non-member function.
+//=============================================================================
+static inline void appendNumber(std::string & text, float value)
+{
+    char digits[16];
+    text.append(digits, formatFloat(value, digits) - digits);
+}
+
+
+//=============================================================================
+// The function "appendIndex" appends a vertex index to a text.
+// INPUT: "quint32 index" is the index.
+// OUTPUT: "std::string & text" returns the text with the index appended.
+// NOTE: This is a non-member function.
+//=============================================================================
+static inline void appendIndex(std::string & text, quint32 index)
+{
+    char digits[10];
+    int numDigits = 0;
+    do
+    {
+        digits[numDigits++] = static_cast<char>('0' + index % 10);
+        index /= 10;
+    } while (index > 0);
+    while (numDigits > 0)
+        text.push_back(digits[--numDigits]);
+}
+
+
+//=============================================================================
+// The function "writeText" writes a piece of text to the model.
+// INPUT: "ZipWriter & zip" is the package being written.
+// "const std::string & text" is the text.
+// OUTPUT: The function returns "false" if writing failed and "true"
+// otherwise.
+// NOTE: This is a non-member function.
+//=============================================================================
+static bool writeText(ZipWriter & zip, const std::string & text)
+{
+    return zip.write(text.data(), static_cast<qint64>(text.size()));
+}
+
+
+//=============================================================================
+// The function "writeFormattedItems" formats a number of items, e.g.,
+// vertices, in parallel chunks and writes their text to the model in order.
+// Only a batch of items is formatted at a time.
+// INPUT: "ZipWriter & zip" is the package being written.
+// "qint64 numItems" is the number of items.
+// "formatItem" appends the text of the item of a given index.
+// "bool areTriangles" indicates if the items are triangles, which are counted
+// as written.
+// "LoadProgress * progress", if given, is advanced as the items are written.
+// Writing stops early if it gets canceled.
+// OUTPUT: The function returns "false" if writing failed or was canceled and
+// "true" otherwise.
+// NOTE: This is a non-member function.
+//=============================================================================
+static bool writeFormattedItems(ZipWriter & zip, qint64 numItems,
+                                const std::function<void(qint64 i, std::string & text)> & formatItem,
+                                bool areTriangles, LoadProgress * progress)
+{
+    std::vector<std::string> chunkTexts;
+    for (qint64 first = 0; first < numItems; first += s_xmlBatchSize)
+    {
+        if (isLoadCanceled(progress) == true)
+            return false;
+        const qint64 numBatchItems = qMin(numItems - first, s_xmlBatchSize);
+        chunkTexts.assign(static_cast<size_t>(numChunks(numBatchItems, s_xmlChunkSize)), std::string());
+        std::string * chunkTextData = chunkTexts.data();
+        parallelForChunks(numBatchItems, s_xmlChunkSize, [&](qint64 chunkIndex, qint64 begin, qint64 end)
+        {
+            std::string & text = chunkTextData[chunkIndex];
+            for (qint64 i = begin; i < end; ++i)
+                formatItem(first + i, text);
+        });
+        qint64 numBytes = 0;
+        for (auto cit = chunkTexts.cbegin(); cit != chunkTexts.cend(); ++cit)
+        {
+            if (writeText(zip, *cit) == false)
+                return false;
+            numBytes += static_cast<qint64>(cit->size());
+        }
+        reportLoadProgress(progress, numBytes, (areTriangles == true) ? numBatchItems : 0);
+    }
+    return true;
+}
+
+
+//=============================================================================
+// The function "writeMeshObject" writes a part to the model as an object
+// holding its welded positions and its triangles, but for those with fewer
+// than 3 distinct vertices, which a 3MF file may not hold.
+// INPUT: "ZipWriter & zip" is the package being written.
+// "int objectId" is the id of the object.
+// "const ManagedPart & managedPart" is the part.
+// "LoadProgress * progress", if given, tracks the progress of the writing.
+// OUTPUT: "bool & isWritten" returns "false" if the part has no triangles
+// left to be written, in which case no object is written, and "true"
+// otherwise.
+// The function itself returns "false" if writing failed or was canceled and
+// "true" otherwise.
+// NOTE: This is a non-member function.
+//=============================================================================
+static bool writeMeshObject(ZipWriter & zip, int objectId, const ManagedPart & managedPart, bool & isWritten,
+                            LoadProgress * progress)
+{
+    const Part & part = *(managedPart.part());
+    const quint32 * triangleData = part.indexConstData();
+    isWritten = false;
+    for (qint64 t = 0; (t < part.numTriangles()) && (isWritten == false); ++t)
+        isWritten = isProperTriangle(triangleData + 3 * t);
+    if (isWritten == false)
+        return true;
+
+    std::string text = "<object id=\"";
+    appendIndex(text, static_cast<quint32>(objectId));
+    text += "\" type=\"model\"";
+    const QString name = QFileInfo(managedPart.fileName()).completeBaseName();
+    if (name.isEmpty() == false)
+        text += " name=\"" + name.toHtmlEscaped().toStdString() + "\"";
+    text += "><mesh><vertices>\n";
+    if (writeText(zip, text) == false)
+        return false;
+
+    // The lower left corner of the part is moved to the origin.
+    const QVector3D * vertexData = part.positionConstData();
+    const QVector3D origin = managedPart.origin();
+    if (writeFormattedItems(zip, part.numPositions(), [=](qint64 i, std::string & itemText)
+        {
+            const QVector3D vertex = vertexData[i] - origin;
+            itemText += "<vertex x=\"";
+            appendNumber(itemText, vertex.x());
+            itemText += "\" y=\"";
+            appendNumber(itemText, vertex.y());
+            itemText += "\" z=\"";
+            appendNumber(itemText, vertex.z());
+            itemText += "\"/>\n";
+        }, false, progress) == false)
+        return false;
+    if (writeText(zip, "</vertices><triangles>\n") == false)
+        return false;
+
+    if (writeFormattedItems(zip, part.numTriangles(), [=](qint64 t, std::string & itemText)
+        {
+            if (isProperTriangle(triangleData + 3 * t) == false)
+                return;
+            itemText += "<triangle v1=\"";
+            appendIndex(itemText, triangleData[3 * t]);
+            itemText += "\" v2=\"";
+            appendIndex(itemText, triangleData[3 * t + 1]);
+            itemText += "\" v3=\"";
+            appendIndex(itemText, triangleData[3 * t + 2]);
+            itemText += "\"/>\n";
+        }, true, progress) == false)
+        return false;
+    return writeText(zip, "</triangles></mesh></object>\n");
+}
+
+
+//=============================================================================
+// The function "buildItemTransform" finds the transform placing a part as it
+// is drawn: a rotated part is turned 90 degrees counterclockwise about its
+// lower left corner and slid right until that corner is back at the origin,
+// and then the part is shifted to its position. A 3MF transform is a 4x3
+// matrix, applied to row vectors, listed row by row.
+// INPUT: "const ManagedPart & managedPart" is the part.
+// OUTPUT: The function returns the transform as the 12 numbers of the matrix.
+// NOTE: This is a non-member function.
+//=============================================================================
+static std::string buildItemTransform(const ManagedPart & managedPart)
+{
+    QVector3D offset = managedPart.drawingPosition();
+    std::string transform;
+    if (managedPart.doRotateBeforeDrawing() == true)
+    {
+        offset += QVector3D(managedPart.boxSize().y(), 0.0f, 0.0f);
+        transform = "0 1 0 -1 0 0 0 0 1 ";
+    }
+    else
+    {
+        transform = "1 0 0 0 1 0 0 0 1 ";
+    }
+    appendNumber(transform, offset.x());
+    transform += " ";
+    appendNumber(transform, offset.y());
+    transform += " ";
+    appendNumber(transform, offset.z());
+    return transform;
+}
+
+
+//=============================================================================
+// The function "writeModel" writes the model of a 3MF package: every distinct
+// mesh once as an object, and every part as a build item placing its object.
+// INPUT: "ZipWriter & zip" is the package being written.
+// "const QList<ManagedPart> & parts" are the parts.
+// "LoadProgress * progress", if given, tracks the progress of the writing.
+// OUTPUT: The function returns "false" if writing failed or was canceled and
+// "true" otherwise.
+// NOTE: This is a non-member function.
+//=============================================================================
+static bool writeModel(ZipWriter & zip, const QList<ManagedPart> & parts, LoadProgress * progress)
+{
+    // Find the distinct meshes; copies of a part share the object of the
+    // first of them.
+    std::vector<int> objectOfPart(static_cast<size_t>(parts.size()), -1);
+    std::vector<int> firstPartOfObject;
+    for (int i = 0; i < parts.size(); ++i)
+    {
+        for (size_t j = 0; (j < firstPartOfObject.size()) && (objectOfPart[i] < 0); ++j)
+        {
+            if (isSameMesh(*(parts[firstPartOfObject[j]].part()), *(parts[i].part())) == true)
+                objectOfPart[i] = static_cast<int>(j);
+        }
+        if (objectOfPart[i] < 0)
+        {
+            objectOfPart[i] = static_cast<int>(firstPartOfObject.size());
+            firstPartOfObject.push_back(i);
+        }
+    }
+
+    // Write the objects, the ids starting at 1.
+    if ((zip.beginEntry(s_modelName) == false) ||
+        (writeText(zip, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                        "<model unit=\"millimeter\" xml:lang=\"en-US\" "
+                        "xmlns=\"http://schemas.microsoft.com/3dmanufacturing/core/2015/02\">\n"
+                        "<resources>\n") == false))
+        return false;
+    std::vector<bool> isObjectWritten(firstPartOfObject.size(), false);
+    for (size_t j = 0; j < firstPartOfObject.size(); ++j)
+    {
+        bool isWritten = false;
+        if (writeMeshObject(zip, static_cast<int>(j) + 1, parts[firstPartOfObject[j]], isWritten,
+                            progress) == false)
+            return false;
+        isObjectWritten[j] = isWritten;
+    }
+
+    // Place every part by a build item.
+    std::string text = "</resources>\n<build>\n";
+    for (int i = 0; i < parts.size(); ++i)
+    {
+        if (isObjectWritten[objectOfPart[i]] == false)
+            continue;
+        text += "<item objectid=\"";
+        appendIndex(text, static_cast<quint32>(objectOfPart[i] + 1));
+        text += "\" transform=\"" + buildItemTransform(parts[i]) + "\"/>\n";
+    }
+    text += "</build>\n</model>\n";
+    return (writeText(zip, text) == true) && (zip.endEntry() == true);
+}
+
+
+//=============================================================================
+// The function "writeThreeMfFile" writes parts, as they are placed in the
+// master box, to a 3MF file. Every distinct mesh is written once, with its
+// vertices welded, and every part places it by a build item, so that copies
+// of a part take hardly any room. The package is a zip archive whose entries
+// are stored uncompressed. The file is written under a temporary name and
+// renamed once complete. Decimated parts are refused rather than written with
+// their coarser meshes.
+// INPUT: "const QString & fileName" is the name of the file to be written to.
+// "const QList<ManagedPart> & parts" are the parts.
+// OUTPUT: "QString * errorMessage", if given, returns the reason of a
+// failure.
+// "LoadProgress * progress", if given, is advanced as the meshes are
+// written. Writing stops early if it gets canceled.
+// The function itself returns "false" if the file could not be written, a
+// part is decimated or writing was canceled, and "true" otherwise.
+//=============================================================================
+bool writeThreeMfFile(const QString & fileName, const QList<ManagedPart> & parts, QString * errorMessage,
+                      LoadProgress * progress)
+{
+    const QStringList decimated = decimatedFileNames(parts);
+    if (decimated.isEmpty() == false)
+    {
+        if (errorMessage != nullptr)
+            *errorMessage = "Could not write the file " + fileName + ", as the parts of the following files "
+                            "are only held decimated: " + decimated.join(", ");
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Specify and open the file for writing.
+    QSaveFile file(fileName);
+    if (file.open(QIODevice::WriteOnly) == false)
+    {
+        if (errorMessage != nullptr)
+            *errorMessage = "Could not open the file " + fileName + " for writing: " + file.errorString();
+        return false;
+    }
+
+    // Write the package, and put the file in place.
+    ZipWriter zip(&file);
+    if ((zip.addEntry("[Content_Types].xml", s_contentTypes) == false) ||
+        (zip.addEntry("_rels/.rels", s_relationships) == false) ||
+        (writeModel(zip, parts, progress) == false) || (zip.finish() == false) || (file.commit() == false))
+    {
+        if (errorMessage != nullptr)
+        {
+            if (isLoadCanceled(progress) == true)
+                *errorMessage = "Writing of " + fileName + " was canceled.";
+            else
+                *errorMessage = "Could not write the file " + fileName + ": " +
+                        ((zip.hasError() == true) ? zip.errorMessage() : file.errorString());
+        }
+        file.cancelWriting();
+        return false;
+    }
+
+    reportWritingThroughput(fileName, QFileInfo(fileName).size(), timer.nsecsElapsed());
+    return true;
+}
@@ -0,0 +1,24 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef THREE_MF_WRITER_HEADER
+#define THREE_MF_WRITER_HEADER
+
+#include <QList>
+#include <QString>
+#include "managedPart.h"
+
+class LoadProgress;
+
+// Write parts, as placed in the master box, to a 3MF file, every distinct
+// mesh once.
+bool writeThreeMfFile(const QString & fileName, const QList<ManagedPart> & parts,
+                      QString * errorMessage = nullptr, LoadProgress * progress = nullptr);
+
+#endif // THREE_MF_WRITER_HEADER
@@ -37,6 +37,7 @@ public:
     QAction *actionAbout;
     QAction *actionUnload;
     QAction *actionResizeWorkspace;
+    QAction *actionExportPlate;
     QWidget *centralwidget;
     QVBoxLayout *verticalLayout_2;
     QVBoxLayout *verticalLayout;
@@ -80,6 +81,8 @@ public:
         actionUnload->setObjectName(QStringLiteral("actionUnload"));
         actionResizeWorkspace = new QAction(Simple3D);
         actionResizeWorkspace->setObjectName(QStringLiteral("actionResizeWorkspace"));
+        actionExportPlate = new QAction(Simple3D);
+        actionExportPlate->setObjectName(QStringLiteral("actionExportPlate"));
         centralwidget = new QWidget(Simple3D);
         centralwidget->setObjectName(QStringLiteral("centralwidget"));
         verticalLayout_2 = new QVBoxLayout(centralwidget);
@@ -196,6 +199,7 @@ public:
         menuFile->addAction(actionLoad);
         menuFile->addAction(actionUnload);
         menuFile->addAction(actionRecentFiles);
+        menuFile->addAction(actionExportPlate);
         menuFile->addSeparator();
         menuFile->addAction(actionExit);
         menuHelp->addAction(actionAbout);
@@ -219,6 +223,8 @@ public:
         actionUnload->setShortcut(QApplication::translate("Simple3D", "Ctrl+U", 0));
         actionResizeWorkspace->setText(QApplication::translate("Simple3D", "Resize Workspace", 0));
         actionResizeWorkspace->setShortcut(QApplication::translate("Simple3D", "Ctrl+W", 0));
+        actionExportPlate->setText(QApplication::translate("Simple3D", "Export Plate...", 0));
+        actionExportPlate->setShortcut(QApplication::translate("Simple3D", "Ctrl+E", 0));
         volumeTextLabel->setText(QApplication::translate("Simple3D", "Volume (selected/all): ", 0));
         volumeValueLabel->setText(QApplication::translate("Simple3D", "0/0", 0));
 #ifndef QT_NO_TOOLTIP
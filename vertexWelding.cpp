@@ -0,0 +1,566 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "vertexWelding.h"
+#include "disjointSets.h"
+#include "parallelFor.h"
+
+#include <atomic>     // atomic
+#include <cmath>      // floor
+#include <cstring>    // memcpy, memcmp
+#include <limits>     // numeric_limits
+#include <vector>
+
+// Number of vertices handled by a single task.
+static const qint64 s_weldChunkSize = 65536;
+// The vertices are partitioned by the top bits of their hashes into buckets
+// welded independently of each other.
+static const int s_numWeldBucketBits = 10;
+static const int s_numWeldBuckets = 1 << s_numWeldBucketBits;
+// Marks an empty slot of a hash table.
+static const quint32 s_emptySlot = std::numeric_limits<quint32>::max();
+// With a tolerance, the cells of the grid are this many times as big as the
+// tolerance, so that most vertices are within the tolerance of only a few of
+// the neighboring cells.
+static const float s_cellSizePerTolerance = 2.0f;
+// Offsets of the 13 neighboring cells after a cell, whose vertices are
+// compared with those of the cell; the other 13 come before it.
+static const int s_numForwardNeighbors = 13;
+static const int s_forwardNeighbors[s_numForwardNeighbors][3] =
+{
+    {1, 0, 0}, {-1, 1, 0}, {0, 1, 0}, {1, 1, 0}, {-1, -1, 1}, {0, -1, 1}, {1, -1, 1},
+    {-1, 0, 1}, {0, 0, 1}, {1, 0, 1}, {-1, 1, 1}, {0, 1, 1}, {1, 1, 1}
+};
+// Tolerance within which the vertices of the parts read are welded.
+static std::atomic<float> s_weldTolerance(0.0f);
+
+//=============================================================================
+// The class "WeldKey" identifies the vertices welded together: the bit
+// patterns of the coordinates if the tolerance is zero, and the coordinates
+// of the cell of a grid otherwise.
+//=============================================================================
+struct WeldKey
+{
+    quint32 words[3];   // one word per coordinate
+};
+
+//=============================================================================
+// The class "WeldCell" is a slot of the hash table of the cells of a bucket,
+// with the range of the list of the vertices of the cell.
+//=============================================================================
+struct WeldCell
+{
+    WeldKey key;      // the cell
+    quint32 begin;    // where the list of the cell begins, or "s_emptySlot" for an empty slot
+    quint32 end;      // where the list of the cell ends
+};
+
+
+//=============================================================================
+// The function "setWeldTolerance" sets the tolerance within which the
+// vertices of the parts read are welded.
+// INPUT: "float tolerance" is the tolerance; zero, negative, and
+// not-a-number values weld only equal positions.
+//=============================================================================
+void setWeldTolerance(float tolerance)
+{
+    s_weldTolerance = (tolerance > 0.0f) ? tolerance : 0.0f;
+}
+
+
+//=============================================================================
+// The function "weldTolerance" gets the tolerance within which the vertices
+// of the parts read are welded.
+//=============================================================================
+float weldTolerance()
+{
+    return s_weldTolerance;
+}
+
+
+//=============================================================================
+// The function "weldKey" finds the key of a vertex. Without a grid, negative
+// zero coordinates are taken as positive ones, so the key is the same for
+// equal positions. Otherwise the key is the cell of the grid holding the
+// vertex: every coordinate is rounded to the nearest multiple of the size of
+// the cells, clamped to the range of 32-bit integers.
+// INPUT: "const QVector3D & vertex" is the vertex.
+// "float cellSize" is the size of the cells of the grid, or zero for none.
+// OUTPUT: The function returns the key.
+// NOTE: This is a non-member function.
+//=============================================================================
+static inline WeldKey weldKey(const QVector3D & vertex, float cellSize)
+{
+    WeldKey key;
+    for (int k = 0; k < 3; ++k)
+    {
+        if (cellSize > 0.0f)
+        {
+            // The comparisons are false for not-a-number coordinates too.
+            const float cell = std::floor(vertex[k] / cellSize + 0.5f);
+            const qint32 index = (cell >= 2147483520.0f) ? std::numeric_limits<qint32>::max() :
+                                 (cell > -2147483648.0f) ? static_cast<qint32>(cell) :
+                                                           std::numeric_limits<qint32>::min();
+            key.words[k] = static_cast<quint32>(index);
+        }
+        else
+        {
+            const float value = vertex[k] + 0.0f;
+            memcpy(&key.words[k], &value, sizeof(value));
+        }
+    }
+    return key;
+}
+
+
+//=============================================================================
+// The function "hashWeldKey" hashes the key of a vertex.
+// INPUT: "const WeldKey & key" is the key.
+// OUTPUT: The function returns the hash.
+// NOTE: This is a non-member function.
+//=============================================================================
+static inline quint64 hashWeldKey(const WeldKey & key)
+{
+    quint64 hash = key.words[0];
+    hash = hash * Q_UINT64_C(0x9E3779B97F4A7C15) + key.words[1];
+    hash = hash * Q_UINT64_C(0x9E3779B97F4A7C15) + key.words[2];
+    hash *= Q_UINT64_C(0x9E3779B97F4A7C15);
+    return hash ^ (hash >> 29);
+}
+
+
+//=============================================================================
+// The function "weldBucket" finds the bucket of a hash.
+// NOTE: This is a non-member function.
+//=============================================================================
+static inline int weldBucket(quint64 hash)
+{
+    return static_cast<int>(hash >> (64 - s_numWeldBucketBits));
+}
+
+
+//=============================================================================
+// The function "findFirstVertices" refers every vertex of a bucket to the
+// first vertex with the same key. An open-addressing hash table, at most
+// half full, holds the first vertices met; the vertices are visited in
+// increasing order, so the result does not depend on the order in which the
+// buckets are handled.
+// INPUT: "const QVector3D * vertices" are the vertices.
+// "float cellSize" is the size of the cells of the grid, or zero for none.
+// "const quint32 * bucketVertices" are the vertices of the bucket, in
+// increasing order.
+// "qint64 numBucketVertices" is the number of vertices of the bucket.
+// OUTPUT: "quint32 * firstVertices" returns the first vertex with the same
+// key for every vertex of the bucket.
+// NOTE: This is a non-member function.
+//=============================================================================
+static void findFirstVertices(const QVector3D * vertices, float cellSize, const quint32 * bucketVertices,
+                              qint64 numBucketVertices, quint32 * firstVertices)
+{
+    quint64 tableSize = 16;
+    while (tableSize < 2 * quint64(numBucketVertices))
+        tableSize *= 2;
+    std::vector<quint32> table(static_cast<size_t>(tableSize), s_emptySlot);
+    for (qint64 j = 0; j < numBucketVertices; ++j)
+    {
+        // Probe linearly for a vertex with the same key or for an empty slot.
+        const quint32 i = bucketVertices[j];
+        const WeldKey key = weldKey(vertices[i], cellSize);
+        quint64 slot = hashWeldKey(key) & (tableSize - 1);
+        while (table[slot] != s_emptySlot)
+        {
+            const WeldKey other = weldKey(vertices[table[slot]], cellSize);
+            if (memcmp(&key, &other, sizeof(WeldKey)) == 0)
+                break;
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (table[slot] == s_emptySlot)
+            table[slot] = i;
+        firstVertices[i] = table[slot];
+    }
+}
+
+
+//=============================================================================
+// The function "findCells" finds the cells of the vertices of a bucket and
+// lists the vertices of every cell together, in increasing order. The cells
+// are put into an open-addressing hash table, kept at most half full by
+// doubling its size as the cells are met, which first numbers the cells and
+// counts their vertices, and then holds the range of the list of every cell.
+// INPUT: "const QVector3D * vertices" are the vertices.
+// "float cellSize" is the positive size of the cells of the grid.
+// "const quint32 * bucketVertices" are the vertices of all the buckets,
+// bucket after bucket, and "quint32 begin" and "quint32 end" where those of
+// the bucket are.
+// "quint32 * vertexCells" is scratch space for the number of the cell of
+// every vertex of the bucket.
+// OUTPUT: "quint32 * cellVertices" returns the vertices of the bucket, cell
+// after cell, in the place of the bucket.
+// "std::vector<WeldCell> & cells" returns the hash table of the cells.
+// NOTE: This is a non-member function.
+//=============================================================================
+static void findCells(const QVector3D * vertices, float cellSize, const quint32 * bucketVertices,
+                      quint32 begin, quint32 end, quint32 * vertexCells, quint32 * cellVertices,
+                      std::vector<WeldCell> & cells)
+{
+    WeldCell emptyCell;
+    emptyCell.begin = s_emptySlot;
+    emptyCell.end = 0;
+    cells.assign(16, emptyCell);
+    quint32 numCells = 0;
+    for (quint32 j = begin; j < end; ++j)
+    {
+        // Probe linearly for the cell or for an empty slot, in which the
+        // cell is numbered.
+        const quint32 i = bucketVertices[j];
+        const WeldKey key = weldKey(vertices[i], cellSize);
+        quint64 slot = hashWeldKey(key) & (cells.size() - 1);
+        while ((cells[slot].begin != s_emptySlot) && (memcmp(&cells[slot].key, &key, sizeof(WeldKey)) != 0))
+            slot = (slot + 1) & (cells.size() - 1);
+        if (cells[slot].begin == s_emptySlot)
+        {
+            if (2 * quint64(numCells + 1) > cells.size())
+            {
+                std::vector<WeldCell> grown(2 * cells.size(), emptyCell);
+                for (auto it = cells.begin(); it != cells.end(); ++it)
+                {
+                    if (it->begin == s_emptySlot)
+                        continue;
+                    quint64 grownSlot = hashWeldKey(it->key) & (grown.size() - 1);
+                    while (grown[grownSlot].begin != s_emptySlot)
+                        grownSlot = (grownSlot + 1) & (grown.size() - 1);
+                    grown[grownSlot] = *it;
+                }
+                cells.swap(grown);
+                slot = hashWeldKey(key) & (cells.size() - 1);
+                while (cells[slot].begin != s_emptySlot)
+                    slot = (slot + 1) & (cells.size() - 1);
+            }
+            cells[slot].key = key;
+            cells[slot].begin = numCells++;
+        }
+        ++cells[slot].end;
+        vertexCells[i] = cells[slot].begin;
+    }
+
+    // Turn the counts into the ranges of the lists, and list the vertices.
+    std::vector<quint32> cursors(numCells);
+    quint32 offset = begin;
+    for (auto it = cells.begin(); it != cells.end(); ++it)
+    {
+        if (it->begin == s_emptySlot)
+            continue;
+        cursors[it->begin] = offset;
+        it->begin = offset;
+        offset += it->end;
+        it->end = offset;
+    }
+    for (quint32 j = begin; j < end; ++j)
+        cellVertices[cursors[vertexCells[bucketVertices[j]]]++] = bucketVertices[j];
+}
+
+
+//=============================================================================
+// The function "findCell" finds a cell in the hash table of its bucket.
+// INPUT: "const WeldKey & key" is the cell.
+// "const std::vector<WeldCell> & cells" is the hash table of the bucket.
+// OUTPUT: The function returns the slot of the cell, or an empty one if the
+// cell has no vertices.
+// NOTE: This is a non-member function.
+//=============================================================================
+static const WeldCell & findCell(const WeldKey & key, const std::vector<WeldCell> & cells)
+{
+    const quint64 tableMask = cells.size() - 1;
+    quint64 slot = hashWeldKey(key) & tableMask;
+    while ((cells[slot].begin != s_emptySlot) && (memcmp(&cells[slot].key, &key, sizeof(WeldKey)) != 0))
+        slot = (slot + 1) & tableMask;
+    return cells[slot];
+}
+
+
+//=============================================================================
+// The function "uniteNearbyVertices" unites the sets of the vertices within
+// the tolerance of each other in a disjoint-set forest, for every cell of a
+// bucket: such vertices are in the same or in neighboring cells, so the
+// vertices of the cell are compared with each other and with those of the 13
+// neighboring cells after it, and every pair of cells is compared once. Only
+// the neighboring cells within the tolerance of a vertex of the cell are
+// looked up; the gaps between the vertices and the sides of the cell are
+// found in double precision, with a small margin for the rounding of the
+// cells of the vertices.
+// INPUT: "const QVector3D * vertices" are the vertices.
+// "float tolerance" is the positive tolerance.
+// "float cellSize" is the size of the cells of the grid, at least twice the
+// tolerance.
+// "const quint32 * cellVertices" are the vertices of all the buckets, cell
+// after cell.
+// "const std::vector<WeldCell> * cells" are the hash tables of the cells of
+// all the buckets, and "int bucket" is the bucket.
+// OUTPUT: "std::atomic<quint32> * parents" returns the disjoint-set forest
+// of the vertices, united for the cells of the bucket.
+// NOTE: This is a non-member function.
+//=============================================================================
+static void uniteNearbyVertices(const QVector3D * vertices, float tolerance, float cellSize,
+                                const quint32 * cellVertices, const std::vector<WeldCell> * cells, int bucket,
+                                std::atomic<quint32> * parents)
+{
+    const float maxDistanceSquared = tolerance * tolerance;
+    const double maxGapSquared = 1.001 * double(tolerance) * double(tolerance);
+    const int allNeighbors = (1 << s_numForwardNeighbors) - 1;
+    for (auto it = cells[bucket].begin(); it != cells[bucket].end(); ++it)
+    {
+        const WeldCell & cell = *it;
+        if (cell.begin == s_emptySlot)
+            continue;
+        for (quint32 j = cell.begin + 1; j < cell.end; ++j)
+        {
+            const QVector3D & vertex = vertices[cellVertices[j]];
+            for (quint32 k = cell.begin; k < j; ++k)
+            {
+                if ((vertices[cellVertices[k]] - vertex).lengthSquared() <= maxDistanceSquared)
+                    uniteSets(parents, cellVertices[j], cellVertices[k]);
+            }
+        }
+
+        // Find the neighboring cells within the tolerance of a vertex.
+        int neighbors = 0;
+        for (quint32 j = cell.begin; (j < cell.end) && (neighbors != allNeighbors); ++j)
+        {
+            const QVector3D & vertex = vertices[cellVertices[j]];
+            double gaps[3][3];
+            for (int k = 0; k < 3; ++k)
+            {
+                const double center = double(static_cast<qint32>(cell.key.words[k])) * double(cellSize);
+                const double offset = double(vertex[k]) - center;
+                gaps[k][0] = qMax(0.0, offset + 0.5 * double(cellSize));
+                gaps[k][1] = 0.0;
+                gaps[k][2] = qMax(0.0, 0.5 * double(cellSize) - offset);
+            }
+            for (int n = 0; n < s_numForwardNeighbors; ++n)
+            {
+                const double gapX = gaps[0][s_forwardNeighbors[n][0] + 1];
+                const double gapY = gaps[1][s_forwardNeighbors[n][1] + 1];
+                const double gapZ = gaps[2][s_forwardNeighbors[n][2] + 1];
+                if (gapX * gapX + gapY * gapY + gapZ * gapZ <= maxGapSquared)
+                    neighbors |= 1 << n;
+            }
+        }
+
+        for (int n = 0; n < s_numForwardNeighbors; ++n)
+        {
+            if ((neighbors & (1 << n)) == 0)
+                continue;
+
+            // Find the neighboring cell, unless it is beyond the grid.
+            WeldKey neighborKey;
+            bool isInGrid = true;
+            for (int k = 0; k < 3; ++k)
+            {
+                const qint64 index = qint64(static_cast<qint32>(cell.key.words[k])) + s_forwardNeighbors[n][k];
+                isInGrid = isInGrid && (index >= std::numeric_limits<qint32>::min()) &&
+                        (index <= std::numeric_limits<qint32>::max());
+                neighborKey.words[k] = static_cast<quint32>(static_cast<qint32>(index));
+            }
+            if (isInGrid == false)
+                continue;
+            const WeldCell & neighbor = findCell(neighborKey, cells[weldBucket(hashWeldKey(neighborKey))]);
+            if (neighbor.begin == s_emptySlot)
+                continue;
+
+            for (quint32 j = cell.begin; j < cell.end; ++j)
+            {
+                const QVector3D & vertex = vertices[cellVertices[j]];
+                for (quint32 k = neighbor.begin; k < neighbor.end; ++k)
+                {
+                    if ((vertices[cellVertices[k]] - vertex).lengthSquared() <= maxDistanceSquared)
+                        uniteSets(parents, cellVertices[j], cellVertices[k]);
+                }
+            }
+        }
+    }
+}
+
+
+//=============================================================================
+// The function "weldVertices" welds the vertices of a triangle soup, i.e.,
+// merges the vertices at equal positions or, with a positive tolerance,
+// within the tolerance of each other. The vertices are partitioned by the
+// hashes of their keys into buckets, with the counts of every chunk of
+// vertices and their prefix sums. Without a tolerance, every bucket then
+// finds the first vertex of every key on its own. With a tolerance, the keys
+// are the cells of a grid twice as big as the tolerance; every bucket lists
+// the vertices of its cells, and the vertices within the tolerance of each
+// other, found in the same and the neighboring cells, are united in a
+// disjoint-set forest, so a chain of vertices each within the tolerance of
+// the next is welded together. A tolerance close to the size of the part
+// crowds the cells, and the comparisons grow quadratic. The positions are
+// then numbered in the order of their first appearance, every one taking the
+// coordinates of its first vertex. All the steps run in parallel.
+// INPUT: "const QVector3D * vertices" are the vertices of the soup, 3 per triangle.
+// "qint64 numVertices" is the number of vertices, fewer than 2^32 - 1.
+// "float tolerance" is the tolerance; zero welds only equal positions.
+// OUTPUT: "GeometryArray<QVector3D> & positions" returns the unique positions.
+// "GeometryArray<quint32> & indices" returns the index of the position of
+// every vertex.
+// "QString * errorMessage", if not null, returns the reason of a failure.
+// The function itself returns "true" on success and "false" if there are too
+// many vertices to be indexed.
+// NOTE: This is a non-member function.
+//=============================================================================
+bool weldVertices(const QVector3D * vertices, qint64 numVertices, float tolerance,
+                  GeometryArray<QVector3D> & positions, GeometryArray<quint32> & indices,
+                  QString * errorMessage)
+{
+    positions.clear();
+    indices.clear();
+    if (numVertices >= qint64(s_emptySlot))
+    {
+        if (errorMessage != nullptr)
+            *errorMessage = "The part has more vertices than can be indexed.";
+        return false;
+    }
+    if (numVertices <= 0)
+        return true;
+    tolerance = (tolerance > 0.0f) ? tolerance : 0.0f;
+    const float cellSize = s_cellSizePerTolerance * tolerance;
+
+    // Count the vertices of every bucket in every chunk.
+    const qint64 chunkCount = numChunks(numVertices, s_weldChunkSize);
+    std::vector<quint32> bucketOffsets(static_cast<size_t>(chunkCount * s_numWeldBuckets), 0);
+    quint32 * bucketOffsetData = bucketOffsets.data();
+    parallelForChunks(numVertices, s_weldChunkSize, [=](qint64 chunkIndex, qint64 begin, qint64 end)
+    {
+        quint32 * counts = bucketOffsetData + chunkIndex * s_numWeldBuckets;
+        for (qint64 i = begin; i < end; ++i)
+            ++counts[weldBucket(hashWeldKey(weldKey(vertices[i], cellSize)))];
+    });
+
+    // Turn the counts into the offsets at which every chunk writes the
+    // vertices of every bucket, bucket after bucket and chunk after chunk.
+    std::vector<quint32> bucketBegins(s_numWeldBuckets + 1, 0);
+    quint32 offset = 0;
+    for (int b = 0; b < s_numWeldBuckets; ++b)
+    {
+        bucketBegins[b] = offset;
+        for (qint64 c = 0; c < chunkCount; ++c)
+        {
+            const quint32 count = bucketOffsetData[c * s_numWeldBuckets + b];
+            bucketOffsetData[c * s_numWeldBuckets + b] = offset;
+            offset += count;
+        }
+    }
+    bucketBegins[s_numWeldBuckets] = offset;
+
+    // Sort the vertices by bucket, keeping them in increasing order within
+    // every bucket, and weld every bucket.
+    GeometryArray<quint32> firstVertices(numVertices);
+    quint32 * firstVertexData = firstVertices.data();
+    {
+        GeometryArray<quint32> bucketVertices(numVertices);
+        quint32 * bucketVertexData = bucketVertices.data();
+        parallelForChunks(numVertices, s_weldChunkSize, [=](qint64 chunkIndex, qint64 begin, qint64 end)
+        {
+            quint32 * offsets = bucketOffsetData + chunkIndex * s_numWeldBuckets;
+            for (qint64 i = begin; i < end; ++i)
+                bucketVertexData[offsets[weldBucket(hashWeldKey(weldKey(vertices[i], cellSize)))]++] = quint32(i);
+        });
+        const quint32 * bucketBeginData = bucketBegins.data();
+        if (tolerance <= 0.0f)
+        {
+            parallelForChunks(s_numWeldBuckets, 1, [=](qint64 b, qint64, qint64)
+            {
+                findFirstVertices(vertices, cellSize, bucketVertexData + bucketBeginData[b],
+                                  bucketBeginData[b + 1] - bucketBeginData[b], firstVertexData);
+            });
+        }
+        else
+        {
+            // List the vertices of every cell together, unite the vertices
+            // within the tolerance of each other, and refer every vertex to
+            // the root of its set, which is its lowest vertex. The first
+            // vertices hold the numbers of the cells of the vertices until
+            // then.
+            std::vector<std::vector<WeldCell> > cells(s_numWeldBuckets);
+            std::vector<WeldCell> * cellData = cells.data();
+            GeometryArray<quint32> cellVertices(numVertices);
+            quint32 * cellVertexData = cellVertices.data();
+            parallelForChunks(s_numWeldBuckets, 1, [=](qint64 b, qint64, qint64)
+            {
+                findCells(vertices, cellSize, bucketVertexData, bucketBeginData[b], bucketBeginData[b + 1],
+                          firstVertexData, cellVertexData, cellData[b]);
+            });
+            bucketVertices.clear();
+            std::vector<std::atomic<quint32> > parents(static_cast<size_t>(numVertices));
+            std::atomic<quint32> * parentData = parents.data();
+            parallelForChunks(numVertices, s_weldChunkSize, [=](qint64, qint64 begin, qint64 end)
+            {
+                for (qint64 i = begin; i < end; ++i)
+                    parentData[i].store(quint32(i), std::memory_order_relaxed);
+            });
+            parallelForChunks(s_numWeldBuckets, 1, [=](qint64 b, qint64, qint64)
+            {
+                uniteNearbyVertices(vertices, tolerance, cellSize, cellVertexData, cellData, int(b), parentData);
+            });
+            parallelForChunks(numVertices, s_weldChunkSize, [=](qint64, qint64 begin, qint64 end)
+            {
+                for (qint64 i = begin; i < end; ++i)
+                    firstVertexData[i] = findRoot(parentData, quint32(i));
+            });
+        }
+    }
+
+    // Count the first vertices of every chunk to find where its positions go.
+    std::vector<quint32> positionOffsets(static_cast<size_t>(chunkCount), 0);
+    quint32 * positionOffsetData = positionOffsets.data();
+    parallelForChunks(numVertices, s_weldChunkSize, [=](qint64 chunkIndex, qint64 begin, qint64 end)
+    {
+        quint32 count = 0;
+        for (qint64 i = begin; i < end; ++i)
+        {
+            if (firstVertexData[i] == quint32(i))
+                ++count;
+        }
+        positionOffsetData[chunkIndex] = count;
+    });
+    quint32 numPositions = 0;
+    for (auto it = positionOffsets.begin(); it != positionOffsets.end(); ++it)
+    {
+        const quint32 count = *it;
+        *it = numPositions;
+        numPositions += count;
+    }
+
+    // Number the positions of the first vertices, and then refer the other
+    // vertices to the positions of their first vertices.
+    positions.resize(numPositions);
+    indices.resize(numVertices);
+    QVector3D * positionData = positions.data();
+    quint32 * indexData = indices.data();
+    parallelForChunks(numVertices, s_weldChunkSize, [=](qint64 chunkIndex, qint64 begin, qint64 end)
+    {
+        quint32 position = positionOffsetData[chunkIndex];
+        for (qint64 i = begin; i < end; ++i)
+        {
+            if (firstVertexData[i] == quint32(i))
+            {
+                positionData[position] = vertices[i];
+                indexData[i] = position++;
+            }
+        }
+    });
+    parallelForChunks(numVertices, s_weldChunkSize, [=](qint64, qint64 begin, qint64 end)
+    {
+        for (qint64 i = begin; i < end; ++i)
+        {
+            if (firstVertexData[i] != quint32(i))
+                indexData[i] = indexData[firstVertexData[i]];
+        }
+    });
+    return true;
+}
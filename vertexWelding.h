@@ -0,0 +1,33 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef VERTEX_WELDING_HEADER
+#define VERTEX_WELDING_HEADER
+
+#include <QtGlobal>
+#include <QString>
+#include <QVector3D>
+#include "geometryArray.h"
+
+// Set and get the tolerance, in the units of the coordinates, within which
+// the vertices of the parts read are welded. The vertices within the
+// tolerance of each other are welded, and so are chains of them, each within
+// the tolerance of the next. Zero welds only the vertices at exactly the same
+// position.
+void setWeldTolerance(float tolerance);
+float weldTolerance();
+
+// Weld the vertices of a triangle soup into unique positions and the indices
+// of the positions, 3 per triangle, in parallel. The results do not depend on
+// the number of threads.
+bool weldVertices(const QVector3D * vertices, qint64 numVertices, float tolerance,
+                  GeometryArray<QVector3D> & positions, GeometryArray<quint32> & indices,
+                  QString * errorMessage = nullptr);
+
+#endif // VERTEX_WELDING_HEADER
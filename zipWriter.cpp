@@ -0,0 +1,359 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#include "zipWriter.h"
+
+#include <QDateTime>
+#include <QIODevice>
+#include <QtEndian>
+
+// Largest value of the 16-bit and 32-bit fields; a larger value is moved to
+// the 64-bit extensions.
+static const qint64 s_max16 = 0xFFFF;
+static const qint64 s_max32 = Q_INT64_C(0xFFFFFFFF);
+// Versions of the format needed to extract an entry.
+static const quint16 s_versionStored = 20;
+static const quint16 s_versionZip64 = 45;
+// General purpose flag telling that the names are in UTF-8.
+static const quint16 s_utf8NamesFlag = 0x0800;
+// Reversed generator polynomial of the CRC-32 of zip archives.
+static const quint32 s_crcPolynomial = 0xEDB88320u;
+
+//=============================================================================
+// The class "CrcTable" holds the CRC-32 remainder of every byte value, so
+// that the CRC-32 is continued a byte at a time.
+//=============================================================================
+struct CrcTable
+{
+    quint32 remainders[256];   // remainder of every byte value
+
+    CrcTable()
+    {
+        for (quint32 byte = 0; byte < 256; ++byte)
+        {
+            quint32 remainder = byte;
+            for (int bit = 0; bit < 8; ++bit)
+                remainder = ((remainder & 1) != 0) ? (remainder >> 1) ^ s_crcPolynomial : (remainder >> 1);
+            remainders[byte] = remainder;
+        }
+    }
+};
+
+
+//=============================================================================
+// The function "appendLittleEndian" appends an integer to a byte array in the
+// little endian byte order, as all fields of a zip archive are.
+// INPUT: "T value" is the integer.
+// OUTPUT: "QByteArray & data" returns the bytes appended.
+// NOTE: This is a non-member function.
+//=============================================================================
+template <typename T>
+static void appendLittleEndian(QByteArray & data, T value)
+{
+    uchar bytes[sizeof(T)];
+    qToLittleEndian(value, bytes);
+    data.append(reinterpret_cast<const char *>(bytes), sizeof(T));
+}
+
+
+//=============================================================================
+// The function "updateCrc" continues the CRC-32 of some contents with more of
+// them.
+// INPUT: "quint32 crc" is the CRC-32 of the contents so far.
+// "const char * data" and "qint64 size" are the contents that follow.
+// OUTPUT: The function returns the CRC-32 of all contents.
+// NOTE: This is a non-member function.
+//=============================================================================
+static quint32 updateCrc(quint32 crc, const char * data, qint64 size)
+{
+    static const CrcTable table;
+    const uchar * bytes = reinterpret_cast<const uchar *>(data);
+    crc = ~crc;
+    for (qint64 i = 0; i < size; ++i)
+        crc = table.remainders[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+
+// Constructor.
+ZipWriter::ZipWriter(QIODevice * device)
+    : m_device(device), m_entries(), m_isInEntry(false), m_position(0), m_dosTime(0), m_dosDate(0),
+      m_errorMessage()
+{
+    // All entries are stamped with the time the archive is written.
+    const QDateTime now = QDateTime::currentDateTime();
+    const QDate date = now.date();
+    const QTime time = now.time();
+    m_dosTime = static_cast<quint16>((time.hour() << 11) | (time.minute() << 5) | (time.second() / 2));
+    m_dosDate = static_cast<quint16>(((qMax(date.year(), 1980) - 1980) << 9) | (date.month() << 5) | date.day());
+}
+
+
+//=============================================================================
+// The function "addEntry" writes an entry whose contents are at hand.
+// INPUT: "const QString & name" is the name of the entry within the archive.
+// "const QByteArray & contents" are the contents of the entry.
+// OUTPUT: The function returns "false" if writing failed and "true"
+// otherwise.
+//=============================================================================
+bool ZipWriter::addEntry(const QString & name, const QByteArray & contents)
+{
+    if (hasError() == true)
+        return false;
+    if (m_isInEntry == true)
+        return fail("An entry is added while another one is being written.");
+
+    ZipEntry entry;
+    entry.name = name.toUtf8();
+    entry.crc = updateCrc(0, contents.constData(), contents.size());
+    entry.size = contents.size();
+    entry.headerOffset = m_position;
+    entry.hasZip64Header = (entry.size >= s_max32);
+    if ((writeLocalHeader(entry) == false) || (writeRaw(contents.constData(), contents.size()) == false))
+        return false;
+    m_entries.push_back(entry);
+    return true;
+}
+
+
+//=============================================================================
+// The function "beginEntry" starts an entry whose contents are written in
+// pieces. Its header is written with 64-bit sizes to be filled in once the
+// entry is complete, since the size is not known yet.
+// INPUT: "const QString & name" is the name of the entry within the archive.
+// OUTPUT: The function returns "false" if writing failed and "true"
+// otherwise.
+//=============================================================================
+bool ZipWriter::beginEntry(const QString & name)
+{
+    if (hasError() == true)
+        return false;
+    if (m_isInEntry == true)
+        return fail("An entry is begun while another one is being written.");
+
+    ZipEntry entry;
+    entry.name = name.toUtf8();
+    entry.crc = 0;
+    entry.size = 0;
+    entry.headerOffset = m_position;
+    entry.hasZip64Header = true;
+    if (writeLocalHeader(entry) == false)
+        return false;
+    m_entries.push_back(entry);
+    m_isInEntry = true;
+    return true;
+}
+
+
+//=============================================================================
+// The function "write" writes a piece of the entry being written.
+// INPUT: "const char * data" and "qint64 size" are the piece.
+// OUTPUT: The function returns "false" if writing failed and "true"
+// otherwise.
+//=============================================================================
+bool ZipWriter::write(const char * data, qint64 size)
+{
+    if (hasError() == true)
+        return false;
+    if (m_isInEntry == false)
+        return fail("The contents are written outside of an entry.");
+
+    ZipEntry & entry = m_entries.back();
+    entry.crc = updateCrc(entry.crc, data, size);
+    entry.size += size;
+    return writeRaw(data, size);
+}
+
+
+//=============================================================================
+// The function "endEntry" completes the entry being written, filling in the
+// size and CRC-32 of its contents in its header.
+// OUTPUT: The function returns "false" if writing failed and "true"
+// otherwise.
+//=============================================================================
+bool ZipWriter::endEntry()
+{
+    if (hasError() == true)
+        return false;
+    if (m_isInEntry == false)
+        return fail("An entry is ended without being begun.");
+    m_isInEntry = false;
+
+    const qint64 endPosition = m_position;
+    if (m_device->seek(m_entries.back().headerOffset) == false)
+        return fail("Could not fill in the header of an entry: " + m_device->errorString());
+    m_position = m_entries.back().headerOffset;
+    if (writeLocalHeader(m_entries.back()) == false)
+        return false;
+    if (m_device->seek(endPosition) == false)
+        return fail("Could not fill in the header of an entry: " + m_device->errorString());
+    m_position = endPosition;
+    return true;
+}
+
+
+//=============================================================================
+// The function "finish" writes the central directory listing all entries,
+// followed by the end records.
+// OUTPUT: The function returns "false" if writing failed and "true"
+// otherwise.
+//=============================================================================
+bool ZipWriter::finish()
+{
+    if (hasError() == true)
+        return false;
+    if (m_isInEntry == true)
+        return fail("The archive is finished while an entry is being written.");
+
+    // Write the central directory.
+    const qint64 directoryOffset = m_position;
+    for (auto cit = m_entries.cbegin(); cit != m_entries.cend(); ++cit)
+    {
+        // Whatever does not fit in its field is moved to the 64-bit extension.
+        // The sizes of an entry whose local header has the extension are moved
+        // there as well, so that both records agree.
+        QByteArray extra;
+        if (cit->hasZip64Header == true)
+        {
+            appendLittleEndian<quint64>(extra, cit->size);
+            appendLittleEndian<quint64>(extra, cit->size);
+        }
+        if (cit->headerOffset >= s_max32)
+            appendLittleEndian<quint64>(extra, cit->headerOffset);
+        if (extra.isEmpty() == false)
+        {
+            QByteArray field;
+            appendLittleEndian<quint16>(field, 0x0001);
+            appendLittleEndian<quint16>(field, static_cast<quint16>(extra.size()));
+            extra.prepend(field);
+        }
+        const bool isZip64 = (cit->hasZip64Header == true) || (extra.isEmpty() == false);
+        const quint32 size = (cit->hasZip64Header == true) ? quint32(s_max32) : static_cast<quint32>(cit->size);
+
+        QByteArray header;
+        appendLittleEndian<quint32>(header, 0x02014b50);
+        appendLittleEndian<quint16>(header, s_versionZip64);
+        appendLittleEndian<quint16>(header, (isZip64 == true) ? s_versionZip64 : s_versionStored);
+        appendLittleEndian<quint16>(header, s_utf8NamesFlag);
+        appendLittleEndian<quint16>(header, 0);   // stored
+        appendLittleEndian<quint16>(header, m_dosTime);
+        appendLittleEndian<quint16>(header, m_dosDate);
+        appendLittleEndian<quint32>(header, cit->crc);
+        appendLittleEndian<quint32>(header, size);
+        appendLittleEndian<quint32>(header, size);
+        appendLittleEndian<quint16>(header, static_cast<quint16>(cit->name.size()));
+        appendLittleEndian<quint16>(header, static_cast<quint16>(extra.size()));
+        appendLittleEndian<quint16>(header, 0);   // comment length
+        appendLittleEndian<quint16>(header, 0);   // disk number
+        appendLittleEndian<quint16>(header, 0);   // internal attributes
+        appendLittleEndian<quint32>(header, 0);   // external attributes
+        appendLittleEndian<quint32>(header, static_cast<quint32>(qMin(cit->headerOffset, s_max32)));
+        header.append(cit->name);
+        header.append(extra);
+        if (writeRaw(header.constData(), header.size()) == false)
+            return false;
+    }
+    const qint64 directorySize = m_position - directoryOffset;
+    const qint64 numEntries = static_cast<qint64>(m_entries.size());
+
+    // An archive that outgrows the end record gets the 64-bit one as well.
+    QByteArray end;
+    if ((numEntries >= s_max16) || (directorySize >= s_max32) || (directoryOffset >= s_max32))
+    {
+        const qint64 zip64EndOffset = m_position;
+        appendLittleEndian<quint32>(end, 0x06064b50);
+        appendLittleEndian<quint64>(end, 44);   // size of the rest of the record
+        appendLittleEndian<quint16>(end, s_versionZip64);
+        appendLittleEndian<quint16>(end, s_versionZip64);
+        appendLittleEndian<quint32>(end, 0);    // disk number
+        appendLittleEndian<quint32>(end, 0);    // disk of the central directory
+        appendLittleEndian<quint64>(end, numEntries);
+        appendLittleEndian<quint64>(end, numEntries);
+        appendLittleEndian<quint64>(end, directorySize);
+        appendLittleEndian<quint64>(end, directoryOffset);
+        appendLittleEndian<quint32>(end, 0x07064b50);
+        appendLittleEndian<quint32>(end, 0);    // disk of the 64-bit end record
+        appendLittleEndian<quint64>(end, zip64EndOffset);
+        appendLittleEndian<quint32>(end, 1);    // number of disks
+    }
+    appendLittleEndian<quint32>(end, 0x06054b50);
+    appendLittleEndian<quint16>(end, 0);        // disk number
+    appendLittleEndian<quint16>(end, 0);        // disk of the central directory
+    appendLittleEndian<quint16>(end, static_cast<quint16>(qMin(numEntries, s_max16)));
+    appendLittleEndian<quint16>(end, static_cast<quint16>(qMin(numEntries, s_max16)));
+    appendLittleEndian<quint32>(end, static_cast<quint32>(qMin(directorySize, s_max32)));
+    appendLittleEndian<quint32>(end, static_cast<quint32>(qMin(directoryOffset, s_max32)));
+    appendLittleEndian<quint16>(end, 0);        // comment length
+    return writeRaw(end.constData(), end.size());
+}
+
+
+//=============================================================================
+// The function "writeLocalHeader" writes the header preceding the contents
+// of an entry. An entry written in pieces gets a 64-bit extension holding the
+// sizes, so that the header keeps its length when it is filled in. With the
+// extension, the 32-bit size fields are set to 0xFFFFFFFF as required.
+// INPUT: "const ZipEntry & entry" is the entry.
+// OUTPUT: The function returns "false" if writing failed and "true"
+// otherwise.
+//=============================================================================
+bool ZipWriter::writeLocalHeader(const ZipEntry & entry)
+{
+    const quint32 size = (entry.hasZip64Header == true) ? quint32(s_max32) : static_cast<quint32>(entry.size);
+    QByteArray header;
+    appendLittleEndian<quint32>(header, 0x04034b50);
+    appendLittleEndian<quint16>(header, (entry.hasZip64Header == true) ? s_versionZip64 : s_versionStored);
+    appendLittleEndian<quint16>(header, s_utf8NamesFlag);
+    appendLittleEndian<quint16>(header, 0);   // stored
+    appendLittleEndian<quint16>(header, m_dosTime);
+    appendLittleEndian<quint16>(header, m_dosDate);
+    appendLittleEndian<quint32>(header, entry.crc);
+    appendLittleEndian<quint32>(header, size);
+    appendLittleEndian<quint32>(header, size);
+    appendLittleEndian<quint16>(header, static_cast<quint16>(entry.name.size()));
+    appendLittleEndian<quint16>(header, (entry.hasZip64Header == true) ? 20 : 0);
+    header.append(entry.name);
+    if (entry.hasZip64Header == true)
+    {
+        appendLittleEndian<quint16>(header, 0x0001);
+        appendLittleEndian<quint16>(header, 16);
+        appendLittleEndian<quint64>(header, entry.size);
+        appendLittleEndian<quint64>(header, entry.size);
+    }
+    return writeRaw(header.constData(), header.size());
+}
+
+
+//=============================================================================
+// The function "writeRaw" writes bytes to the device as they are.
+// INPUT: "const char * data" and "qint64 size" are the bytes.
+// OUTPUT: The function returns "false" if writing failed and "true"
+// otherwise.
+//=============================================================================
+bool ZipWriter::writeRaw(const char * data, qint64 size)
+{
+    if (m_device->write(data, size) != size)
+        return fail("Could not write the archive: " + m_device->errorString());
+    m_position += size;
+    return true;
+}
+
+
+//=============================================================================
+// The function "fail" records the description of a failure unless one has
+// already been recorded.
+// INPUT: "const QString & message" describes the failure.
+// OUTPUT: The function returns "false" for convenience.
+//=============================================================================
+bool ZipWriter::fail(const QString & message)
+{
+    if (m_errorMessage.isEmpty() == true)
+        m_errorMessage = message;
+    return false;
+}
@@ -0,0 +1,73 @@
+//=============================================================================
+// This file is part of Simple3D
+//
+// (c) Copyright 2014-2015 Borislav Karaivanov. All rights reserved.
+//
+// The code is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+//=============================================================================
+
+#ifndef ZIP_WRITER_HEADER
+#define ZIP_WRITER_HEADER
+
+#include <QByteArray>
+#include <QString>
+#include <vector>
+
+class QIODevice;
+
+//=============================================================================
+// This class describes an entry of a zip archive once written.
+//=============================================================================
+struct ZipEntry
+{
+    QByteArray name;       // name of the entry, in UTF-8
+    quint32 crc;           // CRC-32 of the contents
+    qint64 size;           // size of the contents
+    qint64 headerOffset;   // offset of the local header in the archive
+    bool hasZip64Header;   // indicates if the local header holds 64-bit sizes
+};
+
+//=============================================================================
+// This class writes a zip archive sequentially to a device. The entries are
+// stored, i.e., not compressed, so that no compression library is needed to
+// read them, and the 64-bit extensions are used as soon as an entry or the
+// archive outgrows the 32-bit fields. An entry may be written in pieces, in
+// which case the device must support seeking back to fill in its header.
+//=============================================================================
+class ZipWriter
+{
+public:
+    explicit ZipWriter(QIODevice * device);
+
+    // Write an entry whose contents are at hand.
+    bool addEntry(const QString & name, const QByteArray & contents);
+
+    // Write an entry in pieces.
+    bool beginEntry(const QString & name);
+    bool write(const char * data, qint64 size);
+    bool endEntry();
+
+    // Write the central directory once all entries are written.
+    bool finish();
+
+    // Accessors.
+    bool hasError() const { return m_errorMessage.isEmpty() == false; }
+    const QString & errorMessage() const { return m_errorMessage; }
+
+private:
+    bool writeLocalHeader(const ZipEntry & entry);
+    bool writeRaw(const char * data, qint64 size);
+    bool fail(const QString & message);
+
+private:
+    QIODevice * m_device;              // device to write to
+    std::vector<ZipEntry> m_entries;   // entries written so far
+    bool m_isInEntry;                  // indicates if an entry is being written in pieces
+    qint64 m_position;                 // number of bytes written to the device
+    quint16 m_dosTime;                 // modification time of the entries, in MS-DOS format
+    quint16 m_dosDate;                 // modification date of the entries, in MS-DOS format
+    QString m_errorMessage;            // description of a failure, if any
+};
+
+#endif // ZIP_WRITER_HEADER